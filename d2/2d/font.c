@@ -582,6 +582,74 @@ void ogl_font_choose_size(grs_font * font,int gap,int *rw,int *rh){
 		Error("couldn't fit font?\n");
 }
 
+/*
+ * Layouts of the last strings drawn, so a string that is drawn again the same way (most of the HUD, the menus
+ * and the scoreboards, every frame) skips the width, kerning and color code work and goes straight to the
+ * glyph batch.  A layout depends on everything that is part of the key; the canvas offset and the palette are
+ * applied when it is drawn.
+ */
+#define OGL_LAYOUT_CACHE_SIZE	128	// direct mapped, by string and position
+#define OGL_LAYOUT_MAX_LEN	96	// longer strings are not cached
+
+typedef struct ogl_layout_glyph {
+	short	x, y, w, h;
+	short	color;			// palette index, or -1 for color fonts
+	ubyte	letter;
+} ogl_layout_glyph;
+
+typedef struct ogl_layout {
+	grs_font	*font;
+	int		x, y, canvas_w, fg_color, color_level;
+	float		scale_x, scale_y;
+	int		end_fg_color;	// cv_font_fg_color after the color codes in the string
+	int		num_glyphs;
+	char		text[OGL_LAYOUT_MAX_LEN];
+	ogl_layout_glyph glyphs[OGL_LAYOUT_MAX_LEN];
+} ogl_layout;
+
+static ogl_layout Ogl_layouts[OGL_LAYOUT_CACHE_SIZE];
+
+static void ogl_forget_font_layouts(grs_font *font)
+{
+	int i;
+
+	for (i=0; i<OGL_LAYOUT_CACHE_SIZE; i++)
+		if (Ogl_layouts[i].font == font)
+			Ogl_layouts[i].font = NULL;
+}
+
+static ogl_layout *ogl_find_layout(int x, int y, const char *s, int len)
+{
+	unsigned h = 2166136261u;
+	ogl_layout *l;
+	int i;
+
+	for (i=0; i<len; i++)
+		h = (h ^ (unsigned char)s[i]) * 16777619u;
+	h = (h ^ x) * 16777619u;
+	h = (h ^ y) * 16777619u;
+
+	l = &Ogl_layouts[h % OGL_LAYOUT_CACHE_SIZE];
+	if (l->font == grd_curcanv->cv_font && l->x == x && l->y == y &&
+		l->canvas_w == grd_curcanv->cv_bitmap.bm_w && l->fg_color == grd_curcanv->cv_font_fg_color &&
+		l->color_level == gr_message_color_level && l->scale_x == FNTScaleX && l->scale_y == FNTScaleY &&
+		!strcmp(l->text, s))
+		return l;
+
+	// not there, set up the slot to be filled in
+	l->font = NULL;
+	l->x = x;
+	l->y = y;
+	l->canvas_w = grd_curcanv->cv_bitmap.bm_w;
+	l->fg_color = grd_curcanv->cv_font_fg_color;
+	l->color_level = gr_message_color_level;
+	l->scale_x = FNTScaleX;
+	l->scale_y = FNTScaleY;
+	l->num_glyphs = 0;
+	strcpy(l->text, s);
+	return l;
+}
+
 void ogl_init_font(grs_font * font)
 {
 	int oglflags = OGL_FLAG_ALPHA;
@@ -591,6 +659,7 @@ void ogl_init_font(grs_font * font)
 	ubyte *data;
 	int gap=1; // x/y offset between the chars so we can filter
 
+	ogl_forget_font_layouts(font);
 	ogl_font_choose_size(font,gap,&tw,&th);
 	MALLOC(data, ubyte, tw*th);
 	memset(data, TRANSPARENCY_COLOR, tw * th); // map the whole data with transparency so we won't have borders if using gap
@@ -687,6 +756,19 @@ void ogl_init_font(grs_font * font)
 	ogl_loadbmtexture_f(&font->ft_parent_bitmap, GameCfg.TexFilt);
 }
 
+static void ogl_draw_layout(ogl_layout *l)
+{
+	int i;
+
+	for (i=0; i<l->num_glyphs; i++) {
+		ogl_layout_glyph *g = &l->glyphs[i];
+
+		ogl_queue_glyph(g->x, g->y, g->w, g->h, &l->font->ft_bitmaps[g->letter], g->color);
+	}
+	ogl_flush_glyphs();
+	grd_curcanv->cv_font_fg_color = l->end_fg_color;
+}
+
 int ogl_internal_string(int x, int y, const char *s )
 {
 	const char * text_ptr, * next_row, * text_ptr1;
@@ -694,13 +776,24 @@ int ogl_internal_string(int x, int y, const char *s )
 	int xx,yy;
 	int orig_color=grd_curcanv->cv_font_fg_color;//to allow easy reseting to default string color with colored strings -MPM
 	int underline;
+	int len = strlen(s);
+	ogl_layout *layout = NULL;
+
+	if (grd_curscreen->sc_canvas.cv_bitmap.bm_type != BM_OGL)
+		Error("carp.\n");
+
+	if (len < OGL_LAYOUT_MAX_LEN) {
+		layout = ogl_find_layout(x, y, s, len);
+		if (layout->font) {
+			ogl_draw_layout(layout);
+			return 0;
+		}
+	}
 
 	next_row = s;
 
 	yy = y;
 
-	if (grd_curscreen->sc_canvas.cv_bitmap.bm_type != BM_OGL)
-		Error("carp.\n");
 	while (next_row != NULL)
 	{
 		text_ptr1 = next_row;
@@ -715,7 +808,7 @@ int ogl_internal_string(int x, int y, const char *s )
 
 		while (*text_ptr)
 		{
-			int ft_w;
+			int ft_w, dw, dh, color;
 
 			if (*text_ptr == '\n' )
 			{
@@ -740,9 +833,11 @@ int ogl_internal_string(int x, int y, const char *s )
 				{
 					ubyte save_c = (unsigned char) COLOR;
 					
+					ogl_flush_glyphs();
 					gr_setcolor(grd_curcanv->cv_font_fg_color);
 					gr_rect(xx, yy + grd_curcanv->cv_font->ft_baseline + 2, xx + grd_curcanv->cv_font->ft_w, yy + grd_curcanv->cv_font->ft_baseline + 3);
 					gr_setcolor(save_c);
+					layout = NULL;	// not worth caching
 				}
 
 				continue;
@@ -753,13 +848,27 @@ int ogl_internal_string(int x, int y, const char *s )
 			else
 				ft_w = grd_curcanv->cv_font->ft_w;
 
-			if (grd_curcanv->cv_font->ft_flags&FT_COLOR)
-				ogl_ubitmapm_cs(xx,yy,FONTSCALE_X(ft_w),FONTSCALE_Y(grd_curcanv->cv_font->ft_h),&grd_curcanv->cv_font->ft_bitmaps[letter],-1,F1_0);
-			else{
-				if (grd_curcanv->cv_bitmap.bm_type==BM_OGL)
-					ogl_ubitmapm_cs(xx,yy,ft_w*(FONTSCALE_X(grd_curcanv->cv_font->ft_w)/grd_curcanv->cv_font->ft_w),FONTSCALE_Y(grd_curcanv->cv_font->ft_h),&grd_curcanv->cv_font->ft_bitmaps[letter],grd_curcanv->cv_font_fg_color,F1_0);
-				else
+			dh = FONTSCALE_Y(grd_curcanv->cv_font->ft_h);
+			if (grd_curcanv->cv_font->ft_flags&FT_COLOR) {
+				dw = FONTSCALE_X(ft_w);
+				color = -1;
+			} else {
+				if (grd_curcanv->cv_bitmap.bm_type!=BM_OGL)
 					Error("ogl_internal_string: non-color string to non-ogl dest\n");
+				dw = ft_w*(FONTSCALE_X(grd_curcanv->cv_font->ft_w)/grd_curcanv->cv_font->ft_w);
+				color = grd_curcanv->cv_font_fg_color;
+			}
+
+			ogl_queue_glyph(xx,yy,dw,dh,&grd_curcanv->cv_font->ft_bitmaps[letter],color);
+			if (layout) {
+				ogl_layout_glyph *g = &layout->glyphs[layout->num_glyphs++];
+
+				g->x = xx;
+				g->y = yy;
+				g->w = dw;
+				g->h = dh;
+				g->color = color;
+				g->letter = letter;
 			}
 
 			xx += spacing;
@@ -768,6 +877,12 @@ int ogl_internal_string(int x, int y, const char *s )
 		}
 
 	}
+	ogl_flush_glyphs();
+
+	if (layout) {
+		layout->end_fg_color = grd_curcanv->cv_font_fg_color;
+		layout->font = grd_curcanv->cv_font;
+	}
 	return 0;
 }
 
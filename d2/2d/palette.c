@@ -37,6 +37,7 @@ extern int gr_installed;
 #define	MAX_COMPUTED_COLORS	32
 
 int	Num_computed_colors=0;
+int	gr_palette_generation=0;
 
 typedef struct {
 	ubyte	r,g,b,color_num;
@@ -74,6 +75,7 @@ void gr_copy_palette(ubyte *gr_palette, ubyte *pal, int size)
 	        memcpy(gr_palette, pal, size);
 
 	        Num_computed_colors = 0;
+	        gr_palette_generation++;
 }
 
 
@@ -113,6 +115,7 @@ void gr_use_palette_table( char * filename )
 	}
 
 	Num_computed_colors = 0;	//	Flush palette cache.
+	gr_palette_generation++;
 // swap colors 0 and 255 of the palette along with fade table entries
 
 #ifdef SWAP_0_255
@@ -319,8 +319,6 @@ int gr_bitmap_rle_compress( grs_bitmap * bmp )
 	return 1;
 }
 
-#define MAX_CACHE_BITMAPS 32
-
 typedef struct rle_cache_element {
 	grs_bitmap * rle_bitmap;
 	ubyte * rle_data;
@@ -90,6 +90,8 @@ bool g3_draw_line(const g3s_point *p0,const g3s_point *p1)
 	if (p1->p3_flags&PF_OVERFLOW)
 		return must_clip_line(p0,p1,codes_or);
 
+	tmap_bin_flush();		//queued polygons have to be drawn first
+
 	return (bool) (*line_drawer_ptr)(p0->p3_sx,p0->p3_sy,p1->p3_sx,p1->p3_sy);
 }
 #endif
@@ -340,6 +342,8 @@ int checkmuldiv(fix *r,fix a,fix b,fix c);
 //radius, but not to the distance from the eye
 int g3_draw_sphere(g3s_point *pnt,fix rad)
 {
+	tmap_bin_flush();		//queued polygons have to be drawn first
+
 	if (! (pnt->p3_codes & CC_BEHIND)) {
 
 		if (! (pnt->p3_flags & PF_PROJECTED))
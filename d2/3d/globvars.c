@@ -22,6 +22,7 @@ COPYRIGHT 1993-1998 PARALLAX SOFTWARE CORPORATION.  ALL RIGHTS RESERVED.
 
 vms_vector	View_position;
 fix			View_zoom;
+int			View_set;			//a g3_set_view_*() since g3_start_frame()
 
 vms_matrix	Unscaled_matrix;	//before scaling
 vms_matrix	View_matrix;
@@ -32,6 +32,7 @@ extern vms_vector Window_scale;
 extern int free_point_num;
 
 extern fix View_zoom;
+extern int View_set;
 extern vms_vector View_position,Matrix_scale;
 extern vms_matrix View_matrix,Unscaled_matrix;
 
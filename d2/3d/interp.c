@@ -18,6 +18,7 @@ COPYRIGHT 1993-1998 PARALLAX SOFTWARE CORPORATION.  ALL RIGHTS RESERVED.
  */
 
 #include <stdlib.h>
+#include <string.h>
 #include "dxxerror.h"
 
 #include "interp.h"
@@ -58,10 +59,32 @@ void g3_set_interp_points(g3s_point *pointlist)
 #define fp(p)  ((fix *) (p))
 #define vp(p)  ((vms_vector *) (p))
 
+#define ROTATE_BATCH 64
+
+//same as calling g3_rotate_point() for each point, but rotates them in
+//batches with vm_vec_rotate_n()
 void rotate_point_list(g3s_point *dest,vms_vector *src,int n)
 {
-	while (n--)
-		g3_rotate_point(dest++,src++);
+	vms_vector tempv[ROTATE_BATCH],rotv[ROTATE_BATCH];
+
+	while (n > 0) {
+		int i,cnt = n < ROTATE_BATCH ? n : ROTATE_BATCH;
+
+		for (i=0;i<cnt;i++)
+			vm_vec_sub(&tempv[i],&src[i],&View_position);
+
+		vm_vec_rotate_n(rotv,tempv,cnt,&View_matrix);
+
+		for (i=0;i<cnt;i++) {
+			dest[i].p3_vec = rotv[i];
+			dest[i].p3_flags = 0;	//no projected
+			g3_code_point(&dest[i]);
+		}
+
+		dest += cnt;
+		src += cnt;
+		n -= cnt;
+	}
 }
 
 static const vms_angvec zero_angles = {0,0,0};
@@ -550,6 +573,343 @@ bool g3_draw_polygon_model(ubyte *p,grs_bitmap **model_bitmaps,vms_angvec *anim_
 	return 1;
 }
 
+//draw one list of a compiled model.  does the same as g3_draw_polygon_model()
+//on the bytecode the list came from
+static void g3_draw_model_cmds(g3s_model_list *ml,int c,grs_bitmap **model_bitmaps,vms_angvec *anim_angles,g3s_lrgb model_light,fix *glow_values)
+{
+	const g3s_model_cmd *cmd;
+
+	glow_num = -1;		//glow off by default
+
+	for (cmd=&ml->cmds[c]; cmd->op != OP_EOF; cmd++)
+
+		switch (cmd->op) {
+
+			case OP_DEFPOINTS:
+				rotate_point_list(Interp_point_list,&ml->vecs[cmd->vec],cmd->n);
+				break;
+
+			case OP_DEFP_START:
+				rotate_point_list(&Interp_point_list[cmd->num],&ml->vecs[cmd->vec],cmd->n);
+				break;
+
+			case OP_FLATPOLY:
+
+				if (g3_check_normal_facing(&ml->vecs[cmd->vec],&ml->vecs[cmd->vec+1]) > 0) {
+					const short *indices = &ml->indices[cmd->first];
+					int i;
+#ifdef FADE_FLATPOLY
+					int l;
+
+					l = f2i(fixmul(i2f(32), (model_light.r+model_light.g+model_light.b)/3));
+					if (l<0) l = 0;
+					else if (l>32) l = 32;
+					gr_setcolor(gr_fade_table[(l<<8)|cmd->color]);
+#else
+					gr_setcolor(cmd->color);
+#endif
+
+					for (i=0;i<cmd->n;i++)
+						point_list[i] = Interp_point_list + indices[i];
+
+					g3_draw_poly(cmd->n,point_list);
+				}
+				break;
+
+			case OP_TMAPPOLY:
+
+				if (g3_check_normal_facing(&ml->vecs[cmd->vec],&ml->vecs[cmd->vec+1]) > 0) {
+					const short *indices = &ml->indices[cmd->first];
+					g3s_uvl *uvl_list = (g3s_uvl *) (ml->model_ptr + cmd->second);
+					g3s_lrgb light, lrgb_list[MAX_POINTS_PER_POLY];
+					int i;
+
+					//calculate light from surface normal
+					if (glow_num < 0) //no glow
+					{
+						light.r = light.g = light.b = -vm_vec_dot(&View_matrix.fvec,&ml->vecs[cmd->vec+1]);
+						light.r = f1_0/4 + (light.r*3)/4;
+						light.r = fixmul(light.r,model_light.r);
+						light.g = f1_0/4 + (light.g*3)/4;
+						light.g = fixmul(light.g,model_light.g);
+						light.b = f1_0/4 + (light.b*3)/4;
+						light.b = fixmul(light.b,model_light.b);
+					}
+					else //yes glow
+					{
+						light.r = light.g = light.b = glow_values[glow_num];
+						glow_num = -1;
+					}
+
+					//now poke light into l values
+					for (i=0;i<cmd->n;i++)
+					{
+						uvl_list[i].l = (light.r+light.g+light.b)/3;
+						lrgb_list[i] = light;
+						point_list[i] = Interp_point_list + indices[i];
+					}
+
+					g3_draw_tmap(cmd->n,point_list,uvl_list,lrgb_list,model_bitmaps[cmd->num]);
+				}
+				break;
+
+			case OP_SORTNORM:
+
+				if (g3_check_normal_facing(&ml->vecs[cmd->vec],&ml->vecs[cmd->vec+1]) > 0) {		//facing
+
+					//draw back then front
+
+					g3_draw_model_cmds(ml,cmd->second,model_bitmaps,anim_angles,model_light,glow_values);
+					g3_draw_model_cmds(ml,cmd->first,model_bitmaps,anim_angles,model_light,glow_values);
+
+				}
+				else {			//not facing.  draw front then back
+
+					g3_draw_model_cmds(ml,cmd->first,model_bitmaps,anim_angles,model_light,glow_values);
+					g3_draw_model_cmds(ml,cmd->second,model_bitmaps,anim_angles,model_light,glow_values);
+				}
+				break;
+
+			case OP_RODBM: {
+				g3s_point rod_bot_p,rod_top_p;
+				g3s_lrgb rodbm_light = { f1_0, f1_0, f1_0 };
+
+				g3_rotate_point(&rod_bot_p,&ml->vecs[cmd->vec]);
+				g3_rotate_point(&rod_top_p,&ml->vecs[cmd->vec+1]);
+
+				g3_draw_rod_tmap(model_bitmaps[cmd->num],&rod_bot_p,cmd->first,&rod_top_p,cmd->second,rodbm_light);
+				break;
+			}
+
+			case OP_SUBCALL:
+
+				g3_start_instance_angles(&ml->vecs[cmd->vec],anim_angles?&anim_angles[cmd->num]:&zero_angles);
+
+				g3_draw_model_cmds(ml,cmd->first,model_bitmaps,anim_angles,model_light,glow_values);
+
+				g3_done_instance();
+				break;
+
+			case OP_GLOW:
+
+				if (glow_values)
+					glow_num = cmd->num;
+				break;
+		}
+}
+
+bool g3_draw_compiled_model(g3s_model_list *ml,int offset,grs_bitmap **model_bitmaps,vms_angvec *anim_angles,g3s_lrgb light,fix *glow_values)
+{
+	int i;
+
+	for (i=0; i<ml->n_lists; i++)
+		if (ml->list_offsets[i] == offset)
+			break;
+	if (i == ml->n_lists)
+		return 0;
+
+	//find the colors of the flat polygons again once the palette changed
+	if (ml->palette_generation != gr_palette_generation) {
+		int c;
+
+		for (c=0; c<ml->n_cmds; c++)
+			if (ml->cmds[c].op == OP_FLATPOLY)
+				ml->cmds[c].color = gr_find_closest_color_15bpp(ml->cmds[c].num);
+		ml->palette_generation = gr_palette_generation;
+	}
+
+	g3_draw_model_cmds(ml,ml->list_cmds[i],model_bitmaps,anim_angles,light,glow_values);
+
+	return 1;
+}
+
+static int Compile_max_cmds, Compile_max_vecs, Compile_max_indices, Compile_max_lists;
+
+static int compile_new_cmd(g3s_model_list *ml,int op)
+{
+	if (ml->n_cmds >= Compile_max_cmds) {
+		Compile_max_cmds = Compile_max_cmds ? Compile_max_cmds * 2 : 64;
+		ml->cmds = d_realloc(ml->cmds, Compile_max_cmds * sizeof(g3s_model_cmd));
+	}
+
+	memset(&ml->cmds[ml->n_cmds], 0, sizeof(g3s_model_cmd));
+	ml->cmds[ml->n_cmds].op = op;
+
+	return ml->n_cmds++;
+}
+
+static int compile_add_vecs(g3s_model_list *ml,const vms_vector *v,int n)
+{
+	int first = ml->n_vecs;
+
+	while (ml->n_vecs + n > Compile_max_vecs) {
+		Compile_max_vecs = Compile_max_vecs ? Compile_max_vecs * 2 : 256;
+		ml->vecs = d_realloc(ml->vecs, Compile_max_vecs * sizeof(vms_vector));
+	}
+
+	memcpy(&ml->vecs[first], v, n * sizeof(vms_vector));
+	ml->n_vecs += n;
+
+	return first;
+}
+
+static int compile_add_indices(g3s_model_list *ml,const short *indices,int n)
+{
+	int first = ml->n_indices;
+
+	while (ml->n_indices + n > Compile_max_indices) {
+		Compile_max_indices = Compile_max_indices ? Compile_max_indices * 2 : 256;
+		ml->indices = d_realloc(ml->indices, Compile_max_indices * sizeof(short));
+	}
+
+	memcpy(&ml->indices[first], indices, n * sizeof(short));
+	ml->n_indices += n;
+
+	return first;
+}
+
+//compile the list at offset in the bytecode, unless that was done already,
+//and return its first command
+static int compile_model_list(g3s_model_list *ml,int offset)
+{
+	ubyte *p = ml->model_ptr + offset;
+	int i,c,start;
+
+	for (i=0; i<ml->n_lists; i++)
+		if (ml->list_offsets[i] == offset)
+			return ml->list_cmds[i];
+
+	if (ml->n_lists >= Compile_max_lists) {
+		Compile_max_lists = Compile_max_lists ? Compile_max_lists * 2 : 16;
+		ml->list_offsets = d_realloc(ml->list_offsets, Compile_max_lists * sizeof(int));
+		ml->list_cmds = d_realloc(ml->list_cmds, Compile_max_lists * sizeof(int));
+	}
+	start = ml->n_cmds;
+	ml->list_offsets[ml->n_lists] = offset;
+	ml->list_cmds[ml->n_lists] = start;
+	ml->n_lists++;
+
+	while (w(p) != OP_EOF) {
+		g3s_model_cmd *cmd;
+
+		c = compile_new_cmd(ml,w(p));
+		cmd = &ml->cmds[c];
+
+		switch (w(p)) {
+
+			case OP_DEFPOINTS:
+				cmd->n = w(p+2);
+				cmd->vec = compile_add_vecs(ml,vp(p+4),cmd->n);
+				p += cmd->n*sizeof(struct vms_vector) + 4;
+				break;
+
+			case OP_DEFP_START:
+				cmd->n = w(p+2);
+				cmd->num = w(p+4);
+				cmd->vec = compile_add_vecs(ml,vp(p+8),cmd->n);
+				p += cmd->n*sizeof(struct vms_vector) + 8;
+				break;
+
+			case OP_FLATPOLY:
+			case OP_TMAPPOLY:
+				cmd->n = w(p+2);
+				Assert( cmd->n < MAX_POINTS_PER_POLY );
+				cmd->num = w(p+28);
+				cmd->vec = compile_add_vecs(ml,vp(p+4),1);
+				compile_add_vecs(ml,vp(p+16),1);
+				cmd->first = compile_add_indices(ml,wp(p+30),cmd->n);
+				if (cmd->op == OP_TMAPPOLY) {
+					cmd->second = (p+30+((cmd->n&~1)+1)*2) - ml->model_ptr;
+					p += 30 + ((cmd->n&~1)+1)*2 + cmd->n*12;
+				}
+				else
+					p += 30 + ((cmd->n&~1)+1)*2;
+				break;
+
+			case OP_SORTNORM:
+				cmd->vec = compile_add_vecs(ml,vp(p+16),1);
+				compile_add_vecs(ml,vp(p+4),1);
+				cmd->first = (p - ml->model_ptr) + w(p+28);	//offsets until the lists are compiled below
+				cmd->second = (p - ml->model_ptr) + w(p+30);
+				p += 32;
+				break;
+
+			case OP_RODBM:
+				cmd->num = w(p+2);
+				cmd->vec = compile_add_vecs(ml,vp(p+20),1);
+				compile_add_vecs(ml,vp(p+4),1);
+				cmd->first = w(p+16);
+				cmd->second = w(p+32);
+				p += 36;
+				break;
+
+			case OP_SUBCALL:
+				cmd->num = w(p+2);
+				cmd->vec = compile_add_vecs(ml,vp(p+4),1);
+				cmd->first = (p - ml->model_ptr) + w(p+16);
+				p += 20;
+				break;
+
+			case OP_GLOW:
+				cmd->num = w(p+2);
+				p += 4;
+				break;
+
+			default:
+				Error("invalid polygon model\n");
+		}
+	}
+	compile_new_cmd(ml,OP_EOF);
+
+	//now the lists this one calls, after it so it stays in one piece
+	for (c=start; ml->cmds[c].op != OP_EOF; c++) {
+		int first, second;
+
+		if (ml->cmds[c].op == OP_SORTNORM) {
+			first = compile_model_list(ml,ml->cmds[c].first);
+			second = compile_model_list(ml,ml->cmds[c].second);
+			ml->cmds[c].first = first;
+			ml->cmds[c].second = second;
+		}
+		else if (ml->cmds[c].op == OP_SUBCALL) {
+			first = compile_model_list(ml,ml->cmds[c].first);
+			ml->cmds[c].first = first;
+		}
+	}
+
+	return start;
+}
+
+g3s_model_list *g3_compile_polygon_model(ubyte *model_ptr)
+{
+	g3s_model_list *ml;
+
+	MALLOC(ml, g3s_model_list, 1);
+	memset(ml, 0, sizeof(*ml));
+	ml->model_ptr = model_ptr;
+	ml->palette_generation = gr_palette_generation - 1;
+
+	Compile_max_cmds = Compile_max_vecs = Compile_max_indices = Compile_max_lists = 0;
+	compile_model_list(ml,0);
+
+	return ml;
+}
+
+void g3_free_compiled_model(g3s_model_list *ml)
+{
+	if (ml->cmds)
+		d_free(ml->cmds);
+	if (ml->vecs)
+		d_free(ml->vecs);
+	if (ml->indices)
+		d_free(ml->indices);
+	if (ml->list_offsets)
+		d_free(ml->list_offsets);
+	if (ml->list_cmds)
+		d_free(ml->list_cmds);
+	d_free(ml);
+}
+
 #ifndef NDEBUG
 int nest_count;
 #endif
@@ -17,6 +17,8 @@ COPYRIGHT 1993-1998 PARALLAX SOFTWARE CORPORATION.  ALL RIGHTS RESERVED.
  */
  
 
+#include <string.h>
+
 #include "3d.h"
 #include "globvars.h"
 
@@ -31,6 +33,7 @@ void g3_set_view_angles(const vms_vector *view_pos,const vms_angvec *view_orient
 	vm_angles_2_matrix(&View_matrix,view_orient);
 
 	scale_matrix();
+	View_set = 1;
 }
 
 //set view from x,y,z, viewer matrix, and zoom.  Must call one of g3_set_view_*() 
@@ -42,6 +45,17 @@ void g3_set_view_matrix(const vms_vector *view_pos,const vms_matrix *view_matrix
 	View_matrix = *view_matrix;
 
 	scale_matrix();
+	View_set = 1;
+}
+
+int g3_get_view_key(g3s_view_key *key)
+{
+	memset(key,0,sizeof(*key));		//so keys can be compared with memcmp()
+	key->position = View_position;
+	key->matrix = View_matrix;
+	key->canv_w2 = Canv_w2;
+	key->canv_h2 = Canv_h2;
+	return View_set;
 }
 
 //performs aspect scaling on global view matrix
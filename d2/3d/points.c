@@ -60,6 +60,32 @@ ubyte g3_rotate_point(g3s_point *dest,const vms_vector *src)
 
 }
 
+#define ROTATE_BATCH 64
+
+void g3_rotate_points(g3s_point **dest,const vms_vector **src,int n)
+{
+	vms_vector tempv[ROTATE_BATCH],rotv[ROTATE_BATCH];
+
+	while (n > 0) {
+		int i,cnt = n < ROTATE_BATCH ? n : ROTATE_BATCH;
+
+		for (i=0;i<cnt;i++)
+			vm_vec_sub(&tempv[i],src[i],&View_position);
+
+		vm_vec_rotate_n(rotv,tempv,cnt,&View_matrix);
+
+		for (i=0;i<cnt;i++) {
+			dest[i]->p3_vec = rotv[i];
+			dest[i]->p3_flags = 0;	//no projected
+			g3_code_point(dest[i]);
+		}
+
+		dest += cnt;
+		src += cnt;
+		n -= cnt;
+	}
+}
+
 //checks for overflow & divides if ok, fillig in r
 //returns true if div is ok, else false
 int checkmuldiv(fix *r,fix a,fix b,fix c)
@@ -20,6 +20,7 @@ COPYRIGHT 1993-1998 PARALLAX SOFTWARE CORPORATION.  ALL RIGHTS RESERVED.
 #include "3d.h"
 #include "globvars.h"
 #include "fix.h"
+#include "texmap.h"
 
 grs_point blob_vertices[4];
 g3s_point rod_points[4];
@@ -138,6 +139,8 @@ bool g3_draw_bitmap(vms_vector *pos,fix width,fix height,grs_bitmap *bm)
 	g3s_point pnt;
 	fix t,w,h;
 
+	tmap_bin_flush();		//queued polygons have to be drawn first
+
 	if (g3_rotate_point(&pnt,pos) & CC_BEHIND)
 		return 1;
 
@@ -60,6 +60,8 @@ void g3_start_frame(void)
 	
 	Window_scale.z = f1_0;		//always 1
 
+	View_set = 0;
+
 	init_free_points();
 
 #ifdef OGL
@@ -13,6 +13,7 @@ void digi_mixer_end_sound(int);
 int digi_mixer_is_sound_playing(int);
 int digi_mixer_is_channel_playing(int);
 void digi_mixer_reset();
+void digi_mixer_prepare_sounds();
 void digi_set_max_channels(int);
 int digi_get_max_channels();
 void digi_mixer_stop_all_channels();
@@ -15,5 +15,7 @@ void mix_pause_music();
 void mix_resume_music();
 void mix_pause_resume_music();
 void mix_free_music();
+void mix_prefetch_file(char *);
+void mix_free_midi_cache();
 
 #endif
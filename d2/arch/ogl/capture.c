@@ -0,0 +1,437 @@
+/*
+ *
+ * Asynchronous screenshots and frame capture
+ *
+ * The screen is read back into a pixel pack buffer object where the driver
+ * has them, so glReadPixels() returns right away and the pixels are picked
+ * up on a later frame. Converting them and writing them out runs on a
+ * background task, one slot at a time, so captured frames are written in
+ * the order they were read.
+ *
+ */
+
+#include <stdio.h>
+#include <string.h>
+#ifndef _WIN32
+#include <signal.h>
+#endif
+
+#include "ogl_init.h"
+#include "gr.h"
+#include "args.h"
+#include "console.h"
+#include "u_mem.h"
+#include "physfsx.h"
+#include "pngfile.h"
+#include "timer.h"
+#include "worker.h"
+
+#define CAPTURE_SLOTS	4	// frames that can be in flight between the read and the write
+
+#define CAPTURE_FREE	0
+#define CAPTURE_READING	1	// waiting for the pixel pack buffer
+#define CAPTURE_QUEUED	2	// in rgba, waiting for the slot before it to be written
+#define CAPTURE_WRITING	3
+
+typedef struct capture_slot {
+	int		state;
+	int		w, h;
+	int		size;			// bytes allocated for rgba
+	unsigned char	*rgba, *rgb;
+	GLuint		pbo;
+	int		pbo_size;
+	unsigned	frame;			// ogl_capture_frame() call it was read in
+	unsigned	seq;			// order it was read in
+	int		repeat;			// times it is written to the capture stream
+	char		filename[PATH_MAX];	// screenshot file, empty for a frame of the capture stream
+} capture_slot;
+
+typedef struct
+{
+	unsigned char TGAheader[12];
+	unsigned char header[6];
+} TGA_header;
+
+static capture_slot Capture_slots[CAPTURE_SLOTS];
+static capture_slot *Capture_writing = NULL;
+static worker_task *Capture_task = NULL;
+static unsigned Capture_frame_num = 0, Capture_seq = 0;
+static int Capture_use_pbo = -1;	// not checked yet
+
+// continuous capture, started by -gl_capture
+static FILE *Capture_stream = NULL;
+static int Capture_stream_pipe = 0, Capture_stream_failed = 0;
+static int Capture_w, Capture_h;
+static u_int64_t Capture_next_usec;
+
+static int capture_have_pbo(void)
+{
+	if (Capture_use_pbo < 0)
+#ifdef OGLES
+		Capture_use_pbo = 0;
+#else
+		Capture_use_pbo = GLEW_VERSION_2_1 || GLEW_ARB_pixel_buffer_object;
+#endif
+	return Capture_use_pbo;
+}
+
+// Runs on the background task
+static int capture_write_screenshot(capture_slot *s)
+{
+	int w = s->w, h = s->h;
+	#ifdef HAVE_LIBPNG
+	png_data pdata;
+	int x, y;
+
+	for(y = 0; y < h; y++) {
+		int wofs = y * w * 3, rofs = (h - 1 - y) * w * 4;
+		for(x = 0; x < w; x++) {
+			*(s->rgb + wofs + x * 3) = *(s->rgba + rofs + x * 4);
+			*(s->rgb + wofs + x * 3 + 1) = *(s->rgba + rofs + x * 4 + 1);
+			*(s->rgb + wofs + x * 3 + 2) = *(s->rgba + rofs + x * 4 + 2);
+		}
+	}
+
+	memset(&pdata, 0, sizeof(pdata));
+	pdata.width = w;
+	pdata.height = h;
+	pdata.data = s->rgb;
+	pdata.depth = 8;
+
+	return write_png(s->filename, &pdata);
+	#else
+	TGA_header TGA;
+	PHYSFS_File *TGAFile;
+	int pixel;
+
+	for(pixel = 0; pixel < w * h; pixel++) {
+		*(s->rgb + pixel * 3) = *(s->rgba + pixel * 4 + 2);
+		*(s->rgb + pixel * 3 + 1) = *(s->rgba + pixel * 4 + 1);
+		*(s->rgb + pixel * 3 + 2) = *(s->rgba + pixel * 4);
+	}
+
+	if (!(TGAFile = PHYSFSX_openWriteBuffered(s->filename)))
+		return 0;
+
+	// uncompressed RGB
+	memset(&TGA, 0, sizeof(TGA));
+	TGA.TGAheader[2] = 2;
+	TGA.header[0] = w % 256;
+	TGA.header[1] = w / 256;
+	TGA.header[2] = h % 256;
+	TGA.header[3] = h / 256;
+	TGA.header[4] = 24;
+	PHYSFS_write(TGAFile,&TGA,sizeof(TGA_header),1);
+	PHYSFS_write(TGAFile,s->rgb,w*h*3*sizeof(unsigned char),1);
+	return PHYSFS_close(TGAFile);
+	#endif
+}
+
+// Runs on the background task. The stream gets top to bottom RGB24 frames.
+static int capture_write_frame(capture_slot *s)
+{
+	int w = s->w, h = s->h, x, y, i;
+
+	for(y = 0; y < h; y++) {
+		unsigned char *src = s->rgba + (h - 1 - y) * w * 4, *dst = s->rgb + y * w * 3;
+		for(x = 0; x < w; x++, src += 4, dst += 3) {
+			dst[0] = src[0];
+			dst[1] = src[1];
+			dst[2] = src[2];
+		}
+	}
+
+	for (i = 0; i < s->repeat; i++)
+		if (fwrite(s->rgb, w * h * 3, 1, Capture_stream) != 1)
+			return 0;
+	return 1;
+}
+
+static int capture_write(void *data)
+{
+	capture_slot *s = data;
+
+	return s->filename[0] ? capture_write_screenshot(s) : capture_write_frame(s);
+}
+
+static void capture_stop_stream(void)
+{
+	if (!Capture_stream)
+		return;
+
+#ifdef _WIN32
+	if (Capture_stream_pipe)
+		_pclose(Capture_stream);
+	else
+#else
+	if (Capture_stream_pipe)
+		pclose(Capture_stream);
+	else
+#endif
+		fclose(Capture_stream);
+	Capture_stream = NULL;
+}
+
+// Finish the write in progress if it is done or wait is set, pick up the
+// readbacks of earlier frames and start writing the oldest slot.
+static void capture_poll(int wait)
+{
+	capture_slot *oldest = NULL;
+	int i;
+
+	if (Capture_task && (wait || worker_task_done(Capture_task)))
+	{
+		if (!worker_task_finish(Capture_task))
+		{
+			if (Capture_writing->filename[0])
+				con_printf(CON_URGENT, "Could not write screenshot %s!\n", Capture_writing->filename);
+			else if (Capture_stream)
+			{
+				con_printf(CON_URGENT, "Could not write to %s, stopped capturing\n", GameArg.OglCapture);
+				Capture_stream_failed = 1;
+				capture_stop_stream();
+			}
+		}
+		Capture_writing->state = CAPTURE_FREE;
+		Capture_writing = NULL;
+		Capture_task = NULL;
+	}
+
+	for (i = 0; i < CAPTURE_SLOTS; i++)
+	{
+		capture_slot *s = &Capture_slots[i];
+
+		if (s->state == CAPTURE_READING && (wait || s->frame != Capture_frame_num))
+		{
+#ifndef OGLES
+			void *p;
+
+			glBindBuffer(GL_PIXEL_PACK_BUFFER, s->pbo);
+			if ((p = glMapBuffer(GL_PIXEL_PACK_BUFFER, GL_READ_ONLY)) != NULL)
+			{
+				memcpy(s->rgba, p, s->w * s->h * 4);
+				glUnmapBuffer(GL_PIXEL_PACK_BUFFER);
+			}
+			else
+				memset(s->rgba, 0, s->w * s->h * 4);
+			glBindBuffer(GL_PIXEL_PACK_BUFFER, 0);
+#endif
+			s->state = CAPTURE_QUEUED;
+		}
+
+		if ((s->state == CAPTURE_READING || s->state == CAPTURE_QUEUED) && (!oldest || (int)(s->seq - oldest->seq) < 0))
+			oldest = s;
+	}
+
+	if (Capture_task || !oldest || oldest->state != CAPTURE_QUEUED)
+		return;
+
+	if (!oldest->filename[0] && (!Capture_stream || Capture_stream_failed))
+	{
+		oldest->state = CAPTURE_FREE;	// the stream was closed since
+		return;
+	}
+
+	oldest->state = CAPTURE_WRITING;
+	Capture_writing = oldest;
+	Capture_task = worker_task_start(capture_write, oldest);
+}
+
+// Wait until every slot is written
+static void capture_drain(void)
+{
+	int i, busy;
+
+	do
+	{
+		capture_poll(1);
+		for (i = busy = 0; i < CAPTURE_SLOTS; i++)
+			if (Capture_slots[i].state != CAPTURE_FREE)
+				busy = 1;
+	} while (busy);
+}
+
+static capture_slot *capture_get_slot(void)
+{
+	int i;
+
+	for (;;)
+	{
+		for (i = 0; i < CAPTURE_SLOTS; i++)
+			if (Capture_slots[i].state == CAPTURE_FREE)
+				return &Capture_slots[i];
+
+		// the writes fell behind, wait for one rather than drop a frame
+		capture_poll(1);
+	}
+}
+
+// Read the current screen from buffer into s
+static void capture_read(capture_slot *s, GLenum buffer)
+{
+	int w = grd_curscreen->sc_w, h = grd_curscreen->sc_h;
+
+	if (s->size < w * h * 4)
+	{
+		if (s->rgba)
+			d_free(s->rgba);
+		if (s->rgb)
+			d_free(s->rgb);
+		s->size = w * h * 4;
+		s->rgba = d_malloc(s->size);
+		s->rgb = d_malloc(w * h * 3);
+	}
+	s->w = w;
+	s->h = h;
+	s->frame = Capture_frame_num;
+	s->seq = Capture_seq++;
+
+#ifndef OGLES
+	glReadBuffer(buffer);
+
+	if (capture_have_pbo())
+	{
+		if (!s->pbo)
+			glGenBuffers(1, &s->pbo);
+		glBindBuffer(GL_PIXEL_PACK_BUFFER, s->pbo);
+		if (s->pbo_size != w * h * 4)
+		{
+			s->pbo_size = w * h * 4;
+			glBufferData(GL_PIXEL_PACK_BUFFER, s->pbo_size, NULL, GL_STREAM_READ);
+		}
+		glReadPixels(0, 0, w, h, GL_RGBA, GL_UNSIGNED_BYTE, NULL);
+		glBindBuffer(GL_PIXEL_PACK_BUFFER, 0);
+		s->state = CAPTURE_READING;
+		return;
+	}
+#endif
+
+	glReadPixels(0, 0, w, h, GL_RGBA, GL_UNSIGNED_BYTE, s->rgba);
+	s->state = CAPTURE_QUEUED;
+}
+
+void ogl_capture_screenshot(const char *filename)
+{
+	capture_slot *s = capture_get_slot();
+
+	snprintf(s->filename, sizeof(s->filename), "%s", filename);
+	capture_read(s, GL_FRONT);
+	capture_poll(0);
+}
+
+static void capture_start_stream(void)
+{
+	const char *target = GameArg.OglCapture;
+
+	Capture_w = grd_curscreen->sc_w;
+	Capture_h = grd_curscreen->sc_h;
+	Capture_next_usec = 0;
+
+	Capture_stream_pipe = target[0] == '|';
+	if (Capture_stream_pipe)
+	{
+#ifdef _WIN32
+		Capture_stream = _popen(target + 1, "wb");
+#else
+		signal(SIGPIPE, SIG_IGN);	// a failed write stops the capture instead
+		Capture_stream = popen(target + 1, "w");
+#endif
+	}
+	else
+		Capture_stream = fopen(target, "wb");
+
+	if (!Capture_stream)
+	{
+		con_printf(CON_URGENT, "Could not open %s for capturing\n", target);
+		Capture_stream_failed = 1;
+		return;
+	}
+
+	con_printf(CON_NORMAL, "Capturing %ix%i RGB24 frames at %i fps to %s\n", Capture_w, Capture_h, GameArg.OglCaptureFPS, target);
+}
+
+// Called once per frame, with the finished frame in the back buffer
+void ogl_capture_frame(void)
+{
+	Capture_frame_num++;
+
+	if (GameArg.OglCapture && GameArg.DbgGlReadPixelsOk && !Capture_stream_failed)
+	{
+		u_int64_t now = timer_query_usec(), interval = 1000000 / GameArg.OglCaptureFPS;
+
+		if (!Capture_stream)
+			capture_start_stream();
+
+		if (Capture_stream && (Capture_w != grd_curscreen->sc_w || Capture_h != grd_curscreen->sc_h))
+		{
+			con_printf(CON_URGENT, "Resolution changed, stopped capturing to %s\n", GameArg.OglCapture);
+			capture_drain();
+			Capture_stream_failed = 1;
+			capture_stop_stream();
+		}
+		else if (Capture_stream)
+		{
+			if (!Capture_next_usec)
+				Capture_next_usec = now;
+
+			if (now >= Capture_next_usec)
+			{
+				capture_slot *s = capture_get_slot();
+				u_int64_t repeat = 1 + (now - Capture_next_usec) / interval;
+
+				// keep the stream at a fixed rate by repeating frames when the game runs slower,
+				// but don't make up for more than a second
+				if (repeat > GameArg.OglCaptureFPS)
+				{
+					repeat = GameArg.OglCaptureFPS;
+					Capture_next_usec = now + interval;
+				}
+				else
+					Capture_next_usec += repeat * interval;
+
+				s->filename[0] = 0;
+				s->repeat = repeat;
+				capture_read(s, GL_BACK);
+			}
+		}
+	}
+
+	capture_poll(0);
+}
+
+// Write out everything in flight and drop the buffer objects, which belong
+// to the GL context. Called before the video mode changes.
+void ogl_capture_flush(void)
+{
+	int i;
+
+	capture_drain();
+
+#ifndef OGLES
+	for (i = 0; i < CAPTURE_SLOTS; i++)
+		if (Capture_slots[i].pbo)
+		{
+			glDeleteBuffers(1, &Capture_slots[i].pbo);
+			Capture_slots[i].pbo = 0;
+			Capture_slots[i].pbo_size = 0;
+		}
+#endif
+	Capture_use_pbo = -1;
+}
+
+void ogl_capture_close(void)
+{
+	int i;
+
+	ogl_capture_flush();
+	capture_stop_stream();
+
+	for (i = 0; i < CAPTURE_SLOTS; i++)
+	{
+		if (Capture_slots[i].rgba)
+			d_free(Capture_slots[i].rgba);
+		if (Capture_slots[i].rgb)
+			d_free(Capture_slots[i].rgb);
+		Capture_slots[i].size = 0;
+	}
+}
@@ -313,7 +313,10 @@ int ogl_init_window(int x, int y)
 #endif // OGLES
 
 	if (gl_initialized)
+	{
+		ogl_capture_flush();
 		ogl_smash_texture_list_internal();//if we are or were fullscreen, changing vid mode will invalidate current textures
+	}
 
 	SDL_WM_SetCaption(DESCENT_VERSION, "Descent II");
 	SDL_WM_SetIcon( SDL_LoadBMP( "d2x-redux.bmp" ), NULL );
@@ -447,6 +450,7 @@ int gr_toggle_fullscreen(void)
 
 	if (gl_initialized)
 	{
+		ogl_capture_flush();
 		if (sdl_no_modeswitch == 0) {
 			if (!SDL_VideoModeOK(SM_W(Game_screen_mode), SM_H(Game_screen_mode), GameArg.DbgBpp, sdl_video_flags))
 			{
@@ -817,6 +821,7 @@ void gr_close()
 
 	if (gl_initialized)
 	{
+		ogl_capture_close();
 		ogl_smash_texture_list_internal();
 	}
 
@@ -1040,99 +1045,6 @@ void gr_palette_read(ubyte * pal)
 	}
 }
 
-#define GL_BGR_EXT 0x80E0
-
-typedef struct
-{
-      unsigned char TGAheader[12];
-      unsigned char header[6];
-} TGA_header;
-
-//writes out an uncompressed RGB .tga file
-//if we got really spiffy, we could optionally link in libpng or something, and use that.
-void write_bmp(char *savename,int w,int h)
-{
-	unsigned char *rgbaBuf, *buf;
-	#ifdef HAVE_LIBPNG
-	png_data pdata;
-	int x, y;
-	#else
-	TGA_header TGA;
-	GLbyte HeightH,HeightL,WidthH,WidthL;
-	PHYSFS_File *TGAFile;
-	int pixel;
-	#endif
-
-	buf = (unsigned char*)d_malloc(w * h * 3);
-
-	rgbaBuf = (unsigned char*) d_malloc(w * h * 4);
-	glReadPixels(0, 0, w, h, GL_RGBA, GL_UNSIGNED_BYTE, rgbaBuf);
-	#ifdef HAVE_LIBPNG
-	for(y = 0; y < h; y++) {
-		int wofs = y * w * 3, rofs = (h - 1 - y) * w * 4;
-		for(x = 0; x < w; x++) {
-			*(buf + wofs + x * 3) = *(rgbaBuf + rofs + x * 4);
-			*(buf + wofs + x * 3 + 1) = *(rgbaBuf + rofs + x * 4 + 1);
-			*(buf + wofs + x * 3 + 2) = *(rgbaBuf + rofs + x * 4 + 2);
-		}
-	}
-	#else
-	for(pixel = 0; pixel < w * h; pixel++) {
-		*(buf + pixel * 3) = *(rgbaBuf + pixel * 4 + 2);
-		*(buf + pixel * 3 + 1) = *(rgbaBuf + pixel * 4 + 1);
-		*(buf + pixel * 3 + 2) = *(rgbaBuf + pixel * 4);
-	}
-	#endif
-	d_free(rgbaBuf);
-
-	#ifdef HAVE_LIBPNG
-	memset(&pdata, 0, sizeof(pdata));
-	pdata.width = w;
-	pdata.height = h;
-	pdata.data = buf;
-	pdata.depth = 8;
-
-	if (!write_png(savename, &pdata))
-		con_printf(CON_URGENT,"Could not create PNG file to dump screenshot!");
-	#else
-	if (!(TGAFile = PHYSFSX_openWriteBuffered(savename)))
-	{
-		con_printf(CON_URGENT,"Could not create TGA file to dump screenshot!");
-		d_free(buf);
-		return;
-	}
-
-	HeightH = (GLbyte)(h / 256);
-	HeightL = (GLbyte)(h % 256);
-	WidthH  = (GLbyte)(w / 256);
-	WidthL  = (GLbyte)(w % 256);
-	// Write TGA Header
-	TGA.TGAheader[0] = 0;
-	TGA.TGAheader[1] = 0;
-	TGA.TGAheader[2] = 2;
-	TGA.TGAheader[3] = 0;
-	TGA.TGAheader[4] = 0;
-	TGA.TGAheader[5] = 0;
-	TGA.TGAheader[6] = 0;
-	TGA.TGAheader[7] = 0;
-	TGA.TGAheader[8] = 0;
-	TGA.TGAheader[9] = 0;
-	TGA.TGAheader[10] = 0;
-	TGA.TGAheader[11] = 0;
-	TGA.header[0] = (GLbyte) WidthL;
-	TGA.header[1] = (GLbyte) WidthH;
-	TGA.header[2] = (GLbyte) HeightL;
-	TGA.header[3] = (GLbyte) HeightH;
-	TGA.header[4] = (GLbyte) 24;
-	TGA.header[5] = 0;
-	PHYSFS_write(TGAFile,&TGA,sizeof(TGA_header),1);
-	PHYSFS_write(TGAFile,buf,w*h*3*sizeof(unsigned char),1);
-	PHYSFS_close(TGAFile);
-	#endif
-
-	d_free(buf);
-}
-
 void save_screen_shot(int automap_flag)
 {
 	static int savenum=0;
@@ -1162,11 +1074,7 @@ void save_screen_shot(int automap_flag)
 	if (!automap_flag)
 		HUD_init_message(HM_DEFAULT, "%s '%s'", TXT_DUMPING_SCREEN, savename + strlen(SCRNS_DIR));
 
-#ifndef OGLES
-	glReadBuffer(GL_FRONT);
-#endif
-
-	write_bmp(savename,grd_curscreen->sc_w,grd_curscreen->sc_h);
+	ogl_capture_screenshot(savename);	// written out in the background
 
 	start_time();
 }
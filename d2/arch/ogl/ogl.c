@@ -56,6 +56,8 @@
 #include "args.h"
 #include "xmodel.h"
 #include "oglprog.h"
+#include "lighting.h"
+#include "ai.h"
 
 //change to 1 for lots of spew.
 #if 0
@@ -339,6 +341,8 @@ void ogl_texture_stats(void)
 	gr_printf(FSPACX(2), FSPACY(1)+LINE_SPACING, "%i(%i,%i,%i,%i) %iK(%iK wasted) (%i postcachedtex)", used, usedrgba, usedrgb, usedidx, usedother, truebytes / 1024, (truebytes - databytes) / 1024, r_texcount - r_cachedtexcount);
 	gr_printf(FSPACX(2), FSPACY(1)+(LINE_SPACING*2), "%ibpp(r%i,g%i,b%i,a%i)x%i=%iK depth%i=%iK", idx, r, g, b, a, dbl, colorsize / 1024, depth, depthsize / 1024);
 	gr_printf(FSPACX(2), FSPACY(1)+(LINE_SPACING*3), "total=%iK", (colorsize + depthsize + truebytes) / 1024);
+	gr_printf(FSPACX(2), FSPACY(1)+(LINE_SPACING*4), "%i lights (%i cached) %i lit verts", Dynamic_light_stats.lights, Dynamic_light_stats.cached_lights, Dynamic_light_stats.verts);
+	gr_printf(FSPACX(2), FSPACY(1)+(LINE_SPACING*5), "AI: %i robots, read %ius, apply %ius, %i/%i sight lines traced ahead", Ai_frame_stats.robots, Ai_frame_stats.read_usec, Ai_frame_stats.apply_usec, Ai_frame_stats.used, Ai_frame_stats.traced);
 }
 
 void ogl_bindbmtex(grs_bitmap *bm){
@@ -1222,6 +1226,7 @@ void gr_flip(void)
 		ogl_texture_stats();
 
 	ogl_do_palfx();
+	ogl_capture_frame();
 	ogl_swap_buffers_internal();
 	glClear(GL_COLOR_BUFFER_BIT);
 }
@@ -1868,6 +1873,31 @@ void ogl_freebmtexture(grs_bitmap *bm){
 /*
  * Menu / gauges 
  */
+//texture coordinates of bm, which may be a sub bitmap, within its texture
+static void ogl_bitmap_texcoords(grs_bitmap *bm, GLfloat *u1, GLfloat *u2, GLfloat *v1, GLfloat *v2)
+{
+	if (bm->bm_x==0){
+		*u1=0;
+		if (bm->bm_w==bm->gltexture->w || !bm->bm_parent)
+			*u2=bm->gltexture->u;
+		else
+			*u2=(bm->bm_w+bm->bm_x)/(float)bm->gltexture->tw;
+	}else {
+		*u1=bm->bm_x/(float)bm->gltexture->tw;
+		*u2=(bm->bm_w+bm->bm_x)/(float)bm->gltexture->tw;
+	}
+	if (bm->bm_y==0){
+		*v1=0;
+		if (bm->bm_h==bm->gltexture->h || !bm->bm_parent)
+			*v2=bm->gltexture->v;
+		else
+			*v2=(bm->bm_h+bm->bm_y)/(float)bm->gltexture->th;
+	}else{
+		*v1=bm->bm_y/(float)bm->gltexture->th;
+		*v2=(bm->bm_h+bm->bm_y)/(float)bm->gltexture->th;
+	}
+}
+
 bool ogl_ubitmapm_cs(int x, int y,int dw, int dh, grs_bitmap *bm,int c, int scale) // to scale bitmaps
 {
 	GLfloat xo,yo,xf,yf,u1,u2,v1,v2,color_r,color_g,color_b,h;
@@ -1906,26 +1936,7 @@ bool ogl_ubitmapm_cs(int x, int y,int dw, int dh, grs_bitmap *bm,int c, int scal
 	ogl_bindbmtex(bm);
 	ogl_texwrap(bm->gltexture,GL_CLAMP_TO_EDGE);
 	
-	if (bm->bm_x==0){
-		u1=0;
-		if (bm->bm_w==bm->gltexture->w || !bm->bm_parent)
-			u2=bm->gltexture->u;
-		else
-			u2=(bm->bm_w+bm->bm_x)/(float)bm->gltexture->tw;
-	}else {
-		u1=bm->bm_x/(float)bm->gltexture->tw;
-		u2=(bm->bm_w+bm->bm_x)/(float)bm->gltexture->tw;
-	}
-	if (bm->bm_y==0){
-		v1=0;
-		if (bm->bm_h==bm->gltexture->h || !bm->bm_parent)
-			v2=bm->gltexture->v;
-		else
-			v2=(bm->bm_h+bm->bm_y)/(float)bm->gltexture->th;
-	}else{
-		v1=bm->bm_y/(float)bm->gltexture->th;
-		v2=(bm->bm_h+bm->bm_y)/(float)bm->gltexture->th;
-	}
+	ogl_bitmap_texcoords(bm,&u1,&u2,&v1,&v2);
 
 	if (c < 0) {
 		color_r = 1.0;
@@ -1971,9 +1982,103 @@ bool ogl_ubitmapm_cs(int x, int y,int dw, int dh, grs_bitmap *bm,int c, int scal
 	return 0;
 }
 
+/*
+ * Glyph batch for ogl_internal_string().  All glyphs of a font are sub bitmaps of one texture (see
+ * ogl_init_font()), so the glyphs queued here are drawn with one glDrawArrays() per string instead of one
+ * per character.  The batch is drawn when the texture changes, when it is full and by ogl_flush_glyphs().
+ */
+#define OGL_GLYPH_BATCH 256
+
+static GLfloat Glyph_vertex_array[OGL_GLYPH_BATCH*12];
+static GLfloat Glyph_texcoord_array[OGL_GLYPH_BATCH*12];
+static GLfloat Glyph_color_array[OGL_GLYPH_BATCH*24];
+static grs_bitmap *Glyph_bitmap = NULL;	// any queued glyph, to bind the texture with
+static int Num_glyphs = 0;
+
+void ogl_flush_glyphs(void)
+{
+	if (!Num_glyphs)
+		return;
+
+	OGL_ENABLE(TEXTURE_2D);
+	ogl_bindbmtex(Glyph_bitmap);
+	ogl_texwrap(Glyph_bitmap->gltexture,GL_CLAMP_TO_EDGE);
+
+	glEnableClientState(GL_VERTEX_ARRAY);
+	glEnableClientState(GL_COLOR_ARRAY);
+	glEnableClientState(GL_TEXTURE_COORD_ARRAY);
+	glVertexPointer(2, GL_FLOAT, 0, Glyph_vertex_array);
+	glColorPointer(4, GL_FLOAT, 0, Glyph_color_array);
+	glTexCoordPointer(2, GL_FLOAT, 0, Glyph_texcoord_array);
+	glDrawArrays(GL_TRIANGLES, 0, Num_glyphs*6);
+	glDisableClientState(GL_VERTEX_ARRAY);
+	glDisableClientState(GL_COLOR_ARRAY);
+	glDisableClientState(GL_TEXTURE_COORD_ARRAY);
+
+	Num_glyphs = 0;
+}
+
+//same as ogl_ubitmapm_cs(x,y,dw,dh,bm,c,F1_0), but queued
+void ogl_queue_glyph(int x, int y, int dw, int dh, grs_bitmap *bm, int c)
+{
+	GLfloat xo,yo,xf,yf,u1,u2,v1,v2,color_r,color_g,color_b;
+	GLfloat *vert, *tex, *col;
+	int i;
+
+	if (bm->gltexture==NULL || bm->gltexture->handle<=0)
+		ogl_loadbmtexture(bm);
+	if (Num_glyphs && (Num_glyphs == OGL_GLYPH_BATCH || bm->gltexture != Glyph_bitmap->gltexture))
+		ogl_flush_glyphs();
+	Glyph_bitmap = bm;
+
+	if (dw == 0)
+		dw = bm->bm_w;
+	if (dh == 0)
+		dh = bm->bm_h;
+
+	x+=grd_curcanv->cv_bitmap.bm_x;
+	y+=grd_curcanv->cv_bitmap.bm_y;
+	xo = x / (double) last_width;
+	xf = (dw + x) / (double) last_width;
+	yo = 1.0 - y / (double) last_height;
+	yf = 1.0 - (dh + y) / (double) last_height;
+
+	ogl_bitmap_texcoords(bm,&u1,&u2,&v1,&v2);
+
+	if (c < 0) {
+		color_r = 1.0;
+		color_g = 1.0;
+		color_b = 1.0;
+	} else {
+		color_r = CPAL2Tr(c);
+		color_g = CPAL2Tg(c);
+		color_b = CPAL2Tb(c);
+	}
+
+	//two triangles, in the same order as the fan ogl_ubitmapm_cs() draws
+	vert = &Glyph_vertex_array[Num_glyphs*12];
+	tex = &Glyph_texcoord_array[Num_glyphs*12];
+	col = &Glyph_color_array[Num_glyphs*24];
+
+	vert[0] = xo; vert[1] = yo;   tex[0] = u1; tex[1] = v1;
+	vert[2] = xf; vert[3] = yo;   tex[2] = u2; tex[3] = v1;
+	vert[4] = xf; vert[5] = yf;   tex[4] = u2; tex[5] = v2;
+	vert[6] = xo; vert[7] = yo;   tex[6] = u1; tex[7] = v1;
+	vert[8] = xf; vert[9] = yf;   tex[8] = u2; tex[9] = v2;
+	vert[10] = xo; vert[11] = yf; tex[10] = u1; tex[11] = v2;
+
+	for (i=0; i<6; i++) {
+		col[i*4] = color_r;
+		col[i*4+1] = color_g;
+		col[i*4+2] = color_b;
+		col[i*4+3] = 1.0;
+	}
+
+	Num_glyphs++;
+}
+
 void ogl_update_window_clip()
 {
-	extern int Window_clip_left, Window_clip_top, Window_clip_right, Window_clip_bot;
 	int cw = grd_curcanv->cv_bitmap.bm_w, ch = grd_curcanv->cv_bitmap.bm_h;
 
 	if (!Window_clip_left && !Window_clip_top &&
@@ -36,6 +36,7 @@
 int  (*fptr_init)() = NULL;
 void (*fptr_close)() = NULL;
 void (*fptr_reset)() = NULL;
+void (*fptr_prepare_sounds)() = NULL;
 
 void (*fptr_set_channel_volume)(int, int) = NULL;
 void (*fptr_set_channel_pan)(int, int) = NULL;
@@ -57,6 +58,7 @@ void digi_select_system(int n) {
 	fptr_init = digi_mixer_init;
 	fptr_close = digi_mixer_close;
 	fptr_reset = digi_mixer_reset;
+	fptr_prepare_sounds = digi_mixer_prepare_sounds;
 	fptr_set_channel_volume = digi_mixer_set_channel_volume;
 	fptr_set_channel_pan = digi_mixer_set_channel_pan;
 	fptr_start_sound = digi_mixer_start_sound;
@@ -74,6 +76,7 @@ void digi_select_system(int n) {
         fptr_init = digi_audio_init;
         fptr_close = digi_audio_close;
         fptr_reset = digi_audio_reset;
+        fptr_prepare_sounds = NULL;	// mixes the sounds as they are
         fptr_set_channel_volume = digi_audio_set_channel_volume;
         fptr_set_channel_pan = digi_audio_set_channel_pan;
         fptr_start_sound = digi_audio_start_sound;
@@ -111,6 +114,7 @@ int  digi_init()
 
 void digi_close() { fptr_close(); }
 void digi_reset() { fptr_reset(); }
+void digi_prepare_sounds() { if (fptr_prepare_sounds) fptr_prepare_sounds(); }
 
 void digi_set_channel_volume(int channel, int volume) { fptr_set_channel_volume(channel, volume); }
 void digi_set_channel_pan(int channel, int pan) { fptr_set_channel_pan(channel, pan); }
@@ -23,6 +23,7 @@
 #include "kconfig.h"
 #include "config.h"
 #include "args.h"
+#include "profile.h"
 
 //changed on 980905 by adb to increase number of concurrent sounds
 #define MAX_SOUND_SLOTS 32
@@ -122,6 +123,8 @@ static void audio_mixcallback(void *userdata, Uint8 *stream, int len)
 	if (!digi_initialised)
 		return;
 
+	PROFILE_BEGIN("audio_mixcallback");
+
 	memset(stream, 0x80, len); // fix "static" sound bug on Mac OS X
 
 	SDL_LockAudio();
@@ -162,6 +165,8 @@ static void audio_mixcallback(void *userdata, Uint8 *stream, int len)
 	}
 
 	SDL_UnlockAudio();
+
+	PROFILE_END();
 }
 //end changes by adb
 
@@ -25,6 +25,7 @@
 #include "console.h"
 #include "config.h"
 #include "args.h"
+#include "worker.h"
 
 #include "fix.h"
 #include "gr.h" // needed for piggy.h
@@ -48,6 +49,30 @@ static inline int fix2byte(fix f) { return f < 0 ? 0 : f >= 65536 ? 255 : f / 25
 Mix_Chunk SoundChunks[MAX_SOUNDS];
 ubyte channels[MAX_SOUND_SLOTS];
 
+// The sounds converted by digi_mixer_prepare_sounds(), all in one block
+static Uint8 *Sound_arena = NULL;
+static int Sound_arena_offsets[MAX_SOUNDS];
+static int Sound_arena_lengths[MAX_SOUNDS];	// converted length, -1 if the conversion failed
+static int Prepare_sounds[MAX_SOUNDS];		// sound of each job
+
+static void mixdigi_free_sounds()
+{
+	int i;
+
+	for (i = 0; i < MAX_SOUNDS; i++)
+	{
+		if (SoundChunks[i].abuf && SoundChunks[i].allocated)
+			free(SoundChunks[i].abuf);
+		SoundChunks[i].abuf = NULL;
+		SoundChunks[i].alen = 0;
+		SoundChunks[i].allocated = 0;
+	}
+
+	if (Sound_arena)
+		free(Sound_arena);
+	Sound_arena = NULL;
+}
+
 #ifdef __linux__
 static int digi_mixer_check_soundfont(const char *path, void *data)
 {
@@ -102,6 +127,7 @@ void digi_mixer_close() {
 	if (!digi_initialised) return;
 	digi_initialised = 0;
 	Mix_CloseAudio();
+	mixdigi_free_sounds();
 }
 
 /* channel management */
@@ -153,6 +179,72 @@ void mixdigi_convert_sound(int i)
 	}
 }
 
+// Convert one sound into its place in Sound_arena. Runs on any thread.
+static void mixdigi_prepare_sound(void *data, int job, int thread)
+{
+	SDL_AudioCVT cvt = *(SDL_AudioCVT *)data;	// SDL_ConvertAudio() changes it
+	int i = Prepare_sounds[job];
+
+	cvt.buf = Sound_arena + Sound_arena_offsets[i];
+	cvt.len = GameSounds[i].length;
+	memcpy(cvt.buf, GameSounds[i].data, cvt.len);
+	Sound_arena_lengths[i] = SDL_ConvertAudio(&cvt) ? -1 : cvt.len_cvt;
+}
+
+/*
+ * Load-time conversion. Converts every sound that is loaded now on the worker
+ * threads, so the first time one plays does not hold up a frame. Sounds
+ * loaded later, like the ones of the hoard game, are converted when they
+ * first play.
+ */
+void digi_mixer_prepare_sounds()
+{
+	SDL_AudioCVT cvt;
+	int out_freq, out_channels;
+	Uint16 out_format;
+	int i, n = 0, size = 0;
+
+	if (!digi_initialised || GameArg.SysLowMem)
+		return;
+
+	digi_mixer_stop_all_channels();
+	mixdigi_free_sounds();
+
+	Mix_QuerySpec(&out_freq, &out_format, &out_channels);
+	SDL_BuildAudioCVT(&cvt, AUDIO_U8, 1, GameArg.SndDigiSampleRate, out_format, out_channels, out_freq);
+
+	for (i = 0; i < Num_sound_files && i < MAX_SOUNDS; i++)
+	{
+		if (!GameSounds[i].data || GameSounds[i].data == (void *)-1)
+			continue;
+		Prepare_sounds[n++] = i;
+		Sound_arena_offsets[i] = size;
+		size += (GameSounds[i].length * cvt.len_mult + 7) & ~7;
+	}
+
+	if (!n || !(Sound_arena = malloc(size)))
+		return;
+
+	worker_run(mixdigi_prepare_sound, &cvt, n);
+
+	for (i = 0; i < n; i++)
+	{
+		int s = Prepare_sounds[i];
+
+		if (Sound_arena_lengths[s] < 0)
+		{
+			con_printf(CON_DEBUG,"conversion of %d failed\n", s);
+			continue;
+		}
+		SoundChunks[s].abuf = Sound_arena + Sound_arena_offsets[s];
+		SoundChunks[s].alen = Sound_arena_lengths[s];
+		SoundChunks[s].allocated = 0;	// part of Sound_arena
+		SoundChunks[s].volume = 128; // Max volume = 128
+	}
+
+	con_printf(CON_VERBOSE,"Converted %d sounds for the mixer (%d KB)\n", n, size / 1024);
+}
+
 // Volume 0-F1_0
 int digi_mixer_start_sound(short soundnum, fix volume, int pan, int looping, int loop_start, int loop_end, int soundobj)
 {
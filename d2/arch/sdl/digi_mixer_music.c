@@ -16,12 +16,104 @@
 #include "digi_mixer_music.h"
 #include "u_mem.h"
 #include "console.h"
+#include "physfsrwops.h"
+#include "worker.h"
 
 #ifdef _WIN32
 extern int digi_win32_play_midi_song( char * filename, int loop );
 #endif
 Mix_Music *current_music = NULL;
-static unsigned char *current_music_hndlbuf = NULL;
+static SDL_RWops *current_music_rw = NULL;	// what current_music streams from, closed with it
+
+/*
+ * .hmp files converted to MIDI, so a song that played before or was
+ * prefetched does not have to be converted again on the game thread.
+ */
+#define MIDI_CACHE_SIZE 8
+
+typedef struct midi_cache_entry
+{
+	char filename[PATH_MAX];
+	unsigned char *buf;
+	unsigned int len;
+	worker_task *task;	// set while it is converted in the background
+} midi_cache_entry;
+
+static midi_cache_entry Midi_cache[MIDI_CACHE_SIZE];
+static int Midi_cache_next = 0;
+static midi_cache_entry *current_midi = NULL;	// the entry current_music streams from
+
+static int mix_convert_hmp(void *data)
+{
+	midi_cache_entry *e = data;
+
+	hmp2mid(e->filename, &e->buf, &e->len);
+	return e->buf != NULL;
+}
+
+// Find the converted file, or start converting it into the oldest entry
+static midi_cache_entry *mix_convert_midi(const char *filename, int background)
+{
+	midi_cache_entry *e;
+	int i;
+
+	for (i = 0; i < MIDI_CACHE_SIZE; i++)
+		if (Midi_cache[i].filename[0] && !strcmp(Midi_cache[i].filename, filename))
+			return &Midi_cache[i];
+
+	e = &Midi_cache[Midi_cache_next];
+	if (e == current_midi)
+		e = &Midi_cache[Midi_cache_next = (Midi_cache_next + 1) % MIDI_CACHE_SIZE];
+	Midi_cache_next = (Midi_cache_next + 1) % MIDI_CACHE_SIZE;
+
+	if (e->task)
+		worker_task_finish(e->task);
+	e->task = NULL;
+	if (e->buf)
+		d_free(e->buf);
+	e->len = 0;
+	snprintf(e->filename, sizeof(e->filename), "%s", filename);
+
+#ifdef NDEBUG
+	// d_malloc() keeps a list of blocks without a lock in debug builds, so
+	// only convert on another thread in release builds
+	if (background)
+		e->task = worker_task_start(mix_convert_hmp, e);
+	else
+#endif
+		mix_convert_hmp(e);
+
+	return e;
+}
+
+// Start converting a .hmp file that is likely to be played soon.  Only where
+// that can happen in the background, a debug build converts it when it plays.
+void mix_prefetch_file(char *filename)
+{
+#ifdef NDEBUG
+	char *fptr = strrchr(filename, '.');
+
+	if (fptr && !d_stricmp(fptr, ".hmp"))
+		mix_convert_midi(filename, 1);
+#endif
+}
+
+void mix_free_midi_cache()
+{
+	int i;
+
+	mix_free_music();
+	for (i = 0; i < MIDI_CACHE_SIZE; i++)
+	{
+		if (Midi_cache[i].task)
+			worker_task_finish(Midi_cache[i].task);
+		Midi_cache[i].task = NULL;
+		if (Midi_cache[i].buf)
+			d_free(Midi_cache[i].buf);
+		Midi_cache[i].len = 0;
+		Midi_cache[i].filename[0] = 0;
+	}
+}
 
 
 /*
@@ -30,11 +122,8 @@ static unsigned char *current_music_hndlbuf = NULL;
 
 int mix_play_file(char *filename, int loop, void (*hook_finished_track)())
 {
-	SDL_RWops *rw = NULL;
-	PHYSFS_file *filehandle = NULL;
 	char full_path[PATH_MAX];
 	char *fptr;
-	unsigned int bufsize = 0;
 
 	mix_free_music();	// stop and free what we're already playing, if anything
 
@@ -46,9 +135,23 @@ int mix_play_file(char *filename, int loop, void (*hook_finished_track)())
 	// It's a .hmp!
 	if (!d_stricmp(fptr, ".hmp"))
 	{
-		hmp2mid(filename, &current_music_hndlbuf, &bufsize);
-		rw = SDL_RWFromConstMem(current_music_hndlbuf,bufsize*sizeof(char));
-		current_music = Mix_LoadMUS_RW(rw);
+		midi_cache_entry *e = mix_convert_midi(filename, 0);
+
+		if (e->task)	// prefetched, wait for it
+		{
+			worker_task_finish(e->task);
+			e->task = NULL;
+		}
+		if (e->buf && (current_music_rw = SDL_RWFromConstMem(e->buf, e->len)) != NULL)
+		{
+			if ((current_music = Mix_LoadMUS_RW(current_music_rw)) != NULL)
+				current_midi = e;
+			else
+			{
+				SDL_RWclose(current_music_rw);
+				current_music_rw = NULL;
+			}
+		}
 	}
 
 	// try loading music via given filename
@@ -77,18 +180,12 @@ int mix_play_file(char *filename, int loop, void (*hook_finished_track)())
 			filename = full_path;	// used later for possible error reporting
 	}
 
-	// still nothin'? Let's open via PhysFS in case it's located inside an archive
+	// still nothin'? Let's stream it via PhysFS in case it's located inside an archive
 	if (!current_music)
 	{
-		filehandle = PHYSFS_openRead(filename);
-		if (filehandle != NULL)
-		{
-			current_music_hndlbuf = d_realloc(current_music_hndlbuf, sizeof(char *)*PHYSFS_fileLength(filehandle));
-			bufsize = PHYSFS_read(filehandle, current_music_hndlbuf, sizeof(char), PHYSFS_fileLength(filehandle));
-			rw = SDL_RWFromConstMem(current_music_hndlbuf,bufsize*sizeof(char));
-			PHYSFS_close(filehandle);
-			current_music = Mix_LoadMUS_RW(rw);
-		}
+		current_music_rw = PHYSFSRWOPS_openRead(filename);
+		if (current_music_rw)
+			current_music = Mix_LoadMUS_RW(current_music_rw);
 	}
 
 	if (current_music)
@@ -100,7 +197,7 @@ int mix_play_file(char *filename, int loop, void (*hook_finished_track)())
 	else
 	{
 		con_printf(CON_CRITICAL,"Music %s could not be loaded: %s\n", filename, Mix_GetError());
-		mix_stop_music();
+		mix_free_music();
 	}
 
 	return 0;
@@ -115,11 +212,12 @@ void mix_free_music()
 		Mix_FreeMusic(current_music);
 		current_music = NULL;
 	}
-	if (current_music_hndlbuf)
+	if (current_music_rw)
 	{
-		d_free(current_music_hndlbuf);
-		current_music_hndlbuf = NULL;
+		SDL_RWclose(current_music_rw);
+		current_music_rw = NULL;
 	}
+	current_midi = NULL;
 }
 
 void mix_set_music_volume(int vol)
@@ -131,11 +229,6 @@ void mix_set_music_volume(int vol)
 void mix_stop_music()
 {
 	Mix_HaltMusic();
-	if (current_music_hndlbuf)
-	{
-		d_free(current_music_hndlbuf);
-		current_music_hndlbuf = NULL;
-	}
 }
 
 void mix_pause_music()
@@ -16,6 +16,7 @@
 #include "args.h"
 
 #include "joy.h"
+#include "dxma.h"
 
 extern void key_handler(SDL_KeyboardEvent *event);
 extern void mouse_button_handler(SDL_MouseButtonEvent *mbe);
@@ -162,6 +163,8 @@ void event_process(void)
 
 	timer_update();
 
+	dxma_download_poll();	// downloads go on under any menu
+
 	event_poll();	// send input events first
 
 	// Doing this prevents problems when a draw event can create a newmenu,
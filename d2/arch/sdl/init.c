@@ -11,6 +11,8 @@
 #include "text.h"
 #include "args.h"
 #include "config.h"
+#include "worker.h"
+#include "profile.h"
 
 void arch_close(void)
 {
@@ -31,6 +33,10 @@ void arch_close(void)
 
 	key_close();
 
+	worker_close();
+
+	profile_close();
+
 	SDL_Quit();
 }
 
@@ -41,6 +47,10 @@ void arch_init(void)
 	if (SDL_Init(SDL_INIT_VIDEO) < 0)
 		Error("SDL library initialisation failed: %s.",SDL_GetError());
 
+	profile_init();
+
+	worker_init(GameArg.SysThreads);
+
 	key_init();
 
 	digi_select_system( GameArg.SndDisableSdlMixer ? SDLAUDIO_SYSTEM : SDLMIXER_SYSTEM );
@@ -227,11 +227,26 @@ void jukebox_hook_next()
 	jukebox_play();
 }
 
+// Build the full path of a track, to be freed with d_free()
+static char *jukebox_full_filename(char *music_filename)
+{
+	char *full_filename;
+	unsigned long size_full_filename = strlen(GameCfg.CMLevelMusicPath)+strlen(music_filename)+1;
+	int path_len = strlen(GameCfg.CMLevelMusicPath);
+
+	CALLOC(full_filename, char, size_full_filename);
+	if (path_len > 4 && !d_stricmp(&GameCfg.CMLevelMusicPath[path_len - 4], ".m3u"))	// if it's from an M3U playlist
+		strcpy(full_filename, music_filename);
+	else											// if it's from a specified path
+		snprintf(full_filename, size_full_filename, "%s%s", GameCfg.CMLevelMusicPath, music_filename);
+
+	return full_filename;
+}
+
 // Play tracks from Jukebox directory. Play track specified in GameCfg.CMLevelMusicTrack[0] and loop depending on GameCfg.CMLevelMusicPlayOrder
 int jukebox_play()
 {
 	char *music_filename, *full_filename;
-	unsigned long size_full_filename = 0;
 
 	if (!JukeboxSongs.list)
 		return 0;
@@ -243,13 +258,7 @@ int jukebox_play()
 	if (!music_filename)
 		return 0;
 
-	size_full_filename = strlen(GameCfg.CMLevelMusicPath)+strlen(music_filename)+1;
-	CALLOC(full_filename, char, size_full_filename);
-	int path_len = strlen(GameCfg.CMLevelMusicPath);
-	if (path_len > 4 && !d_stricmp(&GameCfg.CMLevelMusicPath[path_len - 4], ".m3u"))	// if it's from an M3U playlist
-		strcpy(full_filename, music_filename);
-	else											// if it's from a specified path
-		snprintf(full_filename, size_full_filename, "%s%s", GameCfg.CMLevelMusicPath, music_filename);
+	full_filename = jukebox_full_filename(music_filename);
 
 	if (!songs_play_file(full_filename, ((GameCfg.CMLevelMusicPlayOrder == MUSIC_CM_PLAYORDER_LEVEL)?1:0), ((GameCfg.CMLevelMusicPlayOrder == MUSIC_CM_PLAYORDER_LEVEL)?NULL:jukebox_hook_next)))
 	{
@@ -270,6 +279,18 @@ int jukebox_play()
 
 	d_free(full_filename);
 
+	// the next track is known unless they are picked at random
+	if (GameCfg.CMLevelMusicPlayOrder != MUSIC_CM_PLAYORDER_RAND)
+	{
+		music_filename = JukeboxSongs.list[(GameCfg.CMLevelMusicTrack[0] + 1) % GameCfg.CMLevelMusicTrack[1]];
+		if (music_filename)
+		{
+			full_filename = jukebox_full_filename(music_filename);
+			songs_prefetch_file(full_filename);
+			d_free(full_filename);
+		}
+	}
+
 	return 1;
 }
 
@@ -0,0 +1,365 @@
+/*
+ *
+ * Frame profiler
+ *
+ * Every thread that opens a zone gets a ring of closed zones of its own, so
+ * timing a zone takes no lock. The game thread empties the rings once per
+ * frame in profile_frame(), adding each zone to its statistics and to the
+ * trace that profile_export_trace() writes out.
+ *
+ */
+
+#include <stdlib.h>
+#include <string.h>
+#include <SDL.h>
+
+#include "profile.h"
+#include "timer.h"
+#include "physfsx.h"
+#include "console.h"
+#include "worker.h"
+#include "args.h"
+
+#define PROFILE_MAX_THREADS	(MAX_WORKER_THREADS+8)	// the pool, the audio thread and background tasks
+#define PROFILE_MAX_DEPTH	32
+#define PROFILE_RING_SIZE	8192	// closed zones a thread can hold between two frames
+#define PROFILE_MAX_ZONES	64
+#define PROFILE_TRACE_SIZE	32768	// closed zones kept for the trace, of all threads
+
+typedef struct profile_event {
+	const char	*name;
+	u_int64_t	start;
+	u_int32_t	usec;
+	ubyte		depth;
+	ubyte		thread;
+} profile_event;
+
+typedef struct profile_thread {
+	int		num;
+	int		generation;
+	int		depth;
+	const char	*open_name[PROFILE_MAX_DEPTH];
+	u_int64_t	open_start[PROFILE_MAX_DEPTH];
+	volatile unsigned head;		// zones written, only changed by the owning thread
+	unsigned	tail;		// zones read, only changed by profile_frame()
+	profile_event	events[PROFILE_RING_SIZE];
+} profile_thread;
+
+typedef struct profile_zone {
+	const char	*name;
+	int		depth;
+	int		calls, last_calls;
+	u_int64_t	usec[PROFILE_HISTORY];	// per frame, indexed by the frame number
+} profile_zone;
+
+int Profile_enabled = 0;
+static volatile int Profile_generation = 0;	// bumped to drop zones opened before timing was turned on
+
+static SDL_mutex *Profile_mutex = NULL;
+static profile_thread *Profile_threads[PROFILE_MAX_THREADS];
+static int Profile_num_threads = 0;
+static __thread_local__ profile_thread *Profile_this_thread = NULL;
+static __thread_local__ int Profile_no_thread = 0;
+
+static profile_zone Profile_zones[PROFILE_MAX_ZONES];
+static int Profile_num_zones = 0;
+static unsigned Profile_frame_num = 0, Profile_frames_seen = 0;
+static u_int64_t Profile_frame_start = 0;
+
+static profile_event Trace_events[PROFILE_TRACE_SIZE];
+static unsigned Trace_head = 0;
+
+static const char Profile_frame_name[] = "Frame";
+
+// Give the calling thread a ring. This uses calloc() rather than d_malloc(),
+// which keeps its list of blocks without a lock in debug builds.
+static profile_thread *profile_add_thread(void)
+{
+	profile_thread *t = NULL;
+
+	if (Profile_no_thread || !Profile_mutex)
+		return NULL;
+
+	SDL_mutexP(Profile_mutex);
+	if (Profile_num_threads < PROFILE_MAX_THREADS && (t = calloc(1, sizeof(profile_thread))) != NULL)
+	{
+		t->num = Profile_num_threads;
+		t->generation = Profile_generation;
+		Profile_threads[Profile_num_threads++] = t;
+	}
+	SDL_mutexV(Profile_mutex);
+
+	if (!t)
+		Profile_no_thread = 1;
+	Profile_this_thread = t;
+	return t;
+}
+
+void profile_init(void)
+{
+	Profile_mutex = SDL_CreateMutex();
+	if (!Profile_mutex)
+		con_printf(CON_URGENT, "Cannot create profiler mutex: %s\n", SDL_GetError());
+
+	profile_add_thread();	// the game thread, always thread 0
+	profile_enable(GameArg.DbgProfile);
+}
+
+// Only call this once every thread that opened a zone has stopped.
+void profile_close(void)
+{
+	int i;
+
+	Profile_enabled = 0;
+	for (i = 0; i < Profile_num_threads; i++)
+	{
+		free(Profile_threads[i]);
+		Profile_threads[i] = NULL;
+	}
+	Profile_num_threads = 0;
+	Profile_this_thread = NULL;
+
+	if (Profile_mutex)
+		SDL_DestroyMutex(Profile_mutex);
+	Profile_mutex = NULL;
+}
+
+void profile_begin(const char *name)
+{
+	profile_thread *t = Profile_this_thread;
+
+	if (!t && !(t = profile_add_thread()))
+		return;
+
+	if (t->generation != Profile_generation)
+	{
+		t->generation = Profile_generation;
+		t->depth = 0;
+	}
+
+	if (t->depth < PROFILE_MAX_DEPTH)
+	{
+		t->open_name[t->depth] = name;
+		t->open_start[t->depth] = timer_query_usec();
+	}
+	t->depth++;
+}
+
+void profile_end(void)
+{
+	profile_thread *t = Profile_this_thread;
+	profile_event *e;
+
+	// no zone open, or it was opened before timing was last turned on
+	if (!t || t->generation != Profile_generation || !t->depth)
+		return;
+
+	if (--t->depth >= PROFILE_MAX_DEPTH)
+		return;
+
+	e = &t->events[t->head % PROFILE_RING_SIZE];
+	e->name = t->open_name[t->depth];
+	e->start = t->open_start[t->depth];
+	e->usec = (u_int32_t)(timer_query_usec() - e->start);
+	e->depth = t->depth;
+	e->thread = t->num;
+	t->head++;	// only after the zone is written, so profile_frame() never reads half of one
+}
+
+void profile_enable(int enable)
+{
+	if (enable && !Profile_enabled)
+	{
+		int i;
+
+		// drop whatever the threads wrote since timing was last on
+		Profile_generation++;
+		SDL_mutexP(Profile_mutex);
+		for (i = 0; i < Profile_num_threads; i++)
+			Profile_threads[i]->tail = Profile_threads[i]->head;
+		SDL_mutexV(Profile_mutex);
+
+		Profile_num_zones = 0;
+		Profile_frame_num = Profile_frames_seen = 0;
+		Profile_frame_start = 0;
+		Trace_head = 0;
+	}
+
+	Profile_enabled = enable != 0;
+}
+
+static profile_zone *profile_find_zone(const char *name, int depth)
+{
+	profile_zone *z;
+	int i;
+
+	for (i = 0; i < Profile_num_zones; i++)
+		if (Profile_zones[i].name == name)
+			return &Profile_zones[i];
+
+	if (Profile_num_zones >= PROFILE_MAX_ZONES)
+		return NULL;
+
+	z = &Profile_zones[Profile_num_zones++];
+	memset(z, 0, sizeof(*z));
+	z->name = name;
+	z->depth = depth;
+	return z;
+}
+
+static void profile_add_event(const profile_event *e)
+{
+	profile_zone *z = profile_find_zone(e->name, e->depth);
+
+	if (z)
+	{
+		z->usec[Profile_frame_num % PROFILE_HISTORY] += e->usec;
+		z->calls++;
+	}
+
+	Trace_events[Trace_head++ % PROFILE_TRACE_SIZE] = *e;
+}
+
+void profile_frame(void)
+{
+	u_int64_t now;
+	int i, n;
+
+	if (!Profile_enabled)
+		return;
+
+	now = timer_query_usec();
+
+	// the frame that just ended
+	if (Profile_frame_start)
+	{
+		profile_event e;
+
+		e.name = Profile_frame_name;
+		e.start = Profile_frame_start;
+		e.usec = (u_int32_t)(now - Profile_frame_start);
+		e.depth = 0;
+		e.thread = Profile_this_thread ? Profile_this_thread->num : 0;
+		profile_add_event(&e);
+	}
+
+	SDL_mutexP(Profile_mutex);
+	n = Profile_num_threads;
+	SDL_mutexV(Profile_mutex);
+
+	for (i = 0; i < n; i++)
+	{
+		profile_thread *t = Profile_threads[i];
+		unsigned head = t->head;
+
+		if (head - t->tail > PROFILE_RING_SIZE)
+			t->tail = head - PROFILE_RING_SIZE;	// the thread lapped us, keep the newest ones
+		for (; t->tail != head; t->tail++)
+			profile_add_event(&t->events[t->tail % PROFILE_RING_SIZE]);
+	}
+
+	// start the next frame
+	if (Profile_frame_start)
+	{
+		Profile_frame_num++;
+		if (Profile_frames_seen < PROFILE_HISTORY - 1)	// one slot is for the frame being collected
+			Profile_frames_seen++;
+	}
+	Profile_frame_start = now;
+
+	for (i = 0; i < Profile_num_zones; i++)
+	{
+		Profile_zones[i].usec[Profile_frame_num % PROFILE_HISTORY] = 0;
+		Profile_zones[i].last_calls = Profile_zones[i].calls;
+		Profile_zones[i].calls = 0;
+	}
+}
+
+static int profile_compare_stats(const void *a, const void *b)
+{
+	const profile_zone_stats *sa = a, *sb = b;
+
+	if (sa->avg_usec != sb->avg_usec)
+		return sa->avg_usec < sb->avg_usec ? 1 : -1;
+	return 0;
+}
+
+int profile_get_stats(profile_zone_stats *stats, int max)
+{
+	int i, n = 0;
+	unsigned j;
+
+	if (!Profile_frames_seen)
+		return 0;
+
+	for (i = 0; i < Profile_num_zones && n < max; i++)
+	{
+		profile_zone *z = &Profile_zones[i];
+		profile_zone_stats *s = &stats[n++];
+		u_int64_t total = 0;
+
+		s->name = z->name;
+		s->depth = z->depth;
+		s->calls = z->last_calls;
+		s->max_usec = 0;
+
+		// the slot of the current frame is still being filled, skip it
+		for (j = 1; j <= Profile_frames_seen; j++)
+		{
+			u_int64_t usec = z->usec[(Profile_frame_num - j) % PROFILE_HISTORY];
+
+			total += usec;
+			if (usec > s->max_usec)
+				s->max_usec = usec;
+		}
+		s->avg_usec = total / Profile_frames_seen;
+	}
+
+	qsort(stats, n, sizeof(profile_zone_stats), profile_compare_stats);
+	return n;
+}
+
+int profile_export_trace(const char *filename)
+{
+	PHYSFS_file *fp;
+	unsigned first, i;
+	u_int64_t base;
+	int thread_seen[PROFILE_MAX_THREADS];
+
+	if (!Trace_head)
+		return -1;
+
+	if (!(fp = PHYSFSX_openWriteBuffered(filename)))
+		return -1;
+
+	first = Trace_head > PROFILE_TRACE_SIZE ? Trace_head - PROFILE_TRACE_SIZE : 0;
+	base = Trace_events[first % PROFILE_TRACE_SIZE].start;
+	for (i = first; i != Trace_head; i++)
+		if (Trace_events[i % PROFILE_TRACE_SIZE].start < base)
+			base = Trace_events[i % PROFILE_TRACE_SIZE].start;
+
+	memset(thread_seen, 0, sizeof(thread_seen));
+	PHYSFSX_printf(fp, "{\"displayTimeUnit\":\"ms\",\"traceEvents\":[\n");
+	for (i = first; i != Trace_head; i++)
+	{
+		profile_event *e = &Trace_events[i % PROFILE_TRACE_SIZE];
+
+		if (!thread_seen[e->thread])
+		{
+			thread_seen[e->thread] = 1;
+			PHYSFSX_printf(fp, "{\"name\":\"thread_name\",\"ph\":\"M\",\"pid\":1,\"tid\":%i,\"args\":{\"name\":\"%s %i\"}},\n",
+				e->thread, e->thread ? "thread" : "main", e->thread);
+		}
+
+		PHYSFSX_printf(fp, "{\"name\":\"%s\",\"ph\":\"X\",\"pid\":1,\"tid\":%i,\"ts\":%llu,\"dur\":%u}%s\n",
+			e->name, e->thread, (unsigned long long)(e->start - base), (unsigned)e->usec,
+			i + 1 != Trace_head ? "," : "");
+	}
+	PHYSFSX_printf(fp, "]}\n");
+
+	if (!PHYSFS_close(fp))
+		return -1;
+
+	con_printf(CON_NORMAL, "Wrote %u profiler zones to %s\n", Trace_head - first, filename);
+	return 0;
+}
@@ -5,6 +5,11 @@
  */
 
 #include <SDL.h>
+#ifdef _WIN32
+#include <windows.h>
+#else
+#include <sys/time.h>
+#endif
 
 #include "maths.h"
 #include "timer.h"
@@ -34,6 +39,26 @@ fix64 timer_query(void)
 	return (F64_RunTime);
 }
 
+// Microseconds since some point in the past, for profiling. Unlike
+// timer_query() it is read from the clock on every call.
+u_int64_t timer_query_usec(void)
+{
+#ifdef _WIN32
+	static LARGE_INTEGER freq;
+	LARGE_INTEGER count;
+
+	if (!freq.QuadPart)
+		QueryPerformanceFrequency(&freq);
+	QueryPerformanceCounter(&count);
+	return (u_int64_t)(count.QuadPart / freq.QuadPart) * 1000000 + (u_int64_t)(count.QuadPart % freq.QuadPart) * 1000000 / freq.QuadPart;
+#else
+	struct timeval tv;
+
+	gettimeofday(&tv, NULL);
+	return (u_int64_t)tv.tv_sec * 1000000 + tv.tv_usec;
+#endif
+}
+
 void timer_delay(fix seconds)
 {
 	SDL_Delay(f2i(fixmul(seconds, i2f(1000))));
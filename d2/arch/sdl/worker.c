@@ -0,0 +1,259 @@
+/*
+ *
+ * SDL worker thread pool
+ *
+ */
+
+#include <SDL.h>
+#ifdef _WIN32
+#include <windows.h>
+#else
+#include <unistd.h>
+#endif
+
+#include "worker.h"
+#include "console.h"
+#include "u_mem.h"
+
+static SDL_Thread *Worker_threads[MAX_WORKER_THREADS];
+static int Num_threads = 1;			// including the game thread
+static SDL_mutex *Worker_mutex = NULL;
+static SDL_cond *Worker_start_cond = NULL, *Worker_done_cond = NULL;
+static int Worker_quit = 0;
+static __thread_local__ int Worker_thread_num = 0;
+
+// current batch, all protected by Worker_mutex
+static worker_job_func Batch_func = NULL;
+static void *Batch_data = NULL;
+static int Batch_num_jobs = 0, Batch_next_job = 0, Batch_jobs_done = 0;
+static int Batch_running = 0;
+
+static int worker_cpu_count(void)
+{
+#ifdef _WIN32
+	SYSTEM_INFO info;
+
+	GetSystemInfo(&info);
+	return info.dwNumberOfProcessors;
+#elif defined(_SC_NPROCESSORS_ONLN)
+	long n = sysconf(_SC_NPROCESSORS_ONLN);
+
+	return n > 0 ? n : 1;
+#else
+	return 1;
+#endif
+}
+
+// Take and run jobs of the current batch until none are left. Called and
+// returns with Worker_mutex held.
+static void worker_do_jobs(int thread)
+{
+	while (Batch_next_job < Batch_num_jobs)
+	{
+		int job = Batch_next_job++;
+
+		SDL_mutexV(Worker_mutex);
+		Batch_func(Batch_data, job, thread);
+		SDL_mutexP(Worker_mutex);
+
+		if (++Batch_jobs_done == Batch_num_jobs)
+			SDL_CondSignal(Worker_done_cond);
+	}
+}
+
+static int worker_thread(void *arg)
+{
+	int thread = (int)(size_t)arg;
+
+	Worker_thread_num = thread;
+
+	SDL_mutexP(Worker_mutex);
+	while (!Worker_quit)
+	{
+		if (Batch_next_job < Batch_num_jobs)
+			worker_do_jobs(thread);
+		else
+			SDL_CondWait(Worker_start_cond, Worker_mutex);
+	}
+	SDL_mutexV(Worker_mutex);
+
+	return 0;
+}
+
+void worker_init(int num_threads)
+{
+	int i;
+
+	if (num_threads <= 0)
+		num_threads = worker_cpu_count();
+	if (num_threads > MAX_WORKER_THREADS)
+		num_threads = MAX_WORKER_THREADS;
+
+	Num_threads = 1;
+	Worker_quit = 0;
+
+	if (num_threads <= 1)
+		return;
+
+	Worker_mutex = SDL_CreateMutex();
+	Worker_start_cond = SDL_CreateCond();
+	Worker_done_cond = SDL_CreateCond();
+	if (!Worker_mutex || !Worker_start_cond || !Worker_done_cond)
+	{
+		con_printf(CON_URGENT, "Cannot create worker threads: %s\n", SDL_GetError());
+		worker_close();
+		return;
+	}
+
+	for (i = 1; i < num_threads; i++)
+	{
+		Worker_threads[i] = SDL_CreateThread(worker_thread, (void *)(size_t)i);
+		if (!Worker_threads[i])
+			break;
+		Num_threads++;
+	}
+
+	con_printf(CON_VERBOSE, "Started %i worker threads\n", Num_threads - 1);
+}
+
+void worker_close(void)
+{
+	int i;
+
+	if (Worker_mutex)
+	{
+		SDL_mutexP(Worker_mutex);
+		Worker_quit = 1;
+		SDL_CondBroadcast(Worker_start_cond);
+		SDL_mutexV(Worker_mutex);
+	}
+
+	for (i = 1; i < Num_threads; i++)
+	{
+		SDL_WaitThread(Worker_threads[i], NULL);
+		Worker_threads[i] = NULL;
+	}
+	Num_threads = 1;
+
+	if (Worker_done_cond)
+		SDL_DestroyCond(Worker_done_cond);
+	if (Worker_start_cond)
+		SDL_DestroyCond(Worker_start_cond);
+	if (Worker_mutex)
+		SDL_DestroyMutex(Worker_mutex);
+	Worker_done_cond = Worker_start_cond = NULL;
+	Worker_mutex = NULL;
+}
+
+int worker_num_threads(void)
+{
+	return Num_threads;
+}
+
+void worker_run(worker_job_func func, void *data, int num_jobs)
+{
+	int i, nested;
+
+	if (num_jobs <= 0)
+		return;
+
+	if (Num_threads > 1 && num_jobs > 1)
+	{
+		SDL_mutexP(Worker_mutex);
+		nested = Batch_running;
+		if (!nested)
+		{
+			Batch_func = func;
+			Batch_data = data;
+			Batch_num_jobs = num_jobs;
+			Batch_next_job = Batch_jobs_done = 0;
+			Batch_running = 1;
+			SDL_CondBroadcast(Worker_start_cond);
+
+			worker_do_jobs(0);
+			while (Batch_jobs_done < Batch_num_jobs)
+				SDL_CondWait(Worker_done_cond, Worker_mutex);
+
+			Batch_num_jobs = Batch_next_job = Batch_jobs_done = 0;
+			Batch_running = 0;
+		}
+		SDL_mutexV(Worker_mutex);
+		if (!nested)
+			return;
+	}
+
+	for (i = 0; i < num_jobs; i++)
+		func(data, i, Worker_thread_num);
+}
+
+struct worker_task
+{
+	SDL_Thread *thread;
+	SDL_mutex *mutex;
+	worker_task_func func;
+	void *data;
+	int done, result;
+};
+
+static int worker_task_thread(void *arg)
+{
+	worker_task *task = arg;
+	int result = task->func(task->data);
+
+	SDL_mutexP(task->mutex);
+	task->result = result;
+	task->done = 1;
+	SDL_mutexV(task->mutex);
+
+	return 0;
+}
+
+worker_task *worker_task_start(worker_task_func func, void *data)
+{
+	worker_task *task;
+
+	MALLOC(task, worker_task, 1);
+	task->func = func;
+	task->data = data;
+	task->done = task->result = 0;
+	task->thread = NULL;
+	task->mutex = SDL_CreateMutex();
+
+	if (task->mutex)
+		task->thread = SDL_CreateThread(worker_task_thread, task);
+	if (!task->thread)
+	{
+		task->result = func(data);
+		task->done = 1;
+	}
+
+	return task;
+}
+
+int worker_task_done(worker_task *task)
+{
+	int done;
+
+	if (!task->thread)
+		return 1;
+
+	SDL_mutexP(task->mutex);
+	done = task->done;
+	SDL_mutexV(task->mutex);
+
+	return done;
+}
+
+int worker_task_finish(worker_task *task)
+{
+	int result;
+
+	if (task->thread)
+		SDL_WaitThread(task->thread, NULL);
+	if (task->mutex)
+		SDL_DestroyMutex(task->mutex);
+	result = task->result;
+	d_free(task);
+
+	return result;
+}
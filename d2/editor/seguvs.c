@@ -34,8 +34,14 @@ COPYRIGHT 1993-1998 PARALLAX SOFTWARE CORPORATION.  ALL RIGHTS RESERVED.
 #include "bm.h"		//	Needed for TmapInfo
 #include	"effects.h"     //      Needed for effects_bm_num
 #include "fvi.h"
-
-void cast_all_light_in_mine(int quick_flag);
+#include "gamesave.h"
+#include "key.h"
+#include "timer.h"
+#include "u_mem.h"
+#include "console.h"
+#include "worker.h"
+
+int cast_all_light_in_mine(int quick_flag);
 //--rotate_uvs-- vms_vector Rightvec;
 
 //	---------------------------------------------------------------------------------------------
@@ -306,9 +312,9 @@ int set_average_light_on_all(void)
 //	set_average_light_on_all_fast();
 
 	Doing_lighting_hack_flag = 1;
-	cast_all_light_in_mine(0);
+	if (cast_all_light_in_mine(0))
+		Update_flags |= UF_WORLD_CHANGED;
 	Doing_lighting_hack_flag = 0;
-	Update_flags |= UF_WORLD_CHANGED;
 
 //	int seg, side;
 
@@ -321,8 +327,8 @@ int set_average_light_on_all(void)
 
 int set_average_light_on_all_quick(void)
 {
-	cast_all_light_in_mine(1);
-	Update_flags |= UF_WORLD_CHANGED;
+	if (cast_all_light_in_mine(1))
+		Update_flags |= UF_WORLD_CHANGED;
 
 	return 0;
 }
@@ -1115,11 +1121,27 @@ typedef struct {
 #define	FVI_HASH_SIZE 8
 #define	FVI_HASH_AND_MASK (FVI_HASH_SIZE - 1)
 
-//	Note: This should be malloced.
-//			Also, the vector should not be 12 bytes, you should only care about some smaller portion of it.
-hash_info	fvi_cache[FVI_HASH_SIZE];
 int	Hash_hits=0, Hash_retries=0, Hash_calcs=0;
 
+//	Light sources are cast in parallel on the worker threads.  Each thread adds the light it casts into its own
+//	copy of the light values, and these are added into the mine when all lights are done.  Light is never negative
+//	and side light saturates at F1_0, so the sum is the same whichever thread casts which light in what order.
+typedef struct {
+	short		segnum, sidenum;
+	fix		intensity;
+} calim_light;
+
+typedef struct {
+	fix		*side_light;					//	[segnum][sidenum][vertnum]
+	fix		*seg_light;						//	[segnum]
+	int		hash_hits, hash_retries, hash_calcs;
+} calim_thread;
+
+static calim_light	*Calim_lights = NULL;
+static int				Calim_num_lights, Calim_first_light, Calim_quick_light;
+static calim_thread	Calim_threads[MAX_WORKER_THREADS];
+static vms_vector		*Calim_seg_centers = NULL;
+
 //	-----------------------------------------------------------------------------------------
 //	Set light from a light source.
 //	Light incident on a surface is defined by the light incident at its points.
@@ -1136,12 +1158,14 @@ int	Hash_hits=0, Hash_retries=0, Hash_calcs=0;
 //	light surface itself, light will be properly cast on the light surface.  Otherwise, the
 //	vector V would be the null vector.
 //	If quick_light set, then don't use find_vector_intersection
-void cast_light_from_side(segment *segp, int light_side, fix light_intensity, int quick_light)
+//	The light is added to ct, see calim_thread.
+void cast_light_from_side(segment *segp, int light_side, fix light_intensity, int quick_light, calim_thread *ct)
 {
 	vms_vector	segment_center;
 	int			segnum,sidenum,vertnum, lightnum;
+	hash_info	fvi_cache[FVI_HASH_SIZE];	//	the vector should not be 12 bytes, you should only care about some smaller portion of it.
 
-	compute_segment_center(&segment_center, segp);
+	segment_center = Calim_seg_centers[segp-Segments];
 
 	//	Do for four lights, one just inside each corner of side containing light.
 	for (lightnum=0; lightnum<4; lightnum++) {
@@ -1174,7 +1198,7 @@ void cast_light_from_side(segment *segp, int light_side, fix light_intensity, in
 				fvi_cache[i].flag = 0;
 
 			//	efficiency hack (I hope!), for faraway segments, don't check each point.
-			compute_segment_center(&r_segment_center, rsegp);
+			r_segment_center = Calim_seg_centers[segnum];
 			dist_to_rseg = vm_vec_dist_quick(&r_segment_center, &segment_center);
 
 			if (dist_to_rseg <= LIGHT_DISTANCE_THRESHOLD) {
@@ -1182,6 +1206,7 @@ void cast_light_from_side(segment *segp, int light_side, fix light_intensity, in
 					if (WALL_IS_DOORWAY(rsegp, sidenum) != WID_NO_WALL) {
 						side			*rsidep = &rsegp->sides[sidenum];
 						vms_vector	*side_normalp = &rsidep->normals[0];	//	kinda stupid? always use vector 0.
+						fix			*side_light = &ct->side_light[(segnum*MAX_SIDES_PER_SEGMENT + sidenum)*4];
 
 						for (vertnum=0; vertnum<4; vertnum++) {
 							fix			distance_to_point, light_at_point, light_dot;
@@ -1226,18 +1251,18 @@ void cast_light_from_side(segment *segp, int light_side, fix light_intensity, in
 											if (hashp->flag) {
 												if ((hashp->vector.x == vector_to_light.x) && (hashp->vector.y == vector_to_light.y) && (hashp->vector.z == vector_to_light.z)) {
 													hit_type = hashp->hit_type;
-													Hash_hits++;
+													ct->hash_hits++;
 													break;
 												} else {
 													Int3();	// How is this possible?  Should be no hits!
-													Hash_retries++;
+													ct->hash_retries++;
 													hash_value = (hash_value+1) & FVI_HASH_AND_MASK;
 													hashp = &fvi_cache[hash_value];
 												}
 											} else {
 												fvi_query fq;
 
-												Hash_calcs++;
+												ct->hash_calcs++;
 												hashp->vector = vector_to_light;
 												hashp->flag = 1;
 
@@ -1259,9 +1284,9 @@ void cast_light_from_side(segment *segp, int light_side, fix light_intensity, in
 									switch (hit_type) {
 										case HIT_NONE:
 											light_at_point = fixmul(light_at_point, light_intensity);
-											rsidep->uvls[vertnum].l += light_at_point;
-											if (rsidep->uvls[vertnum].l > F1_0)
-												rsidep->uvls[vertnum].l = F1_0;
+											side_light[vertnum] += light_at_point;
+											if (side_light[vertnum] > F1_0)
+												side_light[vertnum] = F1_0;
 											break;
 										case HIT_WALL:
 											break;
@@ -1306,12 +1331,12 @@ void calim_zero_light_values(void)
 //	------------------------------------------------------------------------------------------
 //	Used in setting average light value in a segment, cast light from a side to the center
 //	of all segments.
-void cast_light_from_side_to_center(segment *segp, int light_side, fix light_intensity, int quick_light)
+void cast_light_from_side_to_center(segment *segp, int light_side, fix light_intensity, int quick_light, calim_thread *ct)
 {
 	vms_vector	segment_center;
 	int			segnum, lightnum;
 
-	compute_segment_center(&segment_center, segp);
+	segment_center = Calim_seg_centers[segp-Segments];
 
 	//	Do for four lights, one just inside each corner of side containing light.
 	for (lightnum=0; lightnum<4; lightnum++) {
@@ -1325,12 +1350,11 @@ void cast_light_from_side_to_center(segment *segp, int light_side, fix light_int
 		vm_vec_scale_add(&light_location, &light_location, &vector_to_center, F1_0/64);
 
 		for (segnum=0; segnum<=Highest_segment_index; segnum++) {
-			segment		*rsegp = &Segments[segnum];
 			vms_vector	r_segment_center;
 			fix			dist_to_rseg;
 //if ((segp == &Segments[Bugseg]) && (rsegp == &Segments[Bugseg]))
 //	Int3();
-			compute_segment_center(&r_segment_center, rsegp);
+			r_segment_center = Calim_seg_centers[segnum];
 			dist_to_rseg = vm_vec_dist_quick(&r_segment_center, &segment_center);
 
 			if (dist_to_rseg <= LIGHT_DISTANCE_THRESHOLD) {
@@ -1365,9 +1389,7 @@ void cast_light_from_side_to_center(segment *segp, int light_side, fix light_int
 							light_at_point = fixmul(light_at_point, light_intensity);
 							if (light_at_point >= F1_0)
 								light_at_point = F1_0-1;
-							s2s2(rsegp)->static_light += light_at_point;
-							if (s2s2(segp)->static_light < 0)	// if it went negative, saturate
-								s2s2(segp)->static_light = 0;
+							ct->seg_light[segnum] += light_at_point;
 							break;
 						case HIT_WALL:
 							break;
@@ -1388,11 +1410,14 @@ void cast_light_from_side_to_center(segment *segp, int light_side, fix light_int
 }
 
 //	------------------------------------------------------------------------------------------
-//	Process all lights.
-void calim_process_all_lights(int quick_light)
+//	Make the list of all lights.
+void calim_find_all_lights(void)
 {
 	int	segnum, sidenum;
 
+	Calim_num_lights = 0;
+	MALLOC(Calim_lights, calim_light, (Highest_segment_index+1)*MAX_SIDES_PER_SEGMENT);
+
 	for (segnum=0; segnum<=Highest_segment_index; segnum++) {
 		segment	*segp = &Segments[segnum];
 		for (sidenum=0; sidenum<MAX_SIDES_PER_SEGMENT; sidenum++) {
@@ -1413,28 +1438,187 @@ void calim_process_all_lights(int quick_light)
 //				}
 
 				if (light_intensity) {
-					light_intensity /= 4;			// casting light from four spots, so divide by 4.
-					cast_light_from_side(segp, sidenum, light_intensity, quick_light);
-					cast_light_from_side_to_center(segp, sidenum, light_intensity, quick_light);
+					calim_light	*lp = &Calim_lights[Calim_num_lights++];
+
+					lp->segnum = segnum;
+					lp->sidenum = sidenum;
+					lp->intensity = light_intensity / 4;			// casting light from four spots, so divide by 4.
 				}
 			}
 		}
 	}
 }
 
+//	------------------------------------------------------------------------------------------
+//	Cast one light, job is relative to Calim_first_light.  Runs on the worker threads.
+static void calim_cast_light(void *data, int job, int thread)
+{
+	calim_light	*lp = &Calim_lights[Calim_first_light + job];
+	segment		*segp = &Segments[lp->segnum];
+
+	cast_light_from_side(segp, lp->sidenum, lp->intensity, Calim_quick_light, &Calim_threads[thread]);
+	cast_light_from_side_to_center(segp, lp->sidenum, lp->intensity, Calim_quick_light, &Calim_threads[thread]);
+}
+
+//	------------------------------------------------------------------------------------------
+//	Add the light cast by all threads to the mine, on top of the tiny bit of light calim_zero_light_values() puts everywhere.
+void calim_apply_light_values(void)
+{
+	int	segnum, sidenum, vertnum, t;
+	int	num_threads = worker_num_threads();
+
+	calim_zero_light_values();
+
+	for (segnum=0; segnum<=Highest_segment_index; segnum++) {
+		segment *segp = &Segments[segnum];
+		for (sidenum=0; sidenum<MAX_SIDES_PER_SEGMENT; sidenum++) {
+			side	*sidep = &segp->sides[sidenum];
+			for (vertnum=0; vertnum<4; vertnum++) {
+				int	index = (segnum*MAX_SIDES_PER_SEGMENT + sidenum)*4 + vertnum;
+				fix	light = sidep->uvls[vertnum].l;
+
+				for (t=0; t<num_threads; t++)
+					light += Calim_threads[t].side_light[index];
+				sidep->uvls[vertnum].l = min(light, F1_0);
+			}
+		}
+		for (t=0; t<num_threads; t++)
+			Segment2s[segnum].static_light += Calim_threads[t].seg_light[segnum];
+		if (Segment2s[segnum].static_light < 0)	// if it went negative, saturate
+			Segment2s[segnum].static_light = 0;
+	}
+
+	for (t=0; t<num_threads; t++) {
+		Hash_hits += Calim_threads[t].hash_hits;
+		Hash_retries += Calim_threads[t].hash_retries;
+		Hash_calcs += Calim_threads[t].hash_calcs;
+	}
+}
+
+//	------------------------------------------------------------------------------------------
+//	Progress window shown while the lights are cast, with a button to cancel.
+typedef struct calim_progress {
+	UI_GADGET_BUTTON	*cancel;
+	int					cancelled;
+} calim_progress;
+
+static int calim_progress_handler(UI_DIALOG *dlg, d_event *event, calim_progress *cp)
+{
+	if (GADGET_PRESSED(cp->cancel) || (event->type == EVENT_KEY_COMMAND && event_key_get(event) == KEY_ESC)) {
+		cp->cancelled = 1;
+		return 1;
+	}
+
+	if (event->type == EVENT_UI_DIALOG_DRAW) {
+		ui_dprintf_at(dlg, 10, 10, "Casting light: %d of %d", Calim_first_light, Calim_num_lights);
+		return 1;
+	}
+
+	return 0;
+}
+
+#define	CALIM_PROGRESS_USEC	100000		//	Update the progress window this often.
+
+//	------------------------------------------------------------------------------------------
+//	Process all lights.
+//	Returns 0 if cancelled from the progress window.
+int calim_process_all_lights(int quick_light)
+{
+	UI_DIALOG		*dlg = NULL;
+	calim_progress	cp;
+	int				batch_size, t, num_threads;
+	u_int64_t		last_update;
+
+	calim_find_all_lights();
+
+	num_threads = worker_num_threads();
+	for (t=0; t<num_threads; t++) {
+		calim_thread	*ct = &Calim_threads[t];
+
+		CALLOC(ct->side_light, fix, (Highest_segment_index+1)*MAX_SIDES_PER_SEGMENT*4);
+		CALLOC(ct->seg_light, fix, Highest_segment_index+1);
+		ct->hash_hits = ct->hash_retries = ct->hash_calcs = 0;
+	}
+
+	MALLOC(Calim_seg_centers, vms_vector, Highest_segment_index+1);
+	for (t=0; t<=Highest_segment_index; t++)
+		compute_segment_center(&Calim_seg_centers[t], &Segments[t]);
+
+	Calim_quick_light = quick_light;
+	cp.cancelled = 0;
+	if (EditorWindow) {
+		dlg = ui_create_dialog(200, 200, 240, 80, DF_DIALOG | DF_MODAL, (int (*)(UI_DIALOG *, d_event *, void *))calim_progress_handler, &cp);
+		cp.cancel = ui_add_gadget_button(dlg, 80, 40, 80, 26, "Cancel", NULL);
+	}
+
+	//	Cast the lights in batches, so the progress window gets updated in between.
+	batch_size = num_threads * 4;
+	last_update = timer_query_usec();
+	for (Calim_first_light=0; Calim_first_light<Calim_num_lights && !cp.cancelled; Calim_first_light+=batch_size) {
+		worker_run(calim_cast_light, NULL, min(batch_size, Calim_num_lights - Calim_first_light));
+
+		if (dlg && timer_query_usec() - last_update >= CALIM_PROGRESS_USEC) {
+			event_process();
+			last_update = timer_query_usec();
+		}
+	}
+
+	if (dlg)
+		ui_close_dialog(dlg);
+
+	if (!cp.cancelled)
+		calim_apply_light_values();
+
+	for (t=0; t<num_threads; t++) {
+		d_free(Calim_threads[t].side_light);
+		d_free(Calim_threads[t].seg_light);
+	}
+	d_free(Calim_seg_centers);
+	d_free(Calim_lights);
+
+	return !cp.cancelled;
+}
+
 //	------------------------------------------------------------------------------------------
 //	Apply static light in mine.
-//	First, zero all light values.
-//	Then, for all light sources, cast their light.
-void cast_all_light_in_mine(int quick_flag)
+//	First, cast the light of all light sources.
+//	Then, zero all light values and add the cast light.
+//	Returns 0 if cancelled, leaving the light in the mine as it was.
+int cast_all_light_in_mine(int quick_flag)
 {
 
 	validate_segment_all();
 
-	calim_zero_light_values();
+	return calim_process_all_lights(quick_flag);
+
+}
+
+//	------------------------------------------------------------------------------------------
+//	Relight a level and save it, for the -relight command line option.
+//	Returns:
+//	 0 = successfully relit and saved.
+//	 1 = unable to load or save.
+int med_relight_level(char *filename)
+{
+	u_int64_t	start_time;
+
+	if (load_level(filename)) {
+		con_printf(CON_URGENT, "Cannot load level %s\n", filename);
+		return 1;
+	}
+
+	start_time = timer_query_usec();
+	Doing_lighting_hack_flag = 1;
+	cast_all_light_in_mine(0);
+	Doing_lighting_hack_flag = 0;
+	con_printf(CON_NORMAL, "Relit %s: %d lights in %d ms on %d threads\n", filename, Calim_num_lights, (int)((timer_query_usec() - start_time) / 1000), worker_num_threads());
 
-	calim_process_all_lights(quick_flag);
+	if (save_level(filename)) {
+		con_printf(CON_URGENT, "Cannot save level %s\n", filename);
+		return 1;
+	}
 
+	return 0;
 }
 
 // int	Fvit_num = 1000;
@@ -102,6 +102,18 @@ void g3_set_view_angles(const vms_vector *view_pos,const vms_angvec *view_orient
 //set view from x,y,z, viewer matrix, and zoom.  Must call one of g3_set_view_*() 
 void g3_set_view_matrix(const vms_vector *view_pos,const vms_matrix *view_matrix,fix zoom);
 
+//everything rotated and projected points depend on.  points rotated under
+//equal keys are the same
+typedef struct g3s_view_key {
+	vms_vector position;
+	vms_matrix matrix;		//scaled for zoom and aspect
+	fix canv_w2,canv_h2;
+} g3s_view_key;
+
+//get the key of the current view, set up by g3_start_frame() and g3_set_view_*().
+//returns 0 if no view has been set since g3_start_frame(), then the key is stale
+int g3_get_view_key(g3s_view_key *key);
+
 //end the frame
 void g3_end_frame(void);
 
@@ -142,6 +154,10 @@ g3s_codes g3_check_codes(int nv,g3s_point **pointlist);
 //rotates a point. returns codes.  does not check if already rotated
 ubyte g3_rotate_point(g3s_point *dest,const vms_vector *src);
 
+//same as g3_rotate_point() for each dest[i],src[i], but rotates them together
+//with vm_vec_rotate_n()
+void g3_rotate_points(g3s_point **dest,const vms_vector **src,int n);
+
 //projects a point
 void g3_project_point(g3s_point *point);
 
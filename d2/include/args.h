@@ -54,6 +54,8 @@ typedef struct Arg
 	int SysNoBorders;
 	int SysAutoDemo;
 	int SysNoMovies;
+	int SysThreads;
+	int SysNoLevelCache;
 	int CtlNoCursor;
 	int CtlNoMouse;
 	int CtlNoJoystick;
@@ -67,6 +69,8 @@ typedef struct Arg
 	int GfxHiresFNTAvailable;
 #ifdef OGL
 	int OglFixedFont;
+	char *OglCapture;
+	int OglCaptureFPS;
 #endif
 	const char *MplUdpHostAddr;
 	int MplUdpHostPort;
@@ -78,16 +82,19 @@ typedef struct Arg
 	int MplTrackerPort[MAX_TRACKERS];
 	int MplTrackerCount;
 #endif
+	const char *MplDxmaMirror;
 	// Self-hosted relay server, for players who can't port-forward or use a
 	// VPN: transparently tunnels the UDP session through a server both
 	// sides can reach outbound. See tools/relay_server.py.
 	char *EdiAutoLoad;
 	int EdiSaveHoardData;
+	char *EdiRelight;
 	int EdiMacData; // also used for some read routines in non-editor build
 	int DbgVerbose;
 	int DbgSafelog;
 	int DbgNoRun;
 	int DbgRenderStats;
+	int DbgProfile;
 	char *DbgAltTex;
 	char *DbgTexMap;
 	int DbgShowMemInfo;
@@ -272,6 +272,12 @@ extern	int med_load_group( char *filename, int *vertex_ids, short *segment_ids,
 //	 1 = unable to save.
 extern	int med_save_group( char *filename, int *vertex_ids, short *segment_ids, int num_vertices, int num_segments);
 
+// Loads level *filename, casts the light of all light sources in it and saves it again.
+//	Returns:
+//	 0 = successfully relit and saved.
+//	 1 = unable to load or save.
+extern	int med_relight_level(char *filename);
+
 // Updates the screen... (I put the prototype here for curves.c)
 extern   int medlisp_update_screen();
 
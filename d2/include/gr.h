@@ -369,6 +369,10 @@ extern void gr_bitmap_check_transparency( grs_bitmap * bmp );
 int gr_find_closest_color( int r, int g, int b );
 int gr_find_closest_color_15bpp( int rgb );
 
+// Changes whenever the colors gr_find_closest_color() returns may change,
+// for code that keeps its own copies of them.
+extern int gr_palette_generation;
+
 extern void gr_flip(void);
 extern void gr_set_draw_buffer(int buf);
 
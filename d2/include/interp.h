@@ -24,6 +24,43 @@ bool g3_draw_polygon_model(ubyte *model_ptr,grs_bitmap **model_bitmaps,vms_angve
 //init code for bitmap models
 void g3_init_polygon_model(void *model_ptr);
 
+//A polygon model compiled into flat arrays, so drawing it does not have to
+//decode the bytecode.  Each list of the bytecode (the whole model, and each
+//side of a sortnorm and each subcall) becomes a run of commands ending with
+//OP_EOF, with the points, normals and vertex numbers in arrays of their own.
+//Sortnorms keep both sides, since which one is drawn first depends on the
+//view.
+typedef struct g3s_model_cmd {
+	short	op;		//the OP_* it was compiled from
+	short	n;		//number of points, or vertices of a polygon
+	short	num;		//first point, 15bpp color, bitmap, animation angle, or glow number
+	ubyte	color;		//palette color of a flat polygon
+	ubyte	pad;
+	int	vec;		//into vecs: the points, a plane point and normal, the rod ends, or a subcall offset
+	int	first;		//into indices for a polygon, bottom width of a rod, or command of a subcall or the front of a sortnorm
+	int	second;		//bytecode offset of the uvls of a tmap polygon, top width of a rod, or command of the back of a sortnorm
+} g3s_model_cmd;
+
+typedef struct g3s_model_list {
+	ubyte		*model_ptr;	//the bytecode, whose uvls get their light values like when it is interpreted
+	g3s_model_cmd	*cmds;
+	vms_vector	*vecs;
+	short		*indices;
+	int		*list_offsets;	//bytecode offset of each list,
+	int		*list_cmds;	//and the command it starts at
+	int		n_cmds, n_vecs, n_indices, n_lists;
+	int		palette_generation;	//gr_palette_generation the colors were found for
+} g3s_model_list;
+
+//compile a polygon model after g3_init_polygon_model().  the list must be
+//freed before the bytecode is
+g3s_model_list *g3_compile_polygon_model(ubyte *model_ptr);
+void g3_free_compiled_model(g3s_model_list *ml);
+
+//draws the same as g3_draw_polygon_model(model_ptr + offset,...).  returns
+//false if the list at offset was not compiled, so the caller can use that
+bool g3_draw_compiled_model(g3s_model_list *ml,int offset,grs_bitmap **model_bitmaps,vms_angvec *anim_angles,g3s_lrgb light,fix *glow_values);
+
 //un-initialize, i.e., convert color entries back to RGB15
 static inline void g3_uninit_polygon_model(void *model_ptr)
 {
@@ -59,21 +59,48 @@ quadint;
 #define F0_5 	f0_5
 #define F0_1 	f0_1
 
+//The basic operations are inline, since they are in every inner loop of
+//physics, fvi, AI and lighting.  Their results must not change, because
+//demos and multiplayer depend on every machine computing the same values.
+
 //multiply two fixes, return a fix(64)
-fix fixmul (fix a, fix b);
-fix64 fixmul64 (fix a, fix b);
+static inline fix fixmul (fix a, fix b)
+{
+	return (fix)((((fix64) a) * b) / 65536);
+}
+
+static inline fix64 fixmul64 (fix a, fix b)
+{
+	return (fix64)((((fix64) a) * b) / 65536);
+}
 
 //divide two fixes, return a fix
-fix fixdiv (fix a, fix b);
+static inline fix fixdiv (fix a, fix b)
+{
+	return b ? (fix)((((fix64)a) *65536)/b) : 1;
+}
 
 //multiply two fixes, then divide by a third, return a fix
-fix fixmuldiv (fix a, fix b, fix c);
+static inline fix fixmuldiv (fix a, fix b, fix c)
+{
+	return c ? (fix)((((fix64)a)*b)/c) : 1;
+}
 
 //multiply two fixes, and add 64-bit product to a quadint
-void fixmulaccum (quadint * q, fix a, fix b);
+//the sum wraps around at 64 bits like the original 32 bit halves did
+static inline void fixmulaccum (quadint * q, fix a, fix b)
+{
+	u_int64_t s = (((u_int64_t)(u_int32_t)q->high << 32) | q->low) + (u_int64_t)((fix64)a * b);
+
+	q->low = (u_int32_t)s;
+	q->high = (int32_t)(s >> 32);
+}
 
 //extract a fix from a quadint product
-fix fixquadadjust (quadint * q);
+static inline fix fixquadadjust (quadint * q)
+{
+	return (q->high<<16) + (q->low>>16);
+}
 
 //divide a quadint by a long
 int32_t fixdivquadlong (u_int32_t qlow, u_int32_t qhigh, u_int32_t d);
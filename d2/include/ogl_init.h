@@ -95,8 +95,17 @@ void ogl_swap_buffers_internal(void);
 void ogl_set_screen_mode(void);
 void ogl_cache_level_textures(void);
 
+// Screenshots and -gl_capture are read back and written out without
+// stalling the frame, see capture.c
+void ogl_capture_screenshot(const char *filename);
+void ogl_capture_frame(void);
+void ogl_capture_flush(void);
+void ogl_capture_close(void);
+
 void ogl_urect(int left, int top, int right, int bot);
 bool ogl_ubitmapm_cs(int x, int y,int dw, int dh, grs_bitmap *bm,int c, int scale);
+void ogl_queue_glyph(int x, int y, int dw, int dh, grs_bitmap *bm, int c);
+void ogl_flush_glyphs(void);
 bool ogl_ubitblt_i(int dw, int dh, int dx, int dy, int sw, int sh, int sx, int sy, grs_bitmap * src, grs_bitmap * dest, int texfilt);
 bool ogl_ubitblt(int w, int h, int dx, int dy, int sx, int sy, grs_bitmap * src, grs_bitmap * dest);
 void ogl_upixelc(int x, int y, int c);
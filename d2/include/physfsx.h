@@ -339,6 +339,41 @@ static inline void PHYSFSX_readMatrix(vms_matrix *m,PHYSFS_file *file)
 	PHYSFSX_readVector(&m->fvec,file);
 }
 
+// A file mapped into memory by PHYSFSX_openMapped(), to be read in place.
+typedef struct PHYSFSX_map
+{
+	ubyte *data;			// the file's contents, writable, but writes don't go to the file
+	PHYSFS_sint64 size;
+	void *base;			// the whole mapping, which can hold a whole archive
+	size_t base_size;
+} PHYSFSX_map;
+
+// Read little endian values from mapped data, advancing *p past them.
+static inline int PHYSFSX_memReadInt(const ubyte **p)
+{
+	int i;
+
+	memcpy(&i, *p, sizeof(i));
+	*p += sizeof(i);
+
+	return INTEL_INT(i);
+}
+
+static inline short PHYSFSX_memReadShort(const ubyte **p)
+{
+	short s;
+
+	memcpy(&s, *p, sizeof(s));
+	*p += sizeof(s);
+
+	return INTEL_SHORT(s);
+}
+
+static inline sbyte PHYSFSX_memReadByte(const ubyte **p)
+{
+	return (sbyte)*(*p)++;
+}
+
 #define PHYSFSX_contfile_init PHYSFSX_addRelToSearchPath
 #define PHYSFSX_contfile_close PHYSFSX_removeRelFromSearchPath
 
@@ -356,6 +391,8 @@ extern PHYSFS_sint64 PHYSFSX_getFreeDiskSpace();
 extern int PHYSFSX_exists(const char *filename, int ignorecase);
 extern PHYSFS_file *PHYSFSX_openReadBuffered(const char *filename);
 extern PHYSFS_file *PHYSFSX_openWriteBuffered(const char *filename);
+extern PHYSFSX_map *PHYSFSX_openMapped(const char *filename);
+extern void PHYSFSX_closeMapped(PHYSFSX_map *map);
 extern void PHYSFSX_addArchiveContent();
 extern void PHYSFSX_removeArchiveContent();
 
@@ -0,0 +1,53 @@
+/*
+ *
+ * Frame profiler
+ *
+ */
+
+#ifndef _PROFILE_H
+#define _PROFILE_H
+
+#include "pstypes.h"
+
+// Zones are only timed while this is set, so the instrumented code costs a
+// test and a branch otherwise.
+extern int Profile_enabled;
+
+// Time the code between PROFILE_BEGIN(name) and the next PROFILE_END() on the
+// same thread as the zone name, which must be a string literal since it is
+// kept by pointer. Zones nest and can be opened on any thread, so every
+// return path of the timed code has to close the zone.
+#define PROFILE_BEGIN(name)	do { if (Profile_enabled) profile_begin(name); } while (0)
+#define PROFILE_END()		do { if (Profile_enabled) profile_end(); } while (0)
+
+void profile_init(void);
+void profile_close(void);
+
+void profile_begin(const char *name);
+void profile_end(void);
+
+// Turn timing on or off. Turning it on starts the statistics over.
+void profile_enable(int enable);
+
+// Called once per frame on the game thread. Collects the zones every thread
+// closed since the last call into the rolling statistics and the trace.
+void profile_frame(void);
+
+#define PROFILE_HISTORY 64
+
+typedef struct profile_zone_stats {
+	const char	*name;
+	int		depth;			// nesting depth the zone was first seen at
+	int		calls;			// times closed in the last frame
+	u_int64_t	avg_usec, max_usec;	// time per frame over the last PROFILE_HISTORY-1 frames
+} profile_zone_stats;
+
+// Fill stats with up to max zones, slowest first, and return how many.
+int profile_get_stats(profile_zone_stats *stats, int max);
+
+// Write the last few thousand zones of every thread to filename in the write
+// dir, in the Chrome trace event format (chrome://tracing, Perfetto).
+// Returns 0 on success.
+int profile_export_trace(const char *filename);
+
+#endif
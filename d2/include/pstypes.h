@@ -101,5 +101,12 @@ defined(__LITTLE_ENDIAN__)	// from physfs_internal.h
 # define inline __inline
 #endif
 
+// per-thread copy of a global, for state shared by code that also runs on the worker threads (see worker.h)
+#ifdef _MSC_VER
+# define __thread_local__ __declspec(thread)
+#else
+# define __thread_local__ __thread
+#endif
+
 #endif //_TYPES_H
 
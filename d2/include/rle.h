@@ -22,6 +22,8 @@ COPYRIGHT 1993-1998 PARALLAX SOFTWARE CORPORATION.  ALL RIGHTS RESERVED.
 #include "pstypes.h"
 #include "gr.h"
 
+#define MAX_CACHE_BITMAPS 32	// number of expanded bitmaps kept by rle_expand_texture()
+
 void gr_rle_decode( ubyte * src, ubyte * dest );
 int gr_rle_encode( int org_size, ubyte *src, ubyte *dest );
 int gr_rle_getsize( int org_size, ubyte *src );
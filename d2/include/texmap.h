@@ -32,6 +32,14 @@ COPYRIGHT 1993-1998 PARALLAX SOFTWARE CORPORATION.  ALL RIGHTS RESERVED.
 #define MAX_LIGHTING_VALUE	((NUM_LIGHTING_LEVELS-1)*F1_0/NUM_LIGHTING_LEVELS)
 #define MIN_LIGHTING_VALUE	(F1_0/NUM_LIGHTING_LEVELS)
 
+// The C rasterizer keeps its interface variables per thread, so the tile binner can run it on the worker
+// threads.  The assembler scanline renderers address them as plain globals, so with those they stay shared.
+#ifdef NO_ASM
+#define TMAP_THREAD __thread_local__
+#else
+#define TMAP_THREAD
+#endif
+
 #define FIX_RECIP_TABLE_SIZE	641 //increased from 321 to 641, since this res is now quite achievable.. slight fps boost -MM
 // -------------------------------------------------------------------------------------------------------
 extern fix compute_lighting_value(g3s_point *vertptr);
@@ -101,12 +109,12 @@ void gr_upoly_tmap(int nverts, int *vert );
 //function with ylr values
 void gr_upoly_tmap_ylr(int nverts, int *vert, void (*ylr_func)(int, fix, fix) );
 
-extern int Transparency_on,per2_flag;
+extern TMAP_THREAD int Transparency_on,per2_flag;
 
 //	Set to !0 to enable Sim City 2000 (or Eric's Drive Through, or Eric's Game) specific code.
 extern	int	SC2000;
 
-extern int Window_clip_left, Window_clip_bot, Window_clip_right, Window_clip_top;
+extern __thread_local__ int Window_clip_left, Window_clip_bot, Window_clip_right, Window_clip_top;
 
 // for ugly hack put in to be sure we don't overflow render buffer
 
@@ -115,5 +123,14 @@ extern int Window_clip_left, Window_clip_bot, Window_clip_right, Window_clip_top
 
 extern void init_interface_vars_to_assembler(void);
 
+// Software renderer only: between tmap_bin_begin() and tmap_bin_end(), texture maps and flat polygons are
+// queued and then rasterized in parallel on the worker threads, one band of the canvas per job.  Anything
+// else that draws to the canvas in between has to call tmap_bin_flush() first, as has anything that frees
+// a bitmap a queued polygon may use.  Does nothing unless there are worker threads.
+extern int Tmap_bin_active;
+extern void tmap_bin_begin(void);
+extern void tmap_bin_flush(void);
+extern void tmap_bin_end(void);
+
 #endif
 
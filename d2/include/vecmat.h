@@ -176,75 +176,52 @@ extern const vms_matrix vmd_identity_matrix;
 
 //Functions in library
 
-#ifndef INLINE
-
 //adds two vectors, fills in dest, returns ptr to dest
 //ok for dest to equal either source, but should use vm_vec_add2() if so
-vms_vector * vm_vec_add (vms_vector * dest, const vms_vector * src0, const vms_vector * src1);
+static inline vms_vector * vm_vec_add (vms_vector * dest, const vms_vector * src0, const vms_vector * src1)
+{
+	dest->x = src0->x + src1->x;
+	dest->y = src0->y + src1->y;
+	dest->z = src0->z + src1->z;
+
+	return dest;
+}
 
 
 //subs two vectors, fills in dest, returns ptr to dest
 //ok for dest to equal either source, but should use vm_vec_sub2() if so
-vms_vector * vm_vec_sub (vms_vector * dest, const vms_vector * src0, const vms_vector * src1);
-
+static inline vms_vector * vm_vec_sub (vms_vector * dest, const vms_vector * src0, const vms_vector * src1)
+{
+	dest->x = src0->x - src1->x;
+	dest->y = src0->y - src1->y;
+	dest->z = src0->z - src1->z;
 
-//adds one vector to another. returns ptr to dest
-//dest can equal source
-vms_vector * vm_vec_add2 (vms_vector * dest, const vms_vector * src);
+	return dest;
+}
 
 
-//subs one vector from another, returns ptr to dest
+//adds one vector to another. returns ptr to dest
 //dest can equal source
-vms_vector * vm_vec_sub2 (vms_vector * dest, const vms_vector * src);
-
-
-#else   /* INLINE */
+static inline vms_vector * vm_vec_add2 (vms_vector * dest, const vms_vector * src)
+{
+	dest->x += src->x;
+	dest->y += src->y;
+	dest->z += src->z;
 
-#define vm_vec_add(dest,src0,src1) do { \
-(dest)->x = (src0)->x + (src1)->x;
-\
-(dest)->y = (src0)->y + (src1)->y;
-\
-(dest)->z = (src0)->z + (src1)->z;
-\
+	return dest;
 }
-while (0);
 
 
-#define vm_vec_sub(dest,src0,src1) do { \
-(dest)->x = (src0)->x - (src1)->x;
-\
-(dest)->y = (src0)->y - (src1)->y;
-\
-(dest)->z = (src0)->z - (src1)->z;
-\
-}
-while (0);
-
-
-#define vm_vec_add2(dest,src) do {  \
-(dest)->x += (src)->x;
-\
-(dest)->y += (src)->y;
-\
-(dest)->z += (src)->z;
-\
-}
-while (0);
-
+//subs one vector from another, returns ptr to dest
+//dest can equal source
+static inline vms_vector * vm_vec_sub2 (vms_vector * dest, const vms_vector * src)
+{
+	dest->x -= src->x;
+	dest->y -= src->y;
+	dest->z -= src->z;
 
-#define vm_vec_sub2(dest,src) do {  \
-(dest)->x -= (src)->x;
-\
-(dest)->y -= (src)->y;
-\
-(dest)->z -= (src)->z;
-\
+	return dest;
 }
-while (0);
-
-
-#endif  /* INLINE */
 
 //averages two vectors. returns ptr to dest
 //dest can equal either source
@@ -319,7 +296,15 @@ fix vm_vec_normalized_dir_quick (vms_vector * dest, const vms_vector * end, cons
 
 
 ////returns dot product of two vectors
-fix vm_vec_dotprod (const vms_vector * v0, const vms_vector * v1);
+static inline fix vm_vec_dotprod (const vms_vector * v0, const vms_vector * v1)
+{
+	long long p =
+		  (long long) v0->x * v1->x
+		+ (long long) v0->y * v1->y
+		+ (long long) v0->z * v1->z;
+	/* Convert back to fix and return. */
+	return p >> 16;
+}
 
 #define vm_vec_dot(v0,v1) vm_vec_dotprod((v0),(v1))
 
@@ -395,6 +380,19 @@ vms_matrix * vm_vector_2_matrix (vms_matrix * m, vms_vector * fvec, vms_vector *
 //dest CANNOT equal either source
 vms_vector * vm_vec_rotate (vms_vector * dest, const vms_vector * src, const vms_matrix * m);
 
+//batch versions for loops over many vectors.  Each gives exactly the same
+//results as calling vm_vec_rotate(), vm_vec_dot() or vm_vec_mag() for every
+//element, also when built with SSE4.1 or NEON.  dest CANNOT overlap a source.
+void vm_vec_rotate_n (vms_vector * dest, const vms_vector * src, int n, const vms_matrix * m);
+void vm_vec_dot_n (fix * dest, const vms_vector * v0, const vms_vector * v1, int n);
+void vm_vec_mag_n (fix * dest, const vms_vector * v, int n);
+
+#ifndef NDEBUG
+//checks the inline and batch functions against reference versions and
+//times them.  returns the number of results that differ
+int vm_test_math (void);
+#endif
+
 
 //transpose a matrix in place. returns ptr to matrix
 vms_matrix * vm_transpose_matrix (vms_matrix * m);
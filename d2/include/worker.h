@@ -0,0 +1,50 @@
+/*
+ *
+ * Worker thread pool
+ *
+ */
+
+#ifndef _WORKER_H
+#define _WORKER_H
+
+#include "pstypes.h"
+
+#define MAX_WORKER_THREADS 32
+
+// A job function is called once for every job index of a batch. thread is
+// 0 on the game thread and 1..worker_num_threads()-1 on the worker threads,
+// so it can be used to index per-thread scratch data.
+typedef void (*worker_job_func)(void *data, int job, int thread);
+
+// Start the pool. num_threads is the total number of threads that run jobs,
+// counting the game thread. 0 or less picks the number of CPUs, 1 runs
+// everything on the game thread.
+void worker_init(int num_threads);
+void worker_close(void);
+
+// Number of threads that run the jobs of a batch, including the game thread.
+int worker_num_threads(void);
+
+// Run jobs 0..num_jobs-1 of func on the pool and return when all of them are
+// done. The game thread takes jobs too. Jobs are handed out in order, but can
+// finish in any order. Calling this from inside a job runs the nested batch
+// on the calling thread.
+void worker_run(worker_job_func func, void *data, int num_jobs);
+
+// A background task runs func(data) once on a thread of its own, for work
+// that blocks on the network or the disk and must not hold up frames. It
+// does not use the pool, so it can run while batches are running.
+typedef int (*worker_task_func)(void *data);
+typedef struct worker_task worker_task;
+
+// Start func(data). If no thread can be created, it runs right away on the
+// calling thread instead.
+worker_task *worker_task_start(worker_task_func func, void *data);
+
+// Nonzero once func has returned.
+int worker_task_done(worker_task *task);
+
+// Wait for func to return, free the task and return what func returned.
+int worker_task_finish(worker_task *task);
+
+#endif
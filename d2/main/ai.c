@@ -45,6 +45,7 @@ COPYRIGHT 1993-1999 PARALLAX SOFTWARE CORPORATION.  ALL RIGHTS RESERVED.
 #include "morph.h"
 #include "effects.h"
 #include "timer.h"
+#include "state.h"
 #include "sounds.h"
 #include "cntrlcen.h"
 #include "multibot.h"
@@ -59,6 +60,7 @@ COPYRIGHT 1993-1999 PARALLAX SOFTWARE CORPORATION.  ALL RIGHTS RESERVED.
 #include "fuelcen.h"
 #include "controls.h"
 #include "kconfig.h"
+#include "profile.h"
 
 #ifdef EDITOR
 #include "editor/editor.h"
@@ -294,7 +296,8 @@ void make_nearby_robot_snipe(void)
 int Ai_last_missile_camera = -1;
 
 // --------------------------------------------------------------------------------------------------------------------
-void do_ai_frame(object *obj)
+//	The apply phase of do_ai_frame(), see ai_read_phase().
+void do_ai_frame_apply(object *obj)
 {
 	int         objnum = obj-Objects;
 	ai_static   *aip = &obj->ctype.ai_info;
@@ -1477,6 +1480,8 @@ void do_ai_frame_all(void)
 	//dump_ai_objects_all();
 #endif
 
+	PROFILE_BEGIN("do_ai_frame_all");
+
 	set_player_awareness_all();
 
 	if (Ai_last_missile_camera > -1) {
@@ -1485,7 +1490,7 @@ void do_ai_frame_all(void)
 			int i;
 
 			Ai_last_missile_camera = -1;
-			for (i=0; i<=Highest_object_index; i++)
+			for (i=obj_first_used(); i!=-1; i=obj_next_used(i))
 				if (Objects[i].type == OBJ_ROBOT)
 					Objects[i].ctype.ai_info.SUB_FLAGS &= ~SUB_FLAGS_CAMERA_AWAKE;
 		}
@@ -1495,11 +1500,13 @@ void do_ai_frame_all(void)
 	if (Boss_dying) {
 		int i;
 
-		for (i=0; i<=Highest_object_index; i++)
+		for (i=obj_first_used(); i!=-1; i=obj_next_used(i))
 			if (Objects[i].type == OBJ_ROBOT)
 				if (Robot_info[Objects[i].id].boss_flag)
 					do_boss_dying_frame(&Objects[i]);
 	}
+
+	PROFILE_END();
 }
 
 
@@ -1573,56 +1580,56 @@ void state_ai_cloak_info_to_ai_cloak_info_rw(ai_cloak_info *aic, ai_cloak_info_r
 	aic_rw->last_position.z = aic->last_position.z;
 }
 
-int ai_save_state(PHYSFS_file *fp)
+int ai_save_state(state_writer *w)
 {
 	int i = 0;
 	fix tmptime32 = 0;
 
-	PHYSFS_write(fp, &Ai_initialized, sizeof(int), 1);
-	PHYSFS_write(fp, &Overall_agitation, sizeof(int), 1);
+	state_write(w, &Ai_initialized, sizeof(int), 1);
+	state_write(w, &Overall_agitation, sizeof(int), 1);
 	//PHYSFS_write(fp, Ai_local_info, sizeof(ai_local) * MAX_OBJECTS, 1);
 	for (i = 0; i < MAX_OBJECTS; i++)
 	{
 		ai_local_rw *ail_rw;
 		CALLOC(ail_rw, ai_local_rw, 1);
 		state_ai_local_to_ai_local_rw(&Ai_local_info[i], ail_rw);
-		PHYSFS_write(fp, ail_rw, sizeof(ai_local_rw), 1);
+		state_write(w, ail_rw, sizeof(ai_local_rw), 1);
 		d_free(ail_rw);
 	}
-	PHYSFS_write(fp, Point_segs, sizeof(point_seg) * MAX_POINT_SEGS, 1);
+	state_write(w, Point_segs, sizeof(point_seg) * MAX_POINT_SEGS, 1);
 	//PHYSFS_write(fp, Ai_cloak_info, sizeof(ai_cloak_info) * MAX_AI_CLOAK_INFO, 1);
 	for (i = 0; i < MAX_AI_CLOAK_INFO; i++)
 	{
 		ai_cloak_info_rw *aic_rw;
 		CALLOC(aic_rw, ai_cloak_info_rw, 1);
 		state_ai_cloak_info_to_ai_cloak_info_rw(&Ai_cloak_info[i], aic_rw);
-		PHYSFS_write(fp, aic_rw, sizeof(ai_cloak_info_rw), 1);
+		state_write(w, aic_rw, sizeof(ai_cloak_info_rw), 1);
 		d_free(aic_rw);
 	}
 	if (Boss_cloak_start_time - GameTime64 < F1_0*(-18000))
 		tmptime32 = F1_0*(-18000);
 	else
 		tmptime32 = Boss_cloak_start_time - GameTime64;
-	PHYSFS_write(fp, &tmptime32, sizeof(fix), 1);
+	state_write(w, &tmptime32, sizeof(fix), 1);
 	if (Boss_cloak_end_time - GameTime64 < F1_0*(-18000))
 		tmptime32 = F1_0*(-18000);
 	else
 		tmptime32 = Boss_cloak_end_time - GameTime64;
-	PHYSFS_write(fp, &tmptime32, sizeof(fix), 1);
+	state_write(w, &tmptime32, sizeof(fix), 1);
 	if (Last_teleport_time - GameTime64 < F1_0*(-18000))
 		tmptime32 = F1_0*(-18000);
 	else
 		tmptime32 = Last_teleport_time - GameTime64;
-	PHYSFS_write(fp, &tmptime32, sizeof(fix), 1);
-	PHYSFS_write(fp, &Boss_teleport_interval, sizeof(fix), 1);
-	PHYSFS_write(fp, &Boss_cloak_interval, sizeof(fix), 1);
-	PHYSFS_write(fp, &Boss_cloak_duration, sizeof(fix), 1);
+	state_write(w, &tmptime32, sizeof(fix), 1);
+	state_write(w, &Boss_teleport_interval, sizeof(fix), 1);
+	state_write(w, &Boss_cloak_interval, sizeof(fix), 1);
+	state_write(w, &Boss_cloak_duration, sizeof(fix), 1);
 	if (Last_gate_time - GameTime64 < F1_0*(-18000))
 		tmptime32 = F1_0*(-18000);
 	else
 		tmptime32 = Last_gate_time - GameTime64;
-	PHYSFS_write(fp, &tmptime32, sizeof(fix), 1);
-	PHYSFS_write(fp, &Gate_interval, sizeof(fix), 1);
+	state_write(w, &tmptime32, sizeof(fix), 1);
+	state_write(w, &Gate_interval, sizeof(fix), 1);
 	if (Boss_dying_start_time == 0) // if Boss not dead, yet we expect this to be 0, so do not convert!
 	{
 		tmptime32 = 0;
@@ -1636,39 +1643,39 @@ int ai_save_state(PHYSFS_file *fp)
 		if (tmptime32 == 0) // now if our converted value went 0 we should do something against it
 			tmptime32 = -1;
 	}
-	PHYSFS_write(fp, &tmptime32, sizeof(fix), 1);
-	PHYSFS_write(fp, &Boss_dying, sizeof(int), 1);
-	PHYSFS_write(fp, &Boss_dying_sound_playing, sizeof(int), 1);
+	state_write(w, &tmptime32, sizeof(fix), 1);
+	state_write(w, &Boss_dying, sizeof(int), 1);
+	state_write(w, &Boss_dying_sound_playing, sizeof(int), 1);
 	if (Boss_hit_time - GameTime64 < F1_0*(-18000))
 		tmptime32 = F1_0*(-18000);
 	else
 		tmptime32 = Boss_hit_time - GameTime64;
-	PHYSFS_write(fp, &tmptime32, sizeof(fix), 1);
-	PHYSFS_write(fp, &Escort_kill_object, sizeof(Escort_kill_object), 1);
+	state_write(w, &tmptime32, sizeof(fix), 1);
+	state_write(w, &Escort_kill_object, sizeof(Escort_kill_object), 1);
 	if (Escort_last_path_created - GameTime64 < F1_0*(-18000))
 		tmptime32 = F1_0*(-18000);
 	else
 		tmptime32 = Escort_last_path_created - GameTime64;
-	PHYSFS_write(fp, &tmptime32, sizeof(fix), 1);
-	PHYSFS_write(fp, &Escort_goal_object, sizeof(Escort_goal_object), 1);
-	PHYSFS_write(fp, &Escort_special_goal, sizeof(Escort_special_goal), 1);
-	PHYSFS_write(fp, &Escort_goal_index, sizeof(Escort_goal_index), 1);
-	PHYSFS_write(fp, &Stolen_items, sizeof(Stolen_items[0])*MAX_STOLEN_ITEMS, 1);
+	state_write(w, &tmptime32, sizeof(fix), 1);
+	state_write(w, &Escort_goal_object, sizeof(Escort_goal_object), 1);
+	state_write(w, &Escort_special_goal, sizeof(Escort_special_goal), 1);
+	state_write(w, &Escort_goal_index, sizeof(Escort_goal_index), 1);
+	state_write(w, &Stolen_items, sizeof(Stolen_items[0])*MAX_STOLEN_ITEMS, 1);
 
 	{
 		int temp;
 		temp = Point_segs_free_ptr - Point_segs;
-		PHYSFS_write(fp, &temp, sizeof(int), 1);
+		state_write(w, &temp, sizeof(int), 1);
 	}
 
-	PHYSFS_write(fp, &Num_boss_teleport_segs, sizeof(Num_boss_teleport_segs), 1);
-	PHYSFS_write(fp, &Num_boss_gate_segs, sizeof(Num_boss_gate_segs), 1);
+	state_write(w, &Num_boss_teleport_segs, sizeof(Num_boss_teleport_segs), 1);
+	state_write(w, &Num_boss_gate_segs, sizeof(Num_boss_gate_segs), 1);
 
 	if (Num_boss_gate_segs)
-		PHYSFS_write(fp, Boss_gate_segs, sizeof(Boss_gate_segs[0]), Num_boss_gate_segs);
+		state_write(w, Boss_gate_segs, sizeof(Boss_gate_segs[0]), Num_boss_gate_segs);
 
 	if (Num_boss_teleport_segs)
-		PHYSFS_write(fp, Boss_teleport_segs, sizeof(Boss_teleport_segs[0]), Num_boss_teleport_segs);
+		state_write(w, Boss_teleport_segs, sizeof(Boss_teleport_segs[0]), Num_boss_teleport_segs);
 
 	return 1;
 }
@@ -75,6 +75,9 @@ extern void ai_move_to_new_segment( object * obj, short newseg, int first_time )
 extern void ai_recover_from_wall_hit(object *obj, int segnum);
 extern void ai_move_one(object *objp);
 extern void do_ai_frame(object *objp);
+extern void do_ai_frame_apply(object *objp);
+extern void ai_begin_frame(void);
+extern void ai_invalidate_sight_lines(void);
 extern void init_ai_object(int objnum, int initial_mode, int hide_segment);
 extern void update_player_awareness(object *objp, fix new_awareness);
 extern void create_awareness_event(object *objp, int type);         // object *objp can create awareness of player, amount based on "type"
@@ -82,6 +85,7 @@ extern void do_ai_frame_all(void);
 extern void reset_ai_states(object *objp);
 extern int create_path_points(object *objp, int start_seg, int end_seg, point_seg *point_segs, short *num_points, int max_depth, int random_flag, int safety_flag, int avoid_seg);
 extern void create_all_paths(void);
+extern void ai_reset_path_cache(void);
 extern void create_path_to_station(object *objp, int max_length);
 extern void ai_follow_path(object *objp, int player_visibility, int previous_visibility, vms_vector *vec_to_player);
 extern void ai_turn_towards_vector(vms_vector *vec_to_player, object *obj, fix rate);
@@ -260,6 +264,17 @@ extern vms_vector   Hit_pos;
 extern int          Hit_type, Hit_seg;
 extern fvi_info     Hit_data;
 
+// Time spent in the AI phases in the last frame, shown with -renderstats
+typedef struct ai_frame_stats {
+	int robots;         // do_ai_frame() calls
+	int read_usec;      // tracing sight lines ahead on the worker threads
+	int apply_usec;     // do_ai_frame() itself
+	int traced;         // sight lines traced ahead
+	int used;           // traced sight lines do_ai_frame() could use
+} ai_frame_stats;
+
+extern ai_frame_stats Ai_frame_stats;
+
 extern int              Num_awareness_events;
 extern awareness_event  Awareness_events[MAX_AWARENESS_EVENTS];
 
@@ -299,7 +314,8 @@ extern void init_thief_for_level();
 
 extern int Escort_goal_object;
 
-extern int ai_save_state(PHYSFS_file * fp);
+struct state_writer;
+extern int ai_save_state(struct state_writer *w);
 extern int ai_restore_state(PHYSFS_file *fp, int version, int swap);
 
 extern int Buddy_objnum, Buddy_allowed_to_talk;
@@ -57,6 +57,7 @@ COPYRIGHT 1993-1999 PARALLAX SOFTWARE CORPORATION.  ALL RIGHTS RESERVED.
 #include "gauges.h"
 #include "text.h"
 #include "args.h"
+#include "worker.h"
 
 #ifdef EDITOR
 #include "editor/editor.h"
@@ -246,7 +247,7 @@ void init_boss_segments(short segptr[], int *num_segs, int size_check, int one_w
 		object		*boss_objp = &Objects[boss_objnum];
 		int			head, tail;
 		int			seg_queue[QUEUE_SIZE];
-		//ALREADY IN RENDER.H sbyte   visited[MAX_SEGMENTS];
+		sbyte		visited[MAX_SEGMENTS];	// not render.h's, that one is tagged by frame
 		fix			boss_size_save;
 
 		boss_size_save = boss_objp->size;
@@ -466,6 +467,193 @@ void ai_turn_towards_vector(vms_vector *goal_vector, object *objp, fix rate)
 //		Decreases wait between fire times by Overall_agitation/64 seconds.
 
 
+// --------------------------------------------------------------------------------------------------------------------
+//	AI read phase.
+//	Tracing the sight line from a robot to the player is most of the cost of do_ai_frame().  When the first robot of a
+//	frame is about to think, the sight line each robot is expected to check is traced ahead on the worker threads, which
+//	only reads the mine.  The robots then think one by one in object order as always, and player_is_visible_from_object()
+//	takes the traced result only if its query is exactly the one that was traced and no wall changed in between.
+//	Otherwise it traces the line itself, so the robots act exactly the same as when everything runs on one thread.
+
+#define AI_READ_MIN_ROBOTS	8		//fewer robots are not worth waking the worker threads for
+
+typedef struct ai_sight_line {
+	int		valid;
+	int		startseg;
+	vms_vector	p0, p1;
+	int		hit_type;
+	fvi_info	hit_data;
+} ai_sight_line;
+
+ai_frame_stats Ai_frame_stats;			//of the last frame, for -renderstats
+static ai_frame_stats Ai_cur_stats;
+
+static ai_sight_line Ai_sight_lines[MAX_OBJECTS];
+static short Ai_read_list[MAX_OBJECTS];
+static int Ai_read_count, Ai_read_jobs;
+static int Ai_read_pending;
+static wall Ai_read_walls[MAX_WALLS];	//Walls when the sight lines were traced
+static int Ai_read_walls_valid;
+
+// --------------------------------------------------------------------------------------------------------------------
+//	Called every frame before the objects move.
+void ai_begin_frame(void)
+{
+	int	i;
+
+	for (i=0; i<Ai_read_count; i++)
+		Ai_sight_lines[Ai_read_list[i]].valid = 0;
+	Ai_read_count = 0;
+
+	Ai_frame_stats = Ai_cur_stats;
+	memset(&Ai_cur_stats, 0, sizeof(Ai_cur_stats));
+	Ai_read_pending = 1;
+}
+
+// --------------------------------------------------------------------------------------------------------------------
+//	A side changed in a way the sight lines can't see in Walls.
+void ai_invalidate_sight_lines(void)
+{
+	Ai_read_walls_valid = 0;
+}
+
+// --------------------------------------------------------------------------------------------------------------------
+//	Trace the sight line the start of do_ai_frame() will most likely ask for.  Must not write anything but *sl.
+static void ai_trace_sight_line(object *obj, ai_sight_line *sl)
+{
+	int		objnum = obj-Objects;
+	ai_static	*aip = &obj->ctype.ai_info;
+	ai_local	ail = Ai_local_info[objnum];		//a copy, to advance the fire timers as do_ai_frame() will
+	robot_info	*robptr = &Robot_info[obj->id];
+	fix		dist_to_player;
+	fvi_query	fq;
+
+	if (aip->SKIP_AI_COUNT || (aip->SUB_FLAGS & SUB_FLAGS_CAMERA_AWAKE) || cheats.robotskillrobots)
+		return;
+
+	if (ail.next_fire > -F1_0*8)
+		ail.next_fire -= FrameTime;
+	if (robptr->weapon_type2 != -1) {
+		if (ail.next_fire2 > -F1_0*8)
+			ail.next_fire2 -= FrameTime;
+	} else
+		ail.next_fire2 = F1_0*8;
+
+	if (!(Players[Player_num].flags & PLAYER_FLAGS_CLOAKED))
+		sl->p1 = ConsoleObject->pos;
+	else
+		sl->p1 = Ai_cloak_info[objnum & (MAX_AI_CLOAK_INFO-1)].last_position;
+	dist_to_player = vm_vec_dist_quick(&sl->p1, &obj->pos);
+
+	if ((ail.previous_visibility || !((objnum ^ d_tick_count) & 3)) && ready_to_fire(robptr, &ail) && (dist_to_player < F1_0*200) && (robptr->n_guns) && !(robptr->attack_type))
+		calc_gun_point(&sl->p0, obj, (ail.next_fire <= 0) ? aip->CURRENT_GUN : 0);
+	else
+		sl->p0 = obj->pos;
+
+	if ((sl->p0.x != obj->pos.x) || (sl->p0.y != obj->pos.y) || (sl->p0.z != obj->pos.z)) {
+		sl->startseg = find_point_seg(&sl->p0, obj->segnum);
+		if (sl->startseg == -1)
+			return;
+	} else
+		sl->startseg = obj->segnum;
+
+	fq.p0						= &sl->p0;
+	fq.startseg				= sl->startseg;
+	fq.p1						= &sl->p1;
+	fq.rad					= F1_0/4;
+	fq.thisobjnum			= objnum;
+	fq.ignore_obj_list	= NULL;
+	fq.flags					= FQ_TRANSWALL;
+
+	sl->hit_type = find_vector_intersection(&fq, &sl->hit_data);
+	sl->valid = 1;
+}
+
+static void ai_read_job(void *data, int job, int thread)
+{
+	int	per_job = (Ai_read_count + Ai_read_jobs - 1) / Ai_read_jobs;
+	int	i, end = min((job+1) * per_job, Ai_read_count);
+
+	for (i=job*per_job; i<end; i++)
+		ai_trace_sight_line(&Objects[Ai_read_list[i]], &Ai_sight_lines[Ai_read_list[i]]);
+}
+
+// --------------------------------------------------------------------------------------------------------------------
+static void ai_read_phase(void)
+{
+	u_int64_t	start;
+	int		i;
+
+	Ai_read_pending = 0;
+
+	if (worker_num_threads() < 2)
+		return;
+
+	start = timer_query_usec();
+
+	for (i=0; i<=Highest_object_index; i++) {
+		object *objp = &Objects[i];
+
+		if (objp->type == OBJ_ROBOT && (objp->control_type == CT_AI || objp->control_type == CT_MORPH) && !(objp->flags & OF_SHOULD_BE_DEAD))
+			Ai_read_list[Ai_read_count++] = i;
+	}
+
+	if (Ai_read_count < AI_READ_MIN_ROBOTS) {
+		Ai_read_count = 0;
+		return;
+	}
+
+	memcpy(Ai_read_walls, Walls, Num_walls * sizeof(wall));
+	Ai_read_walls_valid = 1;
+
+	Ai_read_jobs = min(worker_num_threads() * 2, Ai_read_count);
+	worker_run(ai_read_job, NULL, Ai_read_jobs);
+
+	for (i=0; i<Ai_read_count; i++)
+		if (Ai_sight_lines[Ai_read_list[i]].valid)
+			Ai_cur_stats.traced++;
+	Ai_cur_stats.read_usec += timer_query_usec() - start;
+}
+
+// --------------------------------------------------------------------------------------------------------------------
+//	do_ai_frame() with the read phase in front and the time it takes counted.
+void do_ai_frame(object *obj)
+{
+	u_int64_t	start;
+
+	if (Ai_read_pending)
+		ai_read_phase();
+
+	start = timer_query_usec();
+	do_ai_frame_apply(obj);
+	Ai_cur_stats.apply_usec += timer_query_usec() - start;
+	Ai_cur_stats.robots++;
+}
+
+// --------------------------------------------------------------------------------------------------------------------
+//	Return the traced hit type and fill in *hit_data if the sight line for fq was traced in the read phase, else -1.
+static int ai_sight_line_lookup(fvi_query *fq, fvi_info *hit_data)
+{
+	ai_sight_line	*sl = &Ai_sight_lines[fq->thisobjnum];
+
+	if (!sl->valid)
+		return -1;
+	sl->valid = 0;		//good for one query
+
+	if (Ai_read_walls_valid && memcmp(Walls, Ai_read_walls, Num_walls * sizeof(wall)))
+		Ai_read_walls_valid = 0;
+
+	if (!Ai_read_walls_valid || fq->startseg != sl->startseg || fq->rad != F1_0/4 || fq->flags != FQ_TRANSWALL || fq->ignore_obj_list ||
+		fq->p0->x != sl->p0.x || fq->p0->y != sl->p0.y || fq->p0->z != sl->p0.z ||
+		fq->p1->x != sl->p1.x || fq->p1->y != sl->p1.y || fq->p1->z != sl->p1.z)
+		return -1;
+
+	*hit_data = sl->hit_data;
+	Ai_cur_stats.used++;
+
+	return sl->hit_type;
+}
+
 // --------------------------------------------------------------------------------------------------------------------
 //	Returns:
 //		0		Player is not visible from object, obstruction or something.
@@ -504,7 +692,9 @@ int player_is_visible_from_object(object *objp, vms_vector *pos, fix field_of_vi
 	fq.ignore_obj_list	= NULL;
 	fq.flags					= FQ_TRANSWALL; // -- Why were we checking objects? | FQ_CHECK_OBJS;		//what about trans walls???
 
-	Hit_type = find_vector_intersection(&fq,&Hit_data);
+	Hit_type = ai_sight_line_lookup(&fq, &Hit_data);
+	if (Hit_type == -1)
+		Hit_type = find_vector_intersection(&fq,&Hit_data);
 
 	Hit_pos = Hit_data.hit_pnt;
 	Hit_seg = Hit_data.hit_seg;
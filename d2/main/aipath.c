@@ -39,6 +39,7 @@ COPYRIGHT 1993-1999 PARALLAX SOFTWARE CORPORATION.  ALL RIGHTS RESERVED.
 #include "player.h"
 #include "fireball.h"
 #include "game.h"
+#include "timer.h"
 
 #define	PARALLAX	0		//	If !0, then special debugging for Parallax eyes enabled.
 
@@ -142,6 +143,7 @@ void insert_center_points(point_seg *psegs, int *num_points)
 int	Safety_flag_override = 0;
 int	Random_flag_override = 0;
 int	Ai_path_debug=0;
+static int	Path_bfs_only = 0;		//	set by test_create_all_paths() to time the breadth first search by itself
 #endif
 
 //	-----------------------------------------------------------------------------------------------------------
@@ -261,6 +263,309 @@ if (vm_vec_mag_quick(&e) < F1_0/2)
 }
 
 
+//	-----------------------------------------------------------------------------------------------------------
+//	Goal directed search and path cache for create_path_points().
+//	The A* search costs PATH_HOP_COST for every segment, plus one for every door that has to be opened, so of the
+//	shortest paths it takes the one through the fewest doors.  The estimate of the cost to the goal is the straight
+//	line distance between the segment centers over the longest step between the centers of two connected segments,
+//	which can't be more than the number of segments still to go.  So the path is as short as the breadth first
+//	search would have found, but the search only looks at the segments towards the goal.
+
+#define	PATH_HOP_COST			256
+#define	PATH_CACHE_SIZE		1024				//	must be a power of 2
+#define	PATH_CACHE_MAX_SEGS	(MAX_PATH_LENGTH+1)
+
+typedef struct path_heap_entry {
+	int		f, g;
+	short		segnum;
+} path_heap_entry;
+
+typedef struct path_cache_entry {
+	int		epoch;								//	Path_epoch when the path was found, 0 if unused
+	int		opener;								//	which doors the object can open, see path_opener()
+	short		start_seg, end_seg;
+	sbyte		max_hops;							//	how many segments the search was allowed to go
+	sbyte		num_segs;							//	-1 if there is no path within max_hops
+	short		segs[PATH_CACHE_MAX_SEGS];
+} path_cache_entry;
+
+static vms_vector	Path_seg_center[MAX_SEGMENTS];
+static fix			Path_max_step;
+static int			Path_centers_valid = 0;
+
+static int			Path_g[MAX_SEGMENTS];
+static short		Path_parent[MAX_SEGMENTS];
+static int			Path_stamp[MAX_SEGMENTS];		//	== Path_cur_stamp if the segment was reached by the current search
+static int			Path_cur_stamp = 0;
+static path_heap_entry	Path_heap[MAX_SEGMENTS*MAX_SIDES_PER_SEGMENT+1];
+static int			Path_heap_size;
+static short		Path_segs[MAX_SEGMENTS];
+
+static path_cache_entry	Path_cache[PATH_CACHE_SIZE];
+static int			Path_epoch = 1;					//	bumped whenever the cached paths may have become wrong
+static wall			Path_walls[MAX_WALLS];			//	Walls when the cached paths were found
+static int			Path_num_walls = -1;
+
+//	-----------------------------------------------------------------------------------------------------------
+//	Forget all cached paths.  Called when a new mine is loaded.
+void ai_reset_path_cache(void)
+{
+	Path_centers_valid = 0;
+	Path_num_walls = -1;
+	Path_epoch++;
+}
+
+//	-----------------------------------------------------------------------------------------------------------
+//	A door opening, closing or being blown up changes which segments are connected, so drop the cached paths.
+static void path_check_walls(void)
+{
+	if ((Path_num_walls == Num_walls) && !memcmp(Walls, Path_walls, Num_walls * sizeof(wall)))
+		return;
+
+	memcpy(Path_walls, Walls, Num_walls * sizeof(wall));
+	Path_num_walls = Num_walls;
+	Path_epoch++;
+}
+
+//	-----------------------------------------------------------------------------------------------------------
+static void path_init_centers(void)
+{
+	int	segnum, sidenum;
+
+	for (segnum=0; segnum<=Highest_segment_index; segnum++)
+		compute_segment_center(&Path_seg_center[segnum], &Segments[segnum]);
+
+	Path_max_step = 0;
+	for (segnum=0; segnum<=Highest_segment_index; segnum++)
+		for (sidenum=0; sidenum<MAX_SIDES_PER_SEGMENT; sidenum++) {
+			int	child = Segments[segnum].children[sidenum];
+
+			if (IS_CHILD(child)) {
+				fix	dist = vm_vec_dist(&Path_seg_center[segnum], &Path_seg_center[child]);
+
+				if (dist > Path_max_step)
+					Path_max_step = dist;
+			}
+		}
+
+	Path_max_step += F1_0;		//	so rounding in vm_vec_dist() can't make the estimate too big
+	Path_centers_valid = 1;
+}
+
+//	-----------------------------------------------------------------------------------------------------------
+//	Least number of segments from segnum to end_seg.
+static int path_estimate(int segnum, int end_seg)
+{
+	return f2i(fixdiv(vm_vec_dist(&Path_seg_center[segnum], &Path_seg_center[end_seg]), Path_max_step));
+}
+
+//	-----------------------------------------------------------------------------------------------------------
+//	Of two entries with the same cost, take the one furthest along first.
+#define PATH_HEAP_LESS(a,b) (((a).f < (b).f) || (((a).f == (b).f) && ((a).g > (b).g)))
+
+static void path_heap_push(int f, int g, int segnum)
+{
+	int	i = Path_heap_size++;
+
+	Assert(Path_heap_size <= MAX_SEGMENTS*MAX_SIDES_PER_SEGMENT+1);
+
+	Path_heap[i].f = f;
+	Path_heap[i].g = g;
+	Path_heap[i].segnum = segnum;
+
+	while (i > 0) {
+		int				parent = (i-1)/2;
+		path_heap_entry	temp;
+
+		if (!PATH_HEAP_LESS(Path_heap[i], Path_heap[parent]))
+			break;
+		temp = Path_heap[i];
+		Path_heap[i] = Path_heap[parent];
+		Path_heap[parent] = temp;
+		i = parent;
+	}
+}
+
+static path_heap_entry path_heap_pop(void)
+{
+	path_heap_entry	top = Path_heap[0];
+	int				i = 0;
+
+	Path_heap[0] = Path_heap[--Path_heap_size];
+
+	for (;;) {
+		int				child = 2*i+1;
+		path_heap_entry	temp;
+
+		if (child >= Path_heap_size)
+			break;
+		if ((child+1 < Path_heap_size) && PATH_HEAP_LESS(Path_heap[child+1], Path_heap[child]))
+			child++;
+		if (!PATH_HEAP_LESS(Path_heap[child], Path_heap[i]))
+			break;
+		temp = Path_heap[i];
+		Path_heap[i] = Path_heap[child];
+		Path_heap[child] = temp;
+		i = child;
+	}
+
+	return top;
+}
+
+//	-----------------------------------------------------------------------------------------------------------
+//	Find a shortest path from start_seg to end_seg through at most max_hops segments after start_seg.
+//	Write its segments, start_seg first, to segs and return how many there are, or return -1 if there is no such path.
+//	Neighbors are tried in the same order as in create_path_points(), so random_flag spreads paths the same way.
+static int path_astar(object *objp, int start_seg, int end_seg, int max_hops, int random_flag, short *segs)
+{
+	sbyte	random_xlate[MAX_SIDES_PER_SEGMENT];
+	int	sidenum, segnum, num_segs, i;
+
+	if (!Path_centers_valid)
+		path_init_centers();
+
+	if (path_estimate(start_seg, end_seg) > max_hops)
+		return -1;
+
+	Path_cur_stamp++;
+	Path_heap_size = 0;
+
+	Path_stamp[start_seg] = Path_cur_stamp;
+	Path_g[start_seg] = 0;
+	Path_parent[start_seg] = -1;
+	path_heap_push(path_estimate(start_seg, end_seg) * PATH_HOP_COST, 0, start_seg);
+
+	if (random_flag)
+		create_random_xlate(random_xlate);
+
+	while (Path_heap_size) {
+		path_heap_entry	cur = path_heap_pop();
+		segment			*segp = &Segments[cur.segnum];
+
+		if (cur.g != Path_g[cur.segnum])
+			continue;		//	found a cheaper way there after this was queued
+		if (cur.segnum == end_seg)
+			break;
+
+		if (random_flag)
+			if (d_rand() < 8192)
+				create_random_xlate(random_xlate);
+
+		for (sidenum=0; sidenum<MAX_SIDES_PER_SEGMENT; sidenum++) {
+			int	snum = random_flag ? random_xlate[sidenum] : sidenum;
+			int	child = segp->children[snum];
+			int	g, h;
+
+			if (!IS_CHILD(child))
+				continue;
+
+			if (WALL_IS_DOORWAY(segp, snum) & WID_FLY_FLAG)
+				g = cur.g + PATH_HOP_COST;
+			else if (ai_door_is_openable(objp, segp, snum))
+				g = cur.g + PATH_HOP_COST + 1;
+			else
+				continue;
+
+			if ((Path_stamp[child] == Path_cur_stamp) && (g >= Path_g[child]))
+				continue;
+
+			h = path_estimate(child, end_seg);
+			if (g/PATH_HOP_COST + h > max_hops)
+				continue;
+
+			Path_stamp[child] = Path_cur_stamp;
+			Path_g[child] = g;
+			Path_parent[child] = cur.segnum;
+			path_heap_push(g + h*PATH_HOP_COST, g, child);
+		}
+	}
+
+	if (Path_stamp[end_seg] != Path_cur_stamp)
+		return -1;
+
+	num_segs = 0;
+	for (segnum=end_seg; segnum!=-1; segnum=Path_parent[segnum])
+		num_segs++;
+
+	i = num_segs;
+	for (segnum=end_seg; segnum!=-1; segnum=Path_parent[segnum])
+		segs[--i] = segnum;
+
+	return num_segs;
+}
+
+//	-----------------------------------------------------------------------------------------------------------
+//	Which doors ai_door_is_openable() lets objp through, or -1 if that depends on more than Walls and the keys.
+static int path_opener(object *objp)
+{
+	if ((objp == NULL) || (objp == ConsoleObject) || (objp->type != OBJ_ROBOT) || Robot_info[objp->id].companion)
+		return -1;
+
+	if ((objp->id == ROBOT_BRAIN) || (objp->ctype.ai_info.behavior == AIB_RUN_FROM) || (objp->ctype.ai_info.behavior == AIB_SNIPE))
+		return 1 | (Players[Player_num].flags & (PLAYER_FLAGS_BLUE_KEY | PLAYER_FLAGS_RED_KEY | PLAYER_FLAGS_GOLD_KEY));
+
+	return 0;
+}
+
+//	-----------------------------------------------------------------------------------------------------------
+//	Find a shortest path of at most max_hops segments for create_path_points(), from the cache if it was found before.
+//	Fill in psegs and return the number of points, or return -1 if there is no such path.
+static int path_find(object *objp, int start_seg, int end_seg, int max_hops, int random_flag, point_seg *psegs)
+{
+	path_cache_entry	*entry = NULL;
+	int		opener, num_segs, i;
+
+#ifdef EDITOR
+	if (EditorWindow)
+		return -1;		//	the mine can change under the cached segment centers
+	if (Path_bfs_only)
+		return -1;
+#endif
+
+	opener = path_opener(objp);
+
+	if (opener != -1) {
+		path_check_walls();
+
+		entry = &Path_cache[(start_seg * 31 + end_seg * 7 + opener) & (PATH_CACHE_SIZE-1)];
+		if ((entry->epoch == Path_epoch) && (entry->start_seg == start_seg) && (entry->end_seg == end_seg) && (entry->opener == opener)) {
+			if (entry->num_segs == -1) {
+				if (max_hops <= entry->max_hops)
+					return -1;
+			} else if (entry->num_segs-1 > max_hops)
+				return -1;
+			//	One time in four, search again so robots sent along the same way don't all take the same path.
+			else if (!random_flag || (d_rand() >= 8192)) {
+				for (i=0; i<entry->num_segs; i++) {
+					psegs[i].segnum = entry->segs[i];
+					compute_segment_center(&psegs[i].point, &Segments[entry->segs[i]]);
+				}
+				return entry->num_segs;
+			}
+		}
+	}
+
+	num_segs = path_astar(objp, start_seg, end_seg, max_hops, random_flag, Path_segs);
+
+	if (entry && (num_segs <= PATH_CACHE_MAX_SEGS) && (max_hops < 128)) {
+		entry->epoch = Path_epoch;
+		entry->opener = opener;
+		entry->start_seg = start_seg;
+		entry->end_seg = end_seg;
+		entry->max_hops = max_hops;
+		entry->num_segs = num_segs;
+		if (num_segs > 0)
+			memcpy(entry->segs, Path_segs, num_segs * sizeof(short));
+	}
+
+	for (i=0; i<num_segs; i++) {
+		psegs[i].segnum = Path_segs[i];
+		compute_segment_center(&psegs[i].point, &Segments[Path_segs[i]]);
+	}
+
+	return num_segs;
+}
+
 //	-----------------------------------------------------------------------------------------------------------
 //	Create a path from objp->pos to the center of end_seg.
 //	Return a list of (segment_num, point_locations) at psegs
@@ -300,6 +605,16 @@ if ((objp->type == OBJ_ROBOT) && (objp->ctype.ai_info.behavior == AIB_RUN_FROM))
 	if (max_depth == -1)
 		max_depth = MAX_PATH_LENGTH;
 
+	//	A path to a known segment no longer than the breadth first search is sure to find can come from path_find().
+	//	Otherwise the search below stops at max_depth with part of a path, which some callers want.
+	if ((end_seg >= 0) && (avoid_seg == -1) && (max_depth > 2)) {
+		l_num_points = path_find(objp, start_seg, end_seg, max_depth-2, random_flag, psegs);
+		if (l_num_points > 0) {
+			psegs += l_num_points;
+			goto cpp_found;
+		}
+	}
+
 	l_num_points = 0;
 //random_flag = Random_flag_override; //!! debug!!
 //safety_flag = Safety_flag_override; //!! debug!!
@@ -450,6 +765,8 @@ cpp_done1: ;
 		*(original_psegs + i) = *(original_psegs + l_num_points - i - 1);
 		*(original_psegs + l_num_points - i - 1) = temp_point_seg;
 	}
+
+cpp_found: ;
 #if PATH_VALIDATION
 	validate_path(2, original_psegs, l_num_points);
 #endif
@@ -1407,22 +1724,49 @@ void test_create_path(void)
 }
 
 //	For all segments in mine, create paths to all segments in mine, print results.
+//	Every path is found both by the breadth first search and by path_astar(), which must agree on its length.
 void test_create_all_paths(void)
 {
 	int	start_seg, end_seg;
 	short	resultant_length;
+	int	num_paths = 0, num_found = 0, num_wrong = 0;
+	u_int64_t	bfs_usec = 0, astar_usec = 0, t;
 
 	Point_segs_free_ptr = Point_segs;
+	ai_reset_path_cache();
 
 	for (start_seg=0; start_seg<=Highest_segment_index-1; start_seg++) {
 		if (Segments[start_seg].segnum != -1) {
 			for (end_seg=start_seg+1; end_seg<=Highest_segment_index; end_seg++) {
 				if (Segments[end_seg].segnum != -1) {
-					create_path_points(&Objects[0], start_seg, end_seg, Point_segs_free_ptr, &resultant_length, -1, 0, 0, -1);
+					int	num_segs, rval;
+
+					Path_bfs_only = 1;
+					t = timer_query_usec();
+					rval = create_path_points(&Objects[0], start_seg, end_seg, Point_segs_free_ptr, &resultant_length, -1, 0, 0, -1);
+					bfs_usec += timer_query_usec() - t;
+					Path_bfs_only = 0;
+
+					t = timer_query_usec();
+					num_segs = path_astar(&Objects[0], start_seg, end_seg, MAX_PATH_LENGTH-2, 0, Path_segs);
+					astar_usec += timer_query_usec() - t;
+
+					num_paths++;
+					if (num_segs != -1)
+						num_found++;
+
+					//	Within MAX_PATH_LENGTH-2 segments the breadth first search always gets to end_seg.
+					if ((rval == 0) && (Point_segs_free_ptr[resultant_length-1].segnum == end_seg) && (resultant_length-1 <= MAX_PATH_LENGTH-2)) {
+						if (num_segs != resultant_length)
+							num_wrong++;
+					} else if (num_segs != -1)
+						num_wrong++;
 				}
 			}
 		}
 	}
+
+	con_printf(CON_NORMAL, "Paths between %i pairs of segments, %i within %i segments: breadth first %lu us, A* %lu us, %i differ\n", num_paths, num_found, MAX_PATH_LENGTH-2, (unsigned long)bfs_usec, (unsigned long)astar_usec, num_wrong);
 }
 
 short	Player_path_length=0;
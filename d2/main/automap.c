@@ -545,12 +545,12 @@ void draw_automap(automap *am)
 	gr_clear_canvas(BM_XRGB(0,0,0));
 
 	g3_start_frame();
-	render_start_frame();
 
 	if (!PlayerCfg.AutomapFreeFlight)
 		vm_vec_scale_add(&am->view_position,&am->view_target,&am->viewMatrix.fvec,-am->viewDist);
 
 	g3_set_view_matrix(&am->view_position,&am->viewMatrix,am->zoom);
+	render_start_frame();
 
 	draw_all_edges(am);
 
@@ -589,8 +589,8 @@ void draw_automap(automap *am)
 	}
 #endif
 
-	objp = &Objects[0];
-	for (i=0;i<=Highest_object_index;i++,objp++) {
+	for (i=obj_first_used();i!=-1;i=obj_next_used(i)) {
+		objp = &Objects[i];
 		switch( objp->type )	{
 		case OBJ_HOSTAGE:
 			gr_setcolor(am->hostage_color);
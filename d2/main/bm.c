@@ -149,6 +149,7 @@ int gamedata_init()
 				Error("Cannot open ham file\n");
 
 	piggy_read_sounds();
+	digi_prepare_sounds();
 
 #ifdef OGL
 	xmodel_load_all();
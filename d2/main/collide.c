@@ -631,6 +631,8 @@ int check_effect_blowup(segment *seg,int side,vms_vector *pnt, object *blower, i
 				}
 
 
+				ai_invalidate_sight_lines();	//transparency of the side may have changed
+
 				return 1;		//blew up!
 			}
 		}
@@ -37,6 +37,9 @@ extern int digi_init();
 extern void digi_reset();
 extern void digi_close();
 
+// Called once the sounds are loaded, to get them ready for playing
+extern void digi_prepare_sounds();
+
 // Volume is max at F1_0.
 extern void digi_play_sample( int sndnum, fix max_volume );
 extern void digi_play_sample_once( int sndnum, fix max_volume );
@@ -38,6 +38,10 @@
  * not certainty. A future protocol addition (the host advertising its own
  * DXMA id) would make this exact; nothing here blocks that.
  *
+ * The normalized forms are computed once per load, along with a trigram
+ * index over them (dxma_build_index()), so the lookup and the browser's
+ * filter only score the rows that can possibly match.
+ *
  * -------------------------------------------------------- safe download --
  *
  * The original version of this feature built a shell command line by
@@ -59,6 +63,28 @@
  * and dxma_safe_basename() rejects any download filename containing a path
  * separator or "..", so a malicious CSV entry cannot write outside
  * MISSION_DIR either.
+ *
+ * ------------------------------------------------------- download queue --
+ *
+ * Mission downloads run on a background task (see worker.h), one at a time
+ * from a small queue, so the game keeps drawing and the network keeps
+ * running while a map comes down. The transfer writes to "<file>.part" and
+ * only renames it to the real name once it is complete; an interrupted or
+ * cancelled download leaves the .part behind and the next attempt resumes
+ * from it (an HTTP range request with libcurl, -C - / -c with the spawned
+ * tools). A server that will not resume gets a fresh transfer instead.
+ *
+ * Zips are unpacked through PhysFS itself -- the archive is mounted at a
+ * private mount point and its files are copied into MISSION_DIR<stem>/ --
+ * with unzip/tar only as a fallback for a PhysFS built without zip support.
+ *
+ * The download thread never touches the console, the menus or d_malloc;
+ * it only fills in its dxma_download entry, and dxma_download_poll() on the
+ * game thread reports the result and starts the next one. It runs from
+ * event_process(), so the queue keeps going under any menu or modal loop. -dxmamirror
+ * swaps the sectorgame.com host for another server (e.g. a local
+ * "python3 -m http.server" serving the same paths), so the whole path can
+ * be exercised without DXMA.
  */
 
 #include <stdio.h>
@@ -81,16 +107,19 @@
 #include "window.h"
 #include "dxma.h"
 #include "gamefont.h"
+#include "args.h"
+#include "worker.h"
 
 #ifdef _WIN32
 #include <windows.h>
 #include <direct.h>
 #else
 #include <unistd.h>
+#include <signal.h>
 #include <sys/wait.h>
-#include <sys/stat.h>
 #include <dlfcn.h>
 #endif
+#include <sys/stat.h>
 
 // Symbols from the generated dxma_csv_data.c (cmake/embed_file.cmake output).
 extern const unsigned char dxma_csv_data[];
@@ -99,7 +128,7 @@ extern const unsigned int dxma_csv_data_len;
 #define DXMA_CACHE_FILE   "dxma_missions_cache.csv"
 #define DXMA_REFRESH_URL  "https://sectorgame.com/dxma/export/csv"
 #define DXMA_LISTING_URL  "https://sectorgame.com/dxma/"
-#define MAX_DXMA_MISSIONS 3000
+#define MAX_DXMA_MISSIONS 16384
 #define DXMA_ROW_TEXT_LEN 256
 #define DXMA_FILTER_LEN 48
 #define DXMA_REFRESH_MAX_PAGES 80
@@ -108,8 +137,17 @@ extern const unsigned int dxma_csv_data_len;
 static dxma_mission Missions[MAX_DXMA_MISSIONS];
 static int MissionCount = 0;
 
+// Progress and cancel state of one background transfer. Written by the
+// download thread, read (and cancel set) by the game thread.
+typedef struct dxma_transfer {
+	volatile PHYSFS_sint64 bytes_done;    // -1 while a spawned tool has it, see dxma_download_status()
+	volatile PHYSFS_sint64 bytes_total;   // 0 while unknown
+	volatile int cancel;
+	char error[128];                      // reported by dxma_download_poll()
+} dxma_transfer;
+
 static int dxma_url_is_safe(const char *url);
-static int dxma_try_download(const char *url, const char *dest);
+static int dxma_try_download(const char *url, const char *dest, dxma_transfer *xfer);
 
 // ------------------------------------------------------------- CSV parsing
 
@@ -198,6 +236,178 @@ static int dxma_compare(const void *a, const void *b)
 	return d_stricmp(((const dxma_mission *)a)->title, ((const dxma_mission *)b)->title);
 }
 
+// ------------------------------------------------------------ search index
+
+// Rebuilt by dxma_build_index() whenever Missions changes, so that neither
+// the join-time lookup nor the browser filter has to normalize and compare
+// every row of a table that keeps growing:
+//  - MissionKeys holds the normalized title, author and download filename of
+//    each row (see dxma_normalize());
+//  - IdSet is an open-addressed hash of the row ids, used to drop rows that
+//    are already in the table when merging the cache or a scrape;
+//  - the trigram index lists, for every run of three normalized characters,
+//    the rows whose keys contain it, in table order. A row containing some
+//    string contains each of its trigrams, so one trigram list of the string
+//    holds every row that can match it.
+
+typedef struct dxma_keys {
+	char title[128];
+	char author[64];
+	char file[128];
+} dxma_keys;
+
+#define DXMA_ID_SET_SIZE  (MAX_DXMA_MISSIONS * 2)   // power of two, never more than half full
+#define DXMA_KEY_CHARS    36                         // 0-9 and a-z, after dxma_normalize()
+#define DXMA_NUM_TRIGRAMS (DXMA_KEY_CHARS * DXMA_KEY_CHARS * DXMA_KEY_CHARS)
+
+static dxma_keys *MissionKeys = NULL;
+static ubyte *MissionMarks = NULL;
+static const char *IdSet[DXMA_ID_SET_SIZE];
+static int *TrigramStart = NULL;   // DXMA_NUM_TRIGRAMS + 1 offsets into TrigramRows
+static int *TrigramRows = NULL;
+static int IndexGeneration = 0;    // bumped by every rebuild
+
+// Lowercase, alnum-only projection, used to compare a mission filename stem
+// against a DXMA title or download filename despite punctuation/case/spacing
+// differences between them.
+static void dxma_normalize(const char *in, char *out, size_t outsz)
+{
+	size_t j = 0;
+	for (size_t i = 0; in[i] && j + 1 < outsz; i++)
+		if (isalnum((unsigned char)in[i]))
+			out[j++] = (char)tolower((unsigned char)in[i]);
+	out[j] = '\0';
+}
+
+static int dxma_key_char(char c)
+{
+	if (c >= '0' && c <= '9') return c - '0';
+	if (c >= 'a' && c <= 'z') return c - 'a' + 10;
+	return -1;
+}
+
+// Trigram number of the first three characters of a normalized string, or -1
+// if it is shorter than that.
+static int dxma_trigram(const char *s)
+{
+	if (!s[0] || !s[1] || !s[2]) return -1;
+	int a = dxma_key_char(s[0]), b = dxma_key_char(s[1]), c = dxma_key_char(s[2]);
+	if (a < 0 || b < 0 || c < 0) return -1;
+	return (a * DXMA_KEY_CHARS + b) * DXMA_KEY_CHARS + c;
+}
+
+static unsigned dxma_id_hash(const char *id)
+{
+	unsigned h = 2166136261u;   // FNV-1a
+	while (*id)
+		h = (h ^ (unsigned char)*id++) * 16777619u;
+	return h & (DXMA_ID_SET_SIZE - 1);
+}
+
+static int dxma_has_id(const char *id)
+{
+	for (unsigned i = dxma_id_hash(id); IdSet[i]; i = (i + 1) & (DXMA_ID_SET_SIZE - 1))
+		if (!strcmp(IdSet[i], id))
+			return 1;
+	return 0;
+}
+
+// Adds id, which must stay where it is until the next rebuild. Returns 0 if
+// it was already there.
+static int dxma_add_id(const char *id)
+{
+	unsigned i = dxma_id_hash(id);
+	for (; IdSet[i]; i = (i + 1) & (DXMA_ID_SET_SIZE - 1))
+		if (!strcmp(IdSet[i], id))
+			return 0;
+	IdSet[i] = id;
+	return 1;
+}
+
+static void dxma_clear_ids(void)
+{
+	memset(IdSet, 0, sizeof(IdSet));
+}
+
+// Visits every distinct trigram in the keys of row once. The first pass
+// (slot NULL) counts them, the second stores row at slot[trigram].
+static void dxma_index_row(int row, int *last, int *slot)
+{
+	const char *keys[3] = { MissionKeys[row].title, MissionKeys[row].author, MissionKeys[row].file };
+	for (int k = 0; k < 3; k++)
+		for (const char *s = keys[k]; *s; s++)
+		{
+			int t = dxma_trigram(s);
+			if (t < 0 || last[t] == row)
+				continue;
+			last[t] = row;
+			if (slot)
+				TrigramRows[slot[t]++] = row;
+			else
+				TrigramStart[t + 1]++;
+		}
+}
+
+static void dxma_build_index(void)
+{
+	int n = MissionCount, *last, *slot;
+
+	dxma_clear_ids();
+	for (int i = 0; i < n; i++)
+		dxma_add_id(Missions[i].id);
+
+	MissionKeys = d_realloc(MissionKeys, sizeof(dxma_keys) * (n ? n : 1));
+	MissionMarks = d_realloc(MissionMarks, n ? n : 1);
+	for (int i = 0; i < n; i++)
+	{
+		const char *url = Missions[i].direct_download_url[0] ? Missions[i].direct_download_url : Missions[i].download_url;
+		const char *slash = strrchr(url, '/');
+		dxma_normalize(Missions[i].title, MissionKeys[i].title, sizeof(MissionKeys[i].title));
+		dxma_normalize(Missions[i].author, MissionKeys[i].author, sizeof(MissionKeys[i].author));
+		dxma_normalize(slash ? slash + 1 : url, MissionKeys[i].file, sizeof(MissionKeys[i].file));
+	}
+
+	if (!TrigramStart)
+		MALLOC(TrigramStart, int, DXMA_NUM_TRIGRAMS + 1);
+	MALLOC(last, int, DXMA_NUM_TRIGRAMS);
+	MALLOC(slot, int, DXMA_NUM_TRIGRAMS);
+
+	memset(TrigramStart, 0, sizeof(int) * (DXMA_NUM_TRIGRAMS + 1));
+	memset(last, -1, sizeof(int) * DXMA_NUM_TRIGRAMS);
+	for (int i = 0; i < n; i++)
+		dxma_index_row(i, last, NULL);
+	for (int t = 0; t < DXMA_NUM_TRIGRAMS; t++)
+		TrigramStart[t + 1] += TrigramStart[t];
+
+	TrigramRows = d_realloc(TrigramRows, sizeof(int) * (TrigramStart[DXMA_NUM_TRIGRAMS] ? TrigramStart[DXMA_NUM_TRIGRAMS] : 1));
+	memcpy(slot, TrigramStart, sizeof(int) * DXMA_NUM_TRIGRAMS);
+	memset(last, -1, sizeof(int) * DXMA_NUM_TRIGRAMS);
+	for (int i = 0; i < n; i++)
+		dxma_index_row(i, last, slot);
+
+	d_free(slot);
+	d_free(last);
+	IndexGeneration++;
+}
+
+// The shortest trigram list of a normalized string. Returns 0 if the string
+// has no trigram, in which case every row is a candidate.
+static int dxma_trigram_candidates(const char *s, const int **rows, int *count)
+{
+	int best = -1;
+	for (; *s; s++)
+	{
+		int t = dxma_trigram(s);
+		if (t >= 0 && (best < 0 || TrigramStart[t + 1] - TrigramStart[t] < TrigramStart[best + 1] - TrigramStart[best]))
+			best = t;
+	}
+	if (best < 0)
+		return 0;
+	*rows = &TrigramRows[TrigramStart[best]];
+	*count = TrigramStart[best + 1] - TrigramStart[best];
+	return 1;
+}
+
 static int dxma_mode_is_relevant(const char *mode)
 {
 	if (!mode || !mode[0])
@@ -304,7 +514,7 @@ static int dxma_fetch_url_to_buffer(const char *url, char **out_buf, size_t *out
 		return 0;
 	if (!PHYSFSX_getRealPath(DXMA_REFRESH_TMP_FILE, real_tmp))
 		return 0;
-	if (!dxma_try_download(url, real_tmp))
+	if (!dxma_try_download(url, real_tmp, NULL))
 		return 0;
 
 	fp = PHYSFSX_openReadBuffered(DXMA_REFRESH_TMP_FILE);
@@ -344,14 +554,6 @@ static int dxma_fetch_url_to_buffer(const char *url, char **out_buf, size_t *out
 	return 1;
 }
 
-static int dxma_has_id(const dxma_mission *arr, int count, const char *id)
-{
-	for (int i = 0; i < count; i++)
-		if (!strcmp(arr[i].id, id))
-			return 1;
-	return 0;
-}
-
 static void dxma_copy_csv_safe(char *dst, size_t dstsz, const char *src)
 {
 	size_t j = 0;
@@ -404,10 +606,11 @@ static int dxma_write_cache_from_missions(void)
 
 static int dxma_refresh_by_scraping(void)
 {
-	dxma_mission incoming[MAX_DXMA_MISSIONS];
+	dxma_mission *incoming;
 	int incoming_count = 0;
 	int saw_any_page = 0;
 
+	MALLOC(incoming, dxma_mission, MAX_DXMA_MISSIONS - MissionCount + 1);
 	for (int page = 1; page <= DXMA_REFRESH_MAX_PAGES; page++)
 	{
 		char url[256];
@@ -498,7 +701,7 @@ static int dxma_refresh_by_scraping(void)
 			char idbuf[16];
 			snprintf(idbuf, sizeof(idbuf), "%d", mission_id);
 
-			if (dxma_has_id(Missions, MissionCount, idbuf) || dxma_has_id(incoming, incoming_count, idbuf))
+			if (dxma_has_id(idbuf))
 			{
 				p = row_end + 5;
 				continue;
@@ -523,6 +726,7 @@ static int dxma_refresh_by_scraping(void)
 			strncpy(m->mode, mode, sizeof(m->mode) - 1);
 			strncpy(m->author, author, sizeof(m->author) - 1);
 			snprintf(m->download_url, sizeof(m->download_url), "https://sectorgame.com/dxma/download?m=%s", m->id);
+			dxma_add_id(m->id);
 
 			p = row_end + 5;
 		}
@@ -535,13 +739,17 @@ static int dxma_refresh_by_scraping(void)
 	}
 
 	if (!saw_any_page)
+	{
+		d_free(incoming);
 		return 0;
+	}
 
 	if (incoming_count > 0)
 	{
 		memcpy(&Missions[MissionCount], incoming, sizeof(dxma_mission) * incoming_count);
 		MissionCount += incoming_count;
 		qsort(Missions, MissionCount, sizeof(dxma_mission), dxma_compare);
+		dxma_build_index();
 		dxma_write_cache_from_missions();
 		con_printf(CON_NORMAL, "DXMA: refresh found %d new %s missions via page scraping\n", incoming_count, DXMA_GAME_TAG);
 	}
@@ -550,6 +758,7 @@ static int dxma_refresh_by_scraping(void)
 		con_printf(CON_NORMAL, "DXMA: refresh found no new %s missions via page scraping\n", DXMA_GAME_TAG);
 	}
 
+	d_free(incoming);
 	return 1;
 }
 
@@ -585,6 +794,10 @@ int dxma_load(void)
 	MissionCount = n;
 	con_printf(CON_NORMAL, "DXMA: %d missions from embedded database\n", n);
 
+	dxma_clear_ids();
+	for (int i = 0; i < MissionCount; i++)
+		dxma_add_id(Missions[i].id);
+
 	// Merge any cached refresh on top of the embedded baseline. The cache
 	// is written after every successful Ctrl+R and contains only missions
 	// that were not already in the embedded CSV, so entries are additive.
@@ -599,15 +812,20 @@ int dxma_load(void)
 			char *buf = d_malloc((size_t)sz);
 			if (buf && PHYSFS_read(fp, buf, 1, (PHYSFS_uint32)sz) == sz)
 			{
-				dxma_mission tmp[MAX_DXMA_MISSIONS];
-				int cn = dxma_parse_csv_buffer(buf, (size_t)sz, tmp, MAX_DXMA_MISSIONS);
+				// parsed straight into the free end of the table; rows already
+				// there are dropped by moving the next new one over them
+				dxma_mission *cached = &Missions[MissionCount];
+				int cn = dxma_parse_csv_buffer(buf, (size_t)sz, cached, MAX_DXMA_MISSIONS - MissionCount);
 				int added = 0;
-				for (int i = 0; i < cn && MissionCount < MAX_DXMA_MISSIONS; i++)
-					if (!dxma_has_id(Missions, MissionCount, tmp[i].id))
-					{
-						Missions[MissionCount++] = tmp[i];
-						added++;
-					}
+				for (int i = 0; i < cn; i++)
+				{
+					if (dxma_has_id(cached[i].id))
+						continue;
+					if (i != added)
+						cached[added] = cached[i];
+					dxma_add_id(cached[added++].id);
+				}
+				MissionCount += added;
 				if (added > 0)
 					con_printf(CON_NORMAL, "DXMA: +%d missions merged from saved cache\n", added);
 			}
@@ -618,6 +836,7 @@ int dxma_load(void)
 
 	if (MissionCount > 0)
 		qsort(Missions, MissionCount, sizeof(dxma_mission), dxma_compare);
+	dxma_build_index();
 	return MissionCount;
 }
 
@@ -677,8 +896,9 @@ static int dxma_safe_basename(const char *url, char *out, size_t outsz)
 // hands that to CreateProcess, which still launches argv[0] directly -- the
 // quoting only controls how *that program* re-splits its own arguments, it
 // is not shell syntax and metacharacters have no special meaning in it.
+// If cancel is given and gets set while it runs, the process is killed.
 // Returns 1 if the process ran and exited 0, else 0.
-static int dxma_spawn_argv(char *const argv[])
+static int dxma_spawn_argv(char *const argv[], volatile int *cancel)
 {
 #ifdef _WIN32
 	char cmdline[4096] = {0};
@@ -704,7 +924,14 @@ static int dxma_spawn_argv(char *const argv[])
 	if (!CreateProcessA(NULL, cmdline, NULL, NULL, FALSE, CREATE_NO_WINDOW, NULL, NULL, &si, &pi))
 		return 0;
 
-	WaitForSingleObject(pi.hProcess, 60000);
+	// the tools are given their own time limits
+	while (WaitForSingleObject(pi.hProcess, 100) == WAIT_TIMEOUT)
+		if (cancel && *cancel)
+		{
+			TerminateProcess(pi.hProcess, 1);
+			WaitForSingleObject(pi.hProcess, INFINITE);
+			break;
+		}
 	DWORD code = 1;
 	GetExitCodeProcess(pi.hProcess, &code);
 	CloseHandle(pi.hProcess);
@@ -724,7 +951,18 @@ static int dxma_spawn_argv(char *const argv[])
 		_exit(127);
 	}
 	int status = 0;
-	if (waitpid(pid, &status, 0) < 0) return 0;
+	pid_t r;
+	while ((r = waitpid(pid, &status, cancel ? WNOHANG : 0)) == 0)
+	{
+		if (*cancel)
+		{
+			kill(pid, SIGTERM);
+			waitpid(pid, &status, 0);
+			return 0;
+		}
+		timer_delay(F1_0/10);
+	}
+	if (r < 0) return 0;
 	return WIFEXITED(status) && WEXITSTATUS(status) == 0;
 #endif
 }
@@ -740,8 +978,9 @@ static int dxma_spawn_argv(char *const argv[])
 // The option numbers hardcoded below are libcurl's stable public ABI values
 // (see include/curl/curl.h in libcurl); they are safe to use without the
 // header. Ranges: 0-9999 = long, 10000-19999 = pointer, 20000-29999 =
-// function pointer, so ordinary variadic promotion via a (...) function
-// pointer passes them correctly.
+// function pointer, 30000-39999 = curl_off_t, so ordinary variadic
+// promotion via a (...) function pointer passes them correctly as long as
+// the curl_off_t ones are passed as a 64-bit DXMA_curl_off_t.
 #define DXMA_CURLOPT_URL              10002
 #define DXMA_CURLOPT_WRITEDATA        10001
 #define DXMA_CURLOPT_USERAGENT        10018
@@ -751,10 +990,21 @@ static int dxma_spawn_argv(char *const argv[])
 #define DXMA_CURLOPT_FAILONERROR         45
 #define DXMA_CURLOPT_NOSIGNAL            99
 #define DXMA_CURLOPT_CONNECTTIMEOUT      78
+#define DXMA_CURLOPT_NOPROGRESS          43
+#define DXMA_CURLOPT_LOW_SPEED_LIMIT     19
+#define DXMA_CURLOPT_LOW_SPEED_TIME      20
+#define DXMA_CURLOPT_XFERINFODATA     10057
+#define DXMA_CURLOPT_XFERINFOFUNCTION 20219
+#define DXMA_CURLOPT_RESUME_FROM_LARGE 30116
+
+#define DXMA_CURLE_HTTP_RETURNED_ERROR   22   // e.g. 416 for a range past the end
+#define DXMA_CURLE_RANGE_ERROR           33   // server does not do range requests
 
 typedef void DXMA_CURL;
 typedef int  DXMA_CURLcode;
+typedef long long DXMA_curl_off_t;
 typedef size_t (*dxma_curl_write_cb)(void *ptr, size_t size, size_t nmemb, void *userdata);
+typedef int (*dxma_curl_xferinfo_cb)(void *userdata, DXMA_curl_off_t dltotal, DXMA_curl_off_t dlnow, DXMA_curl_off_t ultotal, DXMA_curl_off_t ulnow);
 
 static void        *dxma_curl_lib          = NULL;
 static int          dxma_curl_tried_load   = 0;
@@ -837,62 +1087,134 @@ static size_t dxma_libcurl_write_cb(void *ptr, size_t size, size_t nmemb, void *
 	return fwrite(ptr, size, nmemb, fp);
 }
 
+// Progress of a background transfer. dltotal/dlnow only count this request,
+// so a resumed transfer adds what was already on disk. Returning nonzero
+// makes libcurl abort, which is how a cancel gets through.
+typedef struct dxma_libcurl_progress {
+	dxma_transfer *xfer;
+	PHYSFS_sint64 resume_from;
+} dxma_libcurl_progress;
+
+static int dxma_libcurl_xferinfo_cb(void *userdata, DXMA_curl_off_t dltotal, DXMA_curl_off_t dlnow, DXMA_curl_off_t ultotal, DXMA_curl_off_t ulnow)
+{
+	dxma_libcurl_progress *p = (dxma_libcurl_progress *)userdata;
+	(void)ultotal; (void)ulnow;
+
+	p->xfer->bytes_done = p->resume_from + dlnow;
+	if (dltotal > 0)
+		p->xfer->bytes_total = p->resume_from + dltotal;
+	return p->xfer->cancel;
+}
+
+static long dxma_file_size(const char *path)
+{
+	struct stat st;
+	return stat(path, &st) == 0 ? (long)st.st_size : -1;
+}
+
 // In-process download via libcurl. Writes the response body to `dest`.
+// With a transfer (a background download), appends to whatever `dest`
+// already holds via a range request, reports progress and honours cancel;
+// errors go to xfer->error instead of the console, which belongs to the
+// game thread.
 // Returns 1 on HTTP 2xx + full body written, 0 on any error (libcurl not
 // available, network error, HTTP failure, filesystem error).
-static int dxma_libcurl_download(const char *url, const char *dest)
+static int dxma_libcurl_download(const char *url, const char *dest, dxma_transfer *xfer)
 {
 	if (!dxma_libcurl_load()) return 0;
 
 	DXMA_CURL *curl = dxma_p_easy_init();
 	if (!curl) return 0;
 
-	FILE *fp = fopen(dest, "wb");
+	dxma_libcurl_progress progress;
+	progress.xfer = xfer;
+	progress.resume_from = 0;
+	if (xfer && dxma_file_size(dest) > 0)
+		progress.resume_from = dxma_file_size(dest);
+
+	FILE *fp = fopen(dest, progress.resume_from ? "ab" : "wb");
 	if (!fp) { dxma_p_easy_cleanup(curl); return 0; }
 
 	dxma_p_easy_setopt(curl, DXMA_CURLOPT_URL,             url);
 	dxma_p_easy_setopt(curl, DXMA_CURLOPT_WRITEDATA,       fp);
 	dxma_p_easy_setopt(curl, DXMA_CURLOPT_WRITEFUNCTION,   dxma_libcurl_write_cb);
 	dxma_p_easy_setopt(curl, DXMA_CURLOPT_FOLLOWLOCATION,  1L);
-	dxma_p_easy_setopt(curl, DXMA_CURLOPT_TIMEOUT,         60L);
 	dxma_p_easy_setopt(curl, DXMA_CURLOPT_CONNECTTIMEOUT,  15L);
 	dxma_p_easy_setopt(curl, DXMA_CURLOPT_FAILONERROR,     1L);
 	dxma_p_easy_setopt(curl, DXMA_CURLOPT_NOSIGNAL,        1L);
 	dxma_p_easy_setopt(curl, DXMA_CURLOPT_USERAGENT,       "dxx-redux-sng/dxma");
+	if (xfer)
+	{
+		// No overall time limit for a background download, big maps on a
+		// slow line are fine as long as data keeps coming.
+		dxma_p_easy_setopt(curl, DXMA_CURLOPT_LOW_SPEED_LIMIT,   1L);
+		dxma_p_easy_setopt(curl, DXMA_CURLOPT_LOW_SPEED_TIME,    30L);
+		dxma_p_easy_setopt(curl, DXMA_CURLOPT_NOPROGRESS,        0L);
+		dxma_p_easy_setopt(curl, DXMA_CURLOPT_XFERINFODATA,      &progress);
+		dxma_p_easy_setopt(curl, DXMA_CURLOPT_XFERINFOFUNCTION,  (dxma_curl_xferinfo_cb)dxma_libcurl_xferinfo_cb);
+		dxma_p_easy_setopt(curl, DXMA_CURLOPT_RESUME_FROM_LARGE, (DXMA_curl_off_t)progress.resume_from);
+		xfer->bytes_done = progress.resume_from;
+	}
+	else
+		dxma_p_easy_setopt(curl, DXMA_CURLOPT_TIMEOUT,         60L);
 
 	DXMA_CURLcode res = dxma_p_easy_perform(curl);
 	fflush(fp);
 	fclose(fp);
 	dxma_p_easy_cleanup(curl);
 
-	if (res != 0)
+	// The server would not resume (or the .part was already complete but
+	// never renamed): start over once rather than fail.
+	if (progress.resume_from && !xfer->cancel &&
+		(res == DXMA_CURLE_RANGE_ERROR || res == DXMA_CURLE_HTTP_RETURNED_ERROR))
 	{
 		remove(dest);
-		con_printf(CON_NORMAL, "DXMA: libcurl %s failed: %s\n",
-			url,
-			dxma_p_easy_strerror ? dxma_p_easy_strerror(res) : "(no strerror)");
+		return dxma_libcurl_download(url, dest, xfer);
+	}
+
+	if (res != 0)
+	{
+		const char *err = dxma_p_easy_strerror ? dxma_p_easy_strerror(res) : "(no strerror)";
+
+		if (!xfer)
+		{
+			remove(dest);
+			con_printf(CON_NORMAL, "DXMA: libcurl %s failed: %s\n", url, err);
+		}
+		else
+			snprintf(xfer->error, sizeof(xfer->error), "%s", xfer->cancel ? "cancelled" : err);
 		return 0;
 	}
 	return 1;
 }
 
-static int dxma_try_download(const char *url, const char *dest)
+// With a transfer, the spawned tools are asked to continue a partial `dest`
+// too, and are not given an overall time limit.
+static int dxma_try_download(const char *url, const char *dest, dxma_transfer *xfer)
 {
-	if (dxma_libcurl_download(url, dest)) return 1;
+	if (dxma_libcurl_download(url, dest, xfer)) return 1;
+	if (xfer && xfer->cancel) return 0;
+	if (xfer) xfer->bytes_done = -1;
 
 #ifdef _WIN32
 	// curl.exe ships with Windows 10 1803+; avoids depending on PowerShell
 	// (and the more elaborate quoting a -Command string would need).
 	char *argv[] = { "curl.exe", "-fsSL", "--max-time", "60", "-o", (char *)dest, (char *)url, NULL };
+	char *resume_argv[] = { "curl.exe", "-fsSL", "--speed-limit", "1", "--speed-time", "30", "-C", "-", "-o", (char *)dest, (char *)url, NULL };
 #else
 	char *argv[] = { "curl", "-fsSL", "--max-time", "60", "-o", (char *)dest, (char *)url, NULL };
+	char *resume_argv[] = { "curl", "-fsSL", "--speed-limit", "1", "--speed-time", "30", "-C", "-", "-o", (char *)dest, (char *)url, NULL };
 #endif
-	if (dxma_spawn_argv(argv)) return 1;
+	if (dxma_spawn_argv(xfer ? resume_argv : argv, xfer ? &xfer->cancel : NULL)) return 1;
+	if (xfer && xfer->cancel) return 0;
 
 #ifndef _WIN32
 	char *wget_argv[] = { "wget", "-q", "--timeout=60", "-O", (char *)dest, (char *)url, NULL };
-	if (dxma_spawn_argv(wget_argv)) return 1;
+	char *wget_resume_argv[] = { "wget", "-q", "--timeout=60", "-c", "-O", (char *)dest, (char *)url, NULL };
+	if (dxma_spawn_argv(xfer ? wget_resume_argv : wget_argv, xfer ? &xfer->cancel : NULL)) return 1;
+	if (xfer && xfer->cancel) return 0;
 #endif
+	if (xfer) snprintf(xfer->error, sizeof(xfer->error), "no downloader worked (libcurl, curl, wget)");
 	return 0;
 }
 
@@ -904,12 +1226,243 @@ static int dxma_try_extract_zip(const char *zip_path, const char *dest_dir)
 #else
 	char *argv[] = { "unzip", "-o", (char *)zip_path, "-d", (char *)dest_dir, NULL };
 #endif
-	return dxma_spawn_argv(argv);
+	return dxma_spawn_argv(argv, NULL);
 }
 
 // -------------------------------------------------------------- download
 
-int dxma_download_mission(int index)
+#define DXMA_MAX_DOWNLOADS   16
+#define DXMA_PART_SUFFIX     ".part"
+#define DXMA_UNPACK_MOUNT    "dxma_unpack"   // where a zip is mounted while it is unpacked
+#define DXMA_RESULT_TIME     (F1_0 * 5)      // how long the last result stays in the status line
+
+typedef struct dxma_download {
+	int id;
+	char url[512];
+	char title[128];
+	char filename[256];
+	char stem[256];                  // filename without .zip, the folder a zip is unpacked into
+	int is_zip;
+	char real_dest[PATH_MAX];
+	char real_part[PATH_MAX];
+	dxma_transfer xfer;
+	PHYSFS_sint64 start_bytes;       // already in the .part when the transfer started
+	u_int64_t start_usec;
+	int unpacked;
+} dxma_download;
+
+// The queue. Downloads[0] is the one the download thread has while
+// DownloadTask is set; the thread never looks at the others.
+static dxma_download Downloads[DXMA_MAX_DOWNLOADS];
+static int DownloadCount = 0, DownloadNextId = 1;
+static worker_task *DownloadTask = NULL;
+static void dxma_pad_row_to_pixels(char *s, size_t sz, int target_px);  // defined below
+
+static int DownloadFinishedId = 0, DownloadFinishedOk = 0, DownloadFinishedCancelled = 0;
+static char DownloadResult[192];
+static fix64 DownloadResultTime = 0;
+
+// Copy a directory tree out of the mounted archive into the write
+// directory. Runs on the download thread; PhysFS does its own locking.
+static int dxma_unpack_tree(const char *from, const char *to)
+{
+	char **list = PHYSFS_enumerateFiles(from);
+	int ok = list != NULL;
+
+	PHYSFS_mkdir(to);
+	for (char **i = list; ok && *i; i++)
+	{
+		char src[PATH_MAX], dst[PATH_MAX];
+		snprintf(src, sizeof(src), "%s/%s", from, *i);
+		snprintf(dst, sizeof(dst), "%s/%s", to, *i);
+
+		if (PHYSFS_isDirectory(src))
+		{
+			ok = dxma_unpack_tree(src, dst);
+			continue;
+		}
+
+		PHYSFS_file *in = PHYSFS_openRead(src);
+		PHYSFS_file *out = in ? PHYSFS_openWrite(dst) : NULL;
+		char buf[16384];
+		PHYSFS_sint64 n;
+
+		ok = in && out;
+		while (ok && (n = PHYSFS_read(in, buf, 1, sizeof(buf))) > 0)
+			ok = PHYSFS_write(out, buf, 1, (PHYSFS_uint32)n) == n;
+		if (out) PHYSFS_close(out);
+		if (in) PHYSFS_close(in);
+	}
+	if (list) PHYSFS_freeList(list);
+	return ok;
+}
+
+static int dxma_unpack_zip(dxma_download *dl)
+{
+	char to[PATH_MAX];
+	int ok;
+
+	if (!PHYSFS_mount(dl->real_dest, DXMA_UNPACK_MOUNT, 1))
+		return 0;
+	snprintf(to, sizeof(to), MISSION_DIR "%s", dl->stem);
+	ok = dxma_unpack_tree(DXMA_UNPACK_MOUNT, to);
+	PHYSFS_removeFromSearchPath(dl->real_dest);
+	return ok;
+}
+
+// Runs on the download thread.
+static int dxma_download_task(void *data)
+{
+	dxma_download *dl = (dxma_download *)data;
+
+	if (!dxma_try_download(dl->url, dl->real_part, &dl->xfer))
+		return 0;
+
+	remove(dl->real_dest);
+	if (rename(dl->real_part, dl->real_dest) != 0)
+	{
+		snprintf(dl->xfer.error, sizeof(dl->xfer.error), "could not rename %s", dl->real_part);
+		return 0;
+	}
+
+	if (dl->is_zip)
+	{
+		dl->unpacked = dxma_unpack_zip(dl);
+		if (!dl->unpacked)
+		{
+			char real_dir[PATH_MAX];
+			strncpy(real_dir, dl->real_dest, sizeof(real_dir) - 1);
+			real_dir[sizeof(real_dir) - 1] = '\0';
+			char *d2 = strrchr(real_dir, '.');
+			if (d2) *d2 = '\0';
+#ifndef _WIN32
+			mkdir(real_dir, 0755);
+#else
+			_mkdir(real_dir);
+#endif
+			dl->unpacked = dxma_try_extract_zip(dl->real_dest, real_dir);
+		}
+	}
+	return 1;
+}
+
+void dxma_download_poll(void)
+{
+	if (DownloadTask)
+	{
+		if (!worker_task_done(DownloadTask))
+			return;
+
+		dxma_download *dl = &Downloads[0];
+		int ok = worker_task_finish(DownloadTask);
+		DownloadTask = NULL;
+
+		if (ok)
+		{
+			con_printf(CON_NORMAL, "DXMA: downloaded %s\n", dl->real_dest);
+			if (dl->is_zip && !dl->unpacked)
+				con_printf(CON_NORMAL, "DXMA: extraction failed for %s (archive kept, extract manually)\n", dl->filename);
+			snprintf(DownloadResult, sizeof(DownloadResult), "Downloaded %s", dl->title);
+			mission_dir_changed();
+		}
+		else
+		{
+			con_printf(CON_NORMAL, "DXMA: download of %s failed: %s\n", dl->url, dl->xfer.error);
+			snprintf(DownloadResult, sizeof(DownloadResult), "%s %s", dl->xfer.cancel ? "Cancelled" : "Download failed:", dl->title);
+		}
+		DownloadResultTime = timer_query();
+		DownloadFinishedId = dl->id;
+		DownloadFinishedOk = ok;
+		DownloadFinishedCancelled = dl->xfer.cancel;
+
+		DownloadCount--;
+		memmove(&Downloads[0], &Downloads[1], DownloadCount * sizeof(dxma_download));
+	}
+
+	if (DownloadCount)
+	{
+		dxma_download *dl = &Downloads[0];
+		long part = dxma_file_size(dl->real_part);
+
+		dl->start_bytes = part > 0 ? part : 0;
+		dl->start_usec = timer_query_usec();
+		dl->xfer.bytes_done = dl->start_bytes;
+		if (dl->start_bytes)
+			con_printf(CON_NORMAL, "DXMA: resuming %s at %ld bytes\n", dl->filename, part);
+		con_printf(CON_NORMAL, "DXMA: downloading %s -> %s\n", dl->url, dl->real_dest);
+
+		dxma_libcurl_load();	// here, so its console message comes from the game thread
+		DownloadTask = worker_task_start(dxma_download_task, dl);
+	}
+}
+
+int dxma_download_status(char *buf, size_t size)
+{
+	if (!DownloadCount)
+	{
+		if (!DownloadResult[0] || timer_query() > DownloadResultTime + DXMA_RESULT_TIME)
+			return 0;
+		snprintf(buf, size, "%s", DownloadResult);
+		return 1;
+	}
+
+	dxma_download *dl = &Downloads[0];
+	PHYSFS_sint64 done = dl->xfer.bytes_done, total = dl->xfer.bytes_total;
+	char queued[32] = "";
+
+	if (done < 0)	// a spawned curl/wget has it, all we can see is the file growing
+		done = dxma_file_size(dl->real_part) > 0 ? dxma_file_size(dl->real_part) : 0;
+
+	u_int64_t usec = timer_query_usec() - dl->start_usec;
+	int kb_per_sec = usec ? (int)((done - dl->start_bytes) * 1000000 / 1024 / (PHYSFS_sint64)usec) : 0;
+	if (kb_per_sec < 0) kb_per_sec = 0;
+
+	if (DownloadCount > 1)
+		snprintf(queued, sizeof(queued), ", %d queued", DownloadCount - 1);
+
+	if (total > 0)
+		snprintf(buf, size, "Downloading %.40s: %d%% of %d KB, %d KB/s%s", dl->filename,
+			(int)(done * 100 / total), (int)(total / 1024), kb_per_sec, queued);
+	else
+		snprintf(buf, size, "Downloading %.40s: %d KB, %d KB/s%s", dl->filename,
+			(int)(done / 1024), kb_per_sec, queued);
+	return 1;
+}
+
+// The running download is told to stop and is reported by
+// dxma_download_poll() once the thread lets go of it; a queued one just
+// goes. Its .part stays for the next attempt either way.
+static void dxma_cancel_download(int id)
+{
+	for (int i = 0; i < DownloadCount; i++)
+	{
+		if (Downloads[i].id != id)
+			continue;
+		if (i == 0 && DownloadTask)
+		{
+			Downloads[0].xfer.cancel = 1;
+			return;
+		}
+		DownloadFinishedId = id;
+		DownloadFinishedOk = 0;
+		DownloadFinishedCancelled = 1;
+		DownloadCount--;
+		memmove(&Downloads[i], &Downloads[i + 1], (DownloadCount - i) * sizeof(dxma_download));
+		return;
+	}
+}
+
+void dxma_cancel_downloads(void)
+{
+	while (DownloadCount > (DownloadTask ? 1 : 0))
+		dxma_cancel_download(Downloads[DownloadCount - 1].id);
+	if (DownloadTask)
+		dxma_cancel_download(Downloads[0].id);
+	snprintf(DownloadResult, sizeof(DownloadResult), "Downloads cancelled");
+	DownloadResultTime = timer_query();
+}
+
+int dxma_queue_download(int index)
 {
 	const dxma_mission *m = dxma_get(index);
 	if (!m) return 0;
@@ -929,10 +1482,23 @@ int dxma_download_mission(int index)
 		return 0;
 	}
 
+	for (int i = 0; i < DownloadCount; i++)
+		if (!strcmp(Downloads[i].filename, filename))
+		{
+			nm_messagebox(NULL, 1, "OK", "%s\n\nis already being downloaded.", filename);
+			return Downloads[i].id;
+		}
+	if (DownloadCount >= DXMA_MAX_DOWNLOADS)
+	{
+		nm_messagebox(NULL, 1, "OK", "Too many downloads queued,\nwait for some of them to finish.");
+		return 0;
+	}
+
 	PHYSFS_mkdir("missions");
 
-	char dest_path[PATH_MAX];
+	char dest_path[PATH_MAX], part_path[PATH_MAX];
 	snprintf(dest_path, sizeof(dest_path), MISSION_DIR "%s", filename);
+	snprintf(part_path, sizeof(part_path), "%s" DXMA_PART_SUFFIX, dest_path);
 
 	if (PHYSFSX_exists(dest_path, 0))
 	{
@@ -943,46 +1509,87 @@ int dxma_download_mission(int index)
 	if (nm_messagebox(NULL, 2, "Download", "Cancel", "Download from DXMA:\n\n%s\nby %s\n", m->title, m->author) != 0)
 		return 0;
 
-	char real_dest[PATH_MAX];
-	if (!PHYSFSX_getRealPath(dest_path, real_dest))
+	dxma_download *dl = &Downloads[DownloadCount];
+	memset(dl, 0, sizeof(*dl));
+	if (!PHYSFSX_getRealPath(dest_path, dl->real_dest) || !PHYSFSX_getRealPath(part_path, dl->real_part))
 	{
 		nm_messagebox(NULL, 1, "OK", "Could not resolve a real path for the missions folder.");
 		return 0;
 	}
 
-	newmenu_item wm; char msg[256];
-	snprintf(msg, sizeof(msg), "Downloading:\n%.60s\n\nPlease wait...", filename);
-	wm.type = NM_TYPE_TEXT; wm.text = msg;
-	newmenu *wait_menu = newmenu_do3(NULL, NULL, 1, &wm, NULL, NULL, 0, NULL);
-	timer_delay(F1_0 / 4);
-	event_process();
-
-	con_printf(CON_NORMAL, "DXMA: downloading %s -> %s\n", url, real_dest);
-	int ok = dxma_try_download(url, real_dest);
+	// A mirror serves the same paths as sectorgame.com, so keep everything
+	// after the host.
+	if (GameArg.MplDxmaMirror)
+	{
+		const char *path = strchr(url + strlen("https://"), '/');
+		snprintf(dl->url, sizeof(dl->url), "%s%s", GameArg.MplDxmaMirror, path ? path : "/");
+	}
+	else
+		snprintf(dl->url, sizeof(dl->url), "%s", url);
+	snprintf(dl->title, sizeof(dl->title), "%s", m->title);
+	snprintf(dl->filename, sizeof(dl->filename), "%s", filename);
+	snprintf(dl->stem, sizeof(dl->stem), "%s", filename);
+	char *dot = strrchr(dl->stem, '.');
+	dl->is_zip = dot && d_stricmp(dot, ".zip") == 0;
+	if (dl->is_zip) *dot = '\0';
+	dl->id = DownloadNextId++;
+	DownloadCount++;
+
+	dxma_download_poll();
+	return dl->id;
+}
 
-	if (wait_menu) window_close(newmenu_get_window(wait_menu));
+// Shows the download for the wait menu of dxma_download_mission(); the
+// queue itself moves on in event_process() like in every other loop.
+static int dxma_wait_handler(newmenu *menu, d_event *event, int *id)
+{
+	newmenu_item *items = newmenu_get_items(menu);
 
-	if (!ok)
+	switch (event->type)
 	{
-		nm_messagebox(NULL, 1, "OK", "Download failed for:\n%s\n\nCheck the console log for the exact\nerror. On Linux, libcurl.so.4 is normally used\nautomatically; if it is missing, install curl or\nwget as a fallback.", url);
-		return 0;
+	case EVENT_WINDOW_DRAW:
+		if (DownloadFinishedId == *id)
+			return -2;
+		dxma_download_status(items[0].text, DXMA_ROW_TEXT_LEN);
+		break;
+
+	case EVENT_WINDOW_CLOSE:
+		if (DownloadFinishedId != *id)	// ESC
+			dxma_cancel_download(*id);
+		break;
+
+	default: break;
 	}
+	return 0;
+}
+
+int dxma_download_mission(int index)
+{
+	int id = dxma_queue_download(index);
+	if (!id) return 0;
+
+	const dxma_mission *m = dxma_get(index);
+	newmenu_item wm[2];
+	char status[DXMA_ROW_TEXT_LEN] = "";
+	memset(wm, 0, sizeof(wm));
+	// newmenu sizes its box by the text it starts with, so leave room for
+	// the progress to grow into.
+	dxma_download_status(status, sizeof(status));
+	dxma_pad_row_to_pixels(status, sizeof(status), SWIDTH / 2);
+	wm[0].type = NM_TYPE_TEXT; wm[0].text = status;
+	wm[1].type = NM_TYPE_TEXT; wm[1].text = "ESC to cancel";
+	newmenu_do2(NULL, (char *)m->title, 2, wm, (int (*)(newmenu *, d_event *, void *))dxma_wait_handler, &id, 0, NULL);
+
+	// Cancelled with ESC: the thread stops at its next progress callback, or
+	// kills the curl/wget it spawned, and dxma_download_poll() reports it then.
+	if (DownloadFinishedId != id)
+		return 0;
 
-	const char *dot = strrchr(filename, '.');
-	if (dot && d_stricmp(dot, ".zip") == 0)
+	if (!DownloadFinishedOk)
 	{
-		char real_dir[PATH_MAX];
-		strncpy(real_dir, real_dest, sizeof(real_dir) - 1);
-		real_dir[sizeof(real_dir) - 1] = '\0';
-		char *d2 = strrchr(real_dir, '.');
-		if (d2) *d2 = '\0';
-#ifndef _WIN32
-		mkdir(real_dir, 0755);
-#else
-		_mkdir(real_dir);
-#endif
-		if (!dxma_try_extract_zip(real_dest, real_dir))
-			con_printf(CON_NORMAL, "DXMA: extraction failed for %s (archive kept, extract manually)\n", filename);
+		if (!DownloadFinishedCancelled)
+			nm_messagebox(NULL, 1, "OK", "Download failed for:\n%s\n\nCheck the console log for the exact\nerror. On Linux, libcurl.so.4 is normally used\nautomatically; if it is missing, install curl or\nwget as a fallback.", m->title);
+		return 0;
 	}
 
 	nm_messagebox(NULL, 1, "OK", "Mission downloaded!\n\n%s\n\nSaved to missions folder.", m->title);
@@ -1002,7 +1609,7 @@ int dxma_refresh(void)
 		if (PHYSFSX_getRealPath(tmp_path, real_tmp))
 		{
 			con_printf(CON_NORMAL, "DXMA: attempting legacy CSV refresh from %s\n", DXMA_REFRESH_URL);
-			if (dxma_try_download(DXMA_REFRESH_URL, real_tmp))
+			if (dxma_try_download(DXMA_REFRESH_URL, real_tmp, NULL))
 			{
 				PHYSFS_file *fp = PHYSFSX_openReadBuffered(tmp_path);
 				if (fp)
@@ -1014,9 +1621,10 @@ int dxma_refresh(void)
 						char *buf = d_malloc((size_t)sz);
 						if (buf && PHYSFS_read(fp, buf, 1, (PHYSFS_uint32)sz) == sz)
 						{
-							dxma_mission tmp[MAX_DXMA_MISSIONS];
-							int n = dxma_parse_csv_buffer(buf, (size_t)sz, tmp, MAX_DXMA_MISSIONS);
-							good = (n >= 10);
+							dxma_mission *tmp;
+							MALLOC(tmp, dxma_mission, MAX_DXMA_MISSIONS);
+							good = (dxma_parse_csv_buffer(buf, (size_t)sz, tmp, MAX_DXMA_MISSIONS) >= 10);
+							d_free(tmp);
 						}
 						if (buf) d_free(buf);
 					}
@@ -1063,18 +1671,6 @@ int dxma_refresh(void)
 
 // -------------------------------------------------------- filename match
 
-// Lowercase, alnum-only projection, used to compare a mission filename stem
-// against a DXMA title or download filename despite punctuation/case/spacing
-// differences between them.
-static void dxma_normalize(const char *in, char *out, size_t outsz)
-{
-	size_t j = 0;
-	for (size_t i = 0; in[i] && j + 1 < outsz; i++)
-		if (isalnum((unsigned char)in[i]))
-			out[j++] = (char)tolower((unsigned char)in[i]);
-	out[j] = '\0';
-}
-
 // Score in [0, min(len_a,len_b)]: length of the longest common run found by
 // a simple sliding comparison. Cheap, and sufficient to separate "clearly
 // the same slug" from "coincidental short overlap" at this dataset's size.
@@ -1108,19 +1704,29 @@ int dxma_find_match_for_filename(const char *mission_filename)
 	dxma_normalize(stem, wantNorm, sizeof(wantNorm));
 	if (!wantNorm[0]) return -1;
 	size_t wantLen = strlen(wantNorm);
+	if (wantLen < 4) return -1;   // could never pass the confidence floor below
+
+	// Anything that passes the floor shares a run of four or more characters
+	// with the stem, so only rows on one of the stem's trigram lists need
+	// scoring. They are still scored in table order, which keeps ties going
+	// to the same row as scoring all of them would.
+	memset(MissionMarks, 0, MissionCount);
+	for (const char *s = wantNorm; *s; s++)
+	{
+		int t = dxma_trigram(s);
+		if (t < 0) continue;
+		for (int j = TrigramStart[t]; j < TrigramStart[t + 1]; j++)
+			MissionMarks[TrigramRows[j]] = 1;
+	}
 
 	int best = -1, bestScore = 0;
 	for (int i = 0; i < MissionCount; i++)
 	{
-		char titleNorm[128], fileNorm[128];
-		dxma_normalize(Missions[i].title, titleNorm, sizeof(titleNorm));
-
-		const char *url = Missions[i].direct_download_url[0] ? Missions[i].direct_download_url : Missions[i].download_url;
-		const char *slash = strrchr(url, '/');
-		dxma_normalize(slash ? slash + 1 : url, fileNorm, sizeof(fileNorm));
+		if (!MissionMarks[i])
+			continue;
 
-		int scoreTitle = dxma_common_run(wantNorm, titleNorm);
-		int scoreFile = dxma_common_run(wantNorm, fileNorm);
+		int scoreTitle = dxma_common_run(wantNorm, MissionKeys[i].title);
+		int scoreFile = dxma_common_run(wantNorm, MissionKeys[i].file);
 		int score = scoreTitle > scoreFile ? scoreTitle : scoreFile;
 
 		if (score > bestScore) { bestScore = score; best = i; }
@@ -1143,6 +1749,8 @@ static int FilterEnabled = 0;
 static char FilterText[DXMA_FILTER_LEN] = {0};
 static int FilteredIndices[MAX_DXMA_MISSIONS];
 static int FilteredCount = 0;
+static char FilteredNeedle[DXMA_FILTER_LEN] = {0};   // normalized filter FilteredIndices was built for
+static int FilteredGeneration = -1;                  // IndexGeneration it was built for
 
 // DOS scan codes for letters and digits are NOT contiguous, so any
 // arithmetic like ('a' + (base_key - KEY_A)) produces wrong characters.
@@ -1187,25 +1795,54 @@ static int dxma_keycode_to_ascii(int key)
 	}
 }
 
-static int dxma_matches_filter(const dxma_mission *m, const char *filter)
+static int dxma_matches_filter(int index, const char *needle)
 {
-	if (!filter[0])
-		return 1;
-	char needle[DXMA_FILTER_LEN];
-	char hay_title[256];
-	char hay_author[128];
-	dxma_normalize(filter, needle, sizeof(needle));
-	dxma_normalize(m->title, hay_title, sizeof(hay_title));
-	dxma_normalize(m->author, hay_author, sizeof(hay_author));
-	return strstr(hay_title, needle) != NULL || strstr(hay_author, needle) != NULL;
+	return strstr(MissionKeys[index].title, needle) != NULL || strstr(MissionKeys[index].author, needle) != NULL;
 }
 
+// The menu is rebuilt on every key and page flip, so the previous result is
+// kept: a filter that extends the previous one can only match rows that
+// already matched, and only those are tested again. Otherwise the rows on
+// the filter's shortest trigram list are tested, or all of them for a
+// filter of less than three characters.
 static void dxma_build_filtered_indices(void)
 {
-	FilteredCount = 0;
-	for (int i = 0; i < MissionCount && FilteredCount < MAX_DXMA_MISSIONS; i++)
-		if (!FilterEnabled || dxma_matches_filter(&Missions[i], FilterText))
-			FilteredIndices[FilteredCount++] = i;
+	char needle[DXMA_FILTER_LEN];
+	const int *rows;
+	int count;
+
+	needle[0] = '\0';
+	if (FilterEnabled)
+		dxma_normalize(FilterText, needle, sizeof(needle));
+
+	if (FilteredGeneration == IndexGeneration && !strncmp(needle, FilteredNeedle, strlen(FilteredNeedle)))
+	{
+		if (strcmp(needle, FilteredNeedle))
+		{
+			int n = 0;
+			for (int i = 0; i < FilteredCount; i++)
+				if (dxma_matches_filter(FilteredIndices[i], needle))
+					FilteredIndices[n++] = FilteredIndices[i];
+			FilteredCount = n;
+		}
+	}
+	else if (dxma_trigram_candidates(needle, &rows, &count))
+	{
+		FilteredCount = 0;
+		for (int i = 0; i < count; i++)
+			if (dxma_matches_filter(rows[i], needle))
+				FilteredIndices[FilteredCount++] = rows[i];
+	}
+	else
+	{
+		FilteredCount = 0;
+		for (int i = 0; i < MissionCount; i++)
+			if (dxma_matches_filter(i, needle))
+				FilteredIndices[FilteredCount++] = i;
+	}
+
+	strcpy(FilteredNeedle, needle);
+	FilteredGeneration = IndexGeneration;
 }
 
 static int dxma_digits(int value)
@@ -1369,6 +2006,12 @@ static int dxma_menu_handler(newmenu *menu, d_event *event, void *userdata)
 			return 1;
 		}
 
+		if (key == KEY_CTRLED + KEY_X)
+		{
+			dxma_cancel_downloads();
+			return 1;
+		}
+
 		if (FilterEnabled)
 		{
 			int changed = 0;
@@ -1469,10 +2112,27 @@ static int dxma_menu_handler(newmenu *menu, d_event *event, void *userdata)
 		int filtered_idx = (citem - row_base) + PageState.start_index;
 		if (filtered_idx < 0 || filtered_idx >= FilteredCount) return 1;
 		int idx = FilteredIndices[filtered_idx];
-		dxma_download_mission(idx);
+		dxma_queue_download(idx);
 		return 1;
 	}
 
+	case EVENT_NEWMENU_DRAW:
+	{
+		char status[DXMA_ROW_TEXT_LEN];
+		if (!dxma_download_status(status, sizeof(status)))
+			break;
+		gr_set_current_canvas(NULL);
+		gr_set_curfont(GAME_FONT);
+		gr_set_fontcolor(BM_XRGB(0, 31, 0), -1);
+		gr_printf(0x8000, SHEIGHT - LINE_SPACING * 2, "%s", status);
+		if (DownloadCount)
+		{
+			gr_set_fontcolor(BM_XRGB(6, 6, 6), -1);
+			gr_string(0x8000, SHEIGHT - LINE_SPACING, "Ctrl+X cancels downloads");
+		}
+		break;
+	}
+
 	case EVENT_WINDOW_CLOSE:
 		if (ListText) { d_free(ListText); ListText = NULL; }
 		break;
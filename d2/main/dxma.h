@@ -54,9 +54,28 @@ int dxma_refresh(void);
 // dxma.c for why the CSV cannot support an exact one today.
 int dxma_find_match_for_filename(const char *mission_filename);
 
-// Download and extract a mission by table index into MISSION_DIR. Runs
-// synchronously and shows its own progress/confirmation dialogs; intended
-// to be called directly from a menu action or the join-failure prompt.
+// Queue a mission download by table index, after the usual confirmation
+// dialogs. The transfer runs in the background (see dxma.c); a .zip is
+// unpacked into MISSION_DIR<name>/ when it is done. Returns an id for the
+// download, or 0 if it was refused or the player said no.
+int dxma_queue_download(int index);
+
+// Collect a finished download and start the next queued one. Cheap; called
+// every frame from event_process(), so every event loop keeps it going.
+void dxma_download_poll(void);
+
+// One line for the menus and the HUD: the running download with its
+// progress and throughput, or for a few seconds the last result. Returns 0
+// if there is nothing to show.
+int dxma_download_status(char *buf, size_t size);
+
+// Stop the running download (its partial file is kept, so the next attempt
+// resumes) and drop the queued ones.
+void dxma_cancel_downloads(void);
+
+// Queue a mission download and wait for it in a progress menu that ESC
+// cancels; for the join-failure prompt, which needs the mission before it
+// can go on. The game keeps drawing and polling meanwhile.
 // Returns 1 on success.
 int dxma_download_mission(int index);
 
@@ -34,6 +34,10 @@ COPYRIGHT 1993-1999 PARALLAX SOFTWARE CORPORATION.  ALL RIGHTS RESERVED.
 #include "robot.h"
 #include "piggy.h"
 #include "player.h"
+#include "powerup.h"
+#include "gameseg.h"
+#include "timer.h"
+#include "console.h"
 
 #define face_type_num(nfaces,face_num,tri_edge) ((nfaces==1)?0:(tri_edge*2 + face_num))
 
@@ -610,18 +614,19 @@ fix check_vector_to_object(vms_vector *intp,vms_vector *p0,vms_vector *p1,fix ra
 
 
 #define MAX_SEGS_VISITED 100
-int n_segs_visited;
-short segs_visited[MAX_SEGS_VISITED];
+//all per thread, since the AI traces sight lines on the worker threads
+__thread_local__ int n_segs_visited;
+__thread_local__ short segs_visited[MAX_SEGS_VISITED];
 
-int fvi_nest_count;
+__thread_local__ int fvi_nest_count;
 
 //these vars are used to pass vars from fvi_sub() to find_vector_intersection()
-int fvi_hit_object;	// object number of object hit in last find_vector_intersection call.
-int fvi_hit_seg;		// what segment the hit point is in
-int fvi_hit_side;		// what side was hit
-int fvi_hit_side_seg;// what seg the hitside is in
-vms_vector wall_norm;	//ptr to surface normal of hit wall
-int fvi_hit_seg2;		// what segment the hit point is in
+__thread_local__ int fvi_hit_object;	// object number of object hit in last find_vector_intersection call.
+__thread_local__ int fvi_hit_seg;		// what segment the hit point is in
+__thread_local__ int fvi_hit_side;		// what side was hit
+__thread_local__ int fvi_hit_side_seg;// what seg the hitside is in
+__thread_local__ vms_vector wall_norm;	//ptr to surface normal of hit wall
+__thread_local__ int fvi_hit_seg2;		// what segment the hit point is in
 
 int fvi_sub(vms_vector *intp,int *ints,vms_vector *p0,int startseg,vms_vector *p1,fix rad,short thisobjnum,int *ignore_obj_list,int flags,int *seglist,int *n_segs,int entry_seg);
 
@@ -792,6 +797,31 @@ int obj_in_list(int objnum,int *obj_list)
 
 int check_trans_wall(vms_vector *pnt,segment *seg,int sidenum,int facenum);
 
+//	Quick reject for the object checks of fvi_sub(), done per query against the segment's object list.
+//	check_vector_to_object() never tests against a sphere bigger than obj->size+rad and only hits a sphere whose
+//	center is that close to the vector, so an object is skipped before the slower tests when its sphere, doubled
+//	to stay clear of rounding, misses the box around the vector.  In a crowded segment this leaves the sphere test
+//	for the few objects near the vector.
+static inline int object_near_vector_box(object *obj,fix rad,vms_vector *bmin,vms_vector *bmax)
+{
+	fix64 r = 2 * ((fix64)obj->size + rad);
+
+	return	(fix64)obj->pos.x + r >= bmin->x && (fix64)obj->pos.x - r <= bmax->x &&
+		(fix64)obj->pos.y + r >= bmin->y && (fix64)obj->pos.y - r <= bmax->y &&
+		(fix64)obj->pos.z + r >= bmin->z && (fix64)obj->pos.z - r <= bmax->z;
+}
+
+#ifndef NDEBUG
+static int Fvi_no_box_reject = 0;	//	set by fvi_test_crowded_segment() to time fvi_sub() without it
+#endif
+
+static void vector_box(vms_vector *p0,vms_vector *p1,vms_vector *bmin,vms_vector *bmax)
+{
+	bmin->x = min(p0->x,p1->x);  bmax->x = max(p0->x,p1->x);
+	bmin->y = min(p0->y,p1->y);  bmax->y = max(p0->y,p1->y);
+	bmin->z = min(p0->z,p1->z);  bmax->z = max(p0->z,p1->z);
+}
+
 int fvi_sub(vms_vector *intp,int *ints,vms_vector *p0,int startseg,vms_vector *p1,fix rad,short thisobjnum,int *ignore_obj_list,int flags,int *seglist,int *n_segs,int entry_seg)
 {
 	segment *seg;				//the segment we're looking at
@@ -820,9 +850,19 @@ int fvi_sub(vms_vector *intp,int *ints,vms_vector *p0,int startseg,vms_vector *p
 	fvi_nest_count++;
 
 	//first, see if vector hit any objects in this segment
-	if (flags & FQ_CHECK_OBJS)
+	if (flags & FQ_CHECK_OBJS && seg->objects != -1) {
+		vms_vector bmin,bmax;
+#ifndef NDEBUG
+		int box_reject = !Fvi_no_box_reject;
+#else
+		const int box_reject = 1;
+#endif
+
+		vector_box(p0,p1,&bmin,&bmax);
+
 		for (objnum=seg->objects;objnum!=-1;objnum=Objects[objnum].next)
-			if (	!(Objects[objnum].flags & OF_SHOULD_BE_DEAD) &&
+			if (	(!box_reject || object_near_vector_box(&Objects[objnum],rad,&bmin,&bmax)) &&
+					!(Objects[objnum].flags & OF_SHOULD_BE_DEAD) &&
 				 	!(thisobjnum == objnum ) &&
 				 	(ignore_obj_list==NULL || !obj_in_list(objnum,ignore_obj_list)) &&
 				 	!laser_are_related( objnum, thisobjnum ) &&
@@ -864,6 +904,7 @@ int fvi_sub(vms_vector *intp,int *ints,vms_vector *p0,int startseg,vms_vector *p
 						con_printf(CON_DEBUG, "fvi.c: hit_type = HIT_OBJECT\n"); 
 					}
 			}
+	}
 
 	if (	(thisobjnum > -1 ) && (CollisionResult[Objects[thisobjnum].type][OBJ_WALL] == RESULT_NOTHING ) )
 		rad = 0;		//HACK - ignore when edges hit walls
@@ -1313,3 +1354,70 @@ int object_intersects_wall_d(object *objp,int *hseg,int *hside,int *hface)
 
 	return sphere_intersects_wall(&objp->pos,objp->segnum,objp->size,hseg,hside,hface);
 }
+
+#ifndef NDEBUG
+#define FVI_TEST_QUERIES 2000
+
+//	Fill the player's segment with num_objects powerups and shoot vectors through it, with find_vector_intersection()
+//	as it is and with fvi_sub() testing every object like it did before the box reject.  Prints the time both took
+//	and how often their results differ, which they never should.
+void fvi_test_crowded_segment(int num_objects)
+{
+	int		segnum = ConsoleObject->segnum;
+	int		i, num_created = 0, num_hits = 0, num_differ = 0;
+	short		*objnums;
+	u_int64_t	fvi_usec = 0, old_usec = 0, t;
+
+	MALLOC(objnums, short, num_objects);
+
+	for (i=0; i<num_objects; i++) {
+		vms_vector	pos;
+		int		objnum;
+
+		pick_random_point_in_seg(&pos, segnum);
+		objnum = obj_create(OBJ_POWERUP, POW_SHIELD_BOOST, segnum, &pos, &vmd_identity_matrix, Powerup_info[POW_SHIELD_BOOST].size, CT_POWERUP, MT_NONE, RT_NONE);
+		if (objnum == -1)
+			break;
+		objnums[num_created++] = objnum;
+	}
+
+	for (i=0; i<FVI_TEST_QUERIES; i++) {
+		fvi_query	fq;
+		fvi_info	hit_data, old_hit_data;
+		vms_vector	p0, p1;
+
+		pick_random_point_in_seg(&p0, segnum);
+		pick_random_point_in_seg(&p1, segnum);
+
+		fq.p0 = &p0;
+		fq.startseg = segnum;
+		fq.p1 = &p1;
+		fq.rad = ConsoleObject->size;
+		fq.thisobjnum = ConsoleObject-Objects;
+		fq.ignore_obj_list = NULL;
+		fq.flags = FQ_CHECK_OBJS;
+
+		t = timer_query_usec();
+		find_vector_intersection(&fq, &hit_data);
+		fvi_usec += timer_query_usec() - t;
+
+		Fvi_no_box_reject = 1;
+		t = timer_query_usec();
+		find_vector_intersection(&fq, &old_hit_data);
+		old_usec += timer_query_usec() - t;
+		Fvi_no_box_reject = 0;
+
+		if (hit_data.hit_type == HIT_OBJECT)
+			num_hits++;
+		if (hit_data.hit_type != old_hit_data.hit_type || hit_data.hit_object != old_hit_data.hit_object ||
+				hit_data.hit_seg != old_hit_data.hit_seg || vm_vec_dist(&hit_data.hit_pnt, &old_hit_data.hit_pnt))
+			num_differ++;
+	}
+
+	for (i=0; i<num_created; i++)
+		obj_delete(objnums[i]);
+	d_free(objnums);
+
+	con_printf(CON_NORMAL, "%i vectors through %i objects in segment %i, %i hit one: with box reject %lu us, without %lu us, %i differ\n", FVI_TEST_QUERIES, num_created, segnum, num_hits, (unsigned long)fvi_usec, (unsigned long)old_usec, num_differ);
+}
+#endif
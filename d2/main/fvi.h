@@ -83,5 +83,9 @@ void find_hitpoint_uv(fix *u,fix *v,fix *l, vms_vector *pnt,segment *seg,int sid
 int object_intersects_wall(object *objp);
 int object_intersects_wall_d(object *objp,int *hseg,int *hside,int *hface); // same as above but more detailed
 
+#ifndef NDEBUG
+void fvi_test_crowded_segment(int num_objects);
+#endif
+
 #endif
 
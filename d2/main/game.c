@@ -92,6 +92,7 @@ COPYRIGHT 1993-1999 PARALLAX SOFTWARE CORPORATION.  ALL RIGHTS RESERVED.
 #include "movie.h"
 #include "event.h"
 #include "window.h"
+#include "profile.h"
 
 #ifdef OGL
 #include "ogl_init.h"
@@ -1161,12 +1162,15 @@ int game_handler(window *wind, d_event *event, void *data)
 			return ReadControls(event);
 
 		case EVENT_WINDOW_DRAW:
+			profile_frame();
 			calc_frame_time();
 
 			if (!time_paused)
 			{
 				calc_game_time();
+				PROFILE_BEGIN("GameProcessFrame");
 				GameProcessFrame();
+				PROFILE_END();
 			}
 
 			if (!Automap_active)		// efficiency hack
@@ -1175,7 +1179,9 @@ int game_handler(window *wind, d_event *event, void *data)
 					init_cockpit();
 					force_cockpit_redraw=0;
 				}
+				PROFILE_BEGIN("game_render_frame");
 				game_render_frame();
+				PROFILE_END();
 			}
 			break;
 
@@ -1230,6 +1236,8 @@ void close_game()
 {
 	close_gauges();
 	restore_effect_bitmap_icons();
+	free_segment_pvs();
+	free_view_caches();
 }
 
 
@@ -1251,7 +1259,7 @@ object *find_escort()
 {
 	int i;
 
-	for (i=0; i<=Highest_object_index; i++)
+	for (i=obj_first_used(); i!=-1; i=obj_next_used(i))
 		if (Objects[i].type == OBJ_ROBOT)
 			if (Robot_info[Objects[i].id].companion)
 				return &Objects[i];
@@ -79,6 +79,9 @@ COPYRIGHT 1993-1999 PARALLAX SOFTWARE CORPORATION.  ALL RIGHTS RESERVED.
 #include "scores.h"
 
 #include "multi.h"
+#ifdef USE_UDP
+#include "net_udp.h"
+#endif
 #include "race.h"
 #include "cntrlcen.h"
 #include "fuelcen.h"
@@ -91,6 +94,8 @@ COPYRIGHT 1993-1999 PARALLAX SOFTWARE CORPORATION.  ALL RIGHTS RESERVED.
 #include "switch.h"
 #include "escort.h"
 #include "window.h"
+#include "profile.h"
+#include "fvi.h"
 
 #ifdef EDITOR
 #include "editor/editor.h"
@@ -994,6 +999,26 @@ int HandleSystemKey(int key)
 			songs_play_level_song( Current_level_num, 1 );
 			break;
 
+		case KEY_ALTED + KEY_F11:
+			profile_enable(!Profile_enabled);
+			HUD_init_message(HM_DEFAULT, "Profiler %s", Profile_enabled ? "on" : "off");
+			break;
+		case KEY_ALTED + KEY_F12:
+		{
+			char filename[PATH_MAX];
+			int num = 0;
+
+			do
+				sprintf(filename, "trace%04d.json", num++);
+			while (PHYSFSX_exists(filename, 0));
+
+			if (profile_export_trace(filename))
+				HUD_init_message_literal(HM_DEFAULT, "No profiler trace to write");
+			else
+				HUD_init_message(HM_DEFAULT, "Profiler trace written to %s", filename);
+			break;
+		}
+
 		default:
 			return 0;
 			break;
@@ -1492,6 +1517,20 @@ int HandleTestKey(int key)
 			if ((GameArg.DbgUseDoubleBuffer = !GameArg.DbgUseDoubleBuffer)!=0)
 				init_cockpit();
 			break;
+
+		case KEY_DEBUGGED+KEY_SHIFTED+KEY_V:
+			fvi_test_crowded_segment(500);
+			break;
+
+		case KEY_DEBUGGED+KEY_SHIFTED+KEY_M:
+			vm_test_math();
+			break;
+
+#if defined(USE_UDP) && defined(USE_TRACKER)
+		case KEY_DEBUGGED+KEY_SHIFTED+KEY_N:
+			net_udp_test_game_list(UDP_MAX_NETGAMES);
+			break;
+#endif
 		#endif
 
 #ifdef EDITOR
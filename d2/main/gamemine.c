@@ -45,6 +45,11 @@ COPYRIGHT 1993-1999 PARALLAX SOFTWARE CORPORATION.  ALL RIGHTS RESERVED.
 #include "piggy.h"
 #include "byteswap.h"
 #include "gamesave.h"
+#include "physfsx.h"
+#include "makesig.h"
+#include "u_mem.h"
+#include "console.h"
+#include "args.h"
 
 #define REMOVE_EXT(s)  (*(strchr( (s), '.' ))='\0')
 
@@ -905,13 +910,12 @@ void read_special(int segnum,ubyte bit_mask,PHYSFS_file *LoadFile)
 	}
 }
 
-int load_mine_data_compiled(PHYSFS_file *LoadFile)
+// Set up for reading a compiled mine, whether it is parsed or comes from the mine cache.
+static void mine_compiled_setup(void)
 {
-	int     i, segnum, sidenum;
-	ubyte   compiled_version;
-	short   temp_short;
-	ushort  temp_ushort = 0;
-	ubyte   bit_mask;
+#ifdef EDITOR
+	int	i;
+#endif
 
 	d1_pig_present = PHYSFSX_exists(D1_PIGFILE,1);
 #if 0 // the following will be deleted once reading old pigfiles works reliably
@@ -943,6 +947,17 @@ int load_mine_data_compiled(PHYSFS_file *LoadFile)
 
 //	memset( Segments, 0, sizeof(segment)*MAX_SEGMENTS );
 	fuelcen_reset();
+}
+
+int load_mine_data_compiled(PHYSFS_file *LoadFile)
+{
+	int     i, segnum, sidenum;
+	ubyte   compiled_version;
+	short   temp_short;
+	ushort  temp_ushort = 0;
+	ubyte   bit_mask;
+
+	mine_compiled_setup();
 
 	//=============================== Reading part ==============================
 	compiled_version = PHYSFSX_readByte(LoadFile);
@@ -1107,3 +1122,215 @@ int load_mine_data_compiled(PHYSFS_file *LoadFile)
 
 	return 0;
 }
+
+/*
+ * Mine cache.
+ *
+ * Reading a compiled mine means thousands of small reads and then validate_segment_all(), which works out the
+ * side types and normals of every segment.  The result depends only on the mine data in the level file, so it is
+ * saved to MINE_CACHE_DIR in the player directory the first time a level is loaded, and later loads of the same
+ * mine copy Vertices and Segments straight out of a memory mapped cache file instead.
+ *
+ * A cache file is named after a hash of the mine data it was made from and starts with a header that repeats
+ * everything the result depends on, plus a hash of its own contents.  If anything does not match, it is ignored
+ * and rewritten.  The files are in native byte order and struct layout, which the header checks too.
+ */
+
+#define MINE_CACHE_DIR		"levelcache"
+#define MINE_CACHE_SIG		MAKE_SIG('M','C','H','E')
+#define MINE_CACHE_VERSION	1
+#define MINE_CACHE_MAX_FILES	64	// the oldest ones are deleted beyond this
+
+typedef struct mine_cache_header {
+	int		sig, version;
+	int		sizeof_segment, sizeof_vertex;
+	int		level_version, new_file_format, d1_pig_present;
+	int		source_size;		// bytes of mine data in the level file
+	u_int64_t	source_hash;		// of those bytes
+	int		num_vertices, num_segments;
+	u_int64_t	data_hash;		// of Vertices and Segments that follow
+} mine_cache_header;
+
+static u_int64_t mine_cache_hash(const void *data, size_t size, u_int64_t h)
+{
+	const ubyte *p = data;
+
+	while (size--)
+		h = (h ^ *p++) * 0x100000001b3ULL;	// FNV-1a
+
+	return h;
+}
+
+#define MINE_CACHE_HASH_INIT	0xcbf29ce484222325ULL
+
+static void mine_cache_filename(char *filename, int size, u_int64_t source_hash)
+{
+	snprintf(filename, size, MINE_CACHE_DIR "/%08x%08x.lvc", (unsigned)(source_hash >> 32), (unsigned)source_hash);
+}
+
+static void mine_cache_header_init(mine_cache_header *h, int source_size, u_int64_t source_hash)
+{
+	memset(h, 0, sizeof(*h));
+	h->sig = MINE_CACHE_SIG;
+	h->version = MINE_CACHE_VERSION;
+	h->sizeof_segment = sizeof(segment);
+	h->sizeof_vertex = sizeof(vms_vector);
+	h->level_version = Gamesave_current_version;
+	h->new_file_format = New_file_format_load;
+	h->d1_pig_present = d1_pig_present;
+	h->source_size = source_size;
+	h->source_hash = source_hash;
+}
+
+// Fill in the mine from the cache file for it.  Returns 0 if there is no usable one.
+static int mine_cache_read(int source_size, u_int64_t source_hash)
+{
+	char			filename[PATH_MAX];
+	PHYSFSX_map		*map;
+	mine_cache_header	want, h;
+	const ubyte		*vertex_data, *segment_data;
+	int			ok = 0;
+
+	mine_cache_filename(filename, sizeof(filename), source_hash);
+	map = PHYSFSX_openMapped(filename);
+	if (!map)
+		return 0;
+
+	mine_cache_header_init(&want, source_size, source_hash);
+	if (map->size >= sizeof(h)) {
+		memcpy(&h, map->data, sizeof(h));
+		want.num_vertices = h.num_vertices;
+		want.num_segments = h.num_segments;
+		want.data_hash = h.data_hash;
+
+		vertex_data = map->data + sizeof(h);
+		segment_data = vertex_data + h.num_vertices * sizeof(vms_vector);
+
+		ok = !memcmp(&h, &want, sizeof(h)) &&
+			h.num_vertices >= 0 && h.num_vertices <= MAX_VERTICES &&
+			h.num_segments >= 0 && h.num_segments <= MAX_SEGMENTS &&
+			map->size == sizeof(h) + h.num_vertices * sizeof(vms_vector) + h.num_segments * sizeof(segment) &&
+			mine_cache_hash(vertex_data, map->size - sizeof(h), MINE_CACHE_HASH_INIT) == h.data_hash;
+	}
+
+	if (ok) {
+		Num_vertices = h.num_vertices;
+		Num_segments = h.num_segments;
+		memcpy(Vertices, vertex_data, Num_vertices * sizeof(vms_vector));
+		memcpy(Segments, segment_data, Num_segments * sizeof(segment));
+	}
+	else
+		con_printf(CON_VERBOSE, "Ignoring stale mine cache %s\n", filename);
+
+	PHYSFSX_closeMapped(map);
+	return ok;
+}
+
+// Delete the oldest cache files until there are no more than MINE_CACHE_MAX_FILES.
+static void mine_cache_prune(void)
+{
+	char		**list, **i, filename[PATH_MAX], oldest[PATH_MAX];
+	PHYSFS_Stat	stat;
+	PHYSFS_sint64	oldest_time;
+	int		count = 0;
+
+	list = PHYSFS_enumerateFiles(MINE_CACHE_DIR);
+	if (!list)
+		return;
+	for (i = list; *i; i++)
+		count++;
+
+	while (count-- > MINE_CACHE_MAX_FILES) {
+		oldest[0] = 0;
+		oldest_time = 0;
+		for (i = list; *i; i++) {
+			snprintf(filename, sizeof(filename), MINE_CACHE_DIR "/%s", *i);
+			if (PHYSFS_stat(filename, &stat) && (!oldest[0] || stat.modtime < oldest_time)) {
+				strcpy(oldest, filename);
+				oldest_time = stat.modtime;
+			}
+		}
+		if (!oldest[0] || !PHYSFS_delete(oldest))
+			break;
+	}
+
+	PHYSFS_freeList(list);
+}
+
+static void mine_cache_write(int source_size, u_int64_t source_hash)
+{
+	char			filename[PATH_MAX], tempname[PATH_MAX];
+	PHYSFS_file		*fp;
+	mine_cache_header	h;
+	int			ok;
+
+	mine_cache_header_init(&h, source_size, source_hash);
+	h.num_vertices = Num_vertices;
+	h.num_segments = Num_segments;
+	h.data_hash = mine_cache_hash(Vertices, Num_vertices * sizeof(vms_vector), MINE_CACHE_HASH_INIT);
+	h.data_hash = mine_cache_hash(Segments, Num_segments * sizeof(segment), h.data_hash);
+
+	PHYSFS_mkdir(MINE_CACHE_DIR);
+	mine_cache_filename(filename, sizeof(filename), source_hash);
+	snprintf(tempname, sizeof(tempname), "%s.tmp", filename);
+
+	// written under another name first, so a cache file is never seen half written
+	fp = PHYSFSX_openWriteBuffered(tempname);
+	if (!fp)
+		return;
+	ok = PHYSFS_write(fp, &h, sizeof(h), 1) == 1 &&
+		PHYSFS_write(fp, Vertices, sizeof(vms_vector), Num_vertices) == Num_vertices &&
+		PHYSFS_write(fp, Segments, sizeof(segment), Num_segments) == Num_segments;
+	PHYSFS_close(fp);
+
+	PHYSFS_delete(filename);	// a stale one, rename() won't replace it everywhere
+	if (!ok || !PHYSFSX_rename(tempname, filename)) {
+		PHYSFS_delete(tempname);
+		return;
+	}
+
+	mine_cache_prune();
+}
+
+//	Same as load_mine_data_compiled(), size being the number of bytes of mine data in LoadFile, but uses the mine
+//	cache when it can.
+int load_mine_data_cached(PHYSFS_file *LoadFile, int size)
+{
+	PHYSFS_sint64	start = PHYSFS_tell(LoadFile);
+	u_int64_t	source_hash;
+	ubyte		*source;
+	int		i, err;
+
+	if (GameArg.SysNoLevelCache || size <= 0 || start < 0)
+		return load_mine_data_compiled(LoadFile);
+
+	MALLOC(source, ubyte, size);
+	if (PHYSFS_read(LoadFile, source, 1, size) != size) {
+		d_free(source);
+		PHYSFSX_fseek(LoadFile, start, SEEK_SET);
+		return load_mine_data_compiled(LoadFile);
+	}
+	source_hash = mine_cache_hash(source, size, MINE_CACHE_HASH_INIT);
+	d_free(source);
+
+	mine_compiled_setup();
+	if (mine_cache_read(size, source_hash)) {
+		Highest_vertex_index = Num_vertices-1;
+		Highest_segment_index = Num_segments-1;
+#ifdef EDITOR
+		for (i=Highest_segment_index+1; i<MAX_SEGMENTS; i++)
+			Segments[i].segnum = -1;
+#endif
+		for (i=0; i<Num_segments; i++)
+			fuelcen_activate( &Segments[i], Segment2s[i].special );
+		reset_objects(1);		//one object, the player
+		return 0;
+	}
+
+	PHYSFSX_fseek(LoadFile, start, SEEK_SET);
+	err = load_mine_data_compiled(LoadFile);
+	if (!err)
+		mine_cache_write(size, source_hash);
+
+	return err;
+}
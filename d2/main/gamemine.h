@@ -120,6 +120,7 @@ int game_load_mine(char * filename);
 // returns 0=everything ok, 1=old version, -1=error
 int load_mine_data(PHYSFS_file *LoadFile);
 int load_mine_data_compiled(PHYSFS_file *LoadFile);
+int load_mine_data_cached(PHYSFS_file *LoadFile, int size);
 
 extern fix Level_shake_frequency, Level_shake_duration;
 extern int Secret_return_segment;
@@ -51,6 +51,8 @@ COPYRIGHT 1993-1999 PARALLAX SOFTWARE CORPORATION.  ALL RIGHTS RESERVED.
 #include "mission.h"
 #include "gameseq.h"
 #include "args.h"
+#include "dxma.h"
+#include "profile.h"
 
 #ifdef OGL
 #include "ogl_init.h"
@@ -522,6 +524,47 @@ void render_countdown_gauge()
 	}
 }
 
+// Progress of a DXMA mission download running in the background
+void show_dxma_download()
+{
+	char status[256];
+
+	if (!dxma_download_status(status, sizeof(status)))
+		return;
+
+	gr_set_curfont(GAME_FONT);
+	gr_set_fontcolor(BM_XRGB(0,31,0),-1);
+	gr_printf(0x8000, (LINE_SPACING*7)+FSPACY(1), "%s", status);
+}
+
+#define PROFILE_OVERLAY_ZONES 16
+
+// Slowest profiler zones, with their time per frame in ms
+void show_profile()
+{
+	profile_zone_stats stats[PROFILE_OVERLAY_ZONES];
+	int i, n, y = LINE_SPACING*9;
+
+	if (!Profile_enabled || !(n = profile_get_stats(stats, PROFILE_OVERLAY_ZONES)))
+		return;
+
+	gr_set_curfont(GAME_FONT);
+	gr_set_fontcolor(BM_XRGB(0,31,0),-1);
+	gr_string(FSPACX(2), y, "Zone");
+	gr_string(FSPACX(130), y, "avg");
+	gr_string(FSPACX(160), y, "max");
+	gr_string(FSPACX(190), y, "calls");
+
+	for (i = 0; i < n; i++)
+	{
+		y += LINE_SPACING;
+		gr_string(FSPACX(2 + 6 * min(stats[i].depth, 4)), y, stats[i].name);
+		gr_printf(FSPACX(130), y, "%.2f", stats[i].avg_usec / 1000.0);
+		gr_printf(FSPACX(160), y, "%.2f", stats[i].max_usec / 1000.0);
+		gr_printf(FSPACX(190), y, "%i", stats[i].calls);
+	}
+}
+
 void game_draw_hud_stuff()
 {
 #ifndef NDEBUG
@@ -573,6 +616,12 @@ void game_draw_hud_stuff()
 
 	render_countdown_gauge();
 
+	if (PlayerCfg.CurrentCockpitMode != CM_REAR_VIEW)
+		show_dxma_download();
+
+	if (PlayerCfg.CurrentCockpitMode != CM_REAR_VIEW)
+		show_profile();
+
 	if (!is_observer() && GameCfg.FPSIndicator && PlayerCfg.CurrentCockpitMode != CM_REAR_VIEW)
 		show_framerate();
 
@@ -57,6 +57,9 @@ COPYRIGHT 1993-1999 PARALLAX SOFTWARE CORPORATION.  ALL RIGHTS RESERVED.
 #include "byteswap.h"
 #include "multi.h"
 #include "makesig.h"
+#include "lighting.h"
+#include "ai.h"
+#include "render.h"
 
 char Gamesave_current_filename[PATH_MAX];
 
@@ -1197,6 +1200,9 @@ int load_level(const char * filename_passed)
 
 	Slide_segs_computed = 0;
 
+	//the task building the last level's sets must stop before the mine is replaced
+	free_segment_pvs();
+
 #ifdef NETWORK
    if (Game_mode & GM_NETWORK)
 	 {
@@ -1331,7 +1337,7 @@ int load_level(const char * filename_passed)
 	} else
 	#endif
 		//NOTE LINK TO ABOVE!!
-		mine_err = load_mine_data_compiled(LoadFile);
+		mine_err = load_mine_data_cached(LoadFile, gamedata_offset - minedata_offset);
 
 	/* !!!HACK!!!
 	 * Descent 1 - Level 19: OBERON MINE has some ugly overlapping rooms (segment 484).
@@ -1386,6 +1392,10 @@ int load_level(const char * filename_passed)
 	PHYSFS_close( LoadFile );
 
 	set_ambient_sound_flags();
+	reset_dynamic_light_cache();
+	ai_reset_path_cache();
+	build_segment_pvs();
+	reset_view_caches();
 
 	#ifdef EDITOR
 	//If a Descent 1 level and the Descent 1 pig isn't present, pretend it's a Descent 2 level.
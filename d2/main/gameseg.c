@@ -713,7 +713,7 @@ static int trace_segs(const vms_vector *p0, int oldsegnum, int recursion_count)
 	fix side_dists[6];
 	fix biggest_val;
 	int sidenum, bit, check, biggest_side;
-	static ubyte visited [MAX_SEGMENTS];
+	static __thread_local__ ubyte visited [MAX_SEGMENTS];
 
 	Assert((oldsegnum <= Highest_segment_index) && (oldsegnum >= 0));
 
@@ -921,6 +921,7 @@ void LoadLevel(int level_num,int page_in_textures)
 	my_segments_checksum = netmisc_calc_checksum();
 
 	reset_network_objects();
+	multi_save_object_base();
 #endif
 
 	Players[Player_num] = save_player;
@@ -5094,7 +5094,7 @@ void observer_show_bomb_highlights()
 	for (int i = 0; i < MAX_PLAYERS; i++)
 		oldest_bomb[i] = -1;
 
-	for (int i = 0; i <= Highest_object_index; i++)
+	for (int i = obj_first_used(); i != -1; i = obj_next_used(i))
 	{
 		if (Objects[i].type == OBJ_WEAPON && (Objects[i].id == PROXIMITY_ID || Objects[i].id == SUPERPROX_ID))
 		{
@@ -86,6 +86,7 @@ char copyright[] = "DESCENT II  COPYRIGHT (C) 1994-1996 PARALLAX SOFTWARE CORPOR
 #ifdef USE_UDP
 #include "net_udp.h"
 #endif
+#include "state.h"
 
 //Current version number
 
@@ -116,6 +117,8 @@ void print_commandline_help()
 	printf( "  -window                       Run the game in a window\n");
 	printf( "  -noborders                    Do not show borders in window mode\n");
 	printf( "  -nomovies                     Don't play movies\n");
+	printf( "  -threads <n>                  Use <n> threads for parallel work, 1 disables\n\t\t\t\t(default: number of CPUs)\n");
+	printf( "  -nolevelcache                 Don't save or use the mine cache in levelcache/\n");
 
 	printf( "\n Controls:\n\n");
 	printf( "  -nocursor                     Hide mouse cursor\n");
@@ -137,6 +140,8 @@ void print_commandline_help()
 	printf( "  -lowresmovies                 Play low resolution movies if available (for slow machines)\n");
 #ifdef    OGL
 	printf( "  -gl_fixedfont                 Do not scale fonts to current resolution\n");
+	printf( "  -gl_capture <s>               Write raw RGB24 frames to file <s>, or to the\n\t\t\t\tstdin of command <s> if it starts with |\n");
+	printf( "  -gl_capturefps <n>            Capture <n> frames per second (default: 30)\n");
 #endif // OGL
 
 #if defined(USE_UDP)
@@ -144,6 +149,7 @@ void print_commandline_help()
 	printf( "  -udp_hostaddr <s>             Use IP address/Hostname <s> for manual game joining\n\t\t\t\t(default: %s)\n", UDP_MANUAL_ADDR_DEFAULT);
 	printf( "  -udp_hostport <n>             Use UDP port <n> for manual game joining (default: %i)\n", UDP_PORT_DEFAULT);
 	printf( "  -udp_myport <n>               Set my own UDP port to <n> (default: %i)\n", UDP_PORT_DEFAULT);
+	printf( "  -dxmamirror <s>               Download DXMA missions from <s> instead of sectorgame.com\n\t\t\t\t(e.g. http://127.0.0.1:8000)\n");
 #ifdef USE_TRACKER
 	printf( "  -tracker_hostaddr <n>         Address of Tracker server to register/query games to/from\n\t\t\t\t(default: %s)\n", TRACKER_ADDR_DEFAULT);
 	printf( "  -tracker_hostport <n>         Port of Tracker server to register/query games to/from\n\t\t\t\t(default: %i)\n", TRACKER_PORT_DEFAULT);
@@ -155,6 +161,7 @@ void print_commandline_help()
 	printf( "  -autoload <s>                 Autoload level <s> in the editor\n");
 	printf( "  -macdata                      Read and write mac data files in editor (swap colors)\n");
 	printf( "  -hoarddata                    Make the hoard ham file from some files, then exit\n");
+	printf( "  -relight <s>                  Cast the light in level <s> and save it, then exit\n");
 #endif // EDITOR
 
 	printf( "\n Debug (use only if you know what you're doing):\n\n");
@@ -163,6 +170,7 @@ void print_commandline_help()
 	printf( "  -safelog                      Write gamelog.txt unbuffered.\n\t\t\t\tUse to keep helpful output to trace program crashes.\n");
 	printf( "  -norun                        Bail out after initialization\n");
 	printf( "  -renderstats                  Enable renderstats info by default\n");
+	printf( "  -profile                      Enable the frame profiler by default\n\t\t\t\t(Alt-F11 toggles it, Alt-F12 writes a trace)\n");
 	printf( "  -text <s>                     Specify alternate .tex file\n");
 	printf( "  -tmap <s>                     Select texmapper <s> to use\n\t\t\t\t(default: c, available: c, fp, quad, i386)\n");
 	printf( "  -showmeminfo                  Show memory statistics\n");
@@ -441,6 +449,11 @@ int main(int argc, char *argv[])
 	con_printf( CON_DEBUG, "\nRunning game...\n" );
 	init_game();
 
+	#ifdef EDITOR
+	if (GameArg.EdiRelight)
+		exit(med_relight_level(GameArg.EdiRelight));
+	#endif
+
 	// Load the DXMA mission database (embedded baseline, plus a cached
 	// refresh if one exists) so both the mission browser and the join-time
 	// "you're missing this map" lookup work without the player having to
@@ -499,8 +512,11 @@ int main(int argc, char *argv[])
 
 	setjmp(LeaveEvents);
 	while (window_get_front())
+	{
 		// Send events to windows and the default handler
 		event_process();
+		state_save_poll();
+	}
 	
 	// Tidy up - avoids a crash on exit
 	{
@@ -511,6 +527,7 @@ int main(int argc, char *argv[])
 			window_close(wind);
 	}
 
+	state_save_wait();
 	WriteConfigFile();
 	show_order_form();
 
@@ -45,159 +45,409 @@ COPYRIGHT 1993-1999 PARALLAX SOFTWARE CORPORATION.  ALL RIGHTS RESERVED.
 #include "bm.h"
 #include "rle.h"
 #include "wall.h"
+#include "worker.h"
+#ifdef EDITOR
+#include "editor/editor.h"
+#endif
 
 int	Do_dynamic_light=1;
 int use_fcd_lighting = 0;
 g3s_lrgb Dynamic_light[MAX_VERTICES];
+dynamic_light_stats Dynamic_light_stats;
 
 #define	HEADLIGHT_CONE_DOT	(F1_0*9/10)
 #define	HEADLIGHT_SCALE		(F1_0*10)
 
+#define LIGHT_PARALLEL_WORK	8192	//lights*vertices it takes before the clusters are lit on the worker threads
+
+//	Dynamic light is computed in clusters: the render vertices are packed by segment, every moving light is
+//	tested against the bounding box of each segment, and only the vertices of the segments it can reach are
+//	lit.  Lights that did not change since the previous frame are kept in Static_light instead.
+
+//	A bright light, lit on the render vertices this frame.
+typedef struct dyn_light {
+	vms_vector	pos;
+	vms_vector	fvec;			//headlight direction
+	g3s_lrgb	emission;
+	fix		range;			//no light at or beyond this distance
+	fix		max_headlight_dist;
+	int		segnum;
+	int		headlight_shift;
+	int		use_fcd;		//use the connected distance instead of the straight one
+} dyn_light;
+
+//	The render vertices of one segment.
+typedef struct light_cluster {
+	int		segnum;
+	int		first_vert, num_verts;	//in the packed vertex arrays
+	vms_vector	bmin, bmax;		//bounding box of those vertices
+	int		verts_lit;
+} light_cluster;
+
+//	What an object's light was computed from.  The light of an object whose key is the same two frames in a row
+//	is added into Static_light, and taken out again when the key changes.
+typedef struct light_key {
+	int		signature;
+	int		segnum;
+	vms_vector	pos;
+	g3s_lrgb	emission;
+	int		own_segment;		//dim light, only lights its own segment
+} light_key;
+
+static int		Light_vert_num[MAX_VERTICES];		//render vertices, grouped by segment
+static fix		Light_vert_x[MAX_VERTICES], Light_vert_y[MAX_VERTICES], Light_vert_z[MAX_VERTICES];
+static fix		Light_vert_dist[MAX_VERTICES];
+static int		Num_light_verts;
+static light_cluster	Light_clusters[MAX_RENDER_SEGS];
+static int		Num_light_clusters, Light_cluster_jobs;
+static dyn_light	Dyn_lights[MAX_OBJECTS+MUZZLE_QUEUE_MAX];
+static int		Num_dyn_lights;
+
+static g3s_lrgb		Static_light[MAX_VERTICES];
+static light_key	Light_prev_key[MAX_OBJECTS];
+static light_key	Light_static_key[MAX_OBJECTS];
+static sbyte		Light_is_static[MAX_OBJECTS];
+static int		Light_highest_static = -1;
+static int		Light_vert_stamp[MAX_VERTICES], Light_stamp;
+static vms_vector	Light_seg_min[MAX_SEGMENTS], Light_seg_max[MAX_SEGMENTS];
+static int		Light_seg_bounds_valid;
+
 // ----------------------------------------------------------------------------------------------
-void apply_light(g3s_lrgb obj_light_emission, int obj_seg, vms_vector *obj_pos, int n_render_vertices, int *render_vertices, int *vert_segnum_list, int objnum)
+//	Forget all cached light.  Must be called when a new mine is loaded.
+void reset_dynamic_light_cache(void)
+{
+	memset(Static_light, 0, sizeof(Static_light));
+	memset(Light_prev_key, 0, sizeof(Light_prev_key));
+	memset(Light_is_static, 0, sizeof(Light_is_static));
+	memset(Light_vert_stamp, 0, sizeof(Light_vert_stamp));
+	Light_highest_static = -1;
+	Light_stamp = 0;
+	Light_seg_bounds_valid = 0;
+}
+
+// ----------------------------------------------------------------------------------------------
+//	Same as vm_vec_mag_quick(), but with min/max instead of swaps so a loop of them can be vectorized.
+static inline fix light_dist_quick(fix dx, fix dy, fix dz)
+{
+	fix	a, b, c, bc;
+
+	dx = abs(dx);
+	dy = abs(dy);
+	dz = abs(dz);
+
+	a = max(max(dx, dy), dz);
+	c = min(min(dx, dy), dz);
+	b = dx ^ dy ^ dz ^ a ^ c;		//the one in the middle
+
+	bc = (b>>2) + (c>>3);
+
+	return a + bc + (bc>>1);
+}
+
+// ----------------------------------------------------------------------------------------------
+//	Lower bound of vm_vec_dist_quick() from pos to any point in the box.  The quick distance is never less than
+//	the largest coordinate difference.
+static fix light_box_dist(vms_vector *pos, vms_vector *bmin, vms_vector *bmax)
+{
+	fix	d = 0;
+
+	if (pos->x < bmin->x)
+		d = max(d, bmin->x - pos->x);
+	else if (pos->x > bmax->x)
+		d = max(d, pos->x - bmax->x);
+	if (pos->y < bmin->y)
+		d = max(d, bmin->y - pos->y);
+	else if (pos->y > bmax->y)
+		d = max(d, pos->y - bmax->y);
+	if (pos->z < bmin->z)
+		d = max(d, bmin->z - pos->z);
+	else if (pos->z > bmax->z)
+		d = max(d, pos->z - bmax->z);
+
+	return d;
+}
+
+static void light_box_add(vms_vector *bmin, vms_vector *bmax, vms_vector *p)
 {
+	if (p->x < bmin->x) bmin->x = p->x;
+	if (p->x > bmax->x) bmax->x = p->x;
+	if (p->y < bmin->y) bmin->y = p->y;
+	if (p->y > bmax->y) bmax->y = p->y;
+	if (p->z < bmin->z) bmin->z = p->z;
+	if (p->z > bmax->z) bmax->z = p->z;
+}
+
+static fix light_range(g3s_lrgb *emission)
+{
+	return abs(((emission->r+emission->g+emission->b)/3)*64);
+}
+
+static int light_key_equal(light_key *a, light_key *b)
+{
+	return a->signature == b->signature && a->segnum == b->segnum && a->own_segment == b->own_segment &&
+		a->pos.x == b->pos.x && a->pos.y == b->pos.y && a->pos.z == b->pos.z &&
+		a->emission.r == b->emission.r && a->emission.g == b->emission.g && a->emission.b == b->emission.b;
+}
+
+// ----------------------------------------------------------------------------------------------
+//	Dim lights and markers only light the vertices of their own segment.  sign is -1 to take the light out again.
+static void light_own_segment(g3s_lrgb *light, g3s_lrgb *emission, int segnum, vms_vector *pos, int sign)
+{
+	int	*vp = Segments[segnum].verts;
+	fix	range = light_range(emission);
 	int	vv;
 
-	if (((obj_light_emission.r+obj_light_emission.g+obj_light_emission.b)/3) > 0)
-	{
-		fix obji_64 = ((obj_light_emission.r+obj_light_emission.g+obj_light_emission.b)/3)*64;
-		sbyte is_marker = 0;
-		
-		if (objnum != -1)
-			if (Objects[objnum].type == OBJ_MARKER)
-				is_marker = 1;
-
-		// for pretty dim sources, only process vertices in object's own segment.
-		//	12/04/95, MK, markers only cast light in own segment.
-		if ((abs(obji_64) <= F1_0*8) || is_marker) {
-			int *vp = Segments[obj_seg].verts;
-
-			for (vv=0; vv<MAX_VERTICES_PER_SEGMENT; vv++) {
-				int			vertnum;
-				vms_vector	*vertpos;
-				fix			dist;
-
-				vertnum = vp[vv];
-				vertpos = &Vertices[vertnum];
-				dist = vm_vec_dist_quick(obj_pos, vertpos);
-				dist = fixmul(dist/4, dist/4);
-				if (dist < abs(obji_64)) {
-					if (dist < MIN_LIGHT_DIST)
-						dist = MIN_LIGHT_DIST;
-
-					Dynamic_light[vertnum].r += fixdiv(obj_light_emission.r, dist);
-					Dynamic_light[vertnum].g += fixdiv(obj_light_emission.g, dist);
-					Dynamic_light[vertnum].b += fixdiv(obj_light_emission.b, dist);
+	for (vv=0; vv<MAX_VERTICES_PER_SEGMENT; vv++) {
+		int	vertnum = vp[vv];
+		fix	dist;
+
+		dist = vm_vec_dist_quick(pos, &Vertices[vertnum]);
+		dist = fixmul(dist/4, dist/4);
+		if (dist < range) {
+			if (dist < MIN_LIGHT_DIST)
+				dist = MIN_LIGHT_DIST;
+
+			light[vertnum].r += sign * fixdiv(emission->r, dist);
+			light[vertnum].g += sign * fixdiv(emission->g, dist);
+			light[vertnum].b += sign * fixdiv(emission->b, dist);
+		}
+	}
+
+	Dynamic_light_stats.verts += MAX_VERTICES_PER_SEGMENT;
+}
+
+// ----------------------------------------------------------------------------------------------
+//	Light every vertex of the mine in reach of a bright light into Static_light.
+static void light_all_segments(g3s_lrgb *emission, vms_vector *pos, int sign)
+{
+	fix	range = light_range(emission);
+	int	segnum, vv;
+
+	if (!Light_seg_bounds_valid) {
+		for (segnum=0; segnum<=Highest_segment_index; segnum++) {
+			int *vp = Segments[segnum].verts;
+
+			Light_seg_min[segnum] = Light_seg_max[segnum] = Vertices[vp[0]];
+			for (vv=1; vv<MAX_VERTICES_PER_SEGMENT; vv++)
+				light_box_add(&Light_seg_min[segnum], &Light_seg_max[segnum], &Vertices[vp[vv]]);
+		}
+		Light_seg_bounds_valid = 1;
+	}
+
+	Light_stamp++;
+
+	for (segnum=0; segnum<=Highest_segment_index; segnum++) {
+		int	*vp = Segments[segnum].verts;
+
+		if (light_box_dist(pos, &Light_seg_min[segnum], &Light_seg_max[segnum]) >= range)
+			continue;
+
+		for (vv=0; vv<MAX_VERTICES_PER_SEGMENT; vv++) {
+			int	vertnum = vp[vv];
+			fix	dist;
+
+			if (Light_vert_stamp[vertnum] == Light_stamp)
+				continue;
+			Light_vert_stamp[vertnum] = Light_stamp;
+
+			dist = vm_vec_dist_quick(pos, &Vertices[vertnum]);
+			if (dist < range) {
+				if (dist < MIN_LIGHT_DIST)
+					dist = MIN_LIGHT_DIST;
+
+				Static_light[vertnum].r += sign * fixdiv(emission->r, dist);
+				Static_light[vertnum].g += sign * fixdiv(emission->g, dist);
+				Static_light[vertnum].b += sign * fixdiv(emission->b, dist);
+			}
+			Dynamic_light_stats.verts++;
+		}
+	}
+}
+
+static void light_static_apply(light_key *key, int sign)
+{
+	if (key->own_segment)
+		light_own_segment(Static_light, &key->emission, key->segnum, &key->pos, sign);
+	else
+		light_all_segments(&key->emission, &key->pos, sign);
+}
+
+// ----------------------------------------------------------------------------------------------
+//	Light the render vertices with a light that is not in Static_light.  Dim lights are done right away, bright ones
+//	are queued for the clusters.
+static void add_dynamic_light(g3s_lrgb obj_light_emission, int obj_seg, vms_vector *obj_pos, int objnum)
+{
+	fix		range = light_range(&obj_light_emission);
+	dyn_light	*l;
+
+	Dynamic_light_stats.lights++;
+
+	//	for pretty dim sources, only process vertices in object's own segment.
+	//	12/04/95, MK, markers only cast light in own segment.
+	if (range <= F1_0*8 || (objnum != -1 && Objects[objnum].type == OBJ_MARKER)) {
+		light_own_segment(Dynamic_light, &obj_light_emission, obj_seg, obj_pos, 1);
+		return;
+	}
+
+	l = &Dyn_lights[Num_dyn_lights++];
+	l->pos = *obj_pos;
+	l->emission = obj_light_emission;
+	l->range = range;
+	l->segnum = obj_seg;
+	l->headlight_shift = 0;
+	l->max_headlight_dist = F1_0*200;
+	l->use_fcd = use_fcd_lighting && range > F1_0*32;
+
+	if (objnum != -1)
+		if (Objects[objnum].type == OBJ_PLAYER)
+			if (Players[Objects[objnum].id].flags & PLAYER_FLAGS_HEADLIGHT_ON) {
+				l->headlight_shift = 3;
+				l->fvec = Objects[objnum].orient.fvec;
+				if (Objects[objnum].id != Player_num) {
+					vms_vector	tvec;
+					fvi_query	fq;
+					fvi_info		hit_data;
+					int			fate;
+
+					vm_vec_scale_add(&tvec, &Objects[objnum].pos, &Objects[objnum].orient.fvec, F1_0*200);
+
+					fq.startseg				= Objects[objnum].segnum;
+					fq.p0						= &Objects[objnum].pos;
+					fq.p1						= &tvec;
+					fq.rad					= 0;
+					fq.thisobjnum			= objnum;
+					fq.ignore_obj_list	= NULL;
+					fq.flags					= FQ_TRANSWALL;
+
+					fate = find_vector_intersection(&fq, &hit_data);
+					if (fate != HIT_NONE)
+						l->max_headlight_dist = vm_vec_mag_quick(vm_vec_sub(&tvec, &hit_data.hit_pnt, &Objects[objnum].pos)) + F1_0*4;
 				}
 			}
-		} else {
-			int	headlight_shift = 0;
-			fix	max_headlight_dist = F1_0*200;
-
-			if (objnum != -1)
-				if (Objects[objnum].type == OBJ_PLAYER)
-					if (Players[Objects[objnum].id].flags & PLAYER_FLAGS_HEADLIGHT_ON) {
-						headlight_shift = 3;
-						if (Objects[objnum].id != Player_num) {
-							vms_vector	tvec;
-							fvi_query	fq;
-							fvi_info		hit_data;
-							int			fate;
-
-							vm_vec_scale_add(&tvec, &Objects[objnum].pos, &Objects[objnum].orient.fvec, F1_0*200);
-
-							fq.startseg				= Objects[objnum].segnum;
-							fq.p0						= &Objects[objnum].pos;
-							fq.p1						= &tvec;
-							fq.rad					= 0;
-							fq.thisobjnum			= objnum;
-							fq.ignore_obj_list	= NULL;
-							fq.flags					= FQ_TRANSWALL;
-
-							fate = find_vector_intersection(&fq, &hit_data);
-							if (fate != HIT_NONE)
-								max_headlight_dist = vm_vec_mag_quick(vm_vec_sub(&tvec, &hit_data.hit_pnt, &Objects[objnum].pos)) + F1_0*4;
-						}
-					}
+}
 
-			for (vv=0; vv<n_render_vertices; vv++) {
-				int			vertnum, vsegnum;
-				vms_vector	*vertpos;
-				fix			dist;
-				int			apply_light = 0;
+// ----------------------------------------------------------------------------------------------
+//	Headlights and lights using the connected distance, one vertex at a time.
+static void light_cluster_slow(light_cluster *cl, dyn_light *l)
+{
+	int	vv;
+
+	for (vv=cl->first_vert; vv<cl->first_vert+cl->num_verts; vv++) {
+		int			vertnum;
+		vms_vector	*vertpos;
+		fix			dist;
+		int			apply_light = 0;
+
+		vertnum = Light_vert_num[vv];
+		vertpos = &Vertices[vertnum];
+
+		if (l->use_fcd)
+		{
+			dist = find_connected_distance(&l->pos, l->segnum, vertpos, cl->segnum, Num_light_verts, WID_RENDPAST_FLAG+WID_FLY_FLAG);
+			if (dist >= 0)
+				apply_light = 1;
+		}
+		else
+		{
+			dist = vm_vec_dist_quick(&l->pos, vertpos);
+			apply_light = 1;
+		}
+
+		if (apply_light && ((dist >> l->headlight_shift) < l->range)) {
 
-				vertnum = render_vertices[vv];
-				vsegnum = vert_segnum_list[vv];
-				vertpos = &Vertices[vertnum];
+			if (dist < MIN_LIGHT_DIST)
+				dist = MIN_LIGHT_DIST;
 
-				if (use_fcd_lighting && abs(obji_64) > F1_0*32)
+			if (l->headlight_shift)
+			{
+				fix dot;
+				vms_vector vec_to_point;
+
+				vm_vec_sub(&vec_to_point, vertpos, &l->pos);
+				vm_vec_normalize_quick(&vec_to_point); // MK, Optimization note: You compute distance about 15 lines up, this is partially redundant
+				dot = vm_vec_dot(&vec_to_point, &l->fvec);
+				if (dot < F1_0/2)
 				{
-					dist = find_connected_distance(obj_pos, obj_seg, vertpos, vsegnum, n_render_vertices, WID_RENDPAST_FLAG+WID_FLY_FLAG);
-					if (dist >= 0)
-						apply_light = 1;
+					// Do the normal thing, but darken around headlight.
+					Dynamic_light[vertnum].r += fixdiv(l->emission.r, fixmul(HEADLIGHT_SCALE, dist));
+					Dynamic_light[vertnum].g += fixdiv(l->emission.g, fixmul(HEADLIGHT_SCALE, dist));
+					Dynamic_light[vertnum].b += fixdiv(l->emission.b, fixmul(HEADLIGHT_SCALE, dist));
 				}
-				else
+				else if (!(Game_mode & GM_MULTI) || dist < l->max_headlight_dist)
 				{
-					dist = vm_vec_dist_quick(obj_pos, vertpos);
-					apply_light = 1;
+					Dynamic_light[vertnum].r += fixmul(fixmul(dot, dot), l->emission.r)/8;
+					Dynamic_light[vertnum].g += fixmul(fixmul(dot, dot), l->emission.g)/8;
+					Dynamic_light[vertnum].b += fixmul(fixmul(dot, dot), l->emission.b)/8;
 				}
+			}
+			else
+			{
+				Dynamic_light[vertnum].r += fixdiv(l->emission.r, dist);
+				Dynamic_light[vertnum].g += fixdiv(l->emission.g, dist);
+				Dynamic_light[vertnum].b += fixdiv(l->emission.b, dist);
+			}
+		}
+	}
+}
+
+// ----------------------------------------------------------------------------------------------
+//	Light the vertices of one cluster with all queued lights that can reach it.  The clusters do not share
+//	vertices, so they can be lit on different threads.
+static void light_one_cluster(light_cluster *cl)
+{
+	int	first = cl->first_vert, end = cl->first_vert + cl->num_verts;
+	int	i, vv;
 
-				if (apply_light && ((dist >> headlight_shift) < abs(obji_64))) {
+	cl->verts_lit = 0;
 
-					if (dist < MIN_LIGHT_DIST)
-						dist = MIN_LIGHT_DIST;
+	for (i=0; i<Num_dyn_lights; i++) {
+		dyn_light	*l = &Dyn_lights[i];
+		fix		lx = l->pos.x, ly = l->pos.y, lz = l->pos.z, range = l->range;
 
-					if (headlight_shift && objnum != -1)
-					{
-						fix dot;
-						vms_vector vec_to_point;
-
-						vm_vec_sub(&vec_to_point, vertpos, obj_pos);
-						vm_vec_normalize_quick(&vec_to_point); // MK, Optimization note: You compute distance about 15 lines up, this is partially redundant
-						dot = vm_vec_dot(&vec_to_point, &Objects[objnum].orient.fvec);
-						if (dot < F1_0/2)
-						{
-							// Do the normal thing, but darken around headlight.
-							Dynamic_light[vertnum].r += fixdiv(obj_light_emission.r, fixmul(HEADLIGHT_SCALE, dist));
-							Dynamic_light[vertnum].g += fixdiv(obj_light_emission.g, fixmul(HEADLIGHT_SCALE, dist));
-							Dynamic_light[vertnum].b += fixdiv(obj_light_emission.b, fixmul(HEADLIGHT_SCALE, dist));
-						}
-						else
-						{
-							if (Game_mode & GM_MULTI)
-							{
-								if (dist < max_headlight_dist)
-								{
-									Dynamic_light[vertnum].r += fixmul(fixmul(dot, dot), obj_light_emission.r)/8;
-									Dynamic_light[vertnum].g += fixmul(fixmul(dot, dot), obj_light_emission.g)/8;
-									Dynamic_light[vertnum].b += fixmul(fixmul(dot, dot), obj_light_emission.b)/8;
-								}
-							}
-							else
-							{
-								Dynamic_light[vertnum].r += fixmul(fixmul(dot, dot), obj_light_emission.r)/8;
-								Dynamic_light[vertnum].g += fixmul(fixmul(dot, dot), obj_light_emission.g)/8;
-								Dynamic_light[vertnum].b += fixmul(fixmul(dot, dot), obj_light_emission.b)/8;
-							}
-						}
-					}
-					else
-					{
-						Dynamic_light[vertnum].r += fixdiv(obj_light_emission.r, dist);
-						Dynamic_light[vertnum].g += fixdiv(obj_light_emission.g, dist);
-						Dynamic_light[vertnum].b += fixdiv(obj_light_emission.b, dist);
-					}
-				}
-			}
+		if (!l->use_fcd && (light_box_dist(&l->pos, &cl->bmin, &cl->bmax) >> l->headlight_shift) >= range)
+			continue;
+
+		cl->verts_lit += cl->num_verts;
+
+		if (l->headlight_shift || l->use_fcd) {
+			light_cluster_slow(cl, l);
+			continue;
+		}
+
+		for (vv=first; vv<end; vv++)
+			Light_vert_dist[vv] = light_dist_quick(lx - Light_vert_x[vv], ly - Light_vert_y[vv], lz - Light_vert_z[vv]);
+
+		for (vv=first; vv<end; vv++) {
+			fix		dist = Light_vert_dist[vv];
+			g3s_lrgb	*dl;
+
+			if (dist >= range)
+				continue;
+			if (dist < MIN_LIGHT_DIST)
+				dist = MIN_LIGHT_DIST;
+
+			dl = &Dynamic_light[Light_vert_num[vv]];
+			dl->r += fixdiv(l->emission.r, dist);
+			dl->g += fixdiv(l->emission.g, dist);
+			dl->b += fixdiv(l->emission.b, dist);
 		}
 	}
 }
 
+static void light_clusters_job(void *data, int job, int thread)
+{
+	int	per_job = (Num_light_clusters + Light_cluster_jobs - 1) / Light_cluster_jobs;
+	int	c, end = min((job+1) * per_job, Num_light_clusters);
+
+	for (c=job*per_job; c<end; c++)
+		light_one_cluster(&Light_clusters[c]);
+}
+
 #define FLASH_LEN_FIXED_SECONDS (F1_0/3)
 #define FLASH_SCALE             (3*F1_0/FLASH_LEN_FIXED_SECONDS)
 
 // ----------------------------------------------------------------------------------------------
-void cast_muzzle_flash_light(int n_render_vertices, int *render_vertices, int *vert_segnum_list)
+static void cast_muzzle_flash_light(void)
 {
 	fix64 current_time;
 	int i;
@@ -214,7 +464,8 @@ void cast_muzzle_flash_light(int n_render_vertices, int *render_vertices, int *v
 			{
 				g3s_lrgb ml;
 				ml.r = ml.g = ml.b = ((FLASH_LEN_FIXED_SECONDS - time_since_flash) * FLASH_SCALE);
-				apply_light(ml, Muzzle_data[i].segnum, &Muzzle_data[i].pos, n_render_vertices, render_vertices, vert_segnum_list, -1);
+				if (((ml.r+ml.g+ml.b)/3) > 0)
+					add_dynamic_light(ml, Muzzle_data[i].segnum, &Muzzle_data[i].pos, -1);
 			}
 			else
 			{
@@ -455,11 +706,9 @@ void set_dynamic_light(void)
 {
 	int	vv;
 	int	objnum;
-	int	n_render_vertices;
-	int	render_vertices[MAX_VERTICES];
-	int	vert_segnum_list[MAX_VERTICES];
 	sbyte   render_vertex_flags[MAX_VERTICES];
-	int	render_seg,segnum, v;
+	int	render_seg,segnum, v, c;
+	int	use_cache = 1;
 	//static fix light_time;
 
 	Num_headlights = 0;
@@ -474,14 +723,30 @@ void set_dynamic_light(void)
 	light_time = light_time - (F1_0/60);
 	#endif
 
+#ifdef EDITOR
+	//	the mine can change under the cache in the editor
+	if (EditorWindow) {
+		if (Light_highest_static >= 0 || Light_seg_bounds_valid)
+			reset_dynamic_light_cache();
+		use_cache = 0;
+	}
+#endif
+
+	memset(&Dynamic_light_stats, 0, sizeof(Dynamic_light_stats));
 	memset(render_vertex_flags, 0, Highest_vertex_index+1);
 
-	//	Create list of vertices that need to be looked at for setting of ambient light.
-	n_render_vertices = 0;
+	//	Create list of vertices that need to be looked at for setting of ambient light, one cluster per segment.
+	Num_light_verts = 0;
+	Num_light_clusters = 0;
 	for (render_seg=0; render_seg<N_render_segs; render_seg++) {
 		segnum = Render_list[render_seg];
 		if (segnum != -1) {
 			int	*vp = Segments[segnum].verts;
+			light_cluster *cl = &Light_clusters[Num_light_clusters];
+
+			cl->segnum = segnum;
+			cl->first_vert = Num_light_verts;
+
 			for (v=0; v<MAX_VERTICES_PER_SEGMENT; v++) {
 				int	vnum = vp[v];
 				if (vnum<0 || vnum>Highest_vertex_index) {
@@ -490,34 +755,102 @@ void set_dynamic_light(void)
 				}
 				if (!render_vertex_flags[vnum]) {
 					render_vertex_flags[vnum] = 1;
-					render_vertices[n_render_vertices] = vnum;
-					vert_segnum_list[n_render_vertices] = segnum;
-					n_render_vertices++;
+					Light_vert_num[Num_light_verts] = vnum;
+					Light_vert_x[Num_light_verts] = Vertices[vnum].x;
+					Light_vert_y[Num_light_verts] = Vertices[vnum].y;
+					Light_vert_z[Num_light_verts] = Vertices[vnum].z;
+					if (Num_light_verts == cl->first_vert)
+						cl->bmin = cl->bmax = Vertices[vnum];
+					else
+						light_box_add(&cl->bmin, &cl->bmax, &Vertices[vnum]);
+					Num_light_verts++;
 				}
 			}
+
+			cl->num_verts = Num_light_verts - cl->first_vert;
+			if (cl->num_verts)
+				Num_light_clusters++;
 		}
 	}
 
-	for (vv=0; vv<n_render_vertices; vv++) {
+	for (vv=0; vv<Num_light_verts; vv++) {
 		int	vertnum;
 
-		vertnum = render_vertices[vv];
+		vertnum = Light_vert_num[vv];
 		Assert(vertnum >= 0 && vertnum <= Highest_vertex_index);
 		Dynamic_light[vertnum].r = Dynamic_light[vertnum].g = Dynamic_light[vertnum].b = 0;
 	}
 
-	cast_muzzle_flash_light(n_render_vertices, render_vertices, vert_segnum_list);
+	Num_dyn_lights = 0;
+
+	cast_muzzle_flash_light();
 
 	for (objnum=0; objnum<=Highest_object_index; objnum++)
 	{
 		object		*obj = &Objects[objnum];
-		vms_vector	*objpos = &obj->pos;
 		g3s_lrgb	obj_light_emission;
+		light_key	key;
+		int		cacheable;
 
 		obj_light_emission = compute_light_emission(objnum);
 
-		if (((obj_light_emission.r+obj_light_emission.g+obj_light_emission.b)/3) > 0)
-			apply_light(obj_light_emission, obj->segnum, objpos, n_render_vertices, render_vertices, vert_segnum_list, objnum);
+		key.signature = obj->signature;
+		key.segnum = obj->segnum;
+		key.pos = obj->pos;
+		key.emission = obj_light_emission;
+		key.own_segment = light_range(&obj_light_emission) <= F1_0*8 || obj->type == OBJ_MARKER;
+
+		cacheable = use_cache && ((obj_light_emission.r+obj_light_emission.g+obj_light_emission.b)/3) > 0 &&
+			!(obj->type == OBJ_PLAYER && (Players[obj->id].flags & PLAYER_FLAGS_HEADLIGHT_ON)) &&
+			!(use_fcd_lighting && !key.own_segment && light_range(&obj_light_emission) > F1_0*32);
+
+		//	take the light out of the cache when it changed, put it in when it stayed the same for two frames
+		if (Light_is_static[objnum] && !(cacheable && light_key_equal(&key, &Light_static_key[objnum]))) {
+			light_static_apply(&Light_static_key[objnum], -1);
+			Light_is_static[objnum] = 0;
+		}
+		if (!Light_is_static[objnum] && cacheable && light_key_equal(&key, &Light_prev_key[objnum])) {
+			light_static_apply(&key, 1);
+			Light_static_key[objnum] = key;
+			Light_is_static[objnum] = 1;
+			if (objnum > Light_highest_static)
+				Light_highest_static = objnum;
+		}
+		Light_prev_key[objnum] = key;
+
+		if (Light_is_static[objnum])
+			Dynamic_light_stats.cached_lights++;
+		else if (((obj_light_emission.r+obj_light_emission.g+obj_light_emission.b)/3) > 0)
+			add_dynamic_light(obj_light_emission, obj->segnum, &obj->pos, objnum);
+	}
+
+	//	objects that went away
+	for (objnum=Highest_object_index+1; objnum<=Light_highest_static; objnum++)
+		if (Light_is_static[objnum]) {
+			light_static_apply(&Light_static_key[objnum], -1);
+			Light_is_static[objnum] = 0;
+			memset(&Light_prev_key[objnum], 0, sizeof(light_key));
+		}
+	if (Light_highest_static > Highest_object_index)
+		Light_highest_static = Highest_object_index;
+
+	//	add the cached light, dim lights are already in
+	for (vv=0; vv<Num_light_verts; vv++) {
+		int	vertnum = Light_vert_num[vv];
+
+		Dynamic_light[vertnum].r += Static_light[vertnum].r;
+		Dynamic_light[vertnum].g += Static_light[vertnum].g;
+		Dynamic_light[vertnum].b += Static_light[vertnum].b;
+	}
+
+	if (Num_dyn_lights) {
+		Light_cluster_jobs = 1;
+		if (Num_dyn_lights * Num_light_verts >= LIGHT_PARALLEL_WORK && !use_fcd_lighting)
+			Light_cluster_jobs = min(worker_num_threads() * 2, Num_light_clusters);
+		worker_run(light_clusters_job, NULL, Light_cluster_jobs);
+
+		for (c=0; c<Num_light_clusters; c++)
+			Dynamic_light_stats.verts += Light_clusters[c].verts_lit;
 	}
 }
 
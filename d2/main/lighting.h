@@ -30,6 +30,18 @@ extern g3s_lrgb Dynamic_light[MAX_VERTICES];
 
 extern void set_dynamic_light(void);
 
+// Forget the light cached across frames, for a new mine
+void reset_dynamic_light_cache(void);
+
+// What set_dynamic_light() did in the last frame, shown with -renderstats
+typedef struct dynamic_light_stats {
+	int lights;         // lights computed this frame
+	int cached_lights;  // lights that did not change and were taken from the cache
+	int verts;          // vertices lit
+} dynamic_light_stats;
+
+extern dynamic_light_stats Dynamic_light_stats;
+
 // Compute the lighting from the headlight for a given vertex on a face.
 // Takes:
 //  point - the 3d coords of the point
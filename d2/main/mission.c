@@ -36,6 +36,7 @@ COPYRIGHT 1993-1999 PARALLAX SOFTWARE CORPORATION.  ALL RIGHTS RESERVED.
 #include "text.h"
 #include "u_mem.h"
 #include "ignorecase.h"
+#include "worker.h"
 
 //values that describe where a mission is located
 enum mle_loc
@@ -327,7 +328,7 @@ char *get_value(char *buf)
 //reads a line, returns ptr to value of passed parm.  returns NULL if none
 char *get_parm_value(char *parm,PHYSFS_file *f)
 {
-	static char buf[80];
+	static __thread_local__ char buf[80];	// mission files are read on the worker threads by mission_index_update()
 
 	if (!PHYSFSX_fgets(buf,80,f))
 		return NULL;
@@ -344,11 +345,64 @@ int ml_sort_func(mle *e0,mle *e1)
 
 }
 
+//reads the name and type of the mission in filename2 (full path).
+//returns 1 if it has a name, else 0.  Safe to call from the worker threads.
+int read_mission_header(char *filename2, char *mission_name, ubyte *anarchy_only_flag)
+{
+	PHYSFS_file *mfile;
+	char *p;
+
+	mfile = PHYSFSX_openReadBuffered(filename2);
+	if (!mfile)
+		return 0;
+
+	p = get_parm_value("name",mfile);
+
+	if (!p) {		//try enhanced mission
+		PHYSFSX_fseek(mfile,0,SEEK_SET);
+		p = get_parm_value("xname",mfile);
+	}
+
+	if (!p) {       //try super-enhanced mission!
+		PHYSFSX_fseek(mfile,0,SEEK_SET);
+		p = get_parm_value("zname",mfile);
+	}
+
+	if (!p) {       //try extensible-enhanced mission!
+		PHYSFSX_fseek(mfile,0,SEEK_SET);
+		p = get_parm_value("!name",mfile);
+	}
+
+	if (p) {
+		char *t;
+		if ((t=strchr(p,';'))!=NULL)
+			*t=0;
+		t = p + strlen(p)-1;
+		while (isspace(*t))
+			*t-- = 0; // remove trailing whitespace
+		if (strlen(p) > MISSION_NAME_LEN)
+			p[MISSION_NAME_LEN] = 0;
+		strncpy(mission_name, p, MISSION_NAME_LEN + 1);
+	}
+	else {
+		PHYSFS_close(mfile);
+		return 0;
+	}
+
+	p = get_parm_value("type",mfile);
+
+	//get mission type
+	*anarchy_only_flag = p ? istok(p,"anarchy") : 0;
+
+	PHYSFS_close(mfile);
+
+	return 1;
+}
+
 //returns 1 if file read ok, else 0
 int read_mission_file(mle *mission, char *filename, int location)
 {
 	char filename2[100];
-	PHYSFS_file *mfile;
 
 	switch (location) {
 		case ML_MISSIONDIR:
@@ -364,9 +418,7 @@ int read_mission_file(mle *mission, char *filename, int location)
 	}
 	strcat(filename2,filename);
 
-	mfile = PHYSFSX_openReadBuffered(filename2);
-
-	if (mfile) {
+	{
 		char *p;
 		char temp[PATH_MAX], *ext;
 
@@ -378,61 +430,20 @@ int read_mission_file(mle *mission, char *filename, int location)
 		
 		if ((ext = strchr(p, '.')) == NULL)
 			return 0;	//missing extension
+
+		if (!read_mission_header(filename2, mission->mission_name, &mission->anarchy_only_flag))
+			return 0;
+
 		// look if it's .mn2 or .msn
 		mission->descent_version = (ext[3] == '2') ? 2 : 1;
 		*ext = 0;			//kill extension
 
 		mission->path = d_strdup(temp);
-		mission->anarchy_only_flag = 0;
 		mission->filename = mission->path + (p - temp);
 		mission->location = location;
 
-		p = get_parm_value("name",mfile);
-
-		if (!p) {		//try enhanced mission
-			PHYSFSX_fseek(mfile,0,SEEK_SET);
-			p = get_parm_value("xname",mfile);
-		}
-
-		if (!p) {       //try super-enhanced mission!
-			PHYSFSX_fseek(mfile,0,SEEK_SET);
-			p = get_parm_value("zname",mfile);
-		}
-
-		if (!p) {       //try extensible-enhanced mission!
-			PHYSFSX_fseek(mfile,0,SEEK_SET);
-			p = get_parm_value("!name",mfile);
-		}
-
-		if (p) {
-			char *t;
-			if ((t=strchr(p,';'))!=NULL)
-				*t=0;
-			t = p + strlen(p)-1;
-			while (isspace(*t))
-				*t-- = 0; // remove trailing whitespace
-			if (strlen(p) > MISSION_NAME_LEN)
-				p[MISSION_NAME_LEN] = 0;
-			strncpy(mission->mission_name, p, MISSION_NAME_LEN + 1);
-		}
-		else {
-			PHYSFS_close(mfile);
-			d_free(mission->path);
-			return 0;
-		}
-
-		p = get_parm_value("type",mfile);
-
-		//get mission type
-		if (p)
-			mission->anarchy_only_flag = istok(p,"anarchy");
-
-		PHYSFS_close(mfile);
-
 		return 1;
 	}
-
-	return 0;
 }
 
 void add_d1_builtin_mission_to_list(mle *mission)
@@ -518,7 +529,171 @@ void add_builtin_mission_to_list(mle *mission, char *name)
 }
 
 
-void add_missions_to_list(mle *mission_list, char *path, char *rel_path, int anarchy_mode)
+//
+//  Mission index
+//
+//  Every .msn/.mn2 under MISSION_DIR with what read_mission_header() found in it, kept in
+//  MISSION_INDEX_FILE between runs and keyed by path, size and modification time.  Updating it
+//  only walks the directories; the files that are new or changed are read again, in parallel
+//  on the worker threads.  The mission list and load_mission_by_name() are built from it.
+//  The directories are walked once a run, the mission list after that comes from the index
+//  alone; load_mission_by_name() walks them again for a name the index does not have.
+//
+
+#define MISSION_INDEX_FILE		"missions.idx"
+#define MISSION_INDEX_VERSION	1
+#define MISSION_INDEX_HASH_SIZE	4096
+
+typedef struct mission_index_entry {
+	char    *path;              // relative to MISSION_DIR, with extension
+	PHYSFS_sint64 size, mtime;
+	char    mission_name[MISSION_NAME_LEN+1];
+	ubyte   anarchy_only_flag;
+	ubyte   valid;              // read_mission_header() found a name
+	ubyte   seen;               // found by the current update
+	int     hash_next;
+} mission_index_entry;
+
+static mission_index_entry *Mission_index = NULL;
+static int Mission_index_num = 0, Mission_index_max = 0;
+static int Mission_index_hash[MISSION_INDEX_HASH_SIZE];
+static int Mission_index_loaded = 0;
+static int Mission_index_scanned = 0;	// the directories were walked this run
+
+static int mission_index_hash(const char *path)
+{
+	unsigned int h = 0;
+
+	while (*path)
+		h = h * 31 + (unsigned char)*path++;
+
+	return h & (MISSION_INDEX_HASH_SIZE - 1);
+}
+
+static void mission_index_rehash(void)
+{
+	int i;
+
+	for (i = 0; i < MISSION_INDEX_HASH_SIZE; i++)
+		Mission_index_hash[i] = -1;
+
+	for (i = 0; i < Mission_index_num; i++)
+	{
+		int h = mission_index_hash(Mission_index[i].path);
+
+		Mission_index[i].hash_next = Mission_index_hash[h];
+		Mission_index_hash[h] = i;
+	}
+}
+
+static mission_index_entry *mission_index_find(const char *path)
+{
+	int i;
+
+	for (i = Mission_index_hash[mission_index_hash(path)]; i != -1; i = Mission_index[i].hash_next)
+		if (!strcmp(Mission_index[i].path, path))
+			return &Mission_index[i];
+
+	return NULL;
+}
+
+static mission_index_entry *mission_index_add(char *path, PHYSFS_sint64 size, PHYSFS_sint64 mtime)
+{
+	mission_index_entry *e;
+	int h = mission_index_hash(path);
+
+	if (Mission_index_num >= Mission_index_max)
+	{
+		Mission_index_max = Mission_index_max ? Mission_index_max * 2 : 256;
+		Mission_index = d_realloc(Mission_index, Mission_index_max * sizeof(mission_index_entry));
+	}
+
+	e = &Mission_index[Mission_index_num];
+	memset(e, 0, sizeof(*e));
+	e->path = d_strdup(path);
+	e->size = size;
+	e->mtime = mtime;
+	e->hash_next = Mission_index_hash[h];
+	Mission_index_hash[h] = Mission_index_num++;
+
+	return e;
+}
+
+static char *mission_index_ext(char *path);
+
+// Lines are "size mtime anarchy valid<TAB>path<TAB>name".
+static void mission_index_read(void)
+{
+	PHYSFS_file *fp;
+	char line[PATH_MAX + 128];
+	int version = 0;
+
+	mission_index_rehash();
+
+	fp = PHYSFSX_openReadBuffered(MISSION_INDEX_FILE);
+	if (!fp)
+		return;
+
+	if (PHYSFSX_fgets(line, sizeof(line), fp))
+		sscanf(line, "version %d", &version);
+
+	while (version == MISSION_INDEX_VERSION && PHYSFSX_fgets(line, sizeof(line), fp))
+	{
+		long long size, mtime;
+		int anarchy, valid;
+		char *path, *name;
+		mission_index_entry *e;
+
+		if (sscanf(line, "%lld %lld %d %d", &size, &mtime, &anarchy, &valid) != 4 ||
+			!(path = strchr(line, '\t')) || !(name = strchr(++path, '\t')))
+			continue;
+		*name++ = 0;
+
+		if (mission_index_find(path))
+			continue;
+		e = mission_index_add(path, size, mtime);
+		e->anarchy_only_flag = anarchy;
+		e->valid = valid && mission_index_ext(path);	// the file is user writable
+		snprintf(e->mission_name, sizeof(e->mission_name), "%s", name);
+	}
+
+	PHYSFS_close(fp);
+}
+
+static void mission_index_write(void)
+{
+	PHYSFS_file *fp;
+	char line[PATH_MAX + 128];
+	int i;
+
+	fp = PHYSFSX_openWriteBuffered(MISSION_INDEX_FILE);
+	if (!fp)
+		return;
+
+	PHYSFSX_printf(fp, "version %d\n", MISSION_INDEX_VERSION);
+	for (i = 0; i < Mission_index_num; i++)
+	{
+		mission_index_entry *e = &Mission_index[i];
+
+		snprintf(line, sizeof(line), "%lld %lld %d %d\t%s\t%s\n", (long long)e->size, (long long)e->mtime,
+			e->anarchy_only_flag, e->valid, e->path, e->mission_name);
+		PHYSFSX_puts(fp, line);
+	}
+
+	PHYSFS_close(fp);
+}
+
+// The extension of the file name of path, or NULL if it has none.
+static char *mission_index_ext(char *path)
+{
+	char *p = strrchr(path, '/');
+
+	return strchr(p ? p + 1 : path, '.');
+}
+
+// Walk path (MISSION_DIR + rel_path) like the mission list always did, and add the index
+// entries of new or changed mission files to *changed.
+static void mission_index_scan(char *path, char *rel_path, int **changed, int *num_changed, int *max_changed)
 {
 	char **find, **i, *ext;
 
@@ -526,31 +701,43 @@ void add_missions_to_list(mle *mission_list, char *path, char *rel_path, int ana
 
 	for (i = find; *i != NULL; i++)
 	{
+		PHYSFS_Stat stat;
+
 		if (strlen(path) + strlen(*i) + 1 >= PATH_MAX)
 			continue;	// path is too long
 
 		strcat(rel_path, *i);
-		if (PHYSFS_isDirectory(path))
+		if (!PHYSFS_stat(path, &stat))
+		{
+			(strrchr(path, '/'))[1] = 0;
+			continue;
+		}
+
+		if (stat.filetype == PHYSFS_FILETYPE_DIRECTORY)
 		{
 			strcat(rel_path, "/");
-			add_missions_to_list(mission_list, path, rel_path, anarchy_mode);
+			mission_index_scan(path, rel_path, changed, num_changed, max_changed);
 			*(strrchr(path, '/')) = 0;
 		}
 		else if ((ext = strrchr(*i, '.')) && (!d_strnicmp(ext, ".msn", 4) || !d_strnicmp(ext, ".mn2", 4)))
-			if (read_mission_file(&mission_list[num_missions], rel_path, ML_MISSIONDIR))
+		{
+			mission_index_entry *e = mission_index_find(rel_path);
+
+			if (!e || e->size != stat.filesize || e->mtime != stat.modtime)
 			{
-				if (anarchy_mode || !mission_list[num_missions].anarchy_only_flag)
+				if (!e)
+					e = mission_index_add(rel_path, stat.filesize, stat.modtime);
+				e->size = stat.filesize;
+				e->mtime = stat.modtime;
+
+				if (*num_changed >= *max_changed)
 				{
-					mission_list[num_missions].builtin_hogsize = 0;
-					num_missions++;
+					*max_changed = *max_changed ? *max_changed * 2 : 256;
+					*changed = d_realloc(*changed, *max_changed * sizeof(int));
 				}
-				else
-					d_free(mission_list[num_missions].path);
+				(*changed)[(*num_changed)++] = e - Mission_index;
 			}
-		
-		if (num_missions >= MAX_MISSIONS)
-		{
-			break;
+			e->seen = 1;
 		}
 
 		(strrchr(path, '/'))[1] = 0;	// chop off the entry
@@ -559,6 +746,109 @@ void add_missions_to_list(mle *mission_list, char *path, char *rel_path, int ana
 	PHYSFS_freeList(find);
 }
 
+// Read one changed mission file, job indexes the list of changed entries.
+static void mission_index_read_job(void *data, int job, int thread)
+{
+	mission_index_entry *e = &Mission_index[((int *)data)[job]];
+	char filename2[PATH_MAX + sizeof(MISSION_DIR)];
+
+	snprintf(filename2, sizeof(filename2), MISSION_DIR "%s", e->path);
+	e->valid = read_mission_header(filename2, e->mission_name, &e->anarchy_only_flag);
+}
+
+//brings the index up to date with what is in MISSION_DIR, and saves it if anything changed.
+void mission_index_update(void)
+{
+	char search_str[PATH_MAX] = MISSION_DIR;
+	int *changed = NULL, num_changed = 0, max_changed = 0;
+	int i, num_left;
+
+	if (!Mission_index_loaded)
+	{
+		mission_index_read();
+		Mission_index_loaded = 1;
+	}
+	Mission_index_scanned = 1;
+
+	for (i = 0; i < Mission_index_num; i++)
+		Mission_index[i].seen = 0;
+
+	mission_index_scan(search_str, search_str + strlen(search_str), &changed, &num_changed, &max_changed);
+
+	worker_run(mission_index_read_job, changed, num_changed);
+
+	// drop the files that are gone
+	for (i = num_left = 0; i < Mission_index_num; i++)
+	{
+		if (Mission_index[i].seen)
+			Mission_index[num_left++] = Mission_index[i];
+		else
+			d_free(Mission_index[i].path);
+	}
+
+	if (num_changed || num_left != Mission_index_num)
+	{
+		con_printf(CON_VERBOSE, "Mission index: %d files, %d read, %d gone\n", num_left, num_changed, Mission_index_num - num_left);
+		Mission_index_num = num_left;
+		mission_index_rehash();
+		mission_index_write();
+	}
+
+	if (changed)
+		d_free(changed);
+}
+
+//brings the index up to date the first time it is used in a run, or after mission_dir_changed().
+static void mission_index_refresh(void)
+{
+	if (!Mission_index_scanned)
+		mission_index_update();
+}
+
+//a mission was added to MISSION_DIR while the game runs, so walk it again for the next list.
+void mission_dir_changed(void)
+{
+	Mission_index_scanned = 0;
+}
+
+//fills in *mission from an index entry.  returns 0 if the entry is not a mission, or if
+//it is anarchy only and anarchy_mode is not set.
+static int mission_index_to_mle(mission_index_entry *e, mle *mission, int anarchy_mode)
+{
+	char *p, *ext;
+
+	if (!e->valid || (!anarchy_mode && e->anarchy_only_flag) || !mission_index_ext(e->path))
+		return 0;
+
+	mission->path = d_strdup(e->path);
+	p = strrchr(mission->path, '/');	// get the filename at the end of the path
+	p = p ? p + 1 : mission->path;
+	ext = strchr(p, '.');
+	// look if it's .mn2 or .msn
+	mission->descent_version = (ext[3] == '2') ? 2 : 1;
+	*ext = 0;			//kill extension
+
+	mission->filename = p;
+	mission->builtin_hogsize = 0;
+	mission->anarchy_only_flag = e->anarchy_only_flag;
+	mission->location = ML_MISSIONDIR;
+	strcpy(mission->mission_name, e->mission_name);
+
+	return 1;
+}
+
+//returns true if the file of the index entry is mission_name.<ext>
+static int mission_index_match(mission_index_entry *e, char *mission_name)
+{
+	char *p = strrchr(e->path, '/');
+	char *ext;
+
+	p = p ? p + 1 : e->path;
+	ext = strchr(p, '.');
+
+	return e->valid && ext && strlen(mission_name) == (size_t)(ext - p) && !d_strnicmp(mission_name, p, ext - p);
+}
+
 /* move <mission_name> to <place> on mission list, increment <place> */
 void promote (mle *mission_list, char * mission_name, int * top_place)
 {
@@ -617,9 +907,8 @@ void free_mission(void)
 mle *build_mission_list(int anarchy_mode)
 {
 	mle *mission_list;
-	int top_place;
+	int i, top_place;
     char	builtin_mission_filename[FILENAME_LEN];
-	char	search_str[PATH_MAX] = MISSION_DIR;
 
 	//now search for levels on disk
 
@@ -640,7 +929,11 @@ mle *build_mission_list(int anarchy_mode)
 	
 	add_builtin_mission_to_list(mission_list + num_missions, builtin_mission_filename);  //read built-in first
 	add_d1_builtin_mission_to_list(mission_list + num_missions);
-	add_missions_to_list(mission_list, search_str, search_str + strlen(search_str), anarchy_mode);
+
+	mission_index_refresh();
+	for (i = 0; i < Mission_index_num && num_missions < MAX_MISSIONS; i++)
+		if (mission_index_to_mle(&Mission_index[i], &mission_list[num_missions], anarchy_mode))
+			num_missions++;
 	
 	// move original missions (in story-chronological order)
 	// to top of mission list
@@ -649,13 +942,6 @@ mle *build_mission_list(int anarchy_mode)
 	promote(mission_list, builtin_mission_filename, &top_place); // d2 or d2demo
 	promote(mission_list, "d2x", &top_place); // vertigo
 
-	if (num_missions > top_place)
-		qsort(&mission_list[top_place],
-		      num_missions - top_place,
-		      sizeof(*mission_list),
- 				(int (*)( const void *, const void * ))ml_sort_func);
-
-
 	if (num_missions > top_place)
 		qsort(&mission_list[top_place],
 		      num_missions - top_place,
@@ -1013,10 +1299,37 @@ int load_mission(mle *mission)
 //Returns true if mission loaded ok, else false.
 int load_mission_by_name(char *mission_name)
 {
-	int i;
-	mle *mission_list = build_mission_list(1);
+	int i, pass;
+	mle *mission_list;
 	bool found = 0;
 
+	// add-on missions straight from the index, without building the whole list. The names of
+	// the built-in missions take the list below, which has them first.
+	if (d_stricmp(mission_name, D1_MISSION_FILENAME) && d_stricmp(mission_name, SHAREWARE_MISSION_FILENAME) &&
+		d_stricmp(mission_name, OEM_MISSION_FILENAME) && d_stricmp(mission_name, FULL_MISSION_FILENAME))
+	{
+		mission_index_refresh();
+		for (pass = 0; pass < 2; pass++)
+		{
+			for (i = 0; i < Mission_index_num; i++)
+				if (mission_index_match(&Mission_index[i], mission_name))
+				{
+					mle mission;
+
+					mission_index_to_mle(&Mission_index[i], &mission, 1);
+					found = load_mission(&mission);
+					d_free(mission.path);
+					if (found)
+						return found;
+				}
+
+			if (pass == 0)
+				mission_index_update();	// it may have been added since the directories were walked
+		}
+	}
+
+	mission_list = build_mission_list(1);
+
 	for (i = 0; i < num_missions; i++)
 		if (!d_stricmp(mission_name, mission_list[i].filename))
 			found = load_mission(mission_list + i);
@@ -135,6 +135,10 @@ int select_mission (int anarchy_mode, char *message, int (*when_selected)(void))
 
 void free_mission(void);
 
+//Call when a mission file is added while the game runs, so the next
+//mission list picks it up.
+void mission_dir_changed(void);
+
 #ifdef EDITOR
 void create_new_mission(void);
 #endif
@@ -980,6 +980,24 @@ int multi_objnum_is_past(int objnum)
 	}
 }
 
+// Keep the objects as the level loaded them, to send joining players what changed since
+void multi_save_object_base(void)
+{
+	if (!(Game_mode & GM_NETWORK))
+		return;
+
+	switch (multi_protocol)
+	{
+#ifdef USE_UDP
+		case MULTI_PROTO_UDP:
+			net_udp_save_object_base();
+			break;
+#endif
+		default:
+			break;
+	}
+}
+
 //
 // Part 1 : functions whose main purpose in life is to divert the flow
 //          of execution to either network  specific code based
@@ -7316,6 +7334,8 @@ multi_process_data(const ubyte *buf, int len)
 			if (!Endlevel_sequence) multi_do_claim_robot(buf); break;
 		case MULTI_ROBOT_POSITION:
 			if (!Endlevel_sequence) multi_do_robot_position(buf); break;
+		case MULTI_ROBOT_POSITIONS:
+			if (!Endlevel_sequence) multi_do_robot_positions(buf); break;
 		case MULTI_ROBOT_EXPLODE:
 			if (!Endlevel_sequence) multi_do_robot_explode(buf); break;
 		case MULTI_ROBOT_RELEASE:
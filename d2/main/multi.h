@@ -60,7 +60,7 @@ extern int multi_protocol; // set and determinate used protocol
 #define MULTI_PROTO_UDP 1 // UDP protocol
 
 // What version of the multiplayer protocol is this? Increment each time something drastic changes in Multiplayer without the version number changes. Can be reset to 0 each time the version of the game changes
-#define MULTI_PROTO_VERSION 30010 // Redux 1.1 + SNG CTF variant + SNG toggles + D2 weapon spawn toggles + Static Powerups (incl. D2 supers)
+#define MULTI_PROTO_VERSION 30012 // Redux 1.1 + SNG CTF variant + SNG toggles + D2 weapon spawn toggles + Static Powerups (incl. D2 supers) + batched robot positions + deflated join sync
 
 // PROTOCOL VARIABLES AND DEFINES - END
 
@@ -69,6 +69,8 @@ extern int multi_protocol; // set and determinate used protocol
 
 #define define_multiplayer_command(NAME,SIZE)	NAME,
 
+#define MULTI_ROBOT_POSITIONS_MAX 5 // robot positions in one MULTI_ROBOT_POSITIONS, at least MAX_ROBOTS_CONTROLLED
+
 #define for_each_multiplayer_command(BEFORE,VALUE,AFTER)	\
 	BEFORE	\
 	VALUE(MULTI_POSITION              , 25)	\
@@ -150,6 +152,7 @@ extern int multi_protocol; // set and determinate used protocol
 	VALUE(MULTI_RACE_UPDATE          , 5)  \
 	VALUE(MULTI_RACE_STATE           , 2 + 3*MAX_PLAYERS)  \
 	VALUE(MULTI_RACE_BOX             , 3)  \
+	VALUE(MULTI_ROBOT_POSITIONS      , 3+MULTI_ROBOT_POSITIONS_MAX*(3+sizeof(shortpos)))	/* (ubyte pnum, ubyte count, count*(short objnum, sbyte owner, shortpos)) */  \
 	AFTER
 for_each_multiplayer_command(enum {, define_multiplayer_command, });
 
@@ -265,6 +268,7 @@ void map_objnum_local_to_remote(int local, int remote, int owner);
 void map_objnum_local_to_local(int objnum);
 void reset_network_objects();
 int multi_objnum_is_past(int objnum);
+void multi_save_object_base(void);
 void multi_do_ping_frame();
 
 void multi_init_objects(void);
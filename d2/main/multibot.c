@@ -45,13 +45,20 @@ COPYRIGHT 1993-1999 PARALLAX SOFTWARE CORPORATION.  ALL RIGHTS RESERVED.
 #include "physics.h" 
 #include "byteswap.h"
 #include "wall.h"
+#include "fvi.h"
+#ifdef USE_UDP
+#include "net_udp.h"
+#endif
+
+#if MULTI_ROBOT_POSITIONS_MAX < MAX_ROBOTS_CONTROLLED
+#error MULTI_ROBOT_POSITIONS cannot hold the position of every controlled robot
+#endif
 
 
 
 int multi_add_controlled_robot(int objnum, int agitation);
 void multi_send_release_robot(int objnum);
 void multi_delete_controlled_robot(int objnum);
-void multi_send_robot_position_sub(int objnum, int now);
 
 //
 // Code for controlling robots in multiplayer games
@@ -73,6 +80,11 @@ fix64 robot_last_message_time[MAX_ROBOTS_CONTROLLED];
 int robot_send_pending[MAX_ROBOTS_CONTROLLED];
 int robot_fired[MAX_ROBOTS_CONTROLLED];
 ubyte robot_fire_buf[MAX_ROBOTS_CONTROLLED][18+3];
+fix64 robot_position_sent_time[MAX_ROBOTS_CONTROLLED];
+
+// Robot positions sent per robot frame, see multi_adapt_robot_budget()
+static int robot_send_budget = MAX_ROBOTS_CONTROLLED;
+static int robot_peer_resends[MAX_PLAYERS];
 
 #define MULTI_ROBOT_PRIORITY(objnum, pnum) ((objnum + pnum) % (N_players - (Netgame.host_is_obs ? 1 : 0)))
 
@@ -274,7 +286,7 @@ multi_add_controlled_robot(int objnum, int agitation)
 	Objects[objnum].ctype.ai_info.REMOTE_OWNER = Player_num;
 	Objects[objnum].ctype.ai_info.REMOTE_SLOT_NUM = i;
 	robot_controlled_time[i] = GameTime64;
-	robot_last_send_time[i] = robot_last_message_time[i] = GameTime64;
+	robot_last_send_time[i] = robot_last_message_time[i] = robot_position_sent_time[i] = GameTime64;
 	return(1);
 }	
 
@@ -365,56 +377,90 @@ multi_send_release_robot(int objnum)
 
 #define MIN_ROBOT_COM_GAP F1_0/12
 
-int
-multi_send_robot_frame(int sent)
+#define ROBOT_POSITION_SIZE		(3+sizeof(shortpos))	// one robot in MULTI_ROBOT_POSITIONS
+#define ROBOT_POSITIONS_LEN		(3+MULTI_ROBOT_POSITIONS_MAX*ROBOT_POSITION_SIZE)
+#define ROBOT_VISIBLE_DIST		(F1_0*200)				// farther robots are not tested for sight
+
+// Halve the robot positions sent per frame if a packet to any other player had to be resent since
+// the last robot frame, else send one more.  The positions go to all players in the same packets,
+// so the slowest connection sets the pace.
+static void multi_adapt_robot_budget(void)
 {
-	static int last_sent = 0;
+	int i, lost = 0;
+
+#ifdef USE_UDP
+	if (multi_protocol == MULTI_PROTO_UDP)
+	{
+		for (i = 0; i < N_players; i++)
+		{
+			int resends;
+
+			if (i == Player_num)
+				continue;
 
+			resends = net_udp_get_resends(i);
+			if (resends != robot_peer_resends[i] && Players[i].connected == CONNECT_PLAYING)
+				lost = 1;
+			robot_peer_resends[i] = resends;
+		}
+	}
+#endif
+
+	if (lost)
+		robot_send_budget = robot_send_budget > 1 ? robot_send_budget/2 : 1;
+	else if (robot_send_budget < MAX_ROBOTS_CONTROLLED)
+		robot_send_budget++;
+}
+
+// How much the other players need the position of the robot in slot now.  A robot close to a
+// player or in its sight comes first, and a robot waiting to be sent gains priority over time
+// so none of them starve.
+static fix multi_robot_priority(int slot)
+{
+	object *robot = &Objects[robot_controlled[slot]];
+	fix priority = 0;
+	fix64 wait;
 	int i;
-	int rval = 0;
 
-	for (i = 0; i < MAX_ROBOTS_CONTROLLED; i++)
+	for (i = 0; i < N_players; i++)
 	{
-		int sending = (last_sent+1+i)%MAX_ROBOTS_CONTROLLED;
-		if ( (robot_controlled[sending] != -1) && ((robot_send_pending[sending] > sent) || (robot_fired[sending] > sent)) )
-		{
-			if (robot_send_pending[sending])
-			{
-				multi_send_robot_position_sub(robot_controlled[sending], (robot_send_pending[sending]>1)?1:0);
-				robot_send_pending[sending] = 0;
-			}
+		object *plobj;
+		fix dist, p;
 
-			if (robot_fired[sending])
-			{
-				robot_fired[sending] = 0;
-				multi_send_data(robot_fire_buf[sending], 18, 1);
-			}
+		if (i == Player_num || Players[i].connected != CONNECT_PLAYING)
+			continue;
 
-			if (!(Game_mode & GM_NETWORK))
-				sent += 1;
+		plobj = &Objects[Players[i].objnum];
+		if (object_is_observer(plobj))
+			continue;
 
-			last_sent = sending;
-			rval++;
-		}
+		dist = vm_vec_dist_quick(&robot->pos, &plobj->pos);
+		p = fixdiv(F1_0*80, dist + F1_0*20);	// 4 next to the player, 1 at 60 units
+
+		if (dist < ROBOT_VISIBLE_DIST && object_to_object_visibility(robot, plobj, FQ_TRANSWALL))
+			p *= 4;
+
+		if (p > priority)
+			priority = p;
 	}
-	Assert((last_sent >= 0) && (last_sent <= MAX_ROBOTS_CONTROLLED));
-	return(rval);
+
+	wait = GameTime64 - robot_position_sent_time[slot];
+	if (wait > F1_0*10)
+		wait = F1_0*10;
+
+	return priority + (fix)wait*4;
 }
 
-void
-multi_send_robot_position_sub(int objnum, int now)
+static int
+multi_add_robot_position(int loc, int objnum)
 {
-	int loc = 0;
 	short s;
 #ifdef WORDS_BIGENDIAN
 	shortpos sp;
 #endif
 
-	multibuf[loc] = MULTI_ROBOT_POSITION;  								loc += 1;
-	multibuf[loc] = Player_num;											loc += 1;
 	s = objnum_local_to_remote(objnum, (sbyte *)&multibuf[loc+2]);
 	PUT_INTEL_SHORT(multibuf+loc, s);
-
 																		loc += 3;
 #ifndef WORDS_BIGENDIAN
 	create_shortpos((shortpos *)(multibuf+loc), Objects+objnum,0);		loc += sizeof(shortpos);
@@ -425,7 +471,88 @@ multi_send_robot_position_sub(int objnum, int now)
 	memcpy(&(multibuf[loc]), (ubyte *)&(sp.xo), 14);
 	loc += 14;
 #endif
-	multi_send_data(multibuf, loc, now?1:0);
+	return loc;
+}
+
+// Send the pending positions of my robots, the most needed ones first.  Forced positions and
+// those of robots that fired are always sent, the others only up to robot_send_budget.
+// Positions left out stay pending for the next robot frame.  A MULTI_ROBOT_POSITIONS has a fixed
+// size, so it is only used when it is full; fewer positions are cheaper as MULTI_ROBOT_POSITION
+// each, which is what makes a smaller budget send less.
+int
+multi_send_robot_frame(int sent)
+{
+	int order[MAX_ROBOTS_CONTROLLED];
+	fix priority[MAX_ROBOTS_CONTROLLED];
+	int i, j, n = 0, count = 0, now = 0;
+	int loc = 3;
+
+	multi_adapt_robot_budget();
+
+	for (i = 0; i < MAX_ROBOTS_CONTROLLED; i++)
+	{
+		fix p;
+
+		if ((robot_controlled[i] == -1) || ((robot_send_pending[i] <= sent) && (robot_fired[i] <= sent)))
+			continue;
+
+		p = robot_fired[i] ? 0x7fffffff : multi_robot_priority(i);
+		for (j = n; j > 0 && priority[j-1] < p; j--)
+		{
+			order[j] = order[j-1];
+			priority[j] = priority[j-1];
+		}
+		order[j] = i;
+		priority[j] = p;
+		n++;
+	}
+
+	for (j = 0; j < n; j++)
+	{
+		i = order[j];
+		if (robot_send_pending[i] && (robot_send_pending[i] > 1 || robot_fired[i] || count < robot_send_budget))
+		{
+			loc = multi_add_robot_position(loc, robot_controlled[i]);
+			if (robot_send_pending[i] > 1)
+				now = 1;
+			robot_send_pending[i] = 0;
+			robot_position_sent_time[i] = GameTime64;
+			count++;
+		}
+	}
+
+	if (count == MULTI_ROBOT_POSITIONS_MAX)
+	{
+		multibuf[0] = MULTI_ROBOT_POSITIONS;
+		multibuf[1] = Player_num;
+		multibuf[2] = count;
+		multi_send_data(multibuf, ROBOT_POSITIONS_LEN, now);
+	}
+	else
+	{
+		ubyte buf[2+ROBOT_POSITION_SIZE];
+
+		for (j = 0; j < count; j++)
+		{
+			buf[0] = MULTI_ROBOT_POSITION;
+			buf[1] = Player_num;
+			memcpy(buf+2, multibuf+3+j*ROBOT_POSITION_SIZE, ROBOT_POSITION_SIZE);
+			multi_send_data(buf, sizeof(buf), now);
+		}
+	}
+
+	// the fire events after the positions they were fired from
+	for (j = 0; j < n; j++)
+	{
+		i = order[j];
+		if (robot_fired[i])
+		{
+			robot_fired[i] = 0;
+			multi_send_data(robot_fire_buf[i], 18, 1);
+		}
+	}
+
+	return(n);
 }
 
 void
@@ -693,20 +820,16 @@ multi_do_release_robot(const ubyte *buf)
 	Objects[botnum].ctype.ai_info.REMOTE_SLOT_NUM = 0;
 }
 
-void
-multi_do_robot_position(const ubyte *buf)
+// Process the movement of one robot sent by player pnum, buf is at its object number
+static void
+multi_do_robot_position_sub(char pnum, const ubyte *buf)
 {
-	// Process robot movement sent by another player
-
 	short botnum, remote_botnum;
-	char pnum;
-	int loc = 1;
+	int loc = 0;
 #ifdef WORDS_BIGENDIAN
 	shortpos sp;
 #endif
 
-	pnum = buf[loc];										loc += 1;
-
 	remote_botnum = GET_INTEL_SHORT(buf + loc);
 	botnum = objnum_remote_to_local(remote_botnum, (sbyte)buf[loc+2]); loc += 3;
 
@@ -748,6 +871,28 @@ multi_do_robot_position(const ubyte *buf)
 #endif
 }
 
+void
+multi_do_robot_position(const ubyte *buf)
+{
+	// Process robot movement sent by another player
+
+	multi_do_robot_position_sub(buf[1], buf+2);
+}
+
+void
+multi_do_robot_positions(const ubyte *buf)
+{
+	// Process the movement of several robots sent by another player
+
+	int i, count = buf[2];
+
+	if (count > MULTI_ROBOT_POSITIONS_MAX)
+		count = MULTI_ROBOT_POSITIONS_MAX;
+
+	for (i = 0; i < count; i++)
+		multi_do_robot_position_sub(buf[1], buf+3+i*ROBOT_POSITION_SIZE);
+}
+
 void
 multi_do_robot_fire(const ubyte *buf)
 {
@@ -14,6 +14,7 @@
 #include <string.h>
 #include <stdlib.h>
 #include <time.h>
+#include <zlib.h>
 #ifdef __unix__
 #include <sys/time.h>
 #endif
@@ -60,6 +61,8 @@
 #include "rbaudio.h"
 #include "config.h"
 #include "vers_id.h"
+#include "profile.h"
+#include "worker.h"
 
 #ifdef _WIN32
 #include <Windows.h>
@@ -117,7 +120,8 @@ void net_udp_send_game_info(struct _sockaddr sender_addr, ubyte info_upid, ubyte
 void net_udp_send_netgame_update();
 void net_udp_do_refuse_stuff (UDP_sequence_packet *their);
 void net_udp_read_sync_packet( ubyte * data, int data_len, struct _sockaddr sender_addr );
-void net_udp_read_object_packet( ubyte *data );
+void net_udp_read_object_packet( ubyte *data, int data_len, struct _sockaddr sender_addr );
+void net_udp_process_object_ack(ubyte *data, int data_len, struct _sockaddr sender_addr);
 void net_udp_ping_frame(fix64 time);
 void net_udp_p2p_ping_frame(fix64 time);
 #ifdef USE_TRACKER
@@ -154,6 +158,7 @@ void net_udp_send_extras ();
 extern void multi_reset_object_texture(object *objp);
 
 static void net_udp_broadcast_game_info(ubyte info_upid);
+static void net_udp_object_changed(int objnum);
 
 void net_udp_process_p2p_ping(ubyte *data, struct _sockaddr sender_addr, int data_len);
 void net_udp_process_p2p_pong(ubyte *data, struct _sockaddr sender_addr, int data_len);
@@ -202,11 +207,13 @@ UDP_sequence_packet UDP_Seq;
 UDP_mdata_store UDP_mdata_queue[UDP_MDATA_STOR_QUEUE_SIZE];
 UDP_mdata_obs_store UDP_mdata_obs_queue[UDP_MDATA_STOR_QUEUE_SIZE];
 UDP_mdata_recv UDP_mdata_got[MAX_PLAYERS];
+static int UDP_mdata_resends[MAX_PLAYERS]; // MDATA packets resent to each player, see net_udp_get_resends()
 UDP_sequence_packet UDP_sync_player; // For rejoin object syncing
 int UDP_sync_obsnum;
 UDP_netgame_info_lite Active_udp_games[UDP_MAX_NETGAMES];
 int num_active_udp_games = 0;
 int num_active_udp_changed = 0;
+static int Udp_game_list_open = 0; // the join list is up, lite info from anyone else is dropped
 static int UDP_Socket[3] = { -1, -1, -1 };
 static char UDP_MyPort[6] = "";
 struct _sockaddr GBcast; // global Broadcast address clients and hosts will use for lite_info exchange over LAN
@@ -283,6 +290,8 @@ char* msg_name(int type)
 			return "UPID_SYNC";
 		case UPID_OBJECT_DATA:
 			return "UPID_OBJECT_DATA";
+		case UPID_OBJECT_ACK:
+			return "UPID_OBJECT_ACK";
 		case UPID_PING:
 			return "UPID_PING";
 		case UPID_PONG:
@@ -436,8 +445,9 @@ void udp_traffic_stat()
 	}
 }
 
-// Resolve address
-int udp_dns_filladdr( char *host, int port, struct _sockaddr *sAddr )
+// Resolve address, without telling the user if it fails. flags are the
+// getaddrinfo() hint flags. Safe to call off the game thread.
+static int udp_dns_resolve( const char *host, int port, struct _sockaddr *sAddr, int flags )
 {
 	// Variables
 	struct addrinfo *result, hints;
@@ -455,14 +465,11 @@ int udp_dns_filladdr( char *host, int port, struct _sockaddr *sAddr )
 	// We are always UDP
 	hints.ai_socktype = SOCK_DGRAM;
 	hints.ai_family = _af;
+	hints.ai_flags = flags;
 	
 	// Resolve the domain name
 	if( getaddrinfo( host, sPort, &hints, &result ) != 0 )
-	{
-		con_printf( CON_URGENT, "udp_dns_filladdr (getaddrinfo) failed\n" );
-		nm_messagebox( TXT_ERROR, 1, TXT_OK, "Could not resolve address" );
 		return -1;
-	}
 	
 	// Zero out the target first
 	memset( sAddr, 0, sizeof( struct _sockaddr ) );
@@ -487,6 +494,18 @@ int udp_dns_filladdr( char *host, int port, struct _sockaddr *sAddr )
 	return 0;
 }
 
+// Resolve address
+int udp_dns_filladdr( char *host, int port, struct _sockaddr *sAddr )
+{
+	if( udp_dns_resolve( host, port, sAddr, 0 ) < 0 )
+	{
+		con_printf( CON_URGENT, "udp_dns_filladdr (getaddrinfo) failed\n" );
+		nm_messagebox( TXT_ERROR, 1, TXT_OK, "Could not resolve address" );
+		return -1;
+	}
+	return 0;
+}
+
 // Closes an existing udp socket
 void udp_close_socket(int socknum)
 {
@@ -824,16 +843,112 @@ int udp_tracker_reqgames()
 	return TrackerCount;
 }
 
+/* Tracker entries that name their host rather than give its address wait
+ * here for a background task to look them up, since getaddrinfo() can block
+ * for seconds and a full tracker list would otherwise freeze the browser once
+ * per entry. The task only ever touches the first Udp_resolve_batch entries,
+ * and the game thread only appends after them, so the queue needs no lock.
+ * All the results are handled on the game thread, which is also the only one
+ * allowed to put up a message box or allocate.
+ */
+#define UDP_RESOLVE_QUEUE	UDP_MAX_NETGAMES
+
+typedef struct udp_resolve_entry
+{
+	char			host[64];
+	int			port;
+	ubyte			info[UPID_GAME_INFO_LITE_SIZE];	// the lite info, UPID byte first
+	int			info_len;
+	struct _sockaddr	addr;		// set by the task
+	int			result;		// set by the task
+} udp_resolve_entry;
+
+static udp_resolve_entry Udp_resolve_queue[UDP_RESOLVE_QUEUE];
+static int Udp_resolve_num = 0;		// entries queued, including the running batch
+static int Udp_resolve_batch = 0;	// entries the running task resolves
+static int Udp_resolve_discard = 0;	// the game list was reset while the task ran
+static worker_task *Udp_resolve_task = NULL;
+
+static int udp_tracker_resolve_task(void *data)
+{
+	int i, n = (int)(size_t)data;
+
+	for (i = 0; i < n; i++)
+	{
+		udp_resolve_entry *e = &Udp_resolve_queue[i];
+
+		e->result = udp_dns_resolve(e->host, e->port, &e->addr, 0);
+	}
+	return n;
+}
+
+// Collect a finished batch and start the next. With wait set, block until
+// the running batch is done.
+static void udp_tracker_resolve_frame(int wait)
+{
+	if (Udp_resolve_task)
+	{
+		int i, n;
+
+		if (!wait && !worker_task_done(Udp_resolve_task))
+			return;
+
+		n = worker_task_finish(Udp_resolve_task);
+		Udp_resolve_task = NULL;
+
+		for (i = 0; i < n && !Udp_resolve_discard; i++)
+		{
+			udp_resolve_entry *e = &Udp_resolve_queue[i];
+
+			if (e->result < 0)
+				con_printf(CON_VERBOSE, "Tracker: could not resolve %s\n", e->host);
+			else
+				net_udp_process_game_info(e->info, e->info_len, e->addr, 1, 0);
+		}
+
+		Udp_resolve_num -= n;
+		memmove(&Udp_resolve_queue[0], &Udp_resolve_queue[n], sizeof(udp_resolve_entry)*Udp_resolve_num);
+		Udp_resolve_batch = 0;
+		Udp_resolve_discard = 0;
+	}
+
+	if (Udp_resolve_num)
+	{
+		Udp_resolve_batch = Udp_resolve_num;
+		Udp_resolve_task = worker_task_start(udp_tracker_resolve_task, (void *)(size_t)Udp_resolve_batch);
+	}
+}
+
+// Drop everything queued. The running batch cannot be stopped, so its
+// results are thrown away when it is collected, or right here with wait set.
+static void udp_tracker_reset_resolve(int wait)
+{
+	if (Udp_resolve_task)
+	{
+		Udp_resolve_num = Udp_resolve_batch;
+		Udp_resolve_discard = 1;
+		if (!wait)
+			return;
+		udp_tracker_resolve_frame(1);
+	}
+	Udp_resolve_num = 0;
+}
+
 /* The tracker has sent us a game.  Let's list it. */
 int udp_tracker_process_game( ubyte *data, int data_len )
 {
 	// All our variables
 	struct _sockaddr sAddr;
+	udp_resolve_entry *e;
 	int iPos = 1;
 	int iPort = 0;
 	int bIPv6 = 0;
 	char *sIP = NULL;
 	
+	// Nobody is looking at the list
+	if( !Udp_game_list_open )
+		return -1;
+	
 	// Zero it out
 	memset( &sAddr, 0, sizeof( sAddr ) );
 	
@@ -849,12 +964,24 @@ int udp_tracker_process_game( ubyte *data, int data_len )
 	iPort = GET_INTEL_SHORT( &data[iPos] );
 	iPos += 2;
 	
-	// Get the DNS stuff
-	if( udp_dns_filladdr( sIP, iPort, &sAddr ) < 0 )
+	// The tracker normally sends a numeric address, which needs no lookup
+	if( udp_dns_resolve( sIP, iPort, &sAddr, AI_NUMERICHOST ) == 0 )
+	{
+		// Now move on to BIGGER AND BETTER THINGS!
+		net_udp_process_game_info( &data[iPos - 1], data_len - iPos, sAddr, 1, 0);
+		return 0;
+	}
+	
+	// A host name goes to the resolver task
+	if( Udp_resolve_num >= UDP_RESOLVE_QUEUE || strlen( sIP ) >= sizeof( e->host ) || data_len < iPos )
 		return -1;
 	
-	// Now move on to BIGGER AND BETTER THINGS!
-	net_udp_process_game_info( &data[iPos - 1], data_len - iPos, sAddr, 1, 0);
+	e = &Udp_resolve_queue[Udp_resolve_num++];
+	strcpy( e->host, sIP );
+	e->port = iPort;
+	memset( e->info, 0, sizeof( e->info ) );
+	memcpy( e->info, &data[iPos - 1], min( data_len - iPos + 1, (int)sizeof( e->info ) ) );
+	e->info_len = data_len - iPos;
 	return 0;
 }
 
@@ -1459,6 +1586,7 @@ int valid_sender(ubyte *data, int data_len, struct _sockaddr sender_addr) {
 		case UPID_GAME_INFO_LITE_REQ: 
 		case UPID_REQUEST: 
 		case UPID_QUIT_JOINING: 
+		case UPID_OBJECT_ACK: 
 		case UPID_PONG: 
 		case UPID_ENDLEVEL_C: 
 			if(! multi_i_am_master()) {
@@ -1510,7 +1638,8 @@ int valid_size(ubyte *data, int data_len, struct _sockaddr sender_addr) {
 		case UPID_DUMP:   			 	if(data_len != UPID_DUMP_SIZE              )  { rv = 0; }  break;
 		case UPID_QUIT_JOINING: 
 		case UPID_REQUEST:   		 	if(data_len != UPID_SEQUENCE_SIZE          )  { rv = 0; }  break;
-		case UPID_OBJECT_DATA:   	 	if(data_len > UPID_MAX_SIZE         	   )  { rv = 0; }  break;
+		case UPID_OBJECT_DATA:   	 	if(data_len > UPID_MAX_SIZE || data_len < UPID_OBJECT_DATA_HEADER_SIZE)  { rv = 0; }  break;
+		case UPID_OBJECT_ACK:   	 	if(data_len != UPID_OBJECT_ACK_SIZE        )  { rv = 0; }  break;
 		case UPID_PING:   	 			if(data_len != UPID_PING_SIZE         	   )  { rv = 0; }  break;
 		case UPID_PONG:   	 			if(data_len != UPID_PONG_SIZE        	   )  { rv = 0; }  break;
 		case UPID_P2P_PING: 			if(data_len != UPID_P2P_PING_SIZE          )  { rv = 0; }  break;
@@ -1844,12 +1973,471 @@ void net_udp_manual_join_game()
 	newmenu_do1( NULL, "ENTER GAME ADDRESS", nitems, m, (int (*)(newmenu *, d_event *, void *))manual_join_game_handler, dj, 0 );
 }
 
+/* The game list.
+ *
+ * Active_udp_games is a pool of slots in no particular order: a game that
+ * goes away is replaced by the last slot rather than shifting the rest down.
+ * Games are found by address and GameID through Udp_game_hash, and listed in
+ * the order of Udp_game_order, which every update keeps sorted by moving just
+ * the game that changed. The list only redraws the rows between
+ * Udp_list_dirty_first and Udp_list_dirty_last that are on the shown page.
+ */
+#define UDP_GAME_HASH_SIZE	1024		// power of two, more than UDP_MAX_NETGAMES
+#define UDP_GAME_NONE		-1
+#define UDP_PING_UNKNOWN	0x7fffffff	// sorts after every real ping
+#define UDP_PING_GROUP		50		// ms, games closer than this are ordered by fill
+
+// Every listed game is sent a UPID_GAME_INFO_LITE_REQ of its own now and then,
+// which times the round trip and keeps the entry fresh. The probes are paced
+// by a token bucket so a list of hundreds of games does not go out at once.
+#define UDP_PROBE_RATE		20		// probes per second
+#define UDP_PROBE_BURST		8
+#define UDP_PROBE_INTERVAL	(F1_0*15)	// between probes of one game
+#define UDP_PROBE_TIMEOUT	(F1_0*3)
+
+typedef struct udp_game_state
+{
+	short	hash_next;	// next slot in the same bucket
+	short	order;		// position in Udp_game_order
+	int	ping;		// ms, or UDP_PING_UNKNOWN
+	fix64	probe_time;	// when the last probe went out, 0 if never
+	ubyte	probe_pending;
+} udp_game_state;
+
+static short Udp_game_hash[UDP_GAME_HASH_SIZE];
+static udp_game_state Udp_game_state[UDP_MAX_NETGAMES];
+static short Udp_game_order[UDP_MAX_NETGAMES];
+static int Udp_list_dirty_first = UDP_MAX_NETGAMES, Udp_list_dirty_last = -1;
+static fix64 Udp_probe_tokens = UDP_PROBE_BURST*F1_0, Udp_probe_last_fill = 0;
+static int Udp_probe_next = 0;
+
+static unsigned net_udp_game_hash(struct _sockaddr *addr, fix GameID)
+{
+	const ubyte *p = (const ubyte *)&addr->sin_addr;
+	unsigned h = 2166136261u;
+	int i;
+
+	// the same fields is_same_addr() compares
+	for (i = 0; i < sizeof(addr->sin_addr); i++)
+		h = (h ^ p[i]) * 16777619u;
+	h = (h ^ addr->sin_port) * 16777619u;
+	h = (h ^ (unsigned)GameID) * 16777619u;
+	return h & (UDP_GAME_HASH_SIZE-1);
+}
+
+static int net_udp_find_game(struct _sockaddr *addr, fix GameID)
+{
+	int i;
+
+	for (i = Udp_game_hash[net_udp_game_hash(addr, GameID)]; i != UDP_GAME_NONE; i = Udp_game_state[i].hash_next)
+		if (Active_udp_games[i].GameID == GameID && is_same_addr(&Active_udp_games[i].game_addr, addr))
+			return i;
+	return UDP_GAME_NONE;
+}
+
+// Point whatever links to slot in its bucket at to instead, which may be
+// Udp_game_state[slot].hash_next to unlink it.
+static void net_udp_relink_game(int slot, int to)
+{
+	short *link = &Udp_game_hash[net_udp_game_hash(&Active_udp_games[slot].game_addr, Active_udp_games[slot].GameID)];
+
+	while (*link != slot)
+	{
+		Assert(*link != UDP_GAME_NONE);
+		link = &Udp_game_state[*link].hash_next;
+	}
+	*link = to;
+}
+
+static void net_udp_mark_list_dirty(int first, int last)
+{
+	if (first < Udp_list_dirty_first)
+		Udp_list_dirty_first = first;
+	if (last > Udp_list_dirty_last)
+		Udp_list_dirty_last = last;
+}
+
+// Negative if game a is listed before game b. Open games come before full
+// ones, then by ping in steps of UDP_PING_GROUP, then the fuller game first.
+static int net_udp_compare_games(int a, int b)
+{
+	UDP_netgame_info_lite *ga = &Active_udp_games[a], *gb = &Active_udp_games[b];
+	int pa = Udp_game_state[a].ping, pb = Udp_game_state[b].ping;
+	int fa = ga->numconnected >= ga->max_numplayers, fb = gb->numconnected >= gb->max_numplayers;
+
+	if (fa != fb)
+		return fa - fb;
+	if (pa != pb && (pa == UDP_PING_UNKNOWN || pb == UDP_PING_UNKNOWN || pa/UDP_PING_GROUP != pb/UDP_PING_GROUP))
+		return pa < pb ? -1 : 1;
+	if (ga->numconnected != gb->numconnected)
+		return gb->numconnected - ga->numconnected;
+	if (pa != pb)
+		return pa < pb ? -1 : 1;
+	// anything that tells two games apart, but not the slot, which changes
+	if (ga->GameID != gb->GameID)
+		return ga->GameID < gb->GameID ? -1 : 1;
+	if (ga->game_addr.sin_port != gb->game_addr.sin_port)
+		return ga->game_addr.sin_port < gb->game_addr.sin_port ? -1 : 1;
+	return memcmp(&ga->game_addr.sin_addr, &gb->game_addr.sin_addr, sizeof(ga->game_addr.sin_addr));
+}
+
+// Udp_game_order[0..n-1] does not hold slot. Put it where it sorts.
+static void net_udp_order_insert(int slot, int n)
+{
+	int lo = 0, hi = n, i;
+
+	while (lo < hi)
+	{
+		int mid = (lo + hi) / 2;
+
+		if (net_udp_compare_games(Udp_game_order[mid], slot) < 0)
+			lo = mid + 1;
+		else
+			hi = mid;
+	}
+
+	for (i = n; i > lo; i--)
+	{
+		Udp_game_order[i] = Udp_game_order[i-1];
+		Udp_game_state[Udp_game_order[i]].order = i;
+	}
+	Udp_game_order[lo] = slot;
+	Udp_game_state[slot].order = lo;
+	net_udp_mark_list_dirty(lo, n);
+}
+
+// Udp_game_order[0..n-1] holds slot. Take it out.
+static void net_udp_order_remove(int slot, int n)
+{
+	int i;
+
+	for (i = Udp_game_state[slot].order; i < n-1; i++)
+	{
+		Udp_game_order[i] = Udp_game_order[i+1];
+		Udp_game_state[Udp_game_order[i]].order = i;
+	}
+	net_udp_mark_list_dirty(Udp_game_state[slot].order, n-1);
+}
+
+// The sort keys of a listed game changed.
+static void net_udp_resort_game(int slot)
+{
+	int pos = Udp_game_state[slot].order;
+
+	if ((pos == 0 || net_udp_compare_games(Udp_game_order[pos-1], slot) < 0) &&
+		(pos == num_active_udp_games-1 || net_udp_compare_games(slot, Udp_game_order[pos+1]) < 0))
+	{
+		net_udp_mark_list_dirty(pos, pos);
+		return;
+	}
+
+	net_udp_order_remove(slot, num_active_udp_games);
+	net_udp_order_insert(slot, num_active_udp_games-1);
+}
+
+static int net_udp_add_game(struct _sockaddr *addr, fix GameID)
+{
+	int slot = num_active_udp_games;
+	unsigned h = net_udp_game_hash(addr, GameID);
+
+	if (slot == UDP_MAX_NETGAMES)
+		return UDP_GAME_NONE;
+
+	memset(&Active_udp_games[slot], 0, sizeof(UDP_netgame_info_lite));
+	memcpy(&Active_udp_games[slot].game_addr, addr, sizeof(struct _sockaddr));
+	Active_udp_games[slot].GameID = GameID;
+	Udp_game_state[slot].hash_next = Udp_game_hash[h];
+	Udp_game_state[slot].ping = UDP_PING_UNKNOWN;
+	Udp_game_state[slot].probe_time = 0;
+	Udp_game_state[slot].probe_pending = 0;
+	Udp_game_hash[h] = slot;
+
+	net_udp_order_insert(slot, num_active_udp_games++);
+	return slot;
+}
+
+static void net_udp_remove_game(int slot)
+{
+	int last = num_active_udp_games-1;
+
+	net_udp_order_remove(slot, num_active_udp_games);
+	net_udp_relink_game(slot, Udp_game_state[slot].hash_next);
+
+	// the last slot fills the hole
+	if (slot != last)
+	{
+		net_udp_relink_game(last, slot);
+		memcpy(&Active_udp_games[slot], &Active_udp_games[last], sizeof(UDP_netgame_info_lite));
+		Udp_game_state[slot] = Udp_game_state[last];
+		Udp_game_order[Udp_game_state[slot].order] = slot;
+	}
+	num_active_udp_games--;
+}
+
+// A game sent us its lite info. Time the probe it answers, if any.
+static void net_udp_game_answered(int slot)
+{
+	udp_game_state *s = &Udp_game_state[slot];
+
+	if (s->probe_pending)
+	{
+		s->ping = (int)(((timer_query() - s->probe_time) * 1000) >> 16);
+		s->probe_pending = 0;
+	}
+}
+
+static void net_udp_reset_game_list(void)
+{
+	memset(Udp_game_hash, 0xff, sizeof(Udp_game_hash)); // UDP_GAME_NONE
+	num_active_udp_games = 0;
+	num_active_udp_changed = 1;
+	Udp_probe_tokens = UDP_PROBE_BURST*F1_0;
+	Udp_probe_last_fill = 0;
+	Udp_probe_next = 0;
+#ifdef USE_TRACKER
+	udp_tracker_reset_resolve(0);
+#endif
+}
+
+// Send the probes that are due and the token bucket allows. Probes that get
+// no answer in time leave the game listed, but without a ping.
+static void net_udp_probe_games(void)
+{
+	fix64 now = timer_query();
+	int n;
+
+	if (Udp_probe_last_fill)
+		Udp_probe_tokens = min(Udp_probe_tokens + (now - Udp_probe_last_fill) * UDP_PROBE_RATE, (fix64)UDP_PROBE_BURST*F1_0);
+	Udp_probe_last_fill = now;
+
+	for (n = 0; n < num_active_udp_games && Udp_probe_tokens >= F1_0; n++)
+	{
+		udp_game_state *s;
+		int slot;
+
+		if (Udp_probe_next >= num_active_udp_games)
+			Udp_probe_next = 0;
+		slot = Udp_probe_next++;
+		s = &Udp_game_state[slot];
+
+		if (s->probe_pending && now - s->probe_time > UDP_PROBE_TIMEOUT)
+		{
+			s->probe_pending = 0;
+			if (s->ping != UDP_PING_UNKNOWN)
+			{
+				s->ping = UDP_PING_UNKNOWN;
+				net_udp_resort_game(slot);
+			}
+		}
+
+		if (s->probe_time && now - s->probe_time < UDP_PROBE_INTERVAL)
+			continue;
+
+		net_udp_request_game_info(Active_udp_games[slot].game_addr, 1);
+		s->probe_time = now;
+		s->probe_pending = 1;
+		Udp_probe_tokens -= F1_0;
+	}
+}
+
+// Put the game shown at position pos of the list into a menu line.
+static void net_udp_draw_game_row(char *text, int pos)
+{
+	UDP_netgame_info_lite *game;
+	int game_status;
+	int j,x, k,tx,ty,ta,nplayers = 0;
+	char levelname[8],MissName[25],GameName[25],thold[2],status[9];
+	unsigned gamemode;
+	thold[1]=0;
+
+	if (pos >= num_active_udp_games)
+	{
+		snprintf(text, sizeof(char)*74, "%d.                                                                      ",pos+1);
+		return;
+	}
+
+	game = &Active_udp_games[Udp_game_order[pos]];
+	game_status = game->game_status;
+
+	// These next two loops protect against menu skewing
+	// if missiontitle or gamename contain a tab
+
+	for (x=0,tx=0,k=0,j=0;j<15;j++)
+	{
+		if (game->mission_title[j]=='\t')
+			continue;
+		thold[0]=game->mission_title[j];
+		gr_get_string_size (thold,&tx,&ty,&ta);
+
+		if ((x+=tx)>=FSPACX(55))
+		{
+			MissName[k]=MissName[k+1]=MissName[k+2]='.';
+			k+=3;
+			break;
+		}
+
+		MissName[k++]=game->mission_title[j];
+	}
+	MissName[k]=0;
+
+	for (x=0,tx=0,k=0,j=0;j<15;j++)
+	{
+		if (game->game_name[j]=='\t')
+			continue;
+		thold[0]=game->game_name[j];
+		gr_get_string_size (thold,&tx,&ty,&ta);
+
+		if ((x+=tx)>=FSPACX(55))
+		{
+			GameName[k]=GameName[k+1]=GameName[k+2]='.';
+			k+=3;
+			break;
+		}
+		GameName[k++]=game->game_name[j];
+	}
+	GameName[k]=0;
+
+	nplayers = game->numconnected;
+
+	if (game->levelnum < 0)
+		snprintf(levelname, sizeof(levelname), "S%d", -game->levelnum);
+	else
+		snprintf(levelname, sizeof(levelname), "%d", game->levelnum);
+
+	if (game_status == NETSTAT_STARTING)
+		snprintf(status, sizeof(status), "FORMING ");
+	else if (game_status == NETSTAT_PLAYING)
+	{
+		if (game->RefusePlayers)
+			snprintf(status, sizeof(status), "RESTRICT");
+		else if (game->game_flags & NETGAME_FLAG_CLOSED)
+			snprintf(status, sizeof(status), "CLOSED  ");
+		else
+			snprintf(status, sizeof(status), "OPEN    ");
+	}
+	else
+		snprintf(status, sizeof(status), "BETWEEN ");
+	
+	gamemode = game->gamemode;
+	snprintf (text,sizeof(char)*74,"%d.\t%s \t%s \t  %d/%d \t%s \t %s \t%s",pos+1,GameName,(gamemode < sizeof(GMNamesShrt) / sizeof(GMNamesShrt[0])) ? GMNamesShrt[gamemode] : "INVALID",nplayers, game->max_numplayers,MissName,levelname,status);
+		
+	Assert(strlen(text) < 75);
+}
+
+#if defined(USE_TRACKER) && !defined(NDEBUG)
+// Nonzero for every listed game the hash, the order or the sort disagree on.
+static int net_udp_check_game_list(void)
+{
+	int pos, errors = 0;
+
+	for (pos = 0; pos < num_active_udp_games; pos++)
+	{
+		int slot = Udp_game_order[pos];
+
+		if (Udp_game_state[slot].order != pos ||
+			net_udp_find_game(&Active_udp_games[slot].game_addr, Active_udp_games[slot].GameID) != slot ||
+			(pos && net_udp_compare_games(Udp_game_order[pos-1], slot) >= 0))
+			errors++;
+	}
+	return errors;
+}
+
+// Build the UPID_TRACKER_INCGAME the tracker would send for made up game n.
+// Every fourth one names its host, so it goes through the resolver task.
+static int net_udp_test_tracker_game(ubyte *buf, int n, int numconnected)
+{
+	char host[32];
+	int len = 0;
+
+	if (n % 4 == 3)
+		snprintf(host, sizeof(host), "localhost");
+	else
+#ifdef IPv6
+		snprintf(host, sizeof(host), "::ffff:10.%d.%d.%d", (n >> 16) & 255, (n >> 8) & 255, n & 255);
+#else
+		snprintf(host, sizeof(host), "10.%d.%d.%d", (n >> 16) & 255, (n >> 8) & 255, n & 255);
+#endif
+
+	memset(buf, 0, 64 + UPID_GAME_INFO_LITE_SIZE);
+	buf[len] = UPID_TRACKER_INCGAME;						len++;
+	buf[len] = 0;									len++; // not IPv6
+	strcpy((char *)&buf[len], host);						len += strlen(host) + 1;
+	PUT_INTEL_SHORT(&buf[len], UDP_PORT_DEFAULT);					len += 2;
+	PUT_INTEL_SHORT(&buf[len], DXX_VERSION_MAJORi);					len += 2;
+	PUT_INTEL_SHORT(&buf[len], DXX_VERSION_MINORi);					len += 2;
+	PUT_INTEL_SHORT(&buf[len], DXX_VERSION_MICROi);					len += 2;
+	PUT_INTEL_INT(&buf[len], n + 1);						len += 4;
+	snprintf((char *)&buf[len], NETGAME_NAME_LEN+1, "Test %d", n);			len += NETGAME_NAME_LEN+1;
+	snprintf((char *)&buf[len], MISSION_NAME_LEN+1, "Descent 2");			len += MISSION_NAME_LEN+1;
+	snprintf((char *)&buf[len], 9, "d2");						len += 9;
+	PUT_INTEL_INT(&buf[len], 1 + n % 24);						len += 4;
+	buf[len] = NETGAME_ANARCHY;							len++;
+	buf[len] = 0;									len++;
+	buf[len] = 0;									len++;
+	buf[len] = NETSTAT_PLAYING;							len++;
+	buf[len] = numconnected;							len++;
+	buf[len] = MAX_PLAYERS;								len++;
+	buf[len] = 0;									len++;
+	return len;
+}
+
+// Pump num_games made up tracker entries through the parser, give them pings
+// and send them all again with new player counts, a third of them with none
+// so they are deleted. Checks the list after each step and leaves it empty.
+void net_udp_test_game_list(int num_games)
+{
+	ubyte buf[64 + UPID_GAME_INFO_LITE_SIZE];
+	u_int64_t t;
+	int i, listed, expected = 0, errors, was_open = Udp_game_list_open;
+
+	num_games = min(num_games, UDP_MAX_NETGAMES);
+	net_udp_reset_game_list();
+	udp_tracker_reset_resolve(1);
+	Udp_game_list_open = 1;
+
+	t = timer_query_usec();
+	for (i = 0; i < num_games; i++)
+		udp_tracker_process_game(buf, net_udp_test_tracker_game(buf, i, 1 + i % MAX_PLAYERS));
+	while (Udp_resolve_task || Udp_resolve_num)
+		udp_tracker_resolve_frame(1);
+	listed = num_active_udp_games;
+	errors = net_udp_check_game_list();
+
+	// answer a probe of every game, which moves it to its ping
+	for (i = 0; i < num_active_udp_games; i++)
+	{
+		Udp_game_state[i].probe_time = timer_query() - (i * 37 % 400) * F1_0 / 1000;
+		Udp_game_state[i].probe_pending = 1;
+		net_udp_game_answered(i);
+		net_udp_resort_game(i);
+	}
+	errors += net_udp_check_game_list();
+
+	for (i = 0; i < num_games; i++)
+	{
+		udp_tracker_process_game(buf, net_udp_test_tracker_game(buf, i, i % 3 ? 1 + i * 5 % MAX_PLAYERS : 0));
+		if (i % 3)
+			expected++;
+	}
+	while (Udp_resolve_task || Udp_resolve_num)
+		udp_tracker_resolve_frame(1);
+	errors += net_udp_check_game_list();
+	t = timer_query_usec() - t;
+
+	con_printf(CON_NORMAL, "%i tracker games: %i listed, %i after updates (%i expected), %i errors, %lu us\n",
+		num_games, listed, num_active_udp_games, expected, errors, (unsigned long)t);
+
+	net_udp_reset_game_list();
+	Udp_game_list_open = was_open;
+}
+#endif
+
 static char *ljtext;
 
 int net_udp_list_join_poll( newmenu *menu, d_event *event, direct_join *dj )
 {
 	// Polling loop for Join Game menu
-	int i, newpage = 0;
+	int i, page_first, newpage = 0;
 	static int NLPage = 0;
 	newmenu_item *menus = newmenu_get_items(menu);
 	int citem = newmenu_get_citem(menu);
@@ -1859,9 +2447,7 @@ int net_udp_list_join_poll( newmenu *menu, d_event *event, direct_join *dj )
 		case EVENT_WINDOW_ACTIVATED:
 		{
 			Netgame.protocol.udp.valid = 0;
-			memset(Active_udp_games, 0, sizeof(UDP_netgame_info_lite)*UDP_MAX_NETGAMES);
-			num_active_udp_changed = 1;
-			num_active_udp_games = 0;
+			net_udp_reset_game_list();
 			net_udp_request_game_info(GBcast, 1);
 #ifdef IPv6
 			net_udp_request_game_info(GMcast_v6, 1);
@@ -1902,9 +2488,7 @@ int net_udp_list_join_poll( newmenu *menu, d_event *event, direct_join *dj )
 			if( key == KEY_F4 )
 			{
 				// Empty the list
-				memset(Active_udp_games, 0, sizeof(UDP_netgame_info_lite)*UDP_MAX_NETGAMES);
-				num_active_udp_changed = 1;
-				num_active_udp_games = 0;
+				net_udp_reset_game_list();
 				
 				// Request LAN games
 				net_udp_request_game_info(GBcast, 1);
@@ -1920,9 +2504,7 @@ int net_udp_list_join_poll( newmenu *menu, d_event *event, direct_join *dj )
 			}
 			if (key == KEY_F5)
 			{
-				memset(Active_udp_games, 0, sizeof(UDP_netgame_info_lite)*UDP_MAX_NETGAMES);
-				num_active_udp_changed = 1;
-				num_active_udp_games = 0;
+				net_udp_reset_game_list();
 				net_udp_request_game_info(GBcast, 1);
 
 #ifdef IPv6
@@ -1934,9 +2516,7 @@ int net_udp_list_join_poll( newmenu *menu, d_event *event, direct_join *dj )
 			if( key == KEY_F6 )
 			{
 				// Zero the list
-				memset( Active_udp_games, 0, sizeof( UDP_netgame_info_lite ) * UDP_MAX_NETGAMES );
-				num_active_udp_changed = 1;
-				num_active_udp_games = 0;
+				net_udp_reset_game_list();
 				
 				// Request from the tracker
 				udp_tracker_reqgames();
@@ -1960,19 +2540,21 @@ int net_udp_list_join_poll( newmenu *menu, d_event *event, direct_join *dj )
 		{
 			if (((citem+(NLPage*UDP_NETGAMES_PPAGE)) >= 4) && (((citem+(NLPage*UDP_NETGAMES_PPAGE))-4) <= num_active_udp_games-1))
 			{
+				UDP_netgame_info_lite *game = &Active_udp_games[Udp_game_order[(citem+(NLPage*UDP_NETGAMES_PPAGE))-4]];
+
 				multi_new_game();
 				net_udp_reset_connection_statuses();
 				N_players = 0;
 				change_playernum_to(1);
 				dj->start_time = timer_query();
 				dj->last_time = 0;
-				memcpy((struct _sockaddr *)&dj->host_addr, (struct _sockaddr *)&Active_udp_games[(citem+(NLPage*UDP_NETGAMES_PPAGE))-4].game_addr, sizeof(struct _sockaddr));
+				memcpy((struct _sockaddr *)&dj->host_addr, (struct _sockaddr *)&game->game_addr, sizeof(struct _sockaddr));
 
 #ifdef USE_TRACKER
 				// The GameID is what the tracker keys the punch brokerage on,
 				// and the game list is the only place a joining client can
 				// learn it before it has talked to the host at all.
-				net_udp_punch_set_target(Active_udp_games[(citem+(NLPage*UDP_NETGAMES_PPAGE))-4].GameID);
+				net_udp_punch_set_target(game->GameID);
 #endif
 
 				// The address here is whatever the tracker/LAN broadcast
@@ -1998,6 +2580,10 @@ int net_udp_list_join_poll( newmenu *menu, d_event *event, direct_join *dj )
 		}
 		case EVENT_WINDOW_CLOSE:
 		{
+			Udp_game_list_open = 0;
+#ifdef USE_TRACKER
+			udp_tracker_reset_resolve(1);
+#endif
 			d_free(ljtext);
 			d_free(menus);
 			d_free(dj);
@@ -2015,91 +2601,25 @@ int net_udp_list_join_poll( newmenu *menu, d_event *event, direct_join *dj )
 			break;
 	}
 
+#ifdef USE_TRACKER
+	udp_tracker_resolve_frame(0);
+#endif
+	if (!dj->connecting)
+		net_udp_probe_games();
 	net_udp_listen();
 
-	if (!num_active_udp_changed && !newpage)
-		return 0;
-
+	// A new page or a new list redraws the whole page, anything else just
+	// the rows that changed
+	page_first = NLPage*UDP_NETGAMES_PPAGE;
+	if (num_active_udp_changed || newpage)
+		net_udp_mark_list_dirty(page_first, page_first+UDP_NETGAMES_PPAGE-1);
 	num_active_udp_changed = 0;
 
-	// Copy the active games data into the menu options
-	for (i = 0; i < UDP_NETGAMES_PPAGE; i++)
-	{
-		int game_status = Active_udp_games[(i+(NLPage*UDP_NETGAMES_PPAGE))].game_status;
-		int j,x, k,tx,ty,ta,nplayers = 0;
-		char levelname[8],MissName[25],GameName[25],thold[2],status[9];
-		thold[1]=0;
-
-		if ((i+(NLPage*UDP_NETGAMES_PPAGE)) >= num_active_udp_games)
-		{
-			snprintf(menus[i+4].text, sizeof(char)*74, "%d.                                                                      ",(i+(NLPage*UDP_NETGAMES_PPAGE))+1);
-			continue;
-		}
-
-		// These next two loops protect against menu skewing
-		// if missiontitle or gamename contain a tab
-
-		for (x=0,tx=0,k=0,j=0;j<15;j++)
-		{
-			if (Active_udp_games[(i+(NLPage*UDP_NETGAMES_PPAGE))].mission_title[j]=='\t')
-				continue;
-			thold[0]=Active_udp_games[(i+(NLPage*UDP_NETGAMES_PPAGE))].mission_title[j];
-			gr_get_string_size (thold,&tx,&ty,&ta);
-
-			if ((x+=tx)>=FSPACX(55))
-			{
-				MissName[k]=MissName[k+1]=MissName[k+2]='.';
-				k+=3;
-				break;
-			}
-
-			MissName[k++]=Active_udp_games[(i+(NLPage*UDP_NETGAMES_PPAGE))].mission_title[j];
-		}
-		MissName[k]=0;
-
-		for (x=0,tx=0,k=0,j=0;j<15;j++)
-		{
-			if (Active_udp_games[(i+(NLPage*UDP_NETGAMES_PPAGE))].game_name[j]=='\t')
-				continue;
-			thold[0]=Active_udp_games[(i+(NLPage*UDP_NETGAMES_PPAGE))].game_name[j];
-			gr_get_string_size (thold,&tx,&ty,&ta);
+	for (i = max(Udp_list_dirty_first-page_first, 0); i < UDP_NETGAMES_PPAGE && page_first+i <= Udp_list_dirty_last; i++)
+		net_udp_draw_game_row(menus[i+4].text, page_first+i);
 
-			if ((x+=tx)>=FSPACX(55))
-			{
-				GameName[k]=GameName[k+1]=GameName[k+2]='.';
-				k+=3;
-				break;
-			}
-			GameName[k++]=Active_udp_games[(i+(NLPage*UDP_NETGAMES_PPAGE))].game_name[j];
-		}
-		GameName[k]=0;
-
-		nplayers = Active_udp_games[(i+(NLPage*UDP_NETGAMES_PPAGE))].numconnected;
-
-		if (Active_udp_games[(i+(NLPage*UDP_NETGAMES_PPAGE))].levelnum < 0)
-			snprintf(levelname, sizeof(levelname), "S%d", -Active_udp_games[(i+(NLPage*UDP_NETGAMES_PPAGE))].levelnum);
-		else
-			snprintf(levelname, sizeof(levelname), "%d", Active_udp_games[(i+(NLPage*UDP_NETGAMES_PPAGE))].levelnum);
-
-		if (game_status == NETSTAT_STARTING)
-			snprintf(status, sizeof(status), "FORMING ");
-		else if (game_status == NETSTAT_PLAYING)
-		{
-			if (Active_udp_games[(i+(NLPage*UDP_NETGAMES_PPAGE))].RefusePlayers)
-				snprintf(status, sizeof(status), "RESTRICT");
-			else if (Active_udp_games[(i+(NLPage*UDP_NETGAMES_PPAGE))].game_flags & NETGAME_FLAG_CLOSED)
-				snprintf(status, sizeof(status), "CLOSED  ");
-			else
-				snprintf(status, sizeof(status), "OPEN    ");
-		}
-		else
-			snprintf(status, sizeof(status), "BETWEEN ");
-		
-		unsigned gamemode = Active_udp_games[(i+(NLPage*UDP_NETGAMES_PPAGE))].gamemode;
-		snprintf (menus[i+4].text,sizeof(char)*74,"%d.\t%s \t%s \t  %d/%d \t%s \t %s \t%s",(i+(NLPage*UDP_NETGAMES_PPAGE))+1,GameName,(gamemode < sizeof(GMNamesShrt) / sizeof(GMNamesShrt[0])) ? GMNamesShrt[gamemode] : "INVALID",nplayers, Active_udp_games[(i+(NLPage*UDP_NETGAMES_PPAGE))].max_numplayers,MissName,levelname,status);
-			
-		Assert(strlen(menus[i+4].text) < 75);
-	}
+	Udp_list_dirty_first = UDP_MAX_NETGAMES;
+	Udp_list_dirty_last = -1;
 	return 0;
 }
 
@@ -2149,9 +2669,8 @@ void net_udp_list_join_game()
 	net_udp_flush();
 	net_udp_listen();  // Throw out old info
 
-	num_active_udp_games = 0;
-
-	memset(Active_udp_games, 0, sizeof(UDP_netgame_info_lite)*UDP_MAX_NETGAMES);
+	net_udp_reset_game_list();
+	Udp_game_list_open = 1;
 
 	gr_set_fontcolor(BM_XRGB(15,15,23),-1);
 
@@ -2286,6 +2805,7 @@ void net_udp_init()
 	memset(&UDP_Seq, 0, sizeof(UDP_sequence_packet));
 	memset(&UDP_MData, 0, sizeof(UDP_mdata_info));
 	net_udp_noloss_init_mdata_queue();
+	net_udp_reset_game_list();
 	UDP_Seq.type = UPID_REQUEST;
 	memcpy(UDP_Seq.player.callsign, Players[Player_num].callsign, CALLSIGN_LEN+1);
 
@@ -2746,20 +3266,15 @@ int net_udp_objnum_is_past(int objnum)
 	// determine whether or not a given object number has already been sent
 	// to a re-joining player.
 	
-	int player_num = UDP_sync_player.player.connected;
-	int obj_mode = !((object_owner[objnum] == -1) || (object_owner[objnum] == player_num));
+	// Objects that change after the object stream is built are sent again
+	// after it, so the stream never has to start over.
 
 	if (!Network_send_objects)
 		return 0; // We're not sending objects to a new player
 
-	if (obj_mode > Network_send_object_mode)
-		return 0;
-	else if (obj_mode < Network_send_object_mode)
-		return 1;
-	else if (objnum < Network_send_objnum)
-		return 1;
-	else
-		return 0;
+	if (Network_send_objnum != -1)
+		net_udp_object_changed(objnum);
+	return 0;
 }
 
 void net_udp_send_door_updates(int pnum)
@@ -2881,25 +3396,295 @@ void net_udp_stop_resync(UDP_sequence_packet *their)
 	}
 }
 
-ubyte object_buffer[UPID_MAX_SIZE];
+/*
+ * Join sync stream
+ *
+ * The objects a joining player needs are written into one buffer, as records of
+ * (int objnum, sbyte owner, int remote_objnum), followed by the object for real
+ * objects: a flag, the CRC32 of the base object and the object_rw. The base is the
+ * same object as it was right after the level was loaded (Object_sync_base), and
+ * if the flag is set the object_rw is XORed with it, so what did not change since
+ * the level was loaded is sent as zeros. The buffer is deflated and sent in chunks
+ * of OBJECT_SYNC_CHUNK. The joining player ACKs every chunk it gets and the host
+ * keeps up to a window of chunks in flight, growing it with every ACK and halving
+ * it when a chunk has to be resent, so the sync goes as fast as the connection.
+ *
+ * Objects that change while the stream is sent (see multi_objnum_is_past()) are
+ * marked, and once the joining player has all of it, the host sends a delta stream
+ * with just these objects: a record to remove what was sent for the object number
+ * if it is gone or now another object, and the object as it is now. The delta starts
+ * with objnum -3 instead of -1 so the joining player does not clear its objects, and
+ * the host keeps sending deltas until nothing changed during the last one.
+ */
 
-void net_udp_send_objects(void)
+#define OBJECT_SYNC_CHUNK		(UPID_MAX_SIZE-UPID_OBJECT_DATA_HEADER_SIZE)
+#define OBJECT_SYNC_RECORD_SIZE	(4+1+4+1+4+sizeof(object_rw))
+#define OBJECT_SYNC_MAX_RAW		((2*MAX_OBJECTS+2)*OBJECT_SYNC_RECORD_SIZE)	// a delta can remove and resend every object
+#define OBJECT_SYNC_MIN_WINDOW	4
+#define OBJECT_SYNC_MAX_WINDOW	64
+#define OBJECT_SYNC_RESEND		(F1_0/4)
+
+// The objects as loaded from the level, in network byte order
+static object_rw *Object_sync_base = NULL;
+static int Object_sync_base_count = 0;
+
+// What the joining player got for each object number, and what changed since
+static ubyte Object_sync_sent[MAX_OBJECTS], Object_sync_dirty[MAX_OBJECTS];
+static sbyte Object_sync_sent_owner[MAX_OBJECTS];
+static short Object_sync_sent_remote[MAX_OBJECTS];
+static int Object_sync_num_dirty = 0;
+
+static struct
+{
+	uint	stream_id;
+	ubyte	*data;			// the deflated records
+	int		size, raw_size, num_chunks;
+	int		acked;			// all chunks before this one are ACKed
+	ubyte	*chunk_acked;
+	fix64	*chunk_sent;	// 0 if not in flight
+	int		window;
+} Object_sync_send;
+
+static struct
+{
+	uint	stream_id;
+	int		valid, done;
+	ubyte	*data;
+	int		size, raw_size, num_chunks;
+	int		acked;			// all chunks before this one arrived
+	ubyte	*chunk_got;
+} Object_sync_recv;
+
+void net_udp_save_object_base(void)
 {
-	sbyte owner, player_num = UDP_sync_player.player.connected;
+	int i;
 
-	if (UDP_sync_player.player.observer) {
-		player_num = OBSERVER_PLAYER_ID;
+	if (Object_sync_base)
+		d_free(Object_sync_base);
+	Object_sync_base_count = 0;
+
+	MALLOC(Object_sync_base, object_rw, Highest_object_index+1);
+	if (!Object_sync_base)
+		return;
+
+	memset(Object_sync_base, 0, sizeof(object_rw)*(Highest_object_index+1));	// so unused fields match on all sides
+	for (i = 0; i <= Highest_object_index; i++)
+	{
+		multi_object_to_object_rw(&Objects[i], &Object_sync_base[i]);
+#ifdef WORDS_BIGENDIAN
+		object_rw_swap(&Object_sync_base[i], 1);
+#endif
 	}
+	Object_sync_base_count = Highest_object_index+1;
+}
 
-	static int obj_count = 0;
-	int loc = 0, i = 0, remote_objnum = 0, obj_count_frame = 0;
-	static fix64 last_send_time = 0;
-	
-	if (last_send_time + (F1_0/50) > timer_query())
+static void net_udp_free_object_stream(void)
+{
+	if (Object_sync_send.data)
+		d_free(Object_sync_send.data);
+	if (Object_sync_send.chunk_acked)
+		d_free(Object_sync_send.chunk_acked);
+	if (Object_sync_send.chunk_sent)
+		d_free(Object_sync_send.chunk_sent);
+	Object_sync_send.num_chunks = 0;
+}
+
+static void net_udp_object_changed(int objnum)
+{
+	if (objnum < 0 || objnum >= MAX_OBJECTS || Object_sync_dirty[objnum])
 		return;
-	last_send_time = timer_query();
+	Object_sync_dirty[objnum] = 1;
+	Object_sync_num_dirty++;
+}
+
+static void net_udp_reset_object_recv(void)
+{
+	if (Object_sync_recv.data)
+		d_free(Object_sync_recv.data);
+	if (Object_sync_recv.chunk_got)
+		d_free(Object_sync_recv.chunk_got);
+	Object_sync_recv.valid = Object_sync_recv.done = 0;
+}
+
+static int net_udp_write_object_record(ubyte *buf, int objnum, sbyte owner, int remote_objnum)
+{
+	int loc = 0;
+
+	PUT_INTEL_INT(buf+loc, objnum);                                loc += 4;
+	buf[loc] = owner;                                              loc += 1;
+	PUT_INTEL_INT(buf+loc, remote_objnum);                         loc += 4;
+
+	if (objnum >= 0)
+	{
+		object_rw *obj_rw = (object_rw *)(buf+loc+5);
+		int i;
+
+		// use object_rw to send objects for now. if object sometime contains some day contains something useful the client should know about, we should use it. but by now it's also easier to use object_rw because then we also do not need fix64 timer values.
+		memset(obj_rw, 0, sizeof(object_rw));
+		multi_object_to_object_rw(&Objects[objnum], obj_rw);
+#ifdef WORDS_BIGENDIAN
+		object_rw_swap(obj_rw, 1);
+#endif
+		if (objnum < Object_sync_base_count)
+		{
+			const ubyte *base = (const ubyte *)&Object_sync_base[objnum];
+
+			buf[loc] = 1;
+			PUT_INTEL_INT(buf+loc+1, crc32(0, base, sizeof(object_rw)));
+			for (i = 0; i < sizeof(object_rw); i++)
+				((ubyte *)obj_rw)[i] ^= base[i];
+		}
+		else
+		{
+			buf[loc] = 0;
+			PUT_INTEL_INT(buf+loc+1, 0);
+		}
+		loc += 5 + sizeof(object_rw);
+	}
+
+	return loc;
+}
+
+static int net_udp_object_is_synced(int objnum)
+{
+	object *obj = &Objects[objnum];
+
+	return (obj->type == OBJ_POWERUP) || (obj->type == OBJ_PLAYER) ||
+			(obj->type == OBJ_CNTRLCEN) || (obj->type == OBJ_GHOST) ||
+			(obj->type == OBJ_ROBOT) || (obj->type == OBJ_HOSTAGE) ||
+			(obj->type==OBJ_WEAPON && obj->id==PMINE_ID);
+}
+
+// Write the objects for player_num (OBSERVER_PLAYER_ID for an observer) and deflate them,
+// all of them or only the ones that changed since the last stream if delta is set.
+// Objects everyone owns or player_num owns come first, so they keep their numbers.
+static int net_udp_build_object_stream(sbyte player_num, int delta)
+{
+	static uint stream_id = 0;
+	ubyte *raw;
+	uLongf size;
+	int loc = 0, obj_count = 0, mode, i;
+
+	net_udp_free_object_stream();
+
+	MALLOC(raw, ubyte, OBJECT_SYNC_MAX_RAW);
+	if (!raw)
+		return 0;
+
+	loc += net_udp_write_object_record(raw+loc, delta ? -3 : -1, player_num, 0);
+
+	if (!delta)
+		memset(Object_sync_sent, 0, sizeof(Object_sync_sent));
+
+	for (i = 0; delta && i < MAX_OBJECTS; i++)
+	{
+		sbyte owner;
+		int remote_objnum;
+
+		// remove what the joining player got if it is gone or another object now
+		if (!Object_sync_dirty[i] || !Object_sync_sent[i])
+			continue;
+		if (net_udp_object_is_synced(i))
+		{
+			remote_objnum = objnum_local_to_remote(i, &owner);
+			if (owner == Object_sync_sent_owner[i] && remote_objnum == Object_sync_sent_remote[i])
+				continue;
+		}
+		loc += net_udp_write_object_record(raw+loc, -4, Object_sync_sent_owner[i], Object_sync_sent_remote[i]);
+		Object_sync_sent[i] = 0;
+	}
+
+	for (mode = 0; mode < 2; mode++)
+	{
+		for (i = 0; i <= Highest_object_index; i++)
+		{
+			sbyte owner;
+			int remote_objnum;
+
+			if (delta && !Object_sync_dirty[i])
+				continue;
+			if (!net_udp_object_is_synced(i))
+				continue;
+			if ((mode == 0) && ((object_owner[i] != -1) && (object_owner[i] != player_num)))
+				continue;
+			if ((mode == 1) && ((object_owner[i] == -1) || (object_owner[i] == player_num)))
+				continue;
+
+			remote_objnum = objnum_local_to_remote(i, &owner);
+			Assert(owner == object_owner[i]);
+
+			loc += net_udp_write_object_record(raw+loc, i, owner, remote_objnum);
+			obj_count++;
+
+			Object_sync_sent[i] = 1;
+			Object_sync_sent_owner[i] = owner;
+			Object_sync_sent_remote[i] = remote_objnum;
+		}
+	}
+
+	memset(Object_sync_dirty, 0, sizeof(Object_sync_dirty));
+	Object_sync_num_dirty = 0;
+
+	// Send count so other side can make sure he got them all
+	loc += net_udp_write_object_record(raw+loc, -2, player_num, obj_count);
+
+	size = compressBound(loc);
+	MALLOC(Object_sync_send.data, ubyte, size);
+	if (!Object_sync_send.data || compress(Object_sync_send.data, &size, raw, loc) != Z_OK)
+	{
+		d_free(raw);
+		net_udp_free_object_stream();
+		return 0;
+	}
+	d_free(raw);
+
+	Object_sync_send.stream_id = ++stream_id;
+	Object_sync_send.size = size;
+	Object_sync_send.raw_size = loc;
+	Object_sync_send.num_chunks = (size + OBJECT_SYNC_CHUNK - 1) / OBJECT_SYNC_CHUNK;
+	Object_sync_send.acked = 0;
+	Object_sync_send.window = OBJECT_SYNC_MIN_WINDOW;
+	CALLOC(Object_sync_send.chunk_acked, ubyte, Object_sync_send.num_chunks);
+	CALLOC(Object_sync_send.chunk_sent, fix64, Object_sync_send.num_chunks);
+	if (!Object_sync_send.chunk_acked || !Object_sync_send.chunk_sent)
+	{
+		net_udp_free_object_stream();
+		return 0;
+	}
+
+	con_printf(CON_VERBOSE, "Object sync%s: %i objects, %i bytes, %i deflated\n", delta ? " delta" : "", obj_count, loc, (int)size);
+	return 1;
+}
+
+static void net_udp_send_object_chunk(int chunk)
+{
+	ubyte buf[UPID_MAX_SIZE];
+	int len = Object_sync_send.size - chunk*OBJECT_SYNC_CHUNK;
 
-	// Send clear objects array trigger and send player num
+	if (len > OBJECT_SYNC_CHUNK)
+		len = OBJECT_SYNC_CHUNK;
+
+	buf[0] = UPID_OBJECT_DATA;
+	PUT_INTEL_INT(buf + 1, UDP_sync_player.token);
+	PUT_INTEL_INT(buf + 5, Object_sync_send.stream_id);
+	PUT_INTEL_SHORT(buf + 9, chunk);
+	PUT_INTEL_SHORT(buf + 11, Object_sync_send.num_chunks);
+	PUT_INTEL_INT(buf + 13, Object_sync_send.size);
+	PUT_INTEL_INT(buf + 17, Object_sync_send.raw_size);
+	memcpy(buf + UPID_OBJECT_DATA_HEADER_SIZE, Object_sync_send.data + chunk*OBJECT_SYNC_CHUNK, len);
+
+	dxx_sendto (UDP_Socket[0], buf, UPID_OBJECT_DATA_HEADER_SIZE + len, 0, (struct sockaddr *)&UDP_sync_player.player.protocol.udp.addr, sizeof(struct _sockaddr));
+}
+
+void net_udp_send_objects(void)
+{
+	sbyte player_num = UDP_sync_player.player.connected;
+	int i, in_flight = 0, lost = 0;
+	fix64 now = timer_query();
+
+	if (UDP_sync_player.player.observer) {
+		player_num = OBSERVER_PLAYER_ID;
+	}
 
 	Assert(Network_send_objects != 0);
 	Assert(player_num >= 0);
@@ -2912,105 +3697,121 @@ void net_udp_send_objects(void)
 		net_log_comment("sending objects stopped due to end level");
 		net_udp_dump_player(UDP_sync_player.player.protocol.udp.addr, UDP_sync_player.token, DUMP_ENDLEVEL);
 		Network_send_objects = 0; 
+		net_udp_free_object_stream();
 		return;
 	}
 
-	memset(object_buffer, 0, UPID_MAX_SIZE);
-	object_buffer[0] = UPID_OBJECT_DATA;
-	PUT_INTEL_INT(object_buffer + 1, UDP_sync_player.token); 
-	loc = 9;
-
 	if (Network_send_objnum == -1)
 	{
-		obj_count = 0;
-		Network_send_object_mode = 0;
-		PUT_INTEL_INT(object_buffer+loc, -1);                       loc += 4;
-		object_buffer[loc] = player_num;                            loc += 1;
-		/* Placeholder for remote_objnum, not used here */          loc += 4;
+		// (re)start with the objects as they are now
+		if (!net_udp_build_object_stream(player_num, 0))
+		{
+			net_log_comment("sending objects stopped due to low memory");
+			net_udp_dump_player(UDP_sync_player.player.protocol.udp.addr, UDP_sync_player.token, DUMP_ENDLEVEL);
+			Network_send_objects = 0;
+			return;
+		}
 		Network_send_objnum = 0;
-		obj_count_frame = 1;
 	}
-	
-	for (i = Network_send_objnum; i <= Highest_object_index; i++)
-	{
-		if ((Objects[i].type != OBJ_POWERUP) && (Objects[i].type != OBJ_PLAYER) &&
-				(Objects[i].type != OBJ_CNTRLCEN) && (Objects[i].type != OBJ_GHOST) &&
-				(Objects[i].type != OBJ_ROBOT) && (Objects[i].type != OBJ_HOSTAGE) &&
-				!(Objects[i].type==OBJ_WEAPON && Objects[i].id==PMINE_ID))
-			continue;
-		if ((Network_send_object_mode == 0) && ((object_owner[i] != -1) && (object_owner[i] != player_num)))
-			continue;
-		if ((Network_send_object_mode == 1) && ((object_owner[i] == -1) || (object_owner[i] == player_num)))
-			continue;
 
-		if ( loc + sizeof(object_rw) + 9 > UPID_MAX_SIZE-1 )
-			break; // Not enough room for another object
+	if (Object_sync_send.acked == Object_sync_send.num_chunks && Object_sync_num_dirty)
+	{
+		// send what changed while the joining player got the last stream
+		if (!net_udp_build_object_stream(player_num, 1))
+		{
+			net_log_comment("sending objects stopped due to low memory");
+			net_udp_dump_player(UDP_sync_player.player.protocol.udp.addr, UDP_sync_player.token, DUMP_ENDLEVEL);
+			Network_send_objects = 0;
+			Network_send_objnum = -1;
+			return;
+		}
+	}
 
-		obj_count_frame++;
-		obj_count++;
+	if (Object_sync_send.acked == Object_sync_send.num_chunks)
+	{
+		net_udp_free_object_stream();
 
-		remote_objnum = objnum_local_to_remote(i, &owner);
-		Assert(owner == object_owner[i]);
+		// Send sync packet which tells the player who he is and to start!
+		net_udp_send_rejoin_sync(player_num);
 
-		PUT_INTEL_INT(object_buffer+loc, i);                        loc += 4;
-		object_buffer[loc] = owner;                                 loc += 1;
-		PUT_INTEL_INT(object_buffer+loc, remote_objnum);            loc += 4;
-		// use object_rw to send objects for now. if object sometime contains some day contains something useful the client should know about, we should use it. but by now it's also easier to use object_rw because then we also do not need fix64 timer values.
-		multi_object_to_object_rw(&Objects[i], (object_rw *)&object_buffer[loc]);
-#ifdef WORDS_BIGENDIAN
-		object_rw_swap((object_rw *)&object_buffer[loc], 1);
-#endif
-		loc += sizeof(object_rw);
-	}
+		// Turn off send object mode
+		Network_send_objnum = -1;
+		Network_send_objects = 0;
 
-	if (obj_count_frame) // Send any objects we've buffered
-	{
-		Network_send_objnum = i;
-		PUT_INTEL_INT(object_buffer+5, obj_count_frame);
+		Network_sending_extras=9; // start to send extras
+		VerifyPlayerJoined = Player_joining_extras = player_num;
 
-		Assert(loc <= UPID_MAX_SIZE);
+		if(UDP_sync_player.player.observer) {
+			VerifyPlayerJoined = -1;
+		}
 
-		dxx_sendto (UDP_Socket[0], object_buffer, loc, 0, (struct sockaddr *)&UDP_sync_player.player.protocol.udp.addr, sizeof(struct _sockaddr));
+		return;
 	}
 
-	if (i > Highest_object_index)
+	for (i = Object_sync_send.acked; i < Object_sync_send.num_chunks; i++)
 	{
-		if (Network_send_object_mode == 0)
+		if (Object_sync_send.chunk_acked[i] || !Object_sync_send.chunk_sent[i])
+			continue;
+		if (Object_sync_send.chunk_sent[i] + OBJECT_SYNC_RESEND <= now)
 		{
-			Network_send_objnum = 0;
-			Network_send_object_mode = 1; // go to next mode
+			Object_sync_send.chunk_sent[i] = 0;
+			lost = 1;
 		}
-		else 
-		{
-			Assert(Network_send_object_mode == 1); 
+		else
+			in_flight++;
+	}
 
-			// Send count so other side can make sure he got them all
-			object_buffer[0] = UPID_OBJECT_DATA;
-			PUT_INTEL_INT(object_buffer+5, 1);
-			PUT_INTEL_INT(object_buffer+9, -2);
-			object_buffer[13] = player_num;
-			PUT_INTEL_INT(object_buffer+14, obj_count);
-			dxx_sendto (UDP_Socket[0], object_buffer, 18, 0, (struct sockaddr *)&UDP_sync_player.player.protocol.udp.addr, sizeof(struct _sockaddr));
+	if (lost)
+	{
+		Object_sync_send.window /= 2;
+		if (Object_sync_send.window < OBJECT_SYNC_MIN_WINDOW)
+			Object_sync_send.window = OBJECT_SYNC_MIN_WINDOW;
+	}
 
+	for (i = Object_sync_send.acked; i < Object_sync_send.num_chunks && in_flight < Object_sync_send.window; i++)
+	{
+		if (Object_sync_send.chunk_acked[i] || Object_sync_send.chunk_sent[i])
+			continue;
+		net_udp_send_object_chunk(i);
+		Object_sync_send.chunk_sent[i] = now ? now : 1;
+		in_flight++;
+	}
+}
 
-			// Send sync packet which tells the player who he is and to start!
-			net_udp_send_rejoin_sync(player_num);
+// The joining player got chunks of the object stream
+void net_udp_process_object_ack(ubyte *data, int data_len, struct _sockaddr sender_addr)
+{
+	uint mask;
+	int acked, i;
 
-			// Turn off send object mode
-			Network_send_objnum = -1;
-			Network_send_objects = 0;
-			obj_count = 0;
+	if (!Network_send_objects || Network_send_objnum == -1 || !Object_sync_send.num_chunks)
+		return;
+	if (GET_INTEL_INT(data + 1) != UDP_sync_player.token || (uint)GET_INTEL_INT(data + 5) != Object_sync_send.stream_id)
+		return;
+	if (memcmp(&sender_addr, &UDP_sync_player.player.protocol.udp.addr, sizeof(struct _sockaddr)))
+		return;
 
-			Network_sending_extras=9; // start to send extras
-			VerifyPlayerJoined = Player_joining_extras = player_num;
+	acked = GET_INTEL_SHORT(data + 9);
+	mask = GET_INTEL_INT(data + 11);
+	if (acked > Object_sync_send.num_chunks)
+		return;
 
-			if(UDP_sync_player.player.observer) {
-				VerifyPlayerJoined = -1;
-			}
+	for (i = 0; i < Object_sync_send.num_chunks; i++)
+	{
+		if (Object_sync_send.chunk_acked[i])
+			continue;
+		if (i < acked || (i > acked && i - acked - 1 < 32 && (mask & (1u << (i - acked - 1)))))
+		{
+			Object_sync_send.chunk_acked[i] = 1;
+			if (Object_sync_send.window < OBJECT_SYNC_MAX_WINDOW)
+				Object_sync_send.window++;
+		}
+	}
 
-			return;
-		} // mode == 1;
-	} // i > Highest_object_index
+	while (Object_sync_send.acked < Object_sync_send.num_chunks && Object_sync_send.chunk_acked[Object_sync_send.acked])
+		Object_sync_send.acked++;
+
+	net_udp_send_objects();	// keep the window full
 }
 
 int net_udp_verify_objects(int remote, int local)
@@ -3032,19 +3833,26 @@ int net_udp_verify_objects(int remote, int local)
 	return(1);
 }
 
-void net_udp_read_object_packet( ubyte *data )
+// The object a delta record from the host is for, if we still have it
+static int net_udp_delta_objnum(int remote_objnum, sbyte owner)
 {
-	multi_received_objects = 1; 
+	int objnum = objnum_remote_to_local(remote_objnum, owner);
+
+	if (objnum < 0 || objnum > Highest_object_index || Objects[objnum].type == OBJ_NONE || object_owner[objnum] != owner)
+		return -1;
+	return objnum;
+}
 
+// Process the records of a whole object stream
+static void net_udp_read_object_records(ubyte *data, int data_len)
+{
 	// Object from another net player we need to sync with
 	object *obj;
 	sbyte obj_owner;
-	static int mode = 0, object_count = 0, my_pnum = 0;
-	int i = 0, segnum = 0, objnum = 0, remote_objnum = 0, nobj = 0, loc = 9;
+	static int mode = 0, object_count = 0, my_pnum = 0, delta = 0;
+	int segnum = 0, objnum = 0, remote_objnum = 0, loc = 0;
 	
-	nobj = GET_INTEL_INT(data + 5);
-
-	for (i = 0; i < nobj; i++)
+	while (loc + 9 <= data_len)
 	{
 		objnum = GET_INTEL_INT(data + loc);                         loc += 4;
 		obj_owner = data[loc];                                      loc += 1;
@@ -3059,6 +3867,27 @@ void net_udp_read_object_packet( ubyte *data )
 			if(!is_observer()) { change_playernum_to(my_pnum); }
 			mode = 1;
 			object_count = 0;
+			delta = 0;
+		}
+		else if (objnum == -3)
+		{
+			// Objects that changed since the last stream, keep the others
+			my_pnum = obj_owner;
+			mode = 1;
+			delta = 1;
+		}
+		else if (objnum == -4)
+		{
+			// An object we got before is gone
+			if (delta)
+			{
+				objnum = ((obj_owner == my_pnum) || (obj_owner == -1)) ? remote_objnum : net_udp_delta_objnum(remote_objnum, obj_owner);
+				if (objnum > 0 && objnum < MAX_OBJECTS && Objects[objnum].type != OBJ_NONE && &Objects[objnum] != ConsoleObject)
+				{
+					obj_delete(objnum);
+					object_owner[objnum] = -1;
+				}
+			}
 		}
 		else if (objnum == -2)
 		{
@@ -3068,6 +3897,8 @@ void net_udp_read_object_packet( ubyte *data )
 				special_reset_objects();
 				mode = 0;
 			}
+			if (delta)
+				continue;	// the count is only for a whole stream
 			if (remote_objnum != object_count) {
 				Int3();
 			}
@@ -3081,6 +3912,30 @@ void net_udp_read_object_packet( ubyte *data )
 		}
 		else 
 		{
+			object_rw *obj_rw = (object_rw *)&data[loc+5];
+			int base_objnum = objnum;
+
+			if (loc + 5 + sizeof(object_rw) > data_len)
+				break;
+
+			if (data[loc])
+			{
+				const ubyte *base = (const ubyte *)&Object_sync_base[base_objnum];
+				int i;
+
+				// we cannot tell what the host sent if our level did not load the same
+				if (base_objnum < 0 || base_objnum >= Object_sync_base_count ||
+					(uint)GET_INTEL_INT(data + loc + 1) != (uint)crc32(0, base, sizeof(object_rw)))
+				{
+					nm_messagebox(NULL, 1, TXT_OK, TXT_NET_SYNC_FAILED);
+					Network_status = NETSTAT_MENU;
+					return;
+				}
+				for (i = 0; i < sizeof(object_rw); i++)
+					((ubyte *)obj_rw)[i] ^= base[i];
+			}
+			loc += 5;
+
 			object_count++;
 			if ((obj_owner == my_pnum) || (obj_owner == -1)) 
 			{
@@ -3094,7 +3949,9 @@ void net_udp_read_object_packet( ubyte *data )
 					special_reset_objects();
 					mode = 0;
 				}
-				objnum = obj_allocate();
+				objnum = delta ? net_udp_delta_objnum(remote_objnum, obj_owner) : -1;
+				if (objnum == -1)
+					objnum = obj_allocate();
 			}
 			if (objnum != -1) {
 				obj = &Objects[objnum];
@@ -3103,10 +3960,9 @@ void net_udp_read_object_packet( ubyte *data )
 				Assert(obj->segnum == -1);
 				Assert(objnum < MAX_OBJECTS);
 #ifdef WORDS_BIGENDIAN
-				object_rw_swap((object_rw *)&data[loc], 1);
+				object_rw_swap(obj_rw, 1);
 #endif
-				multi_object_rw_to_object((object_rw *)&data[loc], obj);
-				loc += sizeof(object_rw);
+				multi_object_rw_to_object(obj_rw, obj);
 				segnum = obj->segnum;
 				obj->next = obj->prev = obj->segnum = -1;
 				obj->attached_obj = -1;
@@ -3119,10 +3975,97 @@ void net_udp_read_object_packet( ubyte *data )
 				else
 					object_owner[objnum] = -1;
 			}
+			loc += sizeof(object_rw);
 		} // For a standard onbject
 	} // For each object in packet
 }
 
+void net_udp_read_object_packet( ubyte *data, int data_len, struct _sockaddr sender_addr )
+{
+	ubyte ack[UPID_OBJECT_ACK_SIZE];
+	uint stream_id = GET_INTEL_INT(data + 5), mask = 0;
+	int chunk = GET_INTEL_SHORT(data + 9), num_chunks = GET_INTEL_SHORT(data + 11);
+	int size = GET_INTEL_INT(data + 13), raw_size = GET_INTEL_INT(data + 17);
+	int len = data_len - UPID_OBJECT_DATA_HEADER_SIZE, i;
+
+	multi_received_objects = 1; 
+
+	if (!Object_sync_recv.valid || Object_sync_recv.stream_id != stream_id)
+	{
+		// a new stream, the objects changed while the last one was sent
+		net_udp_reset_object_recv();
+
+		if (num_chunks <= 0 || size <= 0 || size > compressBound(OBJECT_SYNC_MAX_RAW) || raw_size <= 0 || raw_size > OBJECT_SYNC_MAX_RAW ||
+			(size + OBJECT_SYNC_CHUNK - 1) / OBJECT_SYNC_CHUNK != num_chunks)
+			return;
+
+		MALLOC(Object_sync_recv.data, ubyte, size);
+		CALLOC(Object_sync_recv.chunk_got, ubyte, num_chunks);
+		if (!Object_sync_recv.data || !Object_sync_recv.chunk_got)
+		{
+			net_udp_reset_object_recv();
+			return;
+		}
+
+		Object_sync_recv.stream_id = stream_id;
+		Object_sync_recv.size = size;
+		Object_sync_recv.raw_size = raw_size;
+		Object_sync_recv.num_chunks = num_chunks;
+		Object_sync_recv.acked = 0;
+		Object_sync_recv.valid = 1;
+	}
+
+	if (!Object_sync_recv.done)
+	{
+		if (chunk < 0 || chunk >= Object_sync_recv.num_chunks ||
+			len != ((chunk == Object_sync_recv.num_chunks - 1) ? Object_sync_recv.size - chunk*OBJECT_SYNC_CHUNK : OBJECT_SYNC_CHUNK))
+			return;
+
+		if (!Object_sync_recv.chunk_got[chunk])
+		{
+			memcpy(Object_sync_recv.data + chunk*OBJECT_SYNC_CHUNK, data + UPID_OBJECT_DATA_HEADER_SIZE, len);
+			Object_sync_recv.chunk_got[chunk] = 1;
+		}
+
+		while (Object_sync_recv.acked < Object_sync_recv.num_chunks && Object_sync_recv.chunk_got[Object_sync_recv.acked])
+			Object_sync_recv.acked++;
+
+		for (i = 0; i < 32 && Object_sync_recv.acked + 1 + i < Object_sync_recv.num_chunks; i++)
+			if (Object_sync_recv.chunk_got[Object_sync_recv.acked + 1 + i])
+				mask |= 1u << i;
+	}
+
+	// ACK before the objects are read, the host waits for it to send the rest of the sync
+	ack[0] = UPID_OBJECT_ACK;
+	PUT_INTEL_INT(ack + 1, my_player_token);
+	PUT_INTEL_INT(ack + 5, Object_sync_recv.stream_id);
+	PUT_INTEL_SHORT(ack + 9, Object_sync_recv.acked);
+	PUT_INTEL_INT(ack + 11, mask);
+	dxx_sendto (UDP_Socket[0], ack, UPID_OBJECT_ACK_SIZE, 0, (struct sockaddr *)&sender_addr, sizeof(struct _sockaddr));
+
+	if (!Object_sync_recv.done && Object_sync_recv.acked == Object_sync_recv.num_chunks)
+	{
+		ubyte *raw;
+		uLongf raw_size = Object_sync_recv.raw_size;
+
+		Object_sync_recv.done = 1;
+
+		MALLOC(raw, ubyte, raw_size);
+		if (raw && uncompress(raw, &raw_size, Object_sync_recv.data, Object_sync_recv.size) == Z_OK)
+			net_udp_read_object_records(raw, raw_size);
+		else
+		{
+			nm_messagebox(NULL, 1, TXT_OK, TXT_NET_SYNC_FAILED);
+			Network_status = NETSTAT_MENU;
+		}
+		if (raw)
+			d_free(raw);
+
+		d_free(Object_sync_recv.data);
+		d_free(Object_sync_recv.chunk_got);
+	}
+}
+
 // Finished sending objects
 void net_udp_send_rejoin_sync(int player_num)
 {
@@ -3836,6 +4779,9 @@ int net_udp_process_game_info(ubyte *data, int data_len, struct _sockaddr game_a
 	{
 		UDP_netgame_info_lite recv_game;
 		
+		if (!Udp_game_list_open)
+			return 0;
+
 		memcpy(&recv_game, &game_addr, sizeof(struct _sockaddr));
 												len++; // skip UPID byte
 		recv_game.program_iver[0] = GET_INTEL_SHORT(&(data[len]));			len += 2;
@@ -3855,13 +4801,17 @@ int net_udp_process_game_info(ubyte *data, int data_len, struct _sockaddr game_a
 		recv_game.max_numplayers = data[len];						len++;
 		recv_game.game_flags = data[len];						len++;
 	
-		num_active_udp_changed = 1;
-		
-		for (i = 0; i < num_active_udp_games; i++)
-			if (!d_stricmp(Active_udp_games[i].game_name, recv_game.game_name) && Active_udp_games[i].GameID == recv_game.GameID)
-				break;
+		i = net_udp_find_game(&recv_game.game_addr, recv_game.GameID);
+
+		if (recv_game.numconnected == 0)
+		{
+			// Delete this game
+			if (i != UDP_GAME_NONE)
+				net_udp_remove_game(i);
+			return 1;
+		}
 
-		if (i == UDP_MAX_NETGAMES)
+		if (i == UDP_GAME_NONE && (i = net_udp_add_game(&recv_game.game_addr, recv_game.GameID)) == UDP_GAME_NONE)
 		{
 			return 0;
 		}
@@ -3885,17 +4835,9 @@ int net_udp_process_game_info(ubyte *data, int data_len, struct _sockaddr game_a
 					Active_udp_games[i].game_status=NETSTAT_STARTING;
 			}
 		}
-		
-		if (i == num_active_udp_games)
-			num_active_udp_games++;
 
-		if (Active_udp_games[i].numconnected == 0)
-		{
-			// Delete this game
-			for (j = i; j < num_active_udp_games-1; j++)
-				memcpy(&Active_udp_games[j], &Active_udp_games[j+1], sizeof(UDP_netgame_info_lite));
-			num_active_udp_games--;
-		}
+		net_udp_game_answered(i);
+		net_udp_resort_game(i);
 	}
 	else
 	{
@@ -4153,6 +5095,7 @@ void net_udp_process_packet(ubyte *data, struct _sockaddr sender_addr, int lengt
 		switch (data[0]) {
 			case UPID_P2P_PING:
 			case UPID_REQUEST:
+			case UPID_OBJECT_ACK:
 			case UPID_MDATA_ACK:
 			case UPID_MDATA_PNEEDACK:
 			case UPID_OBSDATA:
@@ -4262,7 +5205,11 @@ void net_udp_process_packet(ubyte *data, struct _sockaddr sender_addr, int lengt
 			break;
 
 		case UPID_OBJECT_DATA:
-			net_udp_read_object_packet(data);
+			net_udp_read_object_packet(data, length, sender_addr);
+			break;
+
+		case UPID_OBJECT_ACK:
+			net_udp_process_object_ack(data, length, sender_addr);
 			break;
 
 		case UPID_PING:
@@ -6378,6 +7325,7 @@ net_udp_level_sync(void)
 	net_udp_noloss_init_mdata_queue();
 
 	net_udp_flush(); // Flush any old packets
+	net_udp_reset_object_recv();
 
 	if (N_players == 0)
 		result = net_udp_wait_for_sync();
@@ -6660,6 +7608,8 @@ void net_udp_do_frame(int force, int listen)
 	if (!(Game_mode&GM_NETWORK) || UDP_Socket[0] == -1)
 		return;
 
+	PROFILE_BEGIN("net_udp_do_frame");
+
 	time = timer_query();
 
 	if (WaitForRefuseAnswer && time>(RefuseTimeLimit+(F1_0*12)))
@@ -6809,6 +7759,8 @@ void net_udp_do_frame(int force, int listen)
 	}
 
 	udp_traffic_stat();
+
+	PROFILE_END();
 }
 
 /* CODE FOR PACKET LOSS PREVENTION - START */
@@ -7030,6 +7982,13 @@ void net_udp_noloss_got_ack(ubyte *data, int data_len, struct _sockaddr sender_a
 	}
 }
 
+// Number of MDATA packets resent to pnum so far. It only counts up, the change between two calls
+// tells if packets to pnum got lost in between.
+int net_udp_get_resends(int pnum)
+{
+	return UDP_mdata_resends[pnum];
+}
+
 /* Init/Free the queue. Call at start and end of a game or level. */
 void net_udp_noloss_init_mdata_queue(void)
 {
@@ -7085,6 +8044,7 @@ void net_udp_noloss_process_queue(fix64 time)
 					
 					con_printf(CON_VERBOSE, "P#%i: Resending pkt_num %i from pnum %i to pnum %i\n",Player_num, UDP_mdata_queue[queuec].pkt_num, UDP_mdata_queue[queuec].Player_num, plc);
 					
+					UDP_mdata_resends[plc]++;
 					UDP_mdata_queue[queuec].pkt_timestamp[plc] = time;
 					memset(&buf, 0, sizeof(UDP_mdata_info));
 					
@@ -11,6 +11,7 @@ int net_udp_setup_game(void);
 void net_udp_manual_join_game();
 void net_udp_list_join_game();
 int net_udp_objnum_is_past(int objnum);
+void net_udp_save_object_base(void);
 void net_udp_do_frame(int force, int listen);
 void net_udp_send_data(const ubyte * ptr, int len, int priority );
 void net_udp_leave_game();
@@ -22,6 +23,7 @@ void net_udp_dump_player(struct _sockaddr dump_addr, int their_token, int why);
 void net_udp_disconnect_player(int playernum);
 int net_udp_level_sync();
 void net_udp_send_mdata_direct(ubyte *data, int data_len, int pnum, int priority);
+int net_udp_get_resends(int pnum);
 void net_udp_send_netgame_update();
 void net_udp_send_obs_quit();
 #ifdef USE_TRACKER
@@ -36,6 +38,9 @@ void udp_tracker_send_obs_message(const char *formatted_text);
 // Send any queued events now. No-op when nothing is queued; called once per
 // net_udp_do_frame() and again before we unregister, to flush the tail.
 void udp_tracker_flush_events(void);
+#ifndef NDEBUG
+void net_udp_test_game_list(int num_games);
+#endif
 #else
 // Keep the call sites in multi.c free of #ifdef clutter. Every argument used
 // at those sites is side-effect free, so discarding them is safe.
@@ -84,7 +89,8 @@ void udp_tracker_flush_events(void);
 #define UPID_QUIT_JOINING			  9 // Packet from a player who suddenly quits joining.
 #define UPID_SEQUENCE_SIZE			 (3 + 4 + (CALLSIGN_LEN+1) + sizeof(struct _sockaddr) + 2 + 1)
 #define UPID_SYNC				 10 // Packet from host containing full netgame info to sync players up.
-#define UPID_OBJECT_DATA			 11 // Packet from host containing object buffer.
+#define UPID_OBJECT_DATA			 11 // Packet from host containing a chunk of the deflated objects.
+#define UPID_OBJECT_DATA_HEADER_SIZE		 21 // pid, token, stream id, chunk, number of chunks, deflated size, size
 #define UPID_PING				 12 // Packet from host containing his GameTime and the Ping list. Client returns this time to host as UPID_PONG and adapts the ping list.
 #define UPID_PING_SIZE				 37
 #define UPID_PONG				 13 // Packet answer from client to UPID_PING. Contains the time the initial ping packet was sent.
@@ -122,6 +128,8 @@ void udp_tracker_flush_events(void);
 #define UPID_GNS_SIGNAL 31 // Relays a GameNetworkingSockets ICE signaling blob between two players, via net_udp_send_to_player() (direct or proxied through host).
 #define UPID_GNS_SIGNAL_HEADER_SIZE (1 + 4 + 1 + 1) // type, token, to_player, from_player
 #endif
+#define UPID_OBJECT_ACK 32 // Packet from a joining player, telling the host which UPID_OBJECT_DATA chunks it got.
+#define UPID_OBJECT_ACK_SIZE (1 + 4 + 4 + 2 + 4) // pid, token, stream id, chunks got in a row, mask of the 32 after the next
 
 // Structure keeping lite game infos (for netlist, etc.)
 typedef struct UDP_netgame_info_lite
@@ -3166,6 +3166,7 @@ void interpolate_frame(fix d_play, fix d_recorded)
 	for (i = 0; i <= num_cur_objs; i++)
 		memcpy(&(Objects[i]), &(cur_objs[i]), sizeof(object));
 	Highest_object_index = num_cur_objs;
+	obj_update_used();
 	d_free(cur_objs);
 }
 
@@ -68,6 +68,7 @@ COPYRIGHT 1993-1999 PARALLAX SOFTWARE CORPORATION.  ALL RIGHTS RESERVED.
 #include "gameseq.h"
 #include "playsave.h"
 #include "timer.h"
+#include "profile.h"
 #ifdef EDITOR
 #include "editor/editor.h"
 #endif
@@ -97,6 +98,7 @@ object	Object_minus_one;
 object Objects[MAX_OBJECTS];
 int num_objects=0;
 int Highest_object_index=0;
+u_int32_t Objects_used[(MAX_OBJECTS+31)/32];
 int Highest_ever_object_index=0;
 
 // grs_bitmap *robot_bms[MAX_ROBOT_BITMAPS];	//all bitmaps for all robots
@@ -196,7 +198,7 @@ object *obj_find_first_of_type (int type)
 {
 	int i;
 
-	for (i=0;i<=Highest_object_index;i++)
+	for (i=obj_first_used();i!=-1;i=obj_next_used(i))
 		if (Objects[i].type==type)
 			return (&Objects[i]);
 	return ((object *)NULL);
@@ -206,7 +208,7 @@ int obj_return_num_of_type (int type)
 {
 	int i,count=0;
 
-	for (i=0;i<=Highest_object_index;i++)
+	for (i=obj_first_used();i!=-1;i=obj_next_used(i))
 		if (Objects[i].type==type)
 			count++;
 	return (count);
@@ -215,7 +217,7 @@ int obj_return_num_of_typeid (int type,int id)
 {
 	int i,count=0;
 
-	for (i=0;i<=Highest_object_index;i++)
+	for (i=obj_first_used();i!=-1;i=obj_next_used(i))
 		if (Objects[i].type==type && Objects[i].id==id)
 			count++;
 	return (count);
@@ -932,7 +934,7 @@ void init_objects()
 	num_objects = 1;						//just the player
 	Highest_object_index = 0;
 
-	
+	obj_update_used();
 }
 
 //after calling init_object(), the network code has grabbed specific
@@ -953,6 +955,18 @@ void special_reset_objects(void)
 		else
 			if (i > Highest_object_index)
 				Highest_object_index = i;
+
+	obj_update_used();
+}
+
+void obj_update_used(void)
+{
+	int i;
+
+	memset(Objects_used, 0, sizeof(Objects_used));
+	for (i=0; i<MAX_OBJECTS; i++)
+		if (Objects[i].type != OBJ_NONE)
+			Objects_used[i >> 5] |= 1u << (i & 31);
 }
 
 #ifndef NDEBUG
@@ -1162,6 +1176,7 @@ int obj_allocate(void)
 	}
 
 	objnum = free_obj_list[num_objects++];
+	Objects_used[objnum >> 5] |= 1u << (objnum & 31);
 
 	if (objnum > Highest_object_index) {
 		Highest_object_index = objnum;
@@ -1186,6 +1201,7 @@ void obj_free(int objnum)
 {
 	free_obj_list[--num_objects] = objnum;
 	Assert(num_objects >= 0);
+	Objects_used[objnum >> 5] &= ~(1u << (objnum & 31));
 
 	if (objnum == Highest_object_index)
 		while (Objects[--Highest_object_index].type == OBJ_NONE);
@@ -1812,10 +1828,8 @@ void obj_delete_all_that_should_be_dead()
 	object *objp;
 	int		local_dead_player_object=-1;
 
-	// Move all objects
-	objp = Objects;
-
-	for (i=0;i<=Highest_object_index;i++) {
+	for (i=obj_first_used();i!=-1;i=obj_next_used(i)) {
+		objp = &Objects[i];
 		if ((objp->type!=OBJ_NONE) && (objp->flags&OF_SHOULD_BE_DEAD) )	{
 			Assert(!(objp->type==OBJ_FIREBALL && objp->ctype.expl_info.delete_time!=-1));
 			if (objp->type==OBJ_PLAYER) {
@@ -1832,7 +1846,6 @@ void obj_delete_all_that_should_be_dead()
 				obj_delete(i);
 			}
 		}
-		objp++;
 	}
 }
 
@@ -2162,6 +2175,8 @@ void object_move_all()
 	int i;
 	object *objp;
 
+	PROFILE_BEGIN("object_move_all");
+
 	if (Highest_object_index > MAX_USED_OBJECTS)
 		free_object_slots(MAX_USED_OBJECTS);		//	Free all possible object slots.
 
@@ -2172,8 +2187,7 @@ void object_move_all()
 	else
 		ConsoleObject->mtype.phys_info.flags &= ~PF_LEVELLING;
 
-	// Move all objects
-	objp = Objects;
+	ai_begin_frame();
 
  	// CED -- If a homer frame is owed, run it and take the time off the counter
  	idealHomerFrameTime = F1_0/idealHomerFPS; 
@@ -2192,12 +2206,13 @@ void object_move_all()
     	currentHomerFrameTime = idealHomerFrameTime*3; 
     }
 
+	// Move all objects
 	#ifndef DEMO_ONLY
-	for (i=0;i<=Highest_object_index;i++) {
+	for (i=obj_first_used();i!=-1;i=obj_next_used(i)) {
+		objp = &Objects[i];
 		if ( (objp->type != OBJ_NONE) && (!(objp->flags&OF_SHOULD_BE_DEAD)) )	{
 			object_move_one( objp );
 		}
-		objp++;
 	}
 	#else
 		i=0;	//kill warning
@@ -2206,6 +2221,7 @@ void object_move_all()
 //	check_duplicate_objects();
 //	remove_incorrect_objects();
 
+	PROFILE_END();
 }
 
 
@@ -2280,6 +2296,8 @@ void reset_objects(int n_objs)
 
 	Highest_object_index = num_objects-1;
 
+	obj_update_used();
+
 	Debris_object_count = 0;
 }
 
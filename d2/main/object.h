@@ -397,6 +397,37 @@ extern object Objects[];
 extern int Highest_object_index;    // highest objnum
 extern int num_objects;
 
+// One bit per object slot in use, set by obj_allocate() and cleared by
+// obj_free(). Loops over all objects step through the used slots with
+// obj_first_used()/obj_next_used(), which skip 32 empty slots at a time.
+// A slot whose bit is set can still be OBJ_NONE, so loops check the type.
+extern u_int32_t Objects_used[(MAX_OBJECTS+31)/32];
+
+// Returns the first used slot after objnum, or -1. Slots used while a loop
+// runs are visited if they come after the current one, as with a loop over
+// every slot up to Highest_object_index.
+static inline int obj_next_used(int objnum)
+{
+	u_int32_t bits;
+
+	for (objnum++; objnum <= Highest_object_index; objnum = (objnum | 31) + 1)
+		if ((bits = Objects_used[objnum >> 5] >> (objnum & 31)) != 0) {
+			while (!(bits & 1)) {
+				bits >>= 1;
+				objnum++;
+			}
+			return objnum <= Highest_object_index ? objnum : -1;
+		}
+
+	return -1;
+}
+
+#define obj_first_used() obj_next_used(-1)
+
+// Sets the bits of Objects_used from the object types, for code that fills
+// in Objects[] directly.
+void obj_update_used(void);
+
 extern char *robot_names[];         // name of each robot
 
 extern int Num_robot_types;
@@ -51,6 +51,8 @@ COPYRIGHT 1993-1999 PARALLAX SOFTWARE CORPORATION.  ALL RIGHTS RESERVED.
 #include "byteswap.h"
 #include "makesig.h"
 #include "console.h"
+#include "texmap.h"
+#include "profile.h"
 
 //#define NO_DUMP_SOUNDS        1   //if set, dump bitmaps but not sounds
 
@@ -184,6 +186,34 @@ void DiskBitmapHeader_d1_read(DiskBitmapHeader *dbh, PHYSFS_file *fp)
 	dbh->offset = PHYSFSX_readInt(fp);
 }
 
+/*
+ * reads a DiskBitmapHeader structure from mapped data
+ */
+static void DiskBitmapHeader_read_mem(DiskBitmapHeader *dbh, const ubyte **p)
+{
+	memcpy(dbh->name, *p, 8);
+	*p += 8;
+	dbh->dflags = PHYSFSX_memReadByte(p);
+	dbh->width = PHYSFSX_memReadByte(p);
+	dbh->height = PHYSFSX_memReadByte(p);
+	dbh->wh_extra = PHYSFSX_memReadByte(p);
+	dbh->flags = PHYSFSX_memReadByte(p);
+	dbh->avg_color = PHYSFSX_memReadByte(p);
+	dbh->offset = PHYSFSX_memReadInt(p);
+}
+
+/*
+ * reads a DiskSoundHeader structure from mapped data
+ */
+static void DiskSoundHeader_read_mem(DiskSoundHeader *dsh, const ubyte **p)
+{
+	memcpy(dsh->name, *p, 8);
+	*p += 8;
+	dsh->length = PHYSFSX_memReadInt(p);
+	dsh->data_length = PHYSFSX_memReadInt(p);
+	dsh->offset = PHYSFSX_memReadInt(p);
+}
+
 int piggy_is_substitutable_bitmap( char * name, char * subst_name );
 
 #ifdef EDITOR
@@ -316,14 +346,23 @@ int piggy_find_sound( char * name )
 }
 
 PHYSFS_file * Piggy_fp = NULL;
+PHYSFSX_map * Piggy_map = NULL;		// the pigfile mapped into memory when it could be, Piggy_fp is NULL then
 
 char Current_pigfile[FILENAME_LEN] = "";
 
-void piggy_close_file()
+static void piggy_close_pig()
 {
-	if ( Piggy_fp ) {
+	if ( Piggy_fp )
 		PHYSFS_close( Piggy_fp );
-		Piggy_fp        = NULL;
+	PHYSFSX_closeMapped( Piggy_map );
+	Piggy_fp        = NULL;
+	Piggy_map       = NULL;
+}
+
+void piggy_close_file()
+{
+	if ( Piggy_fp || Piggy_map ) {
+		piggy_close_pig();
 		Current_pigfile[0] = 0;
 	}
 }
@@ -393,6 +432,83 @@ PHYSFS_file *copy_pigfile_from_cd(char *filename)
 	return PHYSFSX_openReadBuffered(filename);
 }
 
+static int piggy_pig_size()
+{
+	return Piggy_map ? Piggy_map->size : PHYSFS_fileLength(Piggy_fp);
+}
+
+static PHYSFSX_map *piggy_map_pig(char *filename)
+{
+#ifdef EDITOR
+	return NULL;	//the editor rewrites the pigfile from the bitmaps paged in from it, which can't be mapped from it then
+#else
+	return PHYSFSX_openMapped(filename);
+#endif
+}
+
+//open a pigfile, mapped into memory if possible, else through PhysFS
+//if it can't be opened, try the shareware pigfile, and make sure the one opened is valid and up-to-date
+static int piggy_open_pig(char *filename)
+{
+	int pig_id, pig_version;
+
+	if (!(Piggy_map = piggy_map_pig(filename)) && !(Piggy_fp = PHYSFSX_openReadBuffered(filename)))
+		if (!(Piggy_map = piggy_map_pig(DEFAULT_PIGFILE_SHAREWARE)))
+			Piggy_fp = PHYSFSX_openReadBuffered(DEFAULT_PIGFILE_SHAREWARE);
+
+	if (Piggy_map) {
+		const ubyte *p = Piggy_map->data;
+
+		if (Piggy_map->size < 12) {
+			piggy_close_pig();
+			return 0;
+		}
+		pig_id = PHYSFSX_memReadInt(&p);
+		pig_version = PHYSFSX_memReadInt(&p);
+	} else if (Piggy_fp) {
+		pig_id = PHYSFSX_readInt(Piggy_fp);
+		pig_version = PHYSFSX_readInt(Piggy_fp);
+	} else
+		return 0;
+
+	if (pig_id != PIGFILE_ID || pig_version != PIGFILE_VERSION) {
+		piggy_close_pig();              //out of date pig
+		return 0;                       //..so pretend it's not here
+	}
+
+	return 1;
+}
+
+//read the number of bitmaps in the open pigfile and return the table of bitmap headers after it, in place if the
+//pigfile is mapped, else read into *buf, which the caller must free.  *data_start is set to where the bitmaps start.
+static const ubyte *piggy_read_bitmap_headers(int *n_bitmaps, int *data_start, ubyte **buf)
+{
+	const ubyte *p;
+	int header_size;
+
+	*buf = NULL;
+
+	if (Piggy_map) {
+		p = Piggy_map->data + 8;
+		*n_bitmaps = PHYSFSX_memReadInt(&p);
+		header_size = *n_bitmaps * sizeof(DiskBitmapHeader);
+		*data_start = header_size + (p - Piggy_map->data);
+		if (*n_bitmaps < 0 || *data_start > Piggy_map->size)
+			Error("Pigfile <%s> is corrupt", Current_pigfile);
+		return p;
+	}
+
+	*n_bitmaps = PHYSFSX_readInt(Piggy_fp);
+	header_size = *n_bitmaps * sizeof(DiskBitmapHeader);
+	*data_start = header_size + PHYSFS_tell(Piggy_fp);
+
+	MALLOC(*buf, ubyte, header_size + 1);
+	if (PHYSFS_read(Piggy_fp, *buf, 1, header_size) != header_size)
+		Error("Pigfile <%s> is corrupt", Current_pigfile);
+
+	return *buf;
+}
+
 //initialize a pigfile, reading headers
 //returns the size of all the bitmap data
 void piggy_init_pigfile(char *filename)
@@ -401,31 +517,16 @@ void piggy_init_pigfile(char *filename)
 	char temp_name[16];
 	char temp_name_read[16];
 	DiskBitmapHeader bmh;
-	int header_size, N_bitmaps, data_start;
+	int N_bitmaps, data_start;
+	const ubyte *headers;
+	ubyte *header_buf;
 #ifdef EDITOR
 	int data_size;
 #endif
 
 	piggy_close_file();             //close old pig if still open
 
-	Piggy_fp = PHYSFSX_openReadBuffered(filename);
-	
-	//try pigfile for shareware
-	if (!Piggy_fp)
-		Piggy_fp = PHYSFSX_openReadBuffered(DEFAULT_PIGFILE_SHAREWARE);
-
-	if (Piggy_fp) {                         //make sure pig is valid type file & is up-to-date
-		int pig_id,pig_version;
-
-		pig_id = PHYSFSX_readInt(Piggy_fp);
-		pig_version = PHYSFSX_readInt(Piggy_fp);
-		if (pig_id != PIGFILE_ID || pig_version != PIGFILE_VERSION) {
-			PHYSFS_close(Piggy_fp);              //out of date pig
-			Piggy_fp = NULL;                        //..so pretend it's not here
-		}
-	}
-
-	if (!Piggy_fp) {
+	if (!piggy_open_pig(filename)) {
 
 		#ifdef EDITOR
 			return;         //if editor, ok to not have pig, because we'll build one
@@ -436,13 +537,9 @@ void piggy_init_pigfile(char *filename)
 
 	strncpy(Current_pigfile,filename,sizeof(Current_pigfile));
 
-	N_bitmaps = PHYSFSX_readInt(Piggy_fp);
-
-	header_size = N_bitmaps * sizeof(DiskBitmapHeader);
-
-	data_start = header_size + PHYSFS_tell(Piggy_fp);
+	headers = piggy_read_bitmap_headers(&N_bitmaps, &data_start, &header_buf);
 #ifdef EDITOR
-	data_size = PHYSFS_fileLength(Piggy_fp) - data_start;
+	data_size = piggy_pig_size() - data_start;
 #endif
 	Num_bitmap_files = 1;
 
@@ -451,7 +548,7 @@ void piggy_init_pigfile(char *filename)
 		int width;
 		grs_bitmap *bm = &GameBitmaps[i + 1];
 		
-		DiskBitmapHeader_read(&bmh, Piggy_fp);
+		DiskBitmapHeader_read_mem(&bmh, &headers);
 		memcpy( temp_name_read, bmh.name, 8 );
 		temp_name_read[8] = 0;
 		if ( bmh.dflags & DBM_FLAG_ABM )        
@@ -470,6 +567,9 @@ void piggy_init_pigfile(char *filename)
 		piggy_register_bitmap(bm, temp_name, 1);
 	}
 
+	if (header_buf)
+		d_free(header_buf);
+
 #ifdef EDITOR
 	Piggy_bitmap_cache_size = data_size + (data_size/10);   //extra mem for new bitmaps
 	Assert( Piggy_bitmap_cache_size > 0 );
@@ -501,7 +601,9 @@ void piggy_new_pigfile(char *pigname)
 	char temp_name[16];
 	char temp_name_read[16];
 	DiskBitmapHeader bmh;
-	int header_size, N_bitmaps, data_start;
+	int N_bitmaps, data_start;
+	const ubyte *headers;
+	ubyte *header_buf;
 #ifdef EDITOR
 	int must_rewrite_pig = 0;
 #endif
@@ -523,42 +625,23 @@ void piggy_new_pigfile(char *pigname)
 
 	strncpy(Current_pigfile,pigname,sizeof(Current_pigfile));
 
-	Piggy_fp = PHYSFSX_openReadBuffered(pigname);
-
-	//try pigfile for shareware
-	if (!Piggy_fp)
-		Piggy_fp = PHYSFSX_openReadBuffered(DEFAULT_PIGFILE_SHAREWARE);
-	
-	if (Piggy_fp) {  //make sure pig is valid type file & is up-to-date
-		int pig_id,pig_version;
-
-		pig_id = PHYSFSX_readInt(Piggy_fp);
-		pig_version = PHYSFSX_readInt(Piggy_fp);
-		if (pig_id != PIGFILE_ID || pig_version != PIGFILE_VERSION) {
-			PHYSFS_close(Piggy_fp);              //out of date pig
-			Piggy_fp = NULL;                        //..so pretend it's not here
-		}
-	}
+	piggy_open_pig(pigname);
 
 #ifndef EDITOR
-	if (!Piggy_fp)
+	if (!Piggy_fp && !Piggy_map)
 		Error("Cannot open correct version of <%s>", pigname);
 #endif
 
-	if (Piggy_fp) {
-
-		N_bitmaps = PHYSFSX_readInt(Piggy_fp);
-
-		header_size = N_bitmaps * sizeof(DiskBitmapHeader);
+	if (Piggy_fp || Piggy_map) {
 
-		data_start = header_size + PHYSFS_tell(Piggy_fp);
+		headers = piggy_read_bitmap_headers(&N_bitmaps, &data_start, &header_buf);
 
 		for (i=1; i<=N_bitmaps; i++ )
 		{
 			grs_bitmap *bm = &GameBitmaps[i];
 			int width;
 			
-			DiskBitmapHeader_read(&bmh, Piggy_fp);
+			DiskBitmapHeader_read_mem(&bmh, &headers);
 			memcpy( temp_name_read, bmh.name, 8 );
 			temp_name_read[8] = 0;
 	
@@ -587,6 +670,9 @@ void piggy_new_pigfile(char *pigname)
 	
 			GameBitmapOffset[i] = bmh.offset + data_start;
 		}
+
+		if (header_buf)
+			d_free(header_buf);
 	}
 	else
 		N_bitmaps = 0;          //no pigfile, so no bitmaps
@@ -750,20 +836,73 @@ digi_sound bogus_sound;
 
 int piggy_is_needed(int soundnum);
 
+//register the sounds of a table of n_sounds sound headers, which starts at sound_start in its file, and make room
+//for the ones needed in SoundBits
+static void piggy_register_sounds(const ubyte *headers, int n_sounds, int sound_start)
+{
+	int header_size = n_sounds * sizeof(DiskSoundHeader);
+	int i, sbytes = 0;
+	DiskSoundHeader sndh;
+	digi_sound temp_sound;
+	char temp_name_read[16];
+
+	for (i=0; i<n_sounds; i++ ) {
+		DiskSoundHeader_read_mem(&sndh, &headers);
+		temp_sound.length = sndh.length;
+		temp_sound.data = (ubyte *)(size_t)(sndh.offset + header_size + sound_start);
+		SoundOffset[Num_sound_files] = sndh.offset + header_size + sound_start;
+		memcpy( temp_name_read, sndh.name, 8 );
+		temp_name_read[8] = 0;
+		piggy_register_sound( &temp_sound, temp_name_read, 1 );
+		if (piggy_is_needed(i))
+			sbytes += sndh.length;
+	}
+
+	SoundBits = d_malloc( sbytes + 16 );
+	if ( SoundBits == NULL )
+		Error( "Not enough memory to load sounds\n" );
+}
+
+//read a table of n_sounds sound headers at the current position of fp, or in place if the file is mapped too
+static void piggy_read_sound_headers(PHYSFS_file *fp, PHYSFSX_map *map, int n_sounds)
+{
+	int sound_start = PHYSFS_tell(fp);
+	int header_size = n_sounds * sizeof(DiskSoundHeader);
+	ubyte *buf;
+
+	if (n_sounds < 0)
+		Error("Sound file is corrupt");
+
+	if (map && sound_start + header_size <= map->size) {
+		piggy_register_sounds(map->data + sound_start, n_sounds, sound_start);
+		return;
+	}
+
+	MALLOC(buf, ubyte, header_size + 1);
+	if (PHYSFS_read(fp, buf, 1, header_size) != header_size)
+		Error("Sound file is corrupt");
+	piggy_register_sounds(buf, n_sounds, sound_start);
+	d_free(buf);
+}
+
 int read_hamfile()
 {
 	PHYSFS_file * ham_fp = NULL;
+	PHYSFSX_map * ham_map = NULL;
 	int ham_id;
 	int sound_offset = 0;
 	int shareware = 0;
 
 	ham_fp = PHYSFSX_openReadBuffered(DEFAULT_HAMFILE_REGISTERED);
+	if (ham_fp)
+		ham_map = PHYSFSX_openMapped(DEFAULT_HAMFILE_REGISTERED);
 	
 	if (!ham_fp)
 	{
 		ham_fp = PHYSFSX_openReadBuffered(DEFAULT_HAMFILE_SHAREWARE);
 		if (ham_fp)
 		{
+			ham_map = PHYSFSX_openMapped(DEFAULT_HAMFILE_SHAREWARE);
 			shareware = 1;
 			GameArg.SndDigiSampleRate = SAMPLE_RATE_11K;
 #ifdef USE_SDLMIXER
@@ -812,29 +951,33 @@ int read_hamfile()
 
 		bm_read_all(ham_fp);
 		//PHYSFS_read( ham_fp, GameBitmapXlat, sizeof(ushort)*MAX_BITMAP_FILES, 1 );
-		for (i = 0; i < MAX_BITMAP_FILES; i++)
+		if (ham_map)
 		{
-			GameBitmapXlat[i] = PHYSFSX_readShort(ham_fp);
-			if (PHYSFS_eof(ham_fp))
-				break;
+			const ubyte *p = ham_map->data + PHYSFS_tell(ham_fp), *end = ham_map->data + ham_map->size;
+
+			for (i = 0; i < MAX_BITMAP_FILES && p + 2 <= end; i++)
+				GameBitmapXlat[i] = PHYSFSX_memReadShort(&p);
+		}
+		else
+		{
+			for (i = 0; i < MAX_BITMAP_FILES; i++)
+			{
+				GameBitmapXlat[i] = PHYSFSX_readShort(ham_fp);
+				if (PHYSFS_eof(ham_fp))
+					break;
+			}
 		}
 	}
 	#endif
 
 	if (Piggy_hamfile_version < 3) {
 		int N_sounds;
-		int sound_start;
-		int header_size;
-		int i;
-		DiskSoundHeader sndh;
-		digi_sound temp_sound;
-		char temp_name_read[16];
-		int sbytes = 0;
 		static int justonce = 1;
 
 		if (!justonce)
 		{
 			PHYSFS_close(ham_fp);
+			PHYSFSX_closeMapped(ham_map);
 			return 1;
 		}
 		justonce = 0;
@@ -842,30 +985,12 @@ int read_hamfile()
 		PHYSFSX_fseek(ham_fp, sound_offset, SEEK_SET);
 		N_sounds = PHYSFSX_readInt(ham_fp);
 
-		sound_start = PHYSFS_tell(ham_fp);
-
-		header_size = N_sounds * sizeof(DiskSoundHeader);
-
 		//Read sounds
-
-		for (i=0; i<N_sounds; i++ ) {
-			DiskSoundHeader_read(&sndh, ham_fp);
-			temp_sound.length = sndh.length;
-			temp_sound.data = (ubyte *)(size_t)(sndh.offset + header_size + sound_start);
-			SoundOffset[Num_sound_files] = sndh.offset + header_size + sound_start;
-			memcpy( temp_name_read, sndh.name, 8 );
-			temp_name_read[8] = 0;
-			piggy_register_sound( &temp_sound, temp_name_read, 1 );
-			if (piggy_is_needed(i))
-				sbytes += sndh.length;
-		}
-
-		SoundBits = d_malloc( sbytes + 16 );
-		if ( SoundBits == NULL )
-			Error( "Not enough memory to load sounds\n" );
+		piggy_read_sound_headers(ham_fp, ham_map, N_sounds);
 	}
 
 	PHYSFS_close(ham_fp);
+	PHYSFSX_closeMapped(ham_map);
 
 	return 1;
 
@@ -874,15 +999,31 @@ int read_hamfile()
 int read_sndfile()
 {
 	PHYSFS_file * snd_fp = NULL;
+	PHYSFSX_map * snd_map = NULL;
 	int snd_id,snd_version;
 	int N_sounds;
-	int sound_start;
-	int header_size;
-	int i;
-	DiskSoundHeader sndh;
-	digi_sound temp_sound;
-	char temp_name_read[16];
-	int sbytes = 0;
+
+	//read the headers in place if the sound file can be mapped, there's no need to buffer all of it then
+	snd_map = PHYSFSX_openMapped(DEFAULT_SNDFILE);
+	if (snd_map && snd_map->size >= 12) {
+		const ubyte *p = snd_map->data;
+
+		snd_id = PHYSFSX_memReadInt(&p);
+		snd_version = PHYSFSX_memReadInt(&p);
+		N_sounds = PHYSFSX_memReadInt(&p);
+		if (snd_id != SNDFILE_ID || snd_version != SNDFILE_VERSION) {
+			PHYSFSX_closeMapped(snd_map);				//out of date sound file
+			return 0;
+		}
+		if (N_sounds < 0 || 12 + N_sounds * sizeof(DiskSoundHeader) > snd_map->size)
+			Error("Sound file %s is corrupt", DEFAULT_SNDFILE);
+
+		piggy_register_sounds(p, N_sounds, 12);
+		PHYSFSX_closeMapped(snd_map);
+
+		return 1;
+	}
+	PHYSFSX_closeMapped(snd_map);
 
 	snd_fp = PHYSFSX_openReadBuffered(DEFAULT_SNDFILE);
 	
@@ -899,26 +1040,8 @@ int read_sndfile()
 
 	N_sounds = PHYSFSX_readInt(snd_fp);
 
-	sound_start = PHYSFS_tell(snd_fp);
-	header_size = N_sounds*sizeof(DiskSoundHeader);
-
 	//Read sounds
-
-	for (i=0; i<N_sounds; i++ ) {
-		DiskSoundHeader_read(&sndh, snd_fp);
-		temp_sound.length = sndh.length;
-		temp_sound.data = (ubyte *)(size_t)(sndh.offset + header_size + sound_start);
-		SoundOffset[Num_sound_files] = sndh.offset + header_size + sound_start;
-		memcpy( temp_name_read, sndh.name, 8 );
-		temp_name_read[8] = 0;
-		piggy_register_sound( &temp_sound, temp_name_read, 1 );
-		if (piggy_is_needed(i))
-			sbytes += sndh.length;
-	}
-
-	SoundBits = d_malloc( sbytes + 16 );
-	if ( SoundBits == NULL )
-		Error( "Not enough memory to load sounds\n" );
+	piggy_read_sound_headers(snd_fp, NULL, N_sounds);
 
 	PHYSFS_close(snd_fp);
 
@@ -991,12 +1114,37 @@ int piggy_is_needed(int soundnum)
 void piggy_read_sounds(void)
 {
 	PHYSFS_file * fp = NULL;
+	PHYSFSX_map * map = NULL;
 	ubyte * ptr;
 	int i, sbytes;
 
 	ptr = SoundBits;
 	sbytes = 0;
 
+	//copy the sounds straight out of the sound file if it can be mapped
+	map = PHYSFSX_openMapped(DEFAULT_SNDFILE);
+	if (map) {
+		for (i=0; i<Num_sound_files; i++ )      {
+			digi_sound *snd = &GameSounds[i];
+
+			if ( SoundOffset[i] > 0 )       {
+				if ( piggy_is_needed(i) )       {
+					if (SoundOffset[i] + snd->length > map->size)
+						Error("Sound %d is past the end of %s", i, DEFAULT_SNDFILE);
+					snd->data = ptr;
+					ptr += snd->length;
+					sbytes += snd->length;
+					memcpy( snd->data, map->data + SoundOffset[i], snd->length );
+				}
+				else
+					snd->data = (ubyte *) -1;
+			}
+		}
+
+		PHYSFSX_closeMapped(map);
+		return;
+	}
+
 	fp = PHYSFSX_openReadBuffered(DEFAULT_SNDFILE);
 
 	if (fp == NULL)
@@ -1048,6 +1196,68 @@ void piggy_critical_error()
 	grd_curcanv->cv_font = save_font;
 }
 
+//Mac pigfiles have colors 0 and 255 swapped
+static int piggy_is_mac_pig(int pigsize)
+{
+#ifndef MACDATA
+	switch (pigsize) {
+	default:
+		if (!GameArg.EdiMacData)
+			break;
+		// otherwise, fall through...
+	case MAC_ALIEN1_PIGSIZE:
+	case MAC_ALIEN2_PIGSIZE:
+	case MAC_FIRE_PIGSIZE:
+	case MAC_GROUPA_PIGSIZE:
+	case MAC_ICE_PIGSIZE:
+	case MAC_WATER_PIGSIZE:
+		return 1;
+	}
+#endif
+	return 0;
+}
+
+//page in a bitmap from a mapped pigfile.  The pigfile holds bitmaps just as they are kept in memory, so they're
+//used right where they are mapped, unless their colors need swapping, which is done on a copy in the bitmap cache.
+static void piggy_bitmap_page_in_mapped(grs_bitmap *bmp, int i)
+{
+	ubyte *data = Piggy_map->data + GameBitmapOffset[i];
+	int size;
+
+	if (GameBitmapFlags[i] & BM_FLAG_RLE) {
+		if (GameBitmapOffset[i] + 4 > Piggy_map->size)
+			Error("Bitmap %s is past the end of <%s>", AllBitmaps[i].name, Current_pigfile);
+		memcpy(&size, data, 4);
+		size = INTEL_INT(size);
+	} else
+		size = bmp->bm_h*bmp->bm_w;
+
+	if (size < 0 || GameBitmapOffset[i] + size > Piggy_map->size)
+		Error("Bitmap %s is past the end of <%s>", AllBitmaps[i].name, Current_pigfile);
+
+	if (!piggy_is_mac_pig(Piggy_map->size)) {
+		gr_set_bitmap_flags(bmp, GameBitmapFlags[i]);
+		gr_set_bitmap_data(bmp, data);
+		return;
+	}
+
+	if ( Piggy_bitmap_cache_next+size >= Piggy_bitmap_cache_size )
+		piggy_bitmap_page_out_all();
+
+	memcpy(&Piggy_bitmap_cache_data[Piggy_bitmap_cache_next], data, size);
+	gr_set_bitmap_flags(bmp, GameBitmapFlags[i]);
+	gr_set_bitmap_data(bmp, &Piggy_bitmap_cache_data[Piggy_bitmap_cache_next]);
+
+	if ( bmp->bm_flags & BM_FLAG_RLE ) {
+		rle_swap_0_255( bmp );
+		memcpy(&size, bmp->bm_data, 4);
+		size = INTEL_INT(size);
+	} else
+		swap_0_255( bmp );
+
+	Piggy_bitmap_cache_next += size;
+}
+
 void piggy_bitmap_page_in( bitmap_index bitmap )
 {
 	grs_bitmap * bmp;
@@ -1067,6 +1277,8 @@ void piggy_bitmap_page_in( bitmap_index bitmap )
 
 	if ( GameBitmapOffset[i] == 0 ) return;		// A read-from-disk bitmap!!!
 
+	PROFILE_BEGIN("piggy_bitmap_page_in");
+
 	if ( GameArg.SysLowMem ) {
 		org_i = i;
 		i = GameBitmapXlat[i];          // Xlat for low-memory settings!
@@ -1077,6 +1289,11 @@ void piggy_bitmap_page_in( bitmap_index bitmap )
 	if ( bmp->bm_flags & BM_FLAG_PAGED_OUT ) {
 		stop_time();
 
+		if ( Piggy_map ) {
+			piggy_bitmap_page_in_mapped( bmp, i );
+			goto PagedIn;
+		}
+
 	ReDoIt:
 		descent_critical_error = 0;
 		PHYSFSX_fseek( Piggy_fp, GameBitmapOffset[i], SEEK_SET );
@@ -1190,6 +1407,7 @@ void piggy_bitmap_page_in( bitmap_index bitmap )
 		//@@#endif
 		//@@}
 
+	PagedIn:
 		compute_average_rgb(bmp, bmp->avg_color_rgb);
 
 		start_time();
@@ -1208,12 +1426,17 @@ void piggy_bitmap_page_in( bitmap_index bitmap )
 //@@    }
 //@@#endif
 
+	PROFILE_END();
 }
 
 void piggy_bitmap_page_out_all()
 {
 	int i;
-	
+
+#ifndef OGL
+	tmap_bin_flush();	// queued polygons still point into the cache
+#endif
+
 	Piggy_bitmap_cache_next = 0;
 
 	piggy_page_flushed++;
@@ -75,6 +75,7 @@ char* piggy_game_bitmap_name(grs_bitmap *bmp);
 #define MAX_SOUND_FILES     MAX_SOUNDS
 
 extern digi_sound GameSounds[MAX_SOUND_FILES];
+extern int Num_sound_files;
 extern grs_bitmap GameBitmaps[MAX_BITMAP_FILES];
 
 
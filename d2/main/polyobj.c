@@ -51,6 +51,10 @@ int N_polygon_models = 0;
 
 g3s_point robot_points[MAX_POLYGON_VECS];
 
+// compiled draw lists of the models.  kept out of polymodel, which is also
+// the layout of the models in the ham files
+static g3s_model_list *Polygon_model_lists[MAX_POLYGON_MODELS];
+
 #define PM_COMPATIBLE_VERSION 6
 #define PM_OBJFILE_VERSION 8
 
@@ -500,9 +504,28 @@ int read_model_guns(char *filename,vms_vector *gun_points, vms_vector *gun_dirs,
 	return n_guns;
 }
 
+//compile the draw list of a model once its data is loaded
+static void compile_model(polymodel *po)
+{
+	int model_num = po - Polygon_models;
+
+	Assert(model_num >= 0 && model_num < MAX_POLYGON_MODELS);
+
+	if (Polygon_model_lists[model_num])
+		g3_free_compiled_model(Polygon_model_lists[model_num]);
+	Polygon_model_lists[model_num] = g3_compile_polygon_model(po->model_data);
+}
+
 //free up a model, getting rid of all its memory
 void free_model(polymodel *po)
 {
+	int model_num = po - Polygon_models;
+
+	if (model_num >= 0 && model_num < MAX_POLYGON_MODELS && Polygon_model_lists[model_num]) {
+		g3_free_compiled_model(Polygon_model_lists[model_num]);
+		Polygon_model_lists[model_num] = NULL;
+	}
+
 	d_free(po->model_data);
 }
 
@@ -521,6 +544,7 @@ int alt_textures_to_ship_color(bitmap_index alt_textures[]) {
 void draw_polygon_model(vms_vector *pos,vms_matrix *orient,vms_angvec *anim_angles,int model_num,int flags,g3s_lrgb light,fix *glow_values,bitmap_index alt_textures[])
 {
 	polymodel *po;
+	g3s_model_list *ml;
 	int i;
 
 	if (model_num < 0)
@@ -585,10 +609,12 @@ void draw_polygon_model(vms_vector *pos,vms_matrix *orient,vms_angvec *anim_angl
 
 	g3_set_interp_points(robot_points);
 
-	if (flags == 0)		//draw entire object
-
-		g3_draw_polygon_model(po->model_data,texture_list,anim_angles,light,glow_values);
+	ml = Polygon_model_lists[po - Polygon_models];
 
+	if (flags == 0) {		//draw entire object
+		if (!ml || !g3_draw_compiled_model(ml,0,texture_list,anim_angles,light,glow_values))
+			g3_draw_polygon_model(po->model_data,texture_list,anim_angles,light,glow_values);
+	}
 	else {
 		int i;
 	
@@ -604,7 +630,8 @@ void draw_polygon_model(vms_vector *pos,vms_matrix *orient,vms_angvec *anim_angl
 				vm_vec_negate(&ofs);
 				g3_start_instance_matrix(&ofs,NULL);
 	
-				g3_draw_polygon_model(&po->model_data[po->submodel_ptrs[i]],texture_list,anim_angles,light,glow_values);
+				if (!ml || !g3_draw_compiled_model(ml,po->submodel_ptrs[i],texture_list,anim_angles,light,glow_values))
+					g3_draw_polygon_model(&po->model_data[po->submodel_ptrs[i]],texture_list,anim_angles,light,glow_values);
 	
 				g3_done_instance();
 			}	
@@ -707,6 +734,7 @@ int load_polygon_model(char *filename,int n_textures,grs_bitmap ***textures)
 	polyobj_find_min_max(&Polygon_models[N_polygon_models]);
 
 	g3_init_polygon_model(Polygon_models[N_polygon_models].model_data);
+	compile_model(&Polygon_models[N_polygon_models]);
 
 	if (highest_texture_num+1 != n_textures)
 		Error("Model <%s> references %d textures but specifies %d.",filename,highest_texture_num+1,n_textures);
@@ -845,4 +873,5 @@ void polygon_model_data_read(polymodel *pm, PHYSFS_file *fp)
 #endif
 	//verify(pm->model_data);
 	g3_init_polygon_model(pm->model_data);
+	compile_model(pm);
 }
@@ -56,6 +56,8 @@ COPYRIGHT 1993-1999 PARALLAX SOFTWARE CORPORATION.  ALL RIGHTS RESERVED.
 #endif
 #include "args.h"
 #include "race.h"
+#include "profile.h"
+#include "worker.h"
 
 #define INITIAL_LOCAL_LIGHT (F1_0/4)    // local light value in segment of occurence (of light emission)
 
@@ -80,8 +82,27 @@ int Max_debris_objects = 15; // How many debris objects to create
 int	Clear_window_color=-1;
 int	Clear_window=2;	// 1 = Clear whole background window, 2 = clear view portals into rest of world, 0 = no clear
 
-int framecount=-1;
-short Rotated_last[MAX_VERTICES];
+//Rotated points are kept per rendered window.  A window whose view did not change since it was
+//last drawn (a paused game, a still rear view or observer window) finds its points already rotated
+//and projected.  Segment_points and Rotated_last point at the cache of the window being drawn, a
+//point in it is rotated if its Rotated_last entry is framecount.
+typedef struct view_cache {
+	g3s_point		*points;
+	unsigned int	*rotated;
+	unsigned int	generation;			//framecount while this window is drawn
+	unsigned int	vertex_generation;	//Vertex_generation when the points were rotated
+	int				valid;				//key holds the view the points were rotated for
+	g3s_view_key	key;
+} view_cache;
+
+static g3s_point Segment_points_0[MAX_VERTICES];
+static unsigned int Rotated_last_0[MAX_VERTICES];
+static view_cache View_caches[MAX_RENDERED_WINDOWS] = { { Segment_points_0, Rotated_last_0 } };
+static unsigned int Vertex_generation = 0;
+
+unsigned int framecount=0;
+unsigned int *Rotated_last = Rotated_last_0;
+g3s_point *Segment_points = Segment_points_0;
 
 // When any render function needs to know what's looking at it, it should 
 // access Viewer members.
@@ -103,7 +124,7 @@ int	Bottom_bitmap_num = 9;
 #endif
 
 //Global vars for window clip test
-int Window_clip_left,Window_clip_top,Window_clip_right,Window_clip_bot;
+__thread_local__ int Window_clip_left,Window_clip_top,Window_clip_right,Window_clip_bot;
 
 #ifdef EDITOR
 int _search_mode = 0;			//true if looking for curseg,side,face
@@ -720,17 +741,125 @@ void do_render_object(int objnum, int window_num)
 
 }
 
+//drop the rotated points of all windows.  Call when Vertices change
+void reset_view_caches(void)
+{
+	int i;
+
+	Vertex_generation++;
+	for (i=0;i<MAX_RENDERED_WINDOWS;i++)
+		View_caches[i].valid = 0;
+}
+
+void free_view_caches(void)
+{
+	int i;
+
+	reset_view_caches();
+	for (i=1;i<MAX_RENDERED_WINDOWS;i++) {
+		if (View_caches[i].points)
+			d_free(View_caches[i].points);
+		if (View_caches[i].rotated)
+			d_free(View_caches[i].rotated);
+	}
+	Segment_points = Segment_points_0;
+	Rotated_last = Rotated_last_0;
+	framecount = View_caches[0].generation;
+}
+
+//pick the rotated points of window_num, and increment the counter for checking if they are
+//rotated unless its view did not change since it was drawn
+static void start_view(int window_num)
+{
+	g3s_view_key key;
+	view_cache *vc = &View_caches[window_num];
+	int reuse = !cheats.acid && !GameArg.SysLowMem;
+
+	#ifdef EDITOR
+	if (EditorWindow)
+		reuse = 0;		//the mine changes while it is edited
+	#endif
+
+	if (!vc->points) {		//first time this window is drawn
+		MALLOC(vc->points, g3s_point, MAX_VERTICES);
+		CALLOC(vc->rotated, unsigned int, MAX_VERTICES);
+		if (!vc->points || !vc->rotated) {
+			if (vc->points)
+				d_free(vc->points);
+			if (vc->rotated)
+				d_free(vc->rotated);
+			vc = &View_caches[0];
+			reuse = 0;
+		}
+	}
+
+	if (reuse && !g3_get_view_key(&key))
+		reuse = 0;		//called before the view was set
+
+	if (!reuse || !vc->valid || vc->vertex_generation != Vertex_generation || memcmp(&vc->key,&key,sizeof(key))) {
+
+		vc->generation++;
+
+		if (vc->generation==0) {		//wrap!
+
+			memset(vc->rotated,0,MAX_VERTICES*sizeof(*vc->rotated));		//clear all to zero
+			vc->generation=1;											//and set this frame to 1
+		}
+
+		if (reuse)
+			vc->key = key;
+		vc->valid = reuse;
+		vc->vertex_generation = Vertex_generation;
+	}
+
+	framecount = vc->generation;
+	Rotated_last = vc->rotated;
+	Segment_points = vc->points;
+}
+
 //increment counter for checking if points rotated
-//This must be called at the start of the frame if rotate_list() will be used
+//This must be called at the start of the frame if rotate_list() will be used, after the view is set
 void render_start_frame()
 {
-	framecount++;
+	start_view(0);
+}
 
-	if (framecount==0) {		//wrap!
+//rotate the points of pointnumlist that haven't been rotated this frame together
+static void rotate_new_points(int nv,const int *pointnumlist)
+{
+	g3s_point *dest[64];
+	const vms_vector *src[64];
+	int i,n=0;
 
-		memset(Rotated_last,0,sizeof(Rotated_last));		//clear all to zero
-		framecount=1;											//and set this frame to 1
+	for (i=0;i<nv;i++) {
+		int pnum = pointnumlist[i];
+
+		if (Rotated_last[pnum] != framecount) {
+			dest[n] = &Segment_points[pnum];
+			src[n] = &Vertices[pnum];
+			Rotated_last[pnum] = framecount;
+			if (++n == 64) {
+				g3_rotate_points(dest,src,n);
+				n = 0;
+			}
+		}
 	}
+
+	if (n)
+		g3_rotate_points(dest,src,n);
+}
+
+//rotate the points of all segments in the render list before they are drawn
+static void rotate_render_list()
+{
+	int i;
+
+	if (cheats.acid)
+		return;
+
+	for (i=0;i<N_render_segs;i++)
+		if (Render_list[i] != -1)
+			rotate_new_points(MAX_VERTICES_PER_SEGMENT,Segments[Render_list[i]].verts);
 }
 
 //Given a lit of point numbers, rotate any that haven't been rotated this frame
@@ -742,25 +871,23 @@ g3s_codes rotate_list(int nv,int *pointnumlist)
 
 	cc.uand = 0xff;  cc.uor = 0;
 
+	if (!cheats.acid)
+		rotate_new_points(nv,pointnumlist);
+
 	for (i=0;i<nv;i++) {
 
 		pnum = pointnumlist[i];
 
 		pnt = &Segment_points[pnum];
 
-		if (Rotated_last[pnum] != framecount)
+		if (Rotated_last[pnum] != framecount)		//only with cheats.acid, the others were rotated above
 		{
-			if (cheats.acid)
-			{
-				float f = (float) timer_query() / F1_0;
-				vms_vector tmpv = Vertices[pnum];
-				tmpv.x += fl2f(sinf(f * 2.0f + f2fl(tmpv.x)));
-				tmpv.y += fl2f(sinf(f * 3.0f + f2fl(tmpv.y)));
-				tmpv.z += fl2f(sinf(f * 5.0f + f2fl(tmpv.z)));
-				g3_rotate_point(pnt,&tmpv);
-			}
-			else
-				g3_rotate_point(pnt,&Vertices[pnum]);
+			float f = (float) timer_query() / F1_0;
+			vms_vector tmpv = Vertices[pnum];
+			tmpv.x += fl2f(sinf(f * 2.0f + f2fl(tmpv.x)));
+			tmpv.y += fl2f(sinf(f * 3.0f + f2fl(tmpv.y)));
+			tmpv.z += fl2f(sinf(f * 5.0f + f2fl(tmpv.z)));
+			g3_rotate_point(pnt,&tmpv);
 
 			Rotated_last[pnum] = framecount;
 		}
@@ -962,13 +1089,18 @@ int matt_find_connect_side(int seg0,int seg1);
 char visited2[MAX_SEGMENTS];
 #endif
 
-unsigned char visited[MAX_SEGMENTS];
+//a segment is visited (rendered in the current pass) if visited[segnum] == Visited_generation, so starting
+//a pass only bumps the generation instead of clearing the whole array
+unsigned int visited[MAX_SEGMENTS];
+unsigned int Visited_generation = 0;
 short Render_list[MAX_RENDER_SEGS];
 short Seg_depth[MAX_RENDER_SEGS];		//depth for each seg in Render_list
 ubyte processed[MAX_RENDER_SEGS];		//whether each entry has been processed
 int	lcnt_save,scnt_save;
 //@@short *persp_ptr;
 short render_pos[MAX_SEGMENTS];	//where in render_list does this segment appear?
+static unsigned int render_pos_generation[MAX_SEGMENTS];	//render_pos is valid if this is Render_pos_generation
+static unsigned int Render_pos_generation = 0;
 //ubyte no_render_flag[MAX_RENDER_SEGS];
 rect render_windows[MAX_RENDER_SEGS];
 
@@ -1611,6 +1743,8 @@ void render_frame(fix eye_offset, int window_num)
 		return;
 	}
 
+	PROFILE_BEGIN("render_frame");
+
 	if ( Newdemo_state == ND_STATE_RECORDING && eye_offset >= 0 )	{
      
       if (RenderingType==0)
@@ -1694,6 +1828,8 @@ void render_frame(fix eye_offset, int window_num)
 
 	g3_end_frame();
 
+	PROFILE_END();
+
    //RenderingType=0;
 
 	// -- Moved from here by MK, 05/17/95, wrong if multiple renders/frame! FrameCount++;		//we have rendered a frame
@@ -1710,6 +1846,293 @@ void update_rendered_data(int window_num, object *viewer, int rear_view_flag, in
 	Window_rendered_data[window_num].user = user;
 }
 
+//start a new rendering pass, in which no segment is visited yet
+void new_visited_generation(void)
+{
+	if (++Visited_generation == 0) {		//wrapped around, so old marks could match again
+		memset(visited, 0, sizeof(visited));
+		Visited_generation = 1;
+	}
+}
+
+static void new_render_pos_generation(void)
+{
+	if (++Render_pos_generation == 0) {
+		memset(render_pos_generation, 0, sizeof(render_pos_generation));
+		Render_pos_generation = 1;
+	}
+}
+
+#define RENDER_POS(segnum)		(render_pos_generation[segnum] == Render_pos_generation ? render_pos[segnum] : -1)
+#define SET_RENDER_POS(segnum, pos)	(render_pos_generation[segnum] = Render_pos_generation, render_pos[segnum] = (pos))
+
+//	-----------------------------------------------------------------------------------------------------------
+//	Potentially visible sets.  For every segment, the set of segments that can possibly be seen from a point
+//	inside it, so build_segment_list() does not have to project the portals of segments that cannot be seen.
+//	Any sight line out of a segment A that goes further than the neighbor N1 behind its side P1 leaves N1
+//	through some side P2, and from there on it stays on the side of P2 of every plane that separates P1 from
+//	P2.  So a segment is potentially visible from A if it is A, a neighbor of A, or can be reached from the
+//	neighbor behind P2 through portals that are not completely behind one of those planes.  This is only a
+//	superset of what can be seen, and every connection counts as open whatever its wall or door does, so the
+//	sets stay valid while doors open and walls are blown away, and also hold for observers who look through
+//	them.  The live wall state still limits the walk as before.
+//	The sets are built on a background task after a level is loaded and used once it is done.
+
+#define PVS_MAX_PLANES	32
+#define PVS_EPS		(1.0/1024)	//a vertex this close to a plane is on it
+#define PVS_CULL_EPS	1.0		//a portal is culled if it is this far behind a plane, to be safe from rounding
+
+typedef struct pvs_plane {
+	double	x, y, z, d;	//the side of the later portal is positive
+} pvs_plane;
+
+static unsigned int	*Pvs_bits = NULL;	//one row of Pvs_row_words words per segment
+static int		Pvs_row_words = 0, Pvs_num_segments = 0;
+static double		*Pvs_verts = NULL;	//Vertices as doubles, for the background task
+static short		*Pvs_children = NULL;	//per segment, the children and verts of Segments, so the task never
+static int		*Pvs_seg_verts = NULL;	//reads the mine, which the next level load overwrites
+static unsigned int	*Pvs_seen = NULL;	//per segment, the flood that last reached it
+static short		*Pvs_queue = NULL;
+static worker_task	*Pvs_task = NULL;
+static volatile int	Pvs_cancel = 0;
+static int		Pvs_ready = 0;
+
+#define PVS_TEST(row, segnum)	((row)[(segnum) >> 5] & (1u << ((segnum) & 31)))
+#define PVS_SET(row, segnum)	((row)[(segnum) >> 5] |= 1u << ((segnum) & 31))
+
+static double pvs_dist(const pvs_plane *pl, const double *v)
+{
+	return pl->x*v[0] + pl->y*v[1] + pl->z*v[2] + pl->d;
+}
+
+//	Add the plane through edge a-b and vertex c if it has all of from on its negative side and all of to on its
+//	positive side (or the other way around, then it is flipped).
+static void pvs_add_plane(pvs_plane *planes, int *n_planes, const double *a, const double *b, const double *c, const double **from, const double **to)
+{
+	pvs_plane	pl;
+	double		e[3], f[3], len, dist, max_dist = 0;
+	int		i, from_pos = 0, from_neg = 0, to_pos = 0, to_neg = 0;
+
+	if (*n_planes >= PVS_MAX_PLANES)
+		return;
+
+	e[0] = b[0]-a[0]; e[1] = b[1]-a[1]; e[2] = b[2]-a[2];
+	f[0] = c[0]-a[0]; f[1] = c[1]-a[1]; f[2] = c[2]-a[2];
+	pl.x = e[1]*f[2] - e[2]*f[1];
+	pl.y = e[2]*f[0] - e[0]*f[2];
+	pl.z = e[0]*f[1] - e[1]*f[0];
+	len = sqrt(pl.x*pl.x + pl.y*pl.y + pl.z*pl.z);
+	if (len < PVS_EPS)
+		return;		//degenerate
+	pl.x /= len; pl.y /= len; pl.z /= len;
+	pl.d = -(pl.x*a[0] + pl.y*a[1] + pl.z*a[2]);
+
+	for (i=0;i<4;i++) {
+		dist = pvs_dist(&pl, from[i]);
+		if (dist > PVS_EPS) from_pos = 1;
+		if (dist < -PVS_EPS) from_neg = 1;
+		if (fabs(dist) > max_dist) max_dist = fabs(dist);
+
+		dist = pvs_dist(&pl, to[i]);
+		if (dist > PVS_EPS) to_pos = 1;
+		if (dist < -PVS_EPS) to_neg = 1;
+		if (fabs(dist) > max_dist) max_dist = fabs(dist);
+	}
+
+	if (max_dist <= PVS_EPS)
+		return;		//both portals lie in the plane, it separates nothing
+
+	if (!from_pos && !to_neg)
+		planes[(*n_planes)++] = pl;
+	else if (!from_neg && !to_pos) {
+		pl.x = -pl.x; pl.y = -pl.y; pl.z = -pl.z; pl.d = -pl.d;
+		planes[(*n_planes)++] = pl;
+	}
+}
+
+static void pvs_side_verts(int segnum, int sidenum, const double **v)
+{
+	int	i;
+
+	for (i=0;i<4;i++)
+		v[i] = &Pvs_verts[Pvs_seg_verts[segnum*MAX_VERTICES_PER_SEGMENT + Side_to_verts[sidenum][i]] * 3];
+}
+
+//	Mark every segment that can be reached from start (the segment behind p2) without passing a portal that is
+//	completely behind one of the planes separating p1 from p2.
+static void pvs_flood(unsigned int *row, int start, const double **p1, const double **p2, unsigned int flood)
+{
+	pvs_plane	planes[PVS_MAX_PLANES];
+	int		n_planes = 0, i, head = 0, tail = 0;
+
+	for (i=0;i<4;i++) {
+		int j;
+
+		for (j=0;j<4;j++) {
+			pvs_add_plane(planes, &n_planes, p1[i], p1[(i+1)%4], p2[j], p1, p2);
+			pvs_add_plane(planes, &n_planes, p2[i], p2[(i+1)%4], p1[j], p1, p2);
+		}
+	}
+
+	PVS_SET(row, start);
+	Pvs_seen[start] = flood;
+	Pvs_queue[tail++] = start;
+
+	while (head < tail) {
+		int segnum = Pvs_queue[head++], sidenum;
+
+		for (sidenum=0;sidenum<MAX_SIDES_PER_SEGMENT;sidenum++) {
+			int ch = Pvs_children[segnum*MAX_SIDES_PER_SEGMENT + sidenum];
+			const double *q[4];
+			int p;
+
+			if (ch < 0 || Pvs_seen[ch] == flood)
+				continue;
+
+			pvs_side_verts(segnum, sidenum, q);
+			for (p=0;p<n_planes;p++)
+				if (pvs_dist(&planes[p], q[0]) < -PVS_CULL_EPS && pvs_dist(&planes[p], q[1]) < -PVS_CULL_EPS &&
+						pvs_dist(&planes[p], q[2]) < -PVS_CULL_EPS && pvs_dist(&planes[p], q[3]) < -PVS_CULL_EPS)
+					break;
+			if (p < n_planes)
+				continue;	//no sight line through p1 and p2 gets through this portal
+
+			PVS_SET(row, ch);
+			Pvs_seen[ch] = flood;
+			Pvs_queue[tail++] = ch;
+		}
+	}
+}
+
+//	Runs on the background task.  Returns 0 if it was cancelled.
+static int pvs_build(void *data)
+{
+	unsigned int	flood = 0;
+	int		segnum;
+
+	for (segnum=0;segnum<Pvs_num_segments;segnum++) {
+		unsigned int *row = &Pvs_bits[segnum * Pvs_row_words];
+		int s1;
+
+		if (Pvs_cancel)
+			return 0;
+
+		PVS_SET(row, segnum);
+		for (s1=0;s1<MAX_SIDES_PER_SEGMENT;s1++) {
+			int n1 = Pvs_children[segnum*MAX_SIDES_PER_SEGMENT + s1], s2;
+			const double *p1[4];
+
+			if (n1 < 0)
+				continue;
+
+			PVS_SET(row, n1);
+			pvs_side_verts(segnum, s1, p1);
+
+			for (s2=0;s2<MAX_SIDES_PER_SEGMENT;s2++) {
+				int n2 = Pvs_children[n1*MAX_SIDES_PER_SEGMENT + s2];
+				const double *p2[4];
+
+				if (n2 < 0 || n2 == segnum)
+					continue;
+
+				pvs_side_verts(n1, s2, p2);
+				pvs_flood(row, n2, p1, p2, ++flood);
+			}
+		}
+	}
+
+	return 1;
+}
+
+void free_segment_pvs(void)
+{
+	if (Pvs_task) {
+		Pvs_cancel = 1;
+		worker_task_finish(Pvs_task);
+		Pvs_task = NULL;
+	}
+	Pvs_cancel = 0;
+	Pvs_ready = 0;
+	Pvs_num_segments = 0;
+
+	if (Pvs_bits)
+		d_free(Pvs_bits);
+	if (Pvs_verts)
+		d_free(Pvs_verts);
+	if (Pvs_children)
+		d_free(Pvs_children);
+	if (Pvs_seg_verts)
+		d_free(Pvs_seg_verts);
+	if (Pvs_seen)
+		d_free(Pvs_seen);
+	if (Pvs_queue)
+		d_free(Pvs_queue);
+}
+
+//	Start building the sets for the level just loaded.
+void build_segment_pvs(void)
+{
+	int	i;
+
+	free_segment_pvs();
+
+	if (GameArg.SysLowMem)
+		return;
+#ifdef EDITOR
+	if (EditorWindow)
+		return;		//the mine changes while it is edited
+#endif
+
+	//everything the task uses is allocated here, d_malloc() can only be used on the game thread
+	Pvs_num_segments = Highest_segment_index+1;
+	Pvs_row_words = (Pvs_num_segments + 31) / 32;
+	CALLOC(Pvs_bits, unsigned int, Pvs_num_segments * Pvs_row_words);
+	MALLOC(Pvs_verts, double, (Highest_vertex_index+1) * 3);
+	MALLOC(Pvs_children, short, Pvs_num_segments * MAX_SIDES_PER_SEGMENT);
+	MALLOC(Pvs_seg_verts, int, Pvs_num_segments * MAX_VERTICES_PER_SEGMENT);
+	CALLOC(Pvs_seen, unsigned int, Pvs_num_segments);
+	MALLOC(Pvs_queue, short, Pvs_num_segments);
+	if (!Pvs_bits || !Pvs_verts || !Pvs_children || !Pvs_seg_verts || !Pvs_seen || !Pvs_queue) {
+		free_segment_pvs();
+		return;
+	}
+
+	for (i=0;i<=Highest_vertex_index;i++) {
+		Pvs_verts[i*3] = f2fl(Vertices[i].x);
+		Pvs_verts[i*3+1] = f2fl(Vertices[i].y);
+		Pvs_verts[i*3+2] = f2fl(Vertices[i].z);
+	}
+	for (i=0;i<Pvs_num_segments;i++) {
+		memcpy(&Pvs_children[i*MAX_SIDES_PER_SEGMENT], Segments[i].children, sizeof(Segments[i].children));
+		memcpy(&Pvs_seg_verts[i*MAX_VERTICES_PER_SEGMENT], Segments[i].verts, sizeof(Segments[i].verts));
+	}
+
+	Pvs_task = worker_task_start(pvs_build, NULL);
+}
+
+//	The set for segnum, or NULL if the sets are not built (yet).
+static unsigned int *get_segment_pvs(int segnum)
+{
+	if (Pvs_task && worker_task_done(Pvs_task)) {
+		Pvs_ready = worker_task_finish(Pvs_task);
+		Pvs_task = NULL;
+		d_free(Pvs_verts);
+		d_free(Pvs_children);
+		d_free(Pvs_seg_verts);
+		d_free(Pvs_seen);
+		d_free(Pvs_queue);
+	}
+
+	if (!Pvs_ready || segnum < 0 || segnum >= Pvs_num_segments || Pvs_num_segments != Highest_segment_index+1)
+		return NULL;
+#ifdef EDITOR
+	if (EditorWindow)
+		return NULL;
+#endif
+
+	return &Pvs_bits[segnum * Pvs_row_words];
+}
+
 //build a list of segments to be rendered
 //fills in Render_list & N_render_segs
 void build_segment_list(int start_seg_num, int window_num)
@@ -1718,23 +2141,31 @@ void build_segment_list(int start_seg_num, int window_num)
 	int	l,c;
 	int	ch;
 	int	obs = is_observer() || (Newdemo_state == ND_STATE_PLAYBACK && Newdemo_game_mode & GM_OBSERVER);
+	unsigned int *pvs;
+
+	PROFILE_BEGIN("build_segment_list");
 
-	memset(visited, 0, sizeof(visited[0])*(Highest_segment_index+1));
-	memset(render_pos, -1, sizeof(render_pos[0])*(Highest_segment_index+1));
+	new_visited_generation();
+	new_render_pos_generation();
 	//memset(no_render_flag, 0, sizeof(no_render_flag[0])*(MAX_RENDER_SEGS));
-	memset(processed, 0, sizeof(processed));
 
 	#ifndef NDEBUG
 	memset(visited2, 0, sizeof(visited2[0])*(Highest_segment_index+1));
 	#endif
 
+	//the set only holds for points inside the segment
+	pvs = get_segment_pvs(start_seg_num);
+	if (pvs && get_seg_masks(&Viewer_eye, start_seg_num, 0, __FILE__, __LINE__).centermask != 0)
+		pvs = NULL;
+
 	lcnt = scnt = 0;
 
-	Render_list[lcnt] = start_seg_num; visited[start_seg_num]=1;
+	Render_list[lcnt] = start_seg_num;
 	Seg_depth[lcnt] = 0;
+	processed[lcnt] = 0;
 	lcnt++;
 	ecnt = lcnt;
-	render_pos[start_seg_num] = 0;
+	SET_RENDER_POS(start_seg_num, 0);
 
 	render_windows[0].left=render_windows[0].top=0;
 	render_windows[0].right=grd_curcanv->cv_bitmap.bm_w-1;
@@ -1778,6 +2209,9 @@ void build_segment_list(int start_seg_num, int window_num)
 
 				ch=seg->children[c];
 
+				if (pvs && ch >= 0 && !PVS_TEST(pvs, ch))
+					continue;		//can't be seen from anywhere in the start segment
+
 				// Only add side if it doesn't block rendering of the child segment
 				// (in observer mode, add side as long as it has a child)
 				if ((wid & WID_RENDPAST_FLAG) || (obs && (ch >= 0))) {
@@ -1847,7 +2281,7 @@ void build_segment_list(int start_seg_num, int window_num)
 					}
 
 					if (obs || no_proj_flag || (!codes_and_3d && !codes_and_2d)) {	//maybe add this segment
-						int rp = render_pos[ch];
+						int rp = RENDER_POS(ch);
 						rect* new_w = &render_windows[lcnt];
 
 						if (obs || no_proj_flag) *new_w = *check_w;
@@ -1881,12 +2315,12 @@ void build_segment_list(int start_seg_num, int window_num)
 							goto no_add;
 						}
 
-						render_pos[ch] = lcnt;
+						SET_RENDER_POS(ch, lcnt);
 						Render_list[lcnt] = ch;
 						Seg_depth[lcnt] = l;
+						processed[lcnt] = 0;
 						lcnt++;
 						if (lcnt >= MAX_RENDER_SEGS) { goto done_list; }
-						visited[ch] = 1;
 no_add:
 	;
 					}
@@ -1909,6 +2343,7 @@ done_list:
 	first_terminal_seg = scnt;
 	N_render_segs = lcnt;
 
+	PROFILE_END();
 }
 
 //renders onto current canvas
@@ -1929,7 +2364,7 @@ void render_mine(int start_seg_num,fix eye_offset, int window_num)
 
 	//set up for rendering
 
-	render_start_frame();
+	start_view(window_num);
 
 
 	#if defined(EDITOR)
@@ -1951,6 +2386,8 @@ void render_mine(int start_seg_num,fix eye_offset, int window_num)
 		//NOTE LINK TO ABOVE!!
 		build_segment_list(start_seg_num, window_num);		//fills in Render_list & N_render_segs
 
+	rotate_render_list();
+
 	//render away
 
 	#ifndef NDEBUG
@@ -2004,6 +2441,8 @@ void render_mine(int start_seg_num,fix eye_offset, int window_num)
 
 #ifdef OGL
 	if (GameCfg.ClassicDepth && !(Game_mode & GM_MULTI)) {
+#else
+	tmap_bin_begin();	//queue the polygons and rasterize them on the worker threads
 #endif
 	for (nn=N_render_segs;nn--;) {
 		int segnum;
@@ -2014,7 +2453,7 @@ void render_mine(int start_seg_num,fix eye_offset, int window_num)
 		Current_seg_depth = Seg_depth[nn];
 
 		//if (!no_render_flag[nn])
-		if (segnum!=-1 && (_search_mode || visited[segnum]!=255)) {
+		if (segnum!=-1 && (_search_mode || visited[segnum]!=Visited_generation)) {
 			//set global render window vars
 			void ogl_update_window_clip();
 
@@ -2027,7 +2466,7 @@ void render_mine(int start_seg_num,fix eye_offset, int window_num)
 #endif
 
 			render_segment(segnum, window_num);
-			visited[segnum]=255;
+			visited[segnum]=Visited_generation;
 
 			//reset for objects
 			Window_clip_left  = Window_clip_top = 0;
@@ -2064,6 +2503,9 @@ void render_mine(int start_seg_num,fix eye_offset, int window_num)
 			Max_linear_depth = save_linear_depth;
 		}
 	}
+#ifndef OGL
+	tmap_bin_end();
+#endif
 #ifdef OGL
 	} else {
 	// Sorting elements for Alpha - 3 passes
@@ -2075,7 +2517,7 @@ void render_mine(int start_seg_num,fix eye_offset, int window_num)
 		segnum = Render_list[nn];
 		Current_seg_depth = Seg_depth[nn];
 
-		if (segnum!=-1 && (_search_mode || visited[segnum]!=255))
+		if (segnum!=-1 && (_search_mode || visited[segnum]!=Visited_generation))
 		{
 			//set global render window vars
 			Window_clip_left  = render_windows[nn].left;
@@ -2110,11 +2552,11 @@ void render_mine(int start_seg_num,fix eye_offset, int window_num)
 							render_side(seg, sn);
 				}
 			}
-			visited[segnum]=255;
+			visited[segnum]=Visited_generation;
 		}
 	}
 
-	memset(visited, 0, sizeof(visited[0])*(Highest_segment_index+1));
+	new_visited_generation();
 	
 	// Second Pass: Objects
 	for (nn=N_render_segs;nn--;)
@@ -2125,7 +2567,7 @@ void render_mine(int start_seg_num,fix eye_offset, int window_num)
 		segnum = Render_list[nn];
 		Current_seg_depth = Seg_depth[nn];
 
-		if (segnum!=-1 && (_search_mode || visited[segnum]!=255))
+		if (segnum!=-1 && (_search_mode || visited[segnum]!=Visited_generation))
 		{
 			//set global render window vars
 			Window_clip_left  = render_windows[nn].left;
@@ -2133,7 +2575,7 @@ void render_mine(int start_seg_num,fix eye_offset, int window_num)
 			Window_clip_right = render_windows[nn].right;
 			Window_clip_bot   = render_windows[nn].bot;
 
-			visited[segnum]=255;
+			visited[segnum]=Visited_generation;
 
 			//reset for objects
 			Window_clip_left  = Window_clip_top = 0;
@@ -2170,7 +2612,7 @@ void render_mine(int start_seg_num,fix eye_offset, int window_num)
 		}
 	}
 
-	memset(visited, 0, sizeof(visited[0])*(Highest_segment_index+1));
+	new_visited_generation();
 	
 	// Third Pass - Render Transculent level geometry with normal Alpha-Func
 	for (nn=N_render_segs;nn--;)
@@ -2180,7 +2622,7 @@ void render_mine(int start_seg_num,fix eye_offset, int window_num)
 		segnum = Render_list[nn];
 		Current_seg_depth = Seg_depth[nn];
 
-		if (segnum!=-1 && (_search_mode || visited[segnum]!=255))
+		if (segnum!=-1 && (_search_mode || visited[segnum]!=Visited_generation))
 		{
 			//set global render window vars
 			Window_clip_left  = render_windows[nn].left;
@@ -2209,7 +2651,7 @@ void render_mine(int start_seg_num,fix eye_offset, int window_num)
 							render_side(seg, sn);
 				}
 			}
-			visited[segnum]=255;
+			visited[segnum]=Visited_generation;
 		}
 	}
 	}
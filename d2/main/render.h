@@ -73,8 +73,20 @@ int toggle_show_only_curside(void);
 extern fix Render_zoom;     // the player's zoom factor
 
 // This is used internally to render_frame(), but is included here so AI
-// can use it for its own purposes.
-extern unsigned char visited[MAX_SEGMENTS];
+// can use it for its own purposes. A segment is visited if its entry is
+// Visited_generation, new_visited_generation() clears all of them.
+extern unsigned int visited[MAX_SEGMENTS];
+extern unsigned int Visited_generation;
+void new_visited_generation(void);
+
+// Potentially visible sets of the segments of the current level, see render.c
+void build_segment_pvs(void);
+void free_segment_pvs(void);
+
+// Rotated points are kept per rendered window until Vertices or its view change.
+// Call reset_view_caches() when Vertices change.
+void reset_view_caches(void);
+void free_view_caches(void);
 
 extern int N_render_segs;
 extern short Render_list[MAX_RENDER_SEGS];
@@ -23,6 +23,7 @@ COPYRIGHT 1993-1999 PARALLAX SOFTWARE CORPORATION.  ALL RIGHTS RESERVED.
 
 #include "3d.h"
 
-extern	g3s_point	Segment_points[MAX_VERTICES];
+//points of the window being drawn, see render_start_frame()
+extern	g3s_point	*Segment_points;
 
 #endif /* _SEGPOINTS_H */
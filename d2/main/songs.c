@@ -172,6 +172,7 @@ void songs_uninit()
 	songs_stop_all();
 #ifdef USE_SDLMIXER
 	jukebox_unload();
+	mix_free_midi_cache();
 #endif
 	if (BIMSongs != NULL)
 		d_free(BIMSongs);
@@ -284,6 +285,17 @@ void play_credits_track()
 	start_time();
 }
 
+// get a song that is likely to be played next ready, so starting it does not stall the game
+void songs_prefetch_file(char *filename)
+{
+#if defined(USE_SDLMIXER) && !defined(_WIN32)
+	char *fptr = strrchr(filename, '.');
+
+	if (fptr && !d_stricmp(fptr, SONG_EXT_HMP))
+		mix_prefetch_file(filename);
+#endif
+}
+
 // play a filename as music, depending on filename extension.
 int songs_play_file(char *filename, int repeat, void (*hook_finished_track)())
 {
@@ -416,6 +428,11 @@ int songs_play_level_song( int levelnum, int offset )
 				songnum = SONG_FIRST_LEVEL_SONG + (songnum % (Num_bim_songs - SONG_FIRST_LEVEL_SONG));
 				if (songs_play_file(BIMSongs[songnum].filename, 1, NULL))
 					Song_playing = songnum;
+
+				// the end of level song and the song of the next level come next
+				if (Num_bim_songs > SONG_ENDLEVEL)
+					songs_prefetch_file(BIMSongs[SONG_ENDLEVEL].filename);
+				songs_prefetch_file(BIMSongs[SONG_FIRST_LEVEL_SONG + ((songnum - SONG_FIRST_LEVEL_SONG + 1) % (Num_bim_songs - SONG_FIRST_LEVEL_SONG))].filename);
 			}
 			break;
 		}
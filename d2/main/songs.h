@@ -27,6 +27,7 @@ typedef struct bim_song_info {
 #endif
 
 int songs_play_file(char *filename, int repeat, void (*hook_finished_track)());
+void songs_prefetch_file(char *filename);
 int songs_play_song( int songnum, int repeat );
 int songs_play_level_song( int levelnum, int offset );
 
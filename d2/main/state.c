@@ -67,6 +67,8 @@ COPYRIGHT 1993-1999 PARALLAX SOFTWARE CORPORATION.  ALL RIGHTS RESERVED.
 #include "ogl_init.h"
 #endif
 #include "physfsx.h"
+#include "worker.h"
+#include "timer.h"
 
 #define STATE_VERSION 22
 #define STATE_COMPATIBLE_VERSION 20
@@ -610,6 +612,10 @@ int state_get_savegame_filename(char * fname, char * dsc, char * caption, int bl
 	char id[5], dummy_callsign[CALLSIGN_LEN+1];
 	int valid;
 
+	// a savegame still being written replaces its file in one go, so saving can list the old one
+	if (!dsc)
+		state_save_wait();
+
 	nsaves=0;
 	m[0].type = NM_TYPE_TEXT; m[0].text = "\n\n\n\n";
 	for (i=0;i<NUM_SAVES; i++ )	{
@@ -755,6 +761,8 @@ int copy_file(char *old_file, char *new_file)
 
 extern int Final_boss_is_dead;
 
+static int State_save_announce = 0;	// for the next state_save_begin()
+
 //	-----------------------------------------------------------------------------------
 int state_save_all(int secret_save, char *filename_override, int blind_save)
 {
@@ -833,12 +841,185 @@ int state_save_all(int secret_save, char *filename_override, int blind_save)
 		}
 	}
 
+	State_save_announce = !secret_save;	// "Game saved" once it is written
 	rval = state_save_all_sub(filename, desc);
+	if (rval && secret_save)
+		rval = state_save_wait();	// secret level saves are read back right away
+
+	return rval;
+}
+
+/*
+ * Savegames are written in two steps.  state_save_all_sub() serializes the game state into a snapshot in
+ * memory, which is quick, and a background task (see worker.h) writes the snapshot to "<file>.tmp" and renames
+ * it over the savegame, so a save never leaves a half written file behind and the game does not wait for the
+ * disk.  There are two snapshot buffers: the next save fills one while the other is still being written, and
+ * only waits when the previous write still isn't done by the time the new snapshot is.  Each write reports
+ * how it went when it is done (see state_save_report()).
+ *
+ * A snapshot larger than STATE_SNAPSHOT_MAX is not kept in memory: it goes on to the .tmp file directly,
+ * on the game thread, as savegames used to.
+ */
 
-	if (rval && !secret_save)
+#define STATE_SNAPSHOT_MAX	(8*1024*1024)
+
+struct state_writer {
+	char		filename[PATH_MAX];
+	char		tempname[PATH_MAX];
+	ubyte		*data;
+	int		size, max_size;
+	PHYSFS_file	*fp;		// the .tmp file, once the snapshot got too big
+	int		error;
+	int		announce;	// say "Game saved" when written
+	u_int64_t	snapshot_usec, write_usec;
+};
+
+static state_writer State_writers[2];
+static state_writer *State_writing = NULL;	// the one State_write_task has
+static worker_task *State_write_task = NULL;
+
+static int state_replace_file(const char *tempname, const char *filename)
+{
+	// rename() replaces filename atomically where it can, elsewhere it has to go first
+	if (PHYSFSX_rename(tempname, filename))
+		return 1;
+	PHYSFS_delete(filename);
+	return PHYSFSX_rename(tempname, filename);
+}
+
+// Runs on its own thread, so only touches w and the file.
+static int state_write_snapshot(void *data)
+{
+	state_writer	*w = data;
+	u_int64_t	start = timer_query_usec();
+	PHYSFS_file	*fp;
+	int		ok;
+
+	fp = PHYSFS_openWrite(w->tempname);
+	ok = fp && PHYSFS_write(fp, w->data, w->size, 1) == 1;
+	if (fp && !PHYSFS_close(fp))
+		ok = 0;
+	ok = ok && state_replace_file(w->tempname, w->filename);
+	if (!ok)
+		PHYSFS_delete(w->tempname);
+
+	w->write_usec = timer_query_usec() - start;
+	return ok;
+}
+
+static int state_save_report(state_writer *w, int ok)
+{
+	if (!ok) {
+		nm_messagebox(NULL, 1, TXT_OK, "Error writing savegame.\nPossibly out of disk\nspace.");
+		return 0;
+	}
+
+	con_printf(CON_VERBOSE, "Saved %s: %i bytes, snapshot %u us, write %u us\n", w->filename, w->size,
+		(unsigned)w->snapshot_usec, (unsigned)w->write_usec);
+	if (w->announce)
 		HUD_init_message_literal(HM_DEFAULT, "Game saved");
+	return 1;
+}
 
-	return rval;
+// Wait for the savegame being written, if any.  Returns 0 if writing it failed.
+int state_save_wait(void)
+{
+	state_writer	*w = State_writing;
+	int		ok;
+
+	if (!State_write_task)
+		return 1;
+
+	ok = worker_task_finish(State_write_task);
+	State_write_task = NULL;
+	State_writing = NULL;
+
+	return state_save_report(w, ok);
+}
+
+// Report a savegame that has been written, called once per event loop.
+void state_save_poll(void)
+{
+	if (State_write_task && worker_task_done(State_write_task))
+		state_save_wait();
+}
+
+static state_writer *state_save_begin(const char *filename)
+{
+	state_writer *w = State_writing == &State_writers[0] ? &State_writers[1] : &State_writers[0];
+
+	snprintf(w->filename, sizeof(w->filename), "%s", filename);
+	snprintf(w->tempname, sizeof(w->tempname), "%s.tmp", filename);
+	w->size = 0;
+	w->fp = NULL;
+	w->error = 0;
+	w->announce = State_save_announce;
+	State_save_announce = 0;
+	w->snapshot_usec = timer_query_usec();
+	w->write_usec = 0;
+
+	return w;
+}
+
+void state_write(state_writer *w, const void *buf, int size, int count)
+{
+	int bytes = size * count;
+
+	if (w->error || bytes <= 0)
+		return;
+
+	if (!w->fp && w->size + bytes > STATE_SNAPSHOT_MAX) {
+		if (State_writing && !strcmp(State_writing->tempname, w->tempname))
+			state_save_wait();
+		w->fp = PHYSFSX_openWriteBuffered(w->tempname);
+		if (!w->fp || (w->size && PHYSFS_write(w->fp, w->data, w->size, 1) != 1)) {
+			w->error = 1;
+			return;
+		}
+	}
+
+	if (w->fp) {
+		if (PHYSFS_write(w->fp, buf, bytes, 1) != 1)
+			w->error = 1;
+		w->size += bytes;
+		return;
+	}
+
+	if (w->size + bytes > w->max_size) {
+		w->max_size = max(w->max_size * 2, w->size + bytes);
+		w->max_size = min(w->max_size, STATE_SNAPSHOT_MAX);
+		w->data = d_realloc(w->data, w->max_size);
+	}
+	memcpy(w->data + w->size, buf, bytes);
+	w->size += bytes;
+}
+
+// Hand the snapshot over to be written.  Returns 0 if that already failed, whether the write itself
+// works out is reported when it is done.
+static int state_save_end(state_writer *w)
+{
+	int ok;
+
+	w->snapshot_usec = timer_query_usec() - w->snapshot_usec;
+
+	if (w->fp || w->error) {
+		// too big to keep, it's written already
+		ok = !w->error;
+		if (w->fp && !PHYSFS_close(w->fp))
+			ok = 0;
+		w->fp = NULL;
+		ok = ok && state_replace_file(w->tempname, w->filename);
+		if (!ok)
+			PHYSFS_delete(w->tempname);
+		return state_save_report(w, ok);
+	}
+
+	// one write at a time, so they land in the order the saves were made
+	state_save_wait();
+	State_writing = w;
+	State_write_task = worker_task_start(state_write_snapshot, w);
+
+	return 1;
 }
 
 extern	fix	Flash_effect;
@@ -848,7 +1029,7 @@ extern fix64 Time_flash_last_played;
 int state_save_all_sub(char *filename, char *desc)
 {
 	int i,j;
-	PHYSFS_file *fp;
+	state_writer *w;
 	grs_canvas * cnv;
 	ubyte *pal;
 	char mission_filename[9];
@@ -862,29 +1043,24 @@ int state_save_all_sub(char *filename, char *desc)
 		Int3();
 	#endif
 
-	fp = PHYSFSX_openWriteBuffered(filename);
-	if ( !fp ) {
-		nm_messagebox(NULL, 1, TXT_OK, "Error writing savegame.\nPossibly out of disk\nspace.");
-		start_time();
-		return 0;
-	}
+	w = state_save_begin(filename);
 
 //Save id
-	PHYSFS_write(fp, dgss_id, sizeof(char) * 4, 1);
+	state_write(w, dgss_id, sizeof(char) * 4, 1);
 
 //Save version
 	i = STATE_VERSION;
-	PHYSFS_write(fp, &i, sizeof(int), 1);
+	state_write(w, &i, sizeof(int), 1);
 
 // Save Coop state_game_id and this Player's callsign. Oh the redundancy... we have this one later on but Coop games want to read this before loading a state so for easy access save this here, too
 	if (Game_mode & GM_MULTI_COOP)
 	{
-		PHYSFS_write(fp, &state_game_id, sizeof(uint), 1);
-		PHYSFS_write(fp, &Players[Player_num].callsign, sizeof(char)*CALLSIGN_LEN+1, 1);
+		state_write(w, &state_game_id, sizeof(uint), 1);
+		state_write(w, &Players[Player_num].callsign, sizeof(char)*CALLSIGN_LEN+1, 1);
 	}
 
 //Save description
-	PHYSFS_write(fp, desc, sizeof(char) * DESC_LENGTH, 1);
+	state_write(w, desc, sizeof(char) * DESC_LENGTH, 1);
 
 // Save the current screen shot...
 
@@ -920,36 +1096,36 @@ int state_save_all_sub(char *filename, char *desc)
 #endif
 		pal = gr_palette;
 
-		PHYSFS_write(fp, cnv->cv_bitmap.bm_data, THUMBNAIL_W * THUMBNAIL_H, 1);
+		state_write(w, cnv->cv_bitmap.bm_data, THUMBNAIL_W * THUMBNAIL_H, 1);
 
 		gr_set_current_canvas(cnv_save);
 		gr_free_canvas( cnv );
-		PHYSFS_write(fp, pal, 3, 256);
+		state_write(w, pal, 3, 256);
 	}
 	else
 	{
 	 	ubyte color = 0;
 	 	for ( i=0; i<THUMBNAIL_W*THUMBNAIL_H; i++ )
-			PHYSFS_write(fp, &color, sizeof(ubyte), 1);		
+			state_write(w, &color, sizeof(ubyte), 1);		
 	} 
 
 // Save the Between levels flag...
 	i = 0;
-	PHYSFS_write(fp, &i, sizeof(int), 1);
+	state_write(w, &i, sizeof(int), 1);
 
 // Save the mission info...
 	memset(&mission_filename, '\0', 9);
 	snprintf(mission_filename, 9, "%s", Current_mission_filename); // Current_mission_filename is not necessarily 9 bytes long so for saving we use a proper string - preventing corruptions
-	PHYSFS_write(fp, &mission_filename, 9 * sizeof(char), 1);
+	state_write(w, &mission_filename, 9 * sizeof(char), 1);
 
 //Save level info
-	PHYSFS_write(fp, &Current_level_num, sizeof(int), 1);
-	PHYSFS_write(fp, &Next_level_num, sizeof(int), 1);
+	state_write(w, &Current_level_num, sizeof(int), 1);
+	state_write(w, &Next_level_num, sizeof(int), 1);
 
 //Save GameTime
 // NOTE: GameTime now is GameTime64 with fix64 since GameTime could only last 9 hrs. To even help old Savegames, we do not increment Savegame version but rather RESET GameTime64 to 0 on every save! ALL variables based on GameTime64 now will get the current GameTime64 value substracted and saved to fix size as well.
 	tmptime32 = 0;
-	PHYSFS_write(fp, &tmptime32, sizeof(fix), 1);
+	state_write(w, &tmptime32, sizeof(fix), 1);
 
 //Save player info
 	//PHYSFS_write(fp, &Players[Player_num], sizeof(player), 1);
@@ -957,19 +1133,19 @@ int state_save_all_sub(char *filename, char *desc)
 		player_rw *pl_rw;
 		CALLOC(pl_rw, player_rw, 1);
 		state_player_to_player_rw(&Players[Player_num], pl_rw);
-		PHYSFS_write(fp, pl_rw, sizeof(player_rw), 1);
+		state_write(w, pl_rw, sizeof(player_rw), 1);
 		d_free(pl_rw);
 	}
 
 // Save the current weapon info
-	PHYSFS_write(fp, &Players[Player_num].primary_weapon, sizeof(sbyte), 1);
-	PHYSFS_write(fp, &Players[Player_num].secondary_weapon, sizeof(sbyte), 1);
+	state_write(w, &Players[Player_num].primary_weapon, sizeof(sbyte), 1);
+	state_write(w, &Players[Player_num].secondary_weapon, sizeof(sbyte), 1);
 
 // Save the difficulty level
-	PHYSFS_write(fp, &Difficulty_level, sizeof(int), 1);
+	state_write(w, &Difficulty_level, sizeof(int), 1);
 
 // Save cheats enabled
-	PHYSFS_write(fp, &cheats.enabled, sizeof(int), 1);
+	state_write(w, &cheats.enabled, sizeof(int), 1);
 
 //Finish all morph objects
 	for (i=0; i<=Highest_object_index; i++ )	{
@@ -993,115 +1169,115 @@ int state_save_all_sub(char *filename, char *desc)
 
 //Save object info
 	i = Highest_object_index+1;
-	PHYSFS_write(fp, &i, sizeof(int), 1);
+	state_write(w, &i, sizeof(int), 1);
 	//PHYSFS_write(fp, Objects, sizeof(object), i);
 	for (i = 0; i <= Highest_object_index; i++)
 	{
 		object_rw *obj_rw;
 		CALLOC(obj_rw, object_rw, 1);
 		state_object_to_object_rw(&Objects[i], obj_rw);
-		PHYSFS_write(fp, obj_rw, sizeof(object_rw), 1);
+		state_write(w, obj_rw, sizeof(object_rw), 1);
 		d_free(obj_rw);
 	}
 	
 //Save wall info
 	i = Num_walls;
-	PHYSFS_write(fp, &i, sizeof(int), 1);
-	PHYSFS_write(fp, Walls, sizeof(wall), i);
+	state_write(w, &i, sizeof(int), 1);
+	state_write(w, Walls, sizeof(wall), i);
 
 //Save exploding wall info
 	i = MAX_EXPLODING_WALLS;
-	PHYSFS_write(fp, &i, sizeof(int), 1);
-	PHYSFS_write(fp, expl_wall_list, sizeof(*expl_wall_list), i);
+	state_write(w, &i, sizeof(int), 1);
+	state_write(w, expl_wall_list, sizeof(*expl_wall_list), i);
 
 //Save door info
 	i = Num_open_doors;
-	PHYSFS_write(fp, &i, sizeof(int), 1);
-	PHYSFS_write(fp, ActiveDoors, sizeof(active_door), i);
+	state_write(w, &i, sizeof(int), 1);
+	state_write(w, ActiveDoors, sizeof(active_door), i);
 
 //Save cloaking wall info
 	i = Num_cloaking_walls;
-	PHYSFS_write(fp, &i, sizeof(int), 1);
-	PHYSFS_write(fp, CloakingWalls, sizeof(cloaking_wall), i);
+	state_write(w, &i, sizeof(int), 1);
+	state_write(w, CloakingWalls, sizeof(cloaking_wall), i);
 
 //Save trigger info
-	PHYSFS_write(fp, &Num_triggers, sizeof(int), 1);
-	PHYSFS_write(fp, Triggers, sizeof(trigger), Num_triggers);
+	state_write(w, &Num_triggers, sizeof(int), 1);
+	state_write(w, Triggers, sizeof(trigger), Num_triggers);
 
 //Save tmap info
 	for (i = 0; i <= Highest_segment_index; i++)
 	{
 		for (j = 0; j < 6; j++)
 		{
-			PHYSFS_write(fp, &Segments[i].sides[j].wall_num, sizeof(short), 1);
-			PHYSFS_write(fp, &Segments[i].sides[j].tmap_num, sizeof(short), 1);
-			PHYSFS_write(fp, &Segments[i].sides[j].tmap_num2, sizeof(short), 1);
+			state_write(w, &Segments[i].sides[j].wall_num, sizeof(short), 1);
+			state_write(w, &Segments[i].sides[j].tmap_num, sizeof(short), 1);
+			state_write(w, &Segments[i].sides[j].tmap_num2, sizeof(short), 1);
 		}
 	}
 
 // Save the fuelcen info
-	PHYSFS_write(fp, &Control_center_destroyed, sizeof(int), 1);
-	PHYSFS_write(fp, &Countdown_timer, sizeof(int), 1);
-	PHYSFS_write(fp, &Num_robot_centers, sizeof(int), 1);
-	PHYSFS_write(fp, RobotCenters, sizeof(matcen_info), Num_robot_centers);
-	PHYSFS_write(fp, &ControlCenterTriggers, sizeof(control_center_triggers), 1);
-	PHYSFS_write(fp, &Num_fuelcenters, sizeof(int), 1);
-	PHYSFS_write(fp, Station, sizeof(FuelCenter), Num_fuelcenters);
+	state_write(w, &Control_center_destroyed, sizeof(int), 1);
+	state_write(w, &Countdown_timer, sizeof(int), 1);
+	state_write(w, &Num_robot_centers, sizeof(int), 1);
+	state_write(w, RobotCenters, sizeof(matcen_info), Num_robot_centers);
+	state_write(w, &ControlCenterTriggers, sizeof(control_center_triggers), 1);
+	state_write(w, &Num_fuelcenters, sizeof(int), 1);
+	state_write(w, Station, sizeof(FuelCenter), Num_fuelcenters);
 
 // Save the control cen info
-	PHYSFS_write(fp, &Control_center_been_hit, sizeof(int), 1);
-	PHYSFS_write(fp, &Control_center_player_been_seen, sizeof(int), 1);
-	PHYSFS_write(fp, &Control_center_next_fire_time, sizeof(int), 1);
-	PHYSFS_write(fp, &Control_center_present, sizeof(int), 1);
-	PHYSFS_write(fp, &Dead_controlcen_object_num, sizeof(int), 1);
+	state_write(w, &Control_center_been_hit, sizeof(int), 1);
+	state_write(w, &Control_center_player_been_seen, sizeof(int), 1);
+	state_write(w, &Control_center_next_fire_time, sizeof(int), 1);
+	state_write(w, &Control_center_present, sizeof(int), 1);
+	state_write(w, &Dead_controlcen_object_num, sizeof(int), 1);
 
 // Save the AI state
-	ai_save_state( fp );
+	ai_save_state( w );
 
 // Save the automap visited info
 	if ( Highest_segment_index+1 > MAX_SEGMENTS_ORIGINAL )
 	{
-		PHYSFS_write(fp, Automap_visited, sizeof(ubyte), Highest_segment_index + 1);
+		state_write(w, Automap_visited, sizeof(ubyte), Highest_segment_index + 1);
 	}
 	else
-		PHYSFS_write(fp, Automap_visited, sizeof(ubyte), MAX_SEGMENTS_ORIGINAL);
+		state_write(w, Automap_visited, sizeof(ubyte), MAX_SEGMENTS_ORIGINAL);
 
-	PHYSFS_write(fp, &state_game_id, sizeof(uint), 1);
+	state_write(w, &state_game_id, sizeof(uint), 1);
 	i = 0;
-	PHYSFS_write(fp, &cheats.rapidfire, sizeof(int), 1);
-	PHYSFS_write(fp, &i, sizeof(int), 1); // was Lunacy
-	PHYSFS_write(fp, &i, sizeof(int), 1); // was Lunacy, too... and one was Ugly robot stuff a long time ago...
+	state_write(w, &cheats.rapidfire, sizeof(int), 1);
+	state_write(w, &i, sizeof(int), 1); // was Lunacy
+	state_write(w, &i, sizeof(int), 1); // was Lunacy, too... and one was Ugly robot stuff a long time ago...
 
 	// Save automap marker info
 
-	PHYSFS_write(fp, MarkerObject, sizeof(MarkerObject) ,1);
-	PHYSFS_write(fp, &Players[0].callsign[0], sizeof(char), (NUM_MARKERS)*(CALLSIGN_LEN+1)); // PHYSFS_write(fp, MarkerOwner, sizeof(MarkerOwner), 1); MarkerOwner is obsolete
-	PHYSFS_write(fp, MarkerMessage, sizeof(MarkerMessage), 1);
+	state_write(w, MarkerObject, sizeof(MarkerObject) ,1);
+	state_write(w, &Players[0].callsign[0], sizeof(char), (NUM_MARKERS)*(CALLSIGN_LEN+1)); // PHYSFS_write(fp, MarkerOwner, sizeof(MarkerOwner), 1); MarkerOwner is obsolete
+	state_write(w, MarkerMessage, sizeof(MarkerMessage), 1);
 
-	PHYSFS_write(fp, &Players[Player_num].afterburner_charge, sizeof(fix), 1);
+	state_write(w, &Players[Player_num].afterburner_charge, sizeof(fix), 1);
 
 	//save last was super information
-	PHYSFS_write(fp, &Primary_last_was_super, sizeof(Primary_last_was_super), 1);
-	PHYSFS_write(fp, &Secondary_last_was_super, sizeof(Secondary_last_was_super), 1);
+	state_write(w, &Primary_last_was_super, sizeof(Primary_last_was_super), 1);
+	state_write(w, &Secondary_last_was_super, sizeof(Secondary_last_was_super), 1);
 
 	//	Save flash effect stuff
-	PHYSFS_write(fp, &Flash_effect, sizeof(int), 1);
+	state_write(w, &Flash_effect, sizeof(int), 1);
 	if (Time_flash_last_played - GameTime64 < F1_0*(-18000))
 		tmptime32 = F1_0*(-18000);
 	else
 		tmptime32 = Time_flash_last_played - GameTime64;
-	PHYSFS_write(fp, &tmptime32, sizeof(fix), 1);
-	PHYSFS_write(fp, &PaletteRedAdd, sizeof(int), 1);
-	PHYSFS_write(fp, &PaletteGreenAdd, sizeof(int), 1);
-	PHYSFS_write(fp, &PaletteBlueAdd, sizeof(int), 1);
+	state_write(w, &tmptime32, sizeof(fix), 1);
+	state_write(w, &PaletteRedAdd, sizeof(int), 1);
+	state_write(w, &PaletteGreenAdd, sizeof(int), 1);
+	state_write(w, &PaletteBlueAdd, sizeof(int), 1);
 	if ( Highest_segment_index+1 > MAX_SEGMENTS_ORIGINAL )
 	{
-		PHYSFS_write(fp, Light_subtracted, sizeof(Light_subtracted[0]), Highest_segment_index + 1);
+		state_write(w, Light_subtracted, sizeof(Light_subtracted[0]), Highest_segment_index + 1);
 	}
 	else
-		PHYSFS_write(fp, Light_subtracted, sizeof(Light_subtracted[0]), MAX_SEGMENTS_ORIGINAL);
-	PHYSFS_write(fp, &First_secret_visit, sizeof(First_secret_visit), 1);
-	PHYSFS_write(fp, &Omega_charge, sizeof(Omega_charge), 1);
+		state_write(w, Light_subtracted, sizeof(Light_subtracted[0]), MAX_SEGMENTS_ORIGINAL);
+	state_write(w, &First_secret_visit, sizeof(First_secret_visit), 1);
+	state_write(w, &Omega_charge, sizeof(Omega_charge), 1);
 
 // Save Coop Info
 	if (Game_mode & GM_MULTI_COOP)
@@ -1111,25 +1287,25 @@ int state_save_all_sub(char *filename, char *desc)
 			player_rw *pl_rw;
 			CALLOC(pl_rw, player_rw, 1);
 			state_player_to_player_rw(&Players[i], pl_rw);
-			PHYSFS_write(fp, pl_rw, sizeof(player_rw), 1);
+			state_write(w, pl_rw, sizeof(player_rw), 1);
 			d_free(pl_rw);
 		}
-		PHYSFS_write(fp, &Netgame.mission_title, sizeof(char), MISSION_NAME_LEN+1);
-		PHYSFS_write(fp, &Netgame.mission_name, sizeof(char), 9);
-		PHYSFS_write(fp, &Netgame.levelnum, sizeof(int), 1);
-		PHYSFS_write(fp, &Netgame.difficulty, sizeof(ubyte), 1);
-		PHYSFS_write(fp, &Netgame.game_status, sizeof(ubyte), 1);
-		PHYSFS_write(fp, &Netgame.numplayers, sizeof(ubyte), 1);
-		PHYSFS_write(fp, &Netgame.max_numplayers, sizeof(ubyte), 1);
-		PHYSFS_write(fp, &Netgame.numconnected, sizeof(ubyte), 1);
-		PHYSFS_write(fp, &Netgame.level_time, sizeof(int), 1);
+		state_write(w, &Netgame.mission_title, sizeof(char), MISSION_NAME_LEN+1);
+		state_write(w, &Netgame.mission_name, sizeof(char), 9);
+		state_write(w, &Netgame.levelnum, sizeof(int), 1);
+		state_write(w, &Netgame.difficulty, sizeof(ubyte), 1);
+		state_write(w, &Netgame.game_status, sizeof(ubyte), 1);
+		state_write(w, &Netgame.numplayers, sizeof(ubyte), 1);
+		state_write(w, &Netgame.max_numplayers, sizeof(ubyte), 1);
+		state_write(w, &Netgame.numconnected, sizeof(ubyte), 1);
+		state_write(w, &Netgame.level_time, sizeof(int), 1);
 	}
 
-	PHYSFS_close(fp);
-	
+	i = state_save_end(w);
+
 	start_time();
 
-	return 1;
+	return i;
 }
 
 //	-----------------------------------------------------------------------------------
@@ -1246,6 +1422,7 @@ int state_restore_all_sub(char *filename, int secret_restore)
 		Int3();
 	#endif
 
+	state_save_wait();
 	fp = PHYSFSX_openReadBuffered(filename);
 	if ( !fp ) return 0;
 
@@ -1761,6 +1938,7 @@ int state_get_game_id(char *filename)
 	if (!(Game_mode & GM_MULTI_COOP))
 		return 0;
 
+	state_save_wait();
 	fp = PHYSFSX_openReadBuffered(filename);
 	if ( !fp ) return 0;
 
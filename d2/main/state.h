@@ -31,6 +31,12 @@ extern uint state_game_id;
 extern int state_quick_item;
 
 int state_save_all_sub(char *filename, char *desc);
+
+// Savegame data being collected by state_save_all_sub(), see state.c.
+typedef struct state_writer state_writer;
+void state_write(state_writer *w, const void *buf, int size, int count);
+int state_save_wait(void);
+void state_save_poll(void);
 int state_restore_all_sub(char *filename, int secret_restore);
 
 int state_get_save_file(char *fname, char * dsc, int blind_save);
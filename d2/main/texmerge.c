@@ -26,6 +26,7 @@ COPYRIGHT 1993-1999 PARALLAX SOFTWARE CORPORATION.  ALL RIGHTS RESERVED.
 #include "rle.h"
 #include "piggy.h"
 #include "timer.h"
+#include "texmap.h"
 
 #ifdef OGL
 #include "ogl_init.h"
@@ -153,8 +154,12 @@ grs_bitmap * texmerge_get_cached_bitmap( int tmap_bottom, int tmap_top )
 	if (bitmap_bottom->bm_w != bitmap_top->bm_w || bitmap_bottom->bm_h != bitmap_top->bm_h)
 		Error("Top and Bottom textures have different size!\n");
 
-	if (Cache[least_recently_used].bitmap != NULL)
+	if (Cache[least_recently_used].bitmap != NULL) {
+#ifndef OGL
+		tmap_bin_flush();	// a queued polygon may still use it
+#endif
 		gr_free_bitmap(Cache[least_recently_used].bitmap);
+	}
 	Cache[least_recently_used].bitmap = gr_create_bitmap(bitmap_bottom->bm_w,  bitmap_bottom->bm_h);
 #ifdef OGL
 	ogl_freebmtexture(Cache[least_recently_used].bitmap);
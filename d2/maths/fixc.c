@@ -30,70 +30,8 @@ void fixquadnegate(quadint *q)
 	q->high = 0 - q->high - (q->low != 0);
 }
 
-//multiply two ints & add 64-bit result to 64-bit sum
-void fixmulaccum(quadint *q,fix a,fix b)
-{
-	u_int32_t aa,bb;
-	u_int32_t ah,al,bh,bl;
-	u_int32_t t,c=0,old;
-	int neg;
-
-	neg = ((a^b) < 0);
-
-	aa = labs(a); bb = labs(b);
-
-	ah = aa>>16;  al = aa&0xffff;
-	bh = bb>>16;  bl = bb&0xffff;
-
-	t = ah*bl + bh*al;
-
-	if (neg)
-		fixquadnegate(q);
-
-	old = q->low;
-	q->low += al*bl;
-	if (q->low < old) q->high++;
-	
-	old = q->low;
-	q->low += (t<<16);
-	if (q->low < old) q->high++;
-	
-	q->high += ah*bh + (t>>16) + c;
-	
-	if (neg)
-		fixquadnegate(q);
-
-}
-
-//extract a fix from a quad product
-fix fixquadadjust(quadint *q)
-{
-	return (q->high<<16) + (q->low>>16);
-}
-
-
 #define EPSILON (F1_0/100)
 
-fix fixmul(fix a, fix b)
-{
-	return (fix)((((fix64) a) * b) / 65536);
-}
-
-fix64 fixmul64(fix a, fix b)
-{
-	return (fix64)((((fix64) a) * b) / 65536);
-}
-
-fix fixdiv(fix a, fix b)
-{
-	return b ? (fix)((((fix64)a) *65536)/b) : 1;
-}
-
-fix fixmuldiv(fix a, fix b, fix c)
-{
-	return c ? (fix)((((fix64)a)*b)/c) : 1;
-}
-
 //given cos & sin of an angle, return that angle.
 //parms need not be normalized, that is, the ratio of the parms cos/sin must
 //equal the ratio of the actual cos & sin for the result angle, but the parms 
@@ -23,57 +23,25 @@ COPYRIGHT 1993-1998 PARALLAX SOFTWARE CORPORATION.  ALL RIGHTS RESERVED.
 #include "maths.h"
 #include "vecmat.h"
 #include "dxxerror.h"
+#ifndef NDEBUG
+#include <limits.h>
+#include "console.h"
+#include "timer.h"
+#include "u_mem.h"
+#endif
+
+#if defined(__SSE4_1__)
+#include <smmintrin.h>
+#elif defined(__ARM_NEON) || defined(__ARM_NEON__)
+#include <arm_neon.h>
+#define VM_NEON 1
+#endif
 
 //#define USE_ISQRT 1
 
 const vms_vector vmd_zero_vector = ZERO_VECTOR;
 const vms_matrix vmd_identity_matrix = IDENTITY_MATRIX;
 
-//adds two vectors, fills in dest, returns ptr to dest
-//ok for dest to equal either source, but should use vm_vec_add2() if so
-vms_vector *vm_vec_add(vms_vector *dest,const vms_vector *src0,const vms_vector *src1)
-{
-	dest->x = src0->x + src1->x;
-	dest->y = src0->y + src1->y;
-	dest->z = src0->z + src1->z;
-
-	return dest;
-}
-
-
-//subs two vectors, fills in dest, returns ptr to dest
-//ok for dest to equal either source, but should use vm_vec_sub2() if so
-vms_vector *vm_vec_sub(vms_vector *dest,const vms_vector *src0,const vms_vector *src1)
-{
-	dest->x = src0->x - src1->x;
-	dest->y = src0->y - src1->y;
-	dest->z = src0->z - src1->z;
-
-	return dest;
-}
-
-//adds one vector to another. returns ptr to dest
-//dest can equal source
-vms_vector *vm_vec_add2(vms_vector *dest,const vms_vector *src)
-{
-	dest->x += src->x;
-	dest->y += src->y;
-	dest->z += src->z;
-
-	return dest;
-}
-
-//subs one vector from another, returns ptr to dest
-//dest can equal source
-vms_vector *vm_vec_sub2(vms_vector *dest,const vms_vector *src)
-{
-	dest->x -= src->x;
-	dest->y -= src->y;
-	dest->z -= src->z;
-
-	return dest;
-}
-
 //averages two vectors. returns ptr to dest
 //dest can equal either source
 vms_vector *vm_vec_avg(vms_vector *dest,const vms_vector *src0,const vms_vector *src1)
@@ -159,28 +127,6 @@ vms_vector *vm_vec_scale2(vms_vector *dest,fix n,fix d)
 	return dest;
 }
 
-fix vm_vec_dotprod(const vms_vector *v0,const vms_vector *v1)
-{
-#if 0
-	quadint q;
-
-	q.low = q.high = 0;
-
-	fixmulaccum(&q,v0->x,v1->x);
-	fixmulaccum(&q,v0->y,v1->y);
-	fixmulaccum(&q,v0->z,v1->z);
-
-	return fixquadadjust(&q);
-#else
-	long long p =
-		  (long long) v0->x * v1->x
-		+ (long long) v0->y * v1->y
-		+ (long long) v0->z * v1->z;
-	/* Convert back to fix and return. */
-	return p >> 16;
-#endif
-}
-
 fix vm_vec_dot3(fix x,fix y,fix z,const vms_vector *v)
 {
 #if 0
@@ -654,6 +600,122 @@ vms_vector *vm_vec_rotate(vms_vector *dest,const vms_vector *src,const vms_matri
 	return dest;
 }
 
+//The SIMD versions keep the full 64 bit products and sums, like the C
+//versions, and take the low 32 bits of the sum shifted down by 16, which
+//are the same for an arithmetic and a logical shift.
+
+#if defined(__SSE4_1__)
+//dot products of two vectors with the same row, in lanes 0 and 2
+static inline __m128i vm_dot2_sse(__m128i x,__m128i y,__m128i z,const vms_vector *row)
+{
+	__m128i s;
+
+	s = _mm_mul_epi32(x,_mm_set1_epi32(row->x));
+	s = _mm_add_epi64(s,_mm_mul_epi32(y,_mm_set1_epi32(row->y)));
+	s = _mm_add_epi64(s,_mm_mul_epi32(z,_mm_set1_epi32(row->z)));
+
+	return _mm_srli_epi64(s,16);
+}
+#elif defined(VM_NEON)
+static inline int32x2_t vm_dot2_neon(int32x2x3_t v,const vms_vector *row)
+{
+	int64x2_t s;
+
+	s = vmull_n_s32(v.val[0],row->x);
+	s = vmlal_n_s32(s,v.val[1],row->y);
+	s = vmlal_n_s32(s,v.val[2],row->z);
+
+	return vshrn_n_s64(s,16);
+}
+#endif
+
+//rotates n vectors through a matrix
+void vm_vec_rotate_n(vms_vector *dest,const vms_vector *src,int n,const vms_matrix *m)
+{
+	int i = 0;
+
+#if defined(__SSE4_1__)
+	for (; i+2 <= n; i+=2) {
+		__m128i x = _mm_set_epi32(0,src[i+1].x,0,src[i].x);
+		__m128i y = _mm_set_epi32(0,src[i+1].y,0,src[i].y);
+		__m128i z = _mm_set_epi32(0,src[i+1].z,0,src[i].z);
+		__m128i rx = vm_dot2_sse(x,y,z,&m->rvec);
+		__m128i ry = vm_dot2_sse(x,y,z,&m->uvec);
+		__m128i rz = vm_dot2_sse(x,y,z,&m->fvec);
+
+		dest[i].x = _mm_cvtsi128_si32(rx);
+		dest[i].y = _mm_cvtsi128_si32(ry);
+		dest[i].z = _mm_cvtsi128_si32(rz);
+		dest[i+1].x = _mm_extract_epi32(rx,2);
+		dest[i+1].y = _mm_extract_epi32(ry,2);
+		dest[i+1].z = _mm_extract_epi32(rz,2);
+	}
+#elif defined(VM_NEON)
+	for (; i+2 <= n; i+=2) {
+		int32x2x3_t v = vld3_s32(&src[i].x);
+		int32x2x3_t r;
+
+		r.val[0] = vm_dot2_neon(v,&m->rvec);
+		r.val[1] = vm_dot2_neon(v,&m->uvec);
+		r.val[2] = vm_dot2_neon(v,&m->fvec);
+		vst3_s32(&dest[i].x,r);
+	}
+#endif
+
+	for (; i<n; i++)
+		vm_vec_rotate(&dest[i],&src[i],m);
+}
+
+//dot products of n pairs of vectors
+void vm_vec_dot_n(fix *dest,const vms_vector *v0,const vms_vector *v1,int n)
+{
+	int i = 0;
+
+#if defined(__SSE4_1__)
+	for (; i+2 <= n; i+=2) {
+		__m128i s;
+
+		s = _mm_mul_epi32(_mm_set_epi32(0,v0[i+1].x,0,v0[i].x),_mm_set_epi32(0,v1[i+1].x,0,v1[i].x));
+		s = _mm_add_epi64(s,_mm_mul_epi32(_mm_set_epi32(0,v0[i+1].y,0,v0[i].y),_mm_set_epi32(0,v1[i+1].y,0,v1[i].y)));
+		s = _mm_add_epi64(s,_mm_mul_epi32(_mm_set_epi32(0,v0[i+1].z,0,v0[i].z),_mm_set_epi32(0,v1[i+1].z,0,v1[i].z)));
+		s = _mm_srli_epi64(s,16);
+
+		dest[i] = _mm_cvtsi128_si32(s);
+		dest[i+1] = _mm_extract_epi32(s,2);
+	}
+#elif defined(VM_NEON)
+	for (; i+2 <= n; i+=2) {
+		int32x2x3_t a = vld3_s32(&v0[i].x);
+		int32x2x3_t b = vld3_s32(&v1[i].x);
+		int64x2_t s;
+
+		s = vmull_s32(a.val[0],b.val[0]);
+		s = vmlal_s32(s,a.val[1],b.val[1]);
+		s = vmlal_s32(s,a.val[2],b.val[2]);
+		vst1_s32(&dest[i],vshrn_n_s64(s,16));
+	}
+#endif
+
+	for (; i<n; i++)
+		dest[i] = vm_vec_dot(&v0[i],&v1[i]);
+}
+
+//magnitudes of n vectors.  only the sums of squares are computed together,
+//since quad_sqrt() has to be called for each one to get the same results
+void vm_vec_mag_n(fix *dest,const vms_vector *v,int n)
+{
+	int i;
+
+	for (i=0; i<n; i++) {
+		u_int64_t s =
+			  (u_int64_t)((fix64)v[i].x * v[i].x)
+			+ (u_int64_t)((fix64)v[i].y * v[i].y)
+			+ (u_int64_t)((fix64)v[i].z * v[i].z);
+
+		dest[i] = quad_sqrt((u_int32_t)s,(int32_t)(s >> 32));
+	}
+}
+
 
 //transpose a matrix in place. returns ptr to matrix
 vms_matrix *vm_transpose_matrix(vms_matrix *m)
@@ -868,3 +930,189 @@ bool vm_vec_equal(const vms_vector * v1, const vms_vector * v2) {
 bool vm_mat_equal(const vms_matrix * m1, const vms_matrix * m2) {
 	return vm_vec_equal(&m1->rvec, &m2->rvec) && vm_vec_equal(&m1->uvec, &m2->uvec) && vm_vec_equal(&m1->fvec, &m2->fvec);
 }
+
+#ifndef NDEBUG
+//the quadint version of fixmulaccum() the inline one replaced
+static void vm_test_fixmulaccum(quadint *q,fix a,fix b)
+{
+	u_int32_t aa,bb;
+	u_int32_t ah,al,bh,bl;
+	u_int32_t t,old;
+	int neg;
+
+	neg = ((a^b) < 0);
+
+	aa = (a < 0) ? 0u - (u_int32_t)a : (u_int32_t)a;
+	bb = (b < 0) ? 0u - (u_int32_t)b : (u_int32_t)b;
+
+	ah = aa>>16;  al = aa&0xffff;
+	bh = bb>>16;  bl = bb&0xffff;
+
+	t = ah*bl + bh*al;
+
+	if (neg)
+		fixquadnegate(q);
+
+	old = q->low;
+	q->low += al*bl;
+	if (q->low < old) q->high++;
+
+	old = q->low;
+	q->low += (t<<16);
+	if (q->low < old) q->high++;
+
+	q->high += ah*bh + (t>>16);
+
+	if (neg)
+		fixquadnegate(q);
+}
+
+static fix vm_test_dot(const vms_vector *v0,const vms_vector *v1)
+{
+	quadint q;
+
+	q.low = q.high = 0;
+	vm_test_fixmulaccum(&q,v0->x,v1->x);
+	vm_test_fixmulaccum(&q,v0->y,v1->y);
+	vm_test_fixmulaccum(&q,v0->z,v1->z);
+
+	return (q.high<<16) + (q.low>>16);
+}
+
+static u_int32_t Test_seed;
+
+static fix vm_test_rand(void)
+{
+	Test_seed = Test_seed * 1103515245 + 12345;
+	return (fix)((Test_seed >> 16) | (Test_seed << 16));
+}
+
+#define TEST_NUM_EDGES	(11+4*30)
+#define TEST_NUM_VECS	4096
+#define TEST_LOOPS	64
+
+//every pair of edge values, then random vectors, some with small
+//components like the ones in the game
+int vm_test_math(void)
+{
+	static const fix fixed_edges[11] = {0,1,-1,0xffff,-0xffff,0x10000,-0x10000,0x7fff,0x8000,INT_MAX,INT_MIN};
+	fix edges[TEST_NUM_EDGES];
+	vms_vector *v0,*v1,*r0,*r1;
+	fix *f0,*f1,sink = 0;
+	vms_matrix m;
+	int i,j,n,num_edges = 0,num_differ = 0;
+	u_int64_t t,usec[6];
+
+	for (i=0; i<11; i++)
+		edges[num_edges++] = fixed_edges[i];
+	for (i=1; i<31; i++) {
+		edges[num_edges++] = (1<<i) + 1;
+		edges[num_edges++] = (1<<i) - 1;
+		edges[num_edges++] = -(1<<i) + 1;
+		edges[num_edges++] = -(1<<i) - 1;
+	}
+
+	for (i=0; i<num_edges; i++)
+		for (j=0; j<num_edges; j++) {
+			quadint q0,q1;
+			fix64 p = (fix64)edges[i] * edges[j];
+
+			q0.low = q1.low = 0x89abcdef;
+			q0.high = q1.high = -0x1234567;
+			fixmulaccum(&q0,edges[i],edges[j]);
+			vm_test_fixmulaccum(&q1,edges[i],edges[j]);
+			if (q0.low != q1.low || q0.high != q1.high || fixquadadjust(&q0) != (fix)((q1.high<<16) + (q1.low>>16)))
+				num_differ++;
+
+			if (fixmul(edges[i],edges[j]) != (fix)(p / 65536) || fixmul64(edges[i],edges[j]) != p / 65536)
+				num_differ++;
+		}
+
+	MALLOC(v0,vms_vector,TEST_NUM_VECS);
+	MALLOC(v1,vms_vector,TEST_NUM_VECS);
+	MALLOC(r0,vms_vector,TEST_NUM_VECS);
+	MALLOC(r1,vms_vector,TEST_NUM_VECS);
+	MALLOC(f0,fix,TEST_NUM_VECS);
+	MALLOC(f1,fix,TEST_NUM_VECS);
+
+	Test_seed = 1;
+	for (i=0; i<TEST_NUM_VECS; i++) {
+		int shift = (i & 3) ? 8 : 0;	//every 4th one is full range
+
+		if (i < num_edges*3) {
+			v0[i].x = edges[i % num_edges]; v0[i].y = edges[(i/3) % num_edges]; v0[i].z = edges[(i*7) % num_edges];
+		}
+		else {
+			v0[i].x = vm_test_rand() >> shift; v0[i].y = vm_test_rand() >> shift; v0[i].z = vm_test_rand() >> shift;
+		}
+		v1[i].x = vm_test_rand() >> shift; v1[i].y = vm_test_rand() >> shift; v1[i].z = vm_test_rand() >> shift;
+	}
+	m.rvec = v1[1]; m.uvec = v1[2]; m.fvec = v1[3];
+
+	//batch against scalar, and dot against the quadint version
+	vm_vec_rotate_n(r0,v0,TEST_NUM_VECS,&m);
+	vm_vec_dot_n(f0,v0,v1,TEST_NUM_VECS);
+	for (i=0; i<TEST_NUM_VECS; i++) {
+		vm_vec_rotate(&r1[i],&v0[i],&m);
+		if (!vm_vec_equal(&r0[i],&r1[i]))
+			num_differ++;
+		if (f0[i] != vm_vec_dot(&v0[i],&v1[i]) || f0[i] != vm_test_dot(&v0[i],&v1[i]))
+			num_differ++;
+	}
+
+	//quad_sqrt() only takes sums of squares that fit in 63 bits
+	for (i=0; i<TEST_NUM_VECS; i++) {
+		v0[i].x >>= 1; v0[i].y >>= 1; v0[i].z >>= 1;
+	}
+	vm_vec_mag_n(f0,v0,TEST_NUM_VECS);
+	for (i=0; i<TEST_NUM_VECS; i++)
+		if (f0[i] != vm_vec_mag(&v0[i]))
+			num_differ++;
+
+	t = timer_query_usec();
+	for (n=0; n<TEST_LOOPS; n++)
+		for (i=0; i<TEST_NUM_VECS; i++)
+			sink += fixmul(v0[i].x,v1[i].y);
+	usec[0] = timer_query_usec() - t;
+
+	t = timer_query_usec();
+	for (n=0; n<TEST_LOOPS; n++)
+		for (i=0; i<TEST_NUM_VECS; i++)
+			f1[i] = vm_vec_dot(&v0[i],&v1[i]);
+	usec[1] = timer_query_usec() - t;
+
+	t = timer_query_usec();
+	for (n=0; n<TEST_LOOPS; n++)
+		vm_vec_dot_n(f0,v0,v1,TEST_NUM_VECS);
+	usec[2] = timer_query_usec() - t;
+
+	t = timer_query_usec();
+	for (n=0; n<TEST_LOOPS; n++)
+		for (i=0; i<TEST_NUM_VECS; i++)
+			vm_vec_rotate(&r1[i],&v0[i],&m);
+	usec[3] = timer_query_usec() - t;
+
+	t = timer_query_usec();
+	for (n=0; n<TEST_LOOPS; n++)
+		vm_vec_rotate_n(r0,v0,TEST_NUM_VECS,&m);
+	usec[4] = timer_query_usec() - t;
+
+	t = timer_query_usec();
+	for (n=0; n<TEST_LOOPS; n++)
+		vm_vec_mag_n(f0,v0,TEST_NUM_VECS);
+	usec[5] = timer_query_usec() - t;
+
+	d_free(v0);
+	d_free(v1);
+	d_free(r0);
+	d_free(r1);
+	d_free(f0);
+	d_free(f1);
+
+	con_printf(CON_NORMAL, "%i x %i: fixmul %lu us, vm_vec_dot %lu us, vm_vec_dot_n %lu us, vm_vec_rotate %lu us, vm_vec_rotate_n %lu us, vm_vec_mag_n %lu us (%i)\n",
+		TEST_LOOPS, TEST_NUM_VECS, (unsigned long)usec[0], (unsigned long)usec[1], (unsigned long)usec[2], (unsigned long)usec[3], (unsigned long)usec[4], (unsigned long)usec[5], sink & 1);
+	con_printf(CON_NORMAL, "%i pairs of edge values and %i vectors checked, %i results differ\n", num_edges*num_edges, TEST_NUM_VECS, num_differ);
+
+	return num_differ;
+}
+#endif
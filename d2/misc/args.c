@@ -143,6 +143,8 @@ void ReadCmdArgs(void)
 	GameArg.SysWindow 		= FindArg("-window");
 	GameArg.SysNoBorders 		= FindArg("-noborders");
 	GameArg.SysNoMovies 		= FindArg("-nomovies");
+	GameArg.SysThreads 		= get_int_arg("-threads", 0);
+	GameArg.SysNoLevelCache		= FindArg("-nolevelcache");
 	GameArg.SysAutoDemo 		= FindArg("-autodemo");
 
 	// Control Options
@@ -179,6 +181,10 @@ void ReadCmdArgs(void)
 	// OpenGL Options
 
 	GameArg.OglFixedFont 		= FindArg("-gl_fixedfont");
+	GameArg.OglCapture 		= get_str_arg("-gl_capture", NULL);
+	GameArg.OglCaptureFPS 		= get_int_arg("-gl_capturefps", 30);
+	if (GameArg.OglCaptureFPS <= 0 || GameArg.OglCaptureFPS > MAXIMUM_FPS)
+		GameArg.OglCaptureFPS = 30;
 #endif
 
 	// Multiplayer Options
@@ -212,12 +218,15 @@ void ReadCmdArgs(void)
 #endif
 #endif
 
+	GameArg.MplDxmaMirror		= get_str_arg("-dxmamirror", NULL);
+
 #ifdef EDITOR
 	// Editor Options
 
 	GameArg.EdiAutoLoad 		= get_str_arg("-autoload", NULL);
 	GameArg.EdiMacData 		= FindArg("-macdata");
 	GameArg.EdiSaveHoardData 	= FindArg("-hoarddata");
+	GameArg.EdiRelight 		= get_str_arg("-relight", NULL);
 #endif
 
 	// Debug Options
@@ -229,6 +238,7 @@ void ReadCmdArgs(void)
 	GameArg.DbgSafelog 		= FindArg("-safelog");
 	GameArg.DbgNoRun 		= FindArg("-norun");
 	GameArg.DbgRenderStats 		= FindArg("-renderstats");
+	GameArg.DbgProfile 		= FindArg("-profile");
 	GameArg.DbgAltTex 		= get_str_arg("-text", NULL);
 	GameArg.DbgTexMap 		= get_str_arg("-tmap", NULL);
 	GameArg.DbgShowMemInfo 		= FindArg("-showmeminfo");
@@ -15,6 +15,19 @@
 #include <ApplicationServices/ApplicationServices.h>
 #endif
 
+#include <sys/stat.h>
+#ifdef _WIN32
+#include <windows.h>
+#elif defined(__unix__) || defined(__APPLE__) || defined(__MACH__)
+#include <sys/mman.h>
+#include <fcntl.h>
+#include <unistd.h>
+#define PHYSFSX_MMAP
+#endif
+#ifndef S_ISDIR
+#define S_ISDIR(m) (((m) & S_IFMT) == S_IFDIR)
+#endif
+
 #include "physfsx.h"
 #include "args.h"
 #include "object.h"
@@ -470,6 +483,160 @@ PHYSFS_file *PHYSFSX_openWriteBuffered(const char *filename)
 	return fp;
 }
 
+// Map a whole file on the native filesystem into memory, copy on write, so stray writes can't reach the file.
+static void *PHYSFSX_mapNative(const char *path, size_t *size)
+{
+#ifdef _WIN32
+	HANDLE file, mapping;
+	LARGE_INTEGER length;
+	void *base = NULL;
+
+	file = CreateFileA(path, GENERIC_READ, FILE_SHARE_READ, NULL, OPEN_EXISTING, FILE_ATTRIBUTE_NORMAL, NULL);
+	if (file == INVALID_HANDLE_VALUE)
+		return NULL;
+
+	if (GetFileSizeEx(file, &length) && length.QuadPart > 0 && (size_t)length.QuadPart == length.QuadPart)
+	{
+		mapping = CreateFileMappingA(file, NULL, PAGE_WRITECOPY, 0, 0, NULL);
+		if (mapping)
+		{
+			base = MapViewOfFile(mapping, FILE_MAP_COPY, 0, 0, 0);
+			CloseHandle(mapping);	// the view keeps the mapping alive
+		}
+		*size = (size_t)length.QuadPart;
+	}
+	CloseHandle(file);
+
+	return base;
+#elif defined(PHYSFSX_MMAP)
+	struct stat st;
+	void *base = NULL;
+	int fd;
+
+	fd = open(path, O_RDONLY);
+	if (fd < 0)
+		return NULL;
+
+	if (!fstat(fd, &st) && st.st_size > 0)
+	{
+		base = mmap(NULL, st.st_size, PROT_READ | PROT_WRITE, MAP_PRIVATE, fd, 0);
+		if (base == MAP_FAILED)
+			base = NULL;
+		*size = st.st_size;
+	}
+	close(fd);
+
+	return base;
+#else
+	return NULL;
+#endif
+}
+
+static void PHYSFSX_unmapNative(void *base, size_t size)
+{
+#ifdef _WIN32
+	UnmapViewOfFile(base);
+#elif defined(PHYSFSX_MMAP)
+	munmap(base, size);
+#endif
+}
+
+// Find filename in a mapped Descent HOG archive: "DHF", then for each file a 13 byte name, its length and its data.
+static int PHYSFSX_findInHog(ubyte *base, size_t size, const char *filename, ubyte **data, PHYSFS_sint64 *length)
+{
+	size_t pos = 3;
+
+	if (size < 3 || memcmp(base, "DHF", 3))
+		return 0;
+
+	while (pos + 17 <= size)
+	{
+		char name[14];
+		int file_length;
+
+		memcpy(name, base + pos, 13);
+		name[13] = 0;
+		memcpy(&file_length, base + pos + 13, 4);
+		file_length = INTEL_INT(file_length);
+		pos += 17;
+
+		if (file_length < 0 || (size_t)file_length > size - pos)
+			return 0;
+
+		if (!d_stricmp(name, filename))
+		{
+			*data = base + pos;
+			*length = file_length;
+			return 1;
+		}
+
+		pos += file_length;
+	}
+
+	return 0;
+}
+
+// Map a file for reading in place.  Works for plain files and files in uncompressed HOGs, returns NULL for
+// anything else, so the caller can read it through PhysFS instead.
+PHYSFSX_map *PHYSFSX_openMapped(const char *filename)
+{
+	PHYSFSX_map *map;
+	char filename2[PATH_MAX], path[PATH_MAX];
+	const char *realDir;
+	struct stat st;
+
+	if (filename[0] == '\x01')
+		filename++;
+
+	snprintf(filename2, sizeof(filename2), "%s", filename);
+	PHYSFSEXT_locateCorrectCase(filename2);
+
+	realDir = PHYSFS_getRealDir(filename2);
+	if (!realDir || stat(realDir, &st))
+		return NULL;
+
+	MALLOC(map, PHYSFSX_map, 1);
+	if (!map)
+		return NULL;
+
+	if (S_ISDIR(st.st_mode))
+	{
+		if (!PHYSFSX_getRealPath(filename2, path) || !(map->base = PHYSFSX_mapNative(path, &map->base_size)))
+		{
+			d_free(map);
+			return NULL;
+		}
+		map->data = map->base;
+		map->size = map->base_size;
+	}
+	else
+	{
+		// an archive; only the files in the root of a HOG can be read in place
+		if (strchr(filename2, '/') || !(map->base = PHYSFSX_mapNative(realDir, &map->base_size)))
+		{
+			d_free(map);
+			return NULL;
+		}
+		if (!PHYSFSX_findInHog(map->base, map->base_size, filename2, &map->data, &map->size))
+		{
+			PHYSFSX_unmapNative(map->base, map->base_size);
+			d_free(map);
+			return NULL;
+		}
+	}
+
+	return map;
+}
+
+void PHYSFSX_closeMapped(PHYSFSX_map *map)
+{
+	if (!map)
+		return;
+
+	PHYSFSX_unmapNative(map->base, map->base_size);
+	d_free(map);
+}
+
 /* 
  * Add archives to the game.
  * 1) archives from Sharepath/Data to extend/replace builtin game content
@@ -25,6 +25,7 @@ COPYRIGHT 1993-1998 PARALLAX SOFTWARE CORPORATION.  ALL RIGHTS RESERVED.
 #define WIREFRAME 0
 #define PERSPECTIVE 1
 
+#include <limits.h>
 #include "pstypes.h"
 #include "fix.h"
 #include "vecmat.h"
@@ -60,8 +61,8 @@ int	Max_flat_depth;
 // These variables are the interface to assembler.  They get set for each texture map, which is a real waste of time.
 //	They should be set only when they change, which is generally when the window bounds change.  And, even still, it's
 //	a pretty bad interface.
-int	bytes_per_row=-1;
-unsigned char *write_buffer;
+TMAP_THREAD int	bytes_per_row=-1;
+TMAP_THREAD unsigned char *write_buffer;
 int  	window_left;
 int	window_right;
 int	window_top;
@@ -72,19 +73,22 @@ int	*y_pointers=NULL;
 
 fix fix_recip[FIX_RECIP_TABLE_SIZE];
 
-int	Lighting_enabled;
+TMAP_THREAD int	Lighting_enabled;
 int	Fix_recip_table_computed=0;
 
-fix fx_l, fx_u, fx_v, fx_z, fx_du_dx, fx_dv_dx, fx_dz_dx, fx_dl_dx;
-int fx_xleft, fx_xright, fx_y;
-unsigned char * pixptr;
-int per2_flag = 0;
-int Transparency_on = 0;
-int dither_intensity_lighting = 0;
+TMAP_THREAD fix fx_l, fx_u, fx_v, fx_z, fx_du_dx, fx_dv_dx, fx_dz_dx, fx_dl_dx;
+TMAP_THREAD int fx_xleft, fx_xright, fx_y;
+TMAP_THREAD unsigned char * pixptr;
+TMAP_THREAD int per2_flag = 0;
+TMAP_THREAD int Transparency_on = 0;
+TMAP_THREAD int dither_intensity_lighting = 0;
 
-ubyte * tmap_flat_cthru_table;
-ubyte tmap_flat_color;
-ubyte tmap_flat_shade_value;
+TMAP_THREAD ubyte * tmap_flat_cthru_table;
+TMAP_THREAD ubyte tmap_flat_color;
+TMAP_THREAD ubyte tmap_flat_shade_value;
+TMAP_THREAD int tmap_flat_fade_level = GR_FADE_OFF;
+
+TMAP_THREAD int Tmap_band_top = INT_MIN, Tmap_band_bot = INT_MAX;
 
 
 
@@ -360,6 +364,9 @@ void ntmap_scanline_lighted(grs_bitmap *srcb, int y, fix xleft, fix xright, fix
 {
 	fix	dx,recip_dx;
 
+	if (y < Tmap_band_top || y > Tmap_band_bot)
+		return;
+
 	fx_xright = f2i(xright);
 	//edited 06/27/99 Matt Mueller - moved these tests up from within the switch so as not to do a bunch of needless calculations when we are just gonna return anyway.  Slight fps boost?
 	if (fx_xright < Window_clip_left)
@@ -534,6 +541,9 @@ void ntexture_map_lighted(grs_bitmap *srcb, g3ds_tmap *t)
 
 	for (y = topy; y < boty; y++) {
 
+		if (y > Tmap_band_bot)
+			return;
+
 		// See if we have reached the end of the current left edge, and if so, set
 		// new values for dx_dy and x,u,v
 		if (y == next_break_left) {
@@ -644,6 +654,9 @@ void ntmap_scanline_lighted_linear(grs_bitmap *srcb, int y, fix xleft, fix xrigh
 {
 	fix	dx,recip_dx,du_dx,dv_dx,dl_dx;
 
+	if (y < Tmap_band_top || y > Tmap_band_bot)
+		return;
+
 	dx = f2i(xright) - f2i(xleft);
 	if ((dx < 0) || (xright < 0) || (xleft > xright))		// the (xleft > xright) term is not redundant with (dx < 0) because dx is computed using integers
 		return;
@@ -806,6 +819,9 @@ void ntexture_map_lighted_linear(grs_bitmap *srcb, g3ds_tmap *t)
 
 	for (y = topy; y < boty; y++) {
 
+		if (y > Tmap_band_bot)
+			return;
+
 		// See if we have reached the end of the current left edge, and if so, set
 		// new values for dx_dy and x,u,v
 		if (y == next_break_left) {
@@ -900,6 +916,24 @@ void ntexture_map_lighted_linear(grs_bitmap *srcb, g3ds_tmap *t)
 
 // fix	DivNum = F1_0*12;
 
+// -------------------------------------------------------------------------------------
+//	Rasterize right away, or queue for the tile binner while it is collecting a frame.
+// -------------------------------------------------------------------------------------
+static void ntmap_draw(grs_bitmap *bp, g3ds_tmap *t, int perspective)
+{
+#ifndef OGL
+	if (Tmap_bin_active) {
+		tmap_bin_add_tmap(bp, t, perspective);
+		return;
+	}
+#endif
+
+	if (perspective)
+		ntexture_map_lighted(bp, t);
+	else
+		ntexture_map_lighted_linear(bp, t);
+}
+
 // -------------------------------------------------------------------------------------
 // Interface from Matt's data structures to Mike's texture mapper.
 // -------------------------------------------------------------------------------------
@@ -926,8 +960,13 @@ void draw_tmap(grs_bitmap *bp,int nverts,g3s_point **vertbuf)
 		return;
 	}
 
-	if ( bp->bm_flags & BM_FLAG_RLE )
+	if ( bp->bm_flags & BM_FLAG_RLE ) {
+#ifndef OGL
+		if (Tmap_bin_active)
+			tmap_bin_pin_rle(bp);		// queued faces must not lose their expanded bitmap
+#endif
 		bp = rle_expand_texture( bp );		// Expand if rle'd
+	}
 
 	Transparency_on = bp->bm_flags & BM_FLAG_TRANSPARENT;
 	if (bp->bm_flags & BM_FLAG_NO_LIGHTING)
@@ -971,21 +1010,21 @@ void draw_tmap(grs_bitmap *bp,int nverts,g3s_point **vertbuf)
 			case 0:								// choose best interpolation
 				per2_flag = 1;
 				if (Current_seg_depth > Max_perspective_depth)
-					ntexture_map_lighted_linear(bp, &Tmap1);
+					ntmap_draw(bp, &Tmap1, 0);
 				else
-					ntexture_map_lighted(bp, &Tmap1);
+					ntmap_draw(bp, &Tmap1, 1);
 				break;
 			case 1:								// linear interpolation
 				per2_flag = 1;
-				ntexture_map_lighted_linear(bp, &Tmap1);
+				ntmap_draw(bp, &Tmap1, 0);
 				break;
 			case 2:								// perspective every 8th pixel interpolation
 				per2_flag = 1;
-				ntexture_map_lighted(bp, &Tmap1);
+				ntmap_draw(bp, &Tmap1, 1);
 				break;
 			case 3:								// perspective every pixel interpolation
 				per2_flag = 0;					// this hack means do divide every pixel
-				ntexture_map_lighted(bp, &Tmap1);
+				ntmap_draw(bp, &Tmap1, 1);
 				break;
 			default:
 				Assert(0);				// Illegal value for Interpolation_method, must be 0,1,2,3
@@ -995,21 +1034,21 @@ void draw_tmap(grs_bitmap *bp,int nverts,g3s_point **vertbuf)
 			case 0:								// choose best interpolation
 				per2_flag = 1;
 				if (Current_seg_depth > Max_perspective_depth)
-					ntexture_map_lighted_linear(bp, &Tmap1);
+					ntmap_draw(bp, &Tmap1, 0);
 				else
-					ntexture_map_lighted(bp, &Tmap1);
+					ntmap_draw(bp, &Tmap1, 1);
 				break;
 			case 1:								// linear interpolation
 				per2_flag = 1;
-				ntexture_map_lighted_linear(bp, &Tmap1);
+				ntmap_draw(bp, &Tmap1, 0);
 				break;
 			case 2:								// perspective every 8th pixel interpolation
 				per2_flag = 1;
-				ntexture_map_lighted(bp, &Tmap1);
+				ntmap_draw(bp, &Tmap1, 1);
 				break;
 			case 3:								// perspective every pixel interpolation
 				per2_flag = 0;					// this hack means do divide every pixel
-				ntexture_map_lighted(bp, &Tmap1);
+				ntmap_draw(bp, &Tmap1, 1);
 				break;
 			default:
 				Assert(0);				// Illegal value for Interpolation_method, must be 0,1,2,3
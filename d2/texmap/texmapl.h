@@ -27,9 +27,8 @@ extern fix compute_dx_dy(g3ds_tmap *t, int top_vertex,int bottom_vertex, fix rec
 extern void compute_y_bounds(g3ds_tmap *t, int *vlt, int *vlb, int *vrt, int *vrb,int *bottom_y_ind);
 extern void asm_tmap_scanline_lin_v(void);
 
-extern int	fx_y,fx_xleft,fx_xright,per2_flag;
-extern unsigned char tmap_flat_color;
-extern unsigned char *pixptr;
+extern TMAP_THREAD int	fx_y,fx_xleft,fx_xright;
+extern TMAP_THREAD unsigned char *pixptr;
 
 // texture mapper scanline renderers
 extern	void asm_tmap_scanline_per(void);
@@ -59,13 +58,12 @@ extern fix compute_dv_dy_lin(g3ds_tmap *t,int vrt,int vrb, fix recip_dy);
 
 
 // Interface variables to assembler code
-extern	fix	fx_u,fx_v,fx_z,fx_du_dx,fx_dv_dx,fx_dz_dx;
-extern	fix	fx_dl_dx,fx_l;
+extern	TMAP_THREAD fix	fx_u,fx_v,fx_z,fx_du_dx,fx_dv_dx,fx_dz_dx;
+extern	TMAP_THREAD fix	fx_dl_dx,fx_l;
 extern	int	fx_r,fx_g,fx_b,fx_dr_dx,fx_dg_dx,fx_db_dx;
-extern	unsigned char *pixptr;
 
-extern	int	bytes_per_row;
-extern  unsigned char *write_buffer;
+extern	TMAP_THREAD int	bytes_per_row;
+extern  TMAP_THREAD unsigned char *write_buffer;
 extern	int  	window_left;
 extern	int	window_right;
 extern	int	window_top;
@@ -74,12 +72,26 @@ extern	int  	window_width;
 extern	int  	window_height;
 extern	int	scan_doubling_flag;
 extern	int	linear_if_far_flag;
-extern	int	dither_intensity_lighting;
+extern	TMAP_THREAD int	dither_intensity_lighting;
 extern	int	Interlacing_on;
 
-extern ubyte * tmap_flat_cthru_table;
-extern ubyte tmap_flat_color;
-extern ubyte tmap_flat_shade_value;
+extern TMAP_THREAD ubyte * tmap_flat_cthru_table;
+extern TMAP_THREAD ubyte tmap_flat_color;
+extern TMAP_THREAD ubyte tmap_flat_shade_value;
+extern TMAP_THREAD int tmap_flat_fade_level;
+extern TMAP_THREAD int Lighting_enabled;
+
+// Rows the rasterizer may write to.  Everything outside is skipped, but still stepped over so that the rows
+// inside come out exactly as if the whole polygon was drawn.  Set to a screen band by the tile binner.
+extern TMAP_THREAD int Tmap_band_top, Tmap_band_bot;
+
+extern void ntexture_map_lighted(grs_bitmap *srcb, g3ds_tmap *t);
+extern void texture_map_flat_faded(g3ds_tmap *t, int color, int fade_level);
+
+// tile binner (tmapbin.c)
+extern void tmap_bin_add_tmap(grs_bitmap *bp, g3ds_tmap *t, int perspective);
+extern void tmap_bin_add_flat(int nverts, int *vert, int color, int fade_level);
+extern void tmap_bin_pin_rle(grs_bitmap *bp);
 
 
 extern fix fix_recip[];
@@ -0,0 +1,328 @@
+/*
+ *
+ * Screen tile binner for the software texture mapper.
+ *
+ * While render_mine() is drawing, texture maps and flat polygons are queued instead of drawn.  Each one is
+ * binned into the horizontal bands of the canvas it covers, and the bands are then rasterized in parallel on
+ * the worker threads.  A band replays its polygons in the order they were queued, and the rasterizer steps
+ * over the rows outside the band without drawing them (see Tmap_band_top), so the result is exactly the same
+ * as drawing everything on one thread.  Bands rather than square tiles keep every scanline in one piece.
+ *
+ */
+
+#include <string.h>
+#include <limits.h>
+
+#include "pstypes.h"
+#include "fix.h"
+#include "gr.h"
+#include "3d.h"
+#include "texmap.h"
+#include "texmapl.h"
+#include "rle.h"
+#include "u_mem.h"
+#include "dxxerror.h"
+#include "worker.h"
+
+#ifndef OGL
+
+#define TMAP_BIN_LINEAR		0
+#define TMAP_BIN_PERSPECTIVE	1
+#define TMAP_BIN_FLAT		2
+
+#define TMAP_BIN_BANDS_PER_THREAD	2	// a few more bands than threads evens out busy and empty bands
+#define TMAP_BIN_MAX_BANDS		(MAX_WORKER_THREADS*TMAP_BIN_BANDS_PER_THREAD)
+#define TMAP_BIN_MIN_BAND_HEIGHT	16
+#define TMAP_BIN_MAX_CMDS		8192	// flush when this many are queued, to bound the memory used
+
+// One queued polygon, with the rasterizer state it was queued with.
+typedef struct tmap_bin_cmd {
+	grs_bitmap	*bp;
+	int		first_vert;		// index into Bin_verts
+	ubyte		nv;
+	ubyte		type;
+	ubyte		lighting, transparency, per2;
+	ubyte		color;
+	short		fade_level;
+	short		clip_left, clip_top, clip_right, clip_bot;
+} tmap_bin_cmd;
+
+typedef struct tmap_bin_band {
+	int		top, bot;
+	int		*cmds;			// indices into Bin_cmds, in the order they were queued
+	int		num_cmds, max_cmds;
+} tmap_bin_band;
+
+int Tmap_bin_active = 0;
+
+static tmap_bin_cmd *Bin_cmds = NULL;
+static int Bin_num_cmds = 0, Bin_max_cmds = 0;
+static g3ds_vertex *Bin_verts = NULL;
+static int Bin_num_verts = 0, Bin_max_verts = 0;
+
+static tmap_bin_band Bin_bands[TMAP_BIN_MAX_BANDS];
+static int Bin_num_bands = 0, Bin_band_height = 0;
+
+// rle bitmaps expanded by queued polygons, which must stay in the rle cache until they are drawn
+static grs_bitmap *Bin_pinned_rle[MAX_CACHE_BITMAPS];
+static int Bin_num_pinned = 0;
+
+// canvas memory the queued polygons are drawn to
+static unsigned char *Bin_write_buffer;
+static int Bin_bytes_per_row;
+
+// -------------------------------------------------------------------------------------
+void tmap_bin_begin(void)
+{
+#ifdef NO_ASM
+	int	h, i;
+
+	if (Tmap_bin_active || worker_num_threads() < 2)
+		return;
+
+	h = grd_curcanv->cv_bitmap.bm_h;
+	Bin_num_bands = worker_num_threads() * TMAP_BIN_BANDS_PER_THREAD;
+	Bin_band_height = (h + Bin_num_bands - 1) / Bin_num_bands;
+	if (Bin_band_height < TMAP_BIN_MIN_BAND_HEIGHT)
+		Bin_band_height = TMAP_BIN_MIN_BAND_HEIGHT;
+	Bin_num_bands = (h + Bin_band_height - 1) / Bin_band_height;
+	if (Bin_num_bands < 2)
+		return;
+
+	for (i=0; i<Bin_num_bands; i++) {
+		Bin_bands[i].top = i * Bin_band_height;
+		Bin_bands[i].bot = min(Bin_bands[i].top + Bin_band_height, h) - 1;
+		Bin_bands[i].num_cmds = 0;
+	}
+
+	// set up for the current canvas by init_interface_vars_to_assembler() in g3_start_frame()
+	Bin_write_buffer = write_buffer;
+	Bin_bytes_per_row = bytes_per_row;
+
+	Bin_num_cmds = Bin_num_verts = Bin_num_pinned = 0;
+	Tmap_bin_active = 1;
+#endif
+}
+
+// -------------------------------------------------------------------------------------
+//	Rasterize all polygons queued in one band.  Runs on any thread, with the per thread rasterizer state.
+static void tmap_bin_draw_band(void *data, int band_num, int thread)
+{
+	tmap_bin_band	*band = &Bin_bands[band_num];
+	g3ds_tmap	t;
+	int		i;
+	unsigned char	*save_write_buffer = write_buffer;
+	int		save_bytes_per_row = bytes_per_row;
+	int		save_clip_left = Window_clip_left, save_clip_top = Window_clip_top;
+	int		save_clip_right = Window_clip_right, save_clip_bot = Window_clip_bot;
+	int		save_lighting = Lighting_enabled, save_transparency = Transparency_on, save_per2 = per2_flag;
+
+	write_buffer = Bin_write_buffer;
+	bytes_per_row = Bin_bytes_per_row;
+	Tmap_band_top = band->top;
+	Tmap_band_bot = band->bot;
+
+	for (i=0; i<band->num_cmds; i++) {
+		tmap_bin_cmd *cmd = &Bin_cmds[band->cmds[i]];
+
+		t.nv = cmd->nv;
+		memcpy(t.verts, &Bin_verts[cmd->first_vert], cmd->nv * sizeof(g3ds_vertex));
+
+		Window_clip_left = cmd->clip_left;
+		Window_clip_top = cmd->clip_top;
+		Window_clip_right = cmd->clip_right;
+		Window_clip_bot = cmd->clip_bot;
+
+		if (cmd->type == TMAP_BIN_FLAT) {
+			texture_map_flat_faded(&t, cmd->color, cmd->fade_level);
+			continue;
+		}
+
+		Lighting_enabled = cmd->lighting;
+		Transparency_on = cmd->transparency;
+		per2_flag = cmd->per2;
+
+		if (cmd->type == TMAP_BIN_PERSPECTIVE)
+			ntexture_map_lighted(cmd->bp, &t);
+		else
+			ntexture_map_lighted_linear(cmd->bp, &t);
+	}
+
+	Tmap_band_top = INT_MIN;
+	Tmap_band_bot = INT_MAX;
+	write_buffer = save_write_buffer;
+	bytes_per_row = save_bytes_per_row;
+	Window_clip_left = save_clip_left;
+	Window_clip_top = save_clip_top;
+	Window_clip_right = save_clip_right;
+	Window_clip_bot = save_clip_bot;
+	Lighting_enabled = save_lighting;
+	Transparency_on = save_transparency;
+	per2_flag = save_per2;
+}
+
+// -------------------------------------------------------------------------------------
+void tmap_bin_flush(void)
+{
+	int	i;
+
+	if (!Tmap_bin_active || !Bin_num_cmds)
+		return;
+
+	worker_run(tmap_bin_draw_band, NULL, Bin_num_bands);
+
+	Bin_num_cmds = Bin_num_verts = Bin_num_pinned = 0;
+	for (i=0; i<Bin_num_bands; i++)
+		Bin_bands[i].num_cmds = 0;
+}
+
+// -------------------------------------------------------------------------------------
+void tmap_bin_end(void)
+{
+	tmap_bin_flush();
+	Tmap_bin_active = 0;
+}
+
+// -------------------------------------------------------------------------------------
+//	Make room for a polygon with nv vertices and return it, with the current clip window set.
+static tmap_bin_cmd *tmap_bin_new_cmd(int nv)
+{
+	tmap_bin_cmd	*cmd;
+
+	if (Bin_num_cmds >= Bin_max_cmds) {
+		Bin_max_cmds = Bin_max_cmds ? Bin_max_cmds * 2 : 1024;
+		Bin_cmds = d_realloc(Bin_cmds, Bin_max_cmds * sizeof(tmap_bin_cmd));
+	}
+	if (Bin_num_verts + nv > Bin_max_verts) {
+		Bin_max_verts = Bin_max_verts ? Bin_max_verts * 2 : 4096;
+		Bin_verts = d_realloc(Bin_verts, Bin_max_verts * sizeof(g3ds_vertex));
+	}
+
+	cmd = &Bin_cmds[Bin_num_cmds];
+	cmd->first_vert = Bin_num_verts;
+	cmd->nv = nv;
+	cmd->clip_left = Window_clip_left;
+	cmd->clip_top = Window_clip_top;
+	cmd->clip_right = Window_clip_right;
+	cmd->clip_bot = Window_clip_bot;
+
+	return cmd;
+}
+
+// -------------------------------------------------------------------------------------
+//	Queue the new polygon in the bands for rows top through bot.
+static void tmap_bin_add(int top, int bot)
+{
+	int	first, last, b;
+
+	if (top < 0)
+		top = 0;
+	if (bot > Bin_bands[Bin_num_bands-1].bot)
+		bot = Bin_bands[Bin_num_bands-1].bot;
+	if (top > bot)
+		return;
+
+	first = top / Bin_band_height;
+	last = bot / Bin_band_height;
+
+	for (b=first; b<=last; b++) {
+		tmap_bin_band *band = &Bin_bands[b];
+
+		if (band->num_cmds >= band->max_cmds) {
+			band->max_cmds = band->max_cmds ? band->max_cmds * 2 : 256;
+			band->cmds = d_realloc(band->cmds, band->max_cmds * sizeof(int));
+		}
+		band->cmds[band->num_cmds++] = Bin_num_cmds;
+	}
+
+	Bin_num_verts += Bin_cmds[Bin_num_cmds].nv;
+	Bin_num_cmds++;
+
+	if (Bin_num_cmds >= TMAP_BIN_MAX_CMDS)
+		tmap_bin_flush();
+}
+
+// -------------------------------------------------------------------------------------
+//	Rows the rasterizer can touch for a polygon.  Same as the computation in compute_y_bounds().
+static void tmap_bin_y_bounds(g3ds_vertex *v, int nv, int *top, int *bot)
+{
+	int	i;
+
+	*top = *bot = f2i(v[0].y2d);
+	for (i=1; i<nv; i++) {
+		int y = f2i(v[i].y2d);
+
+		if (y < *top)
+			*top = y;
+		if (y > *bot)
+			*bot = y;
+	}
+}
+
+// -------------------------------------------------------------------------------------
+void tmap_bin_add_tmap(grs_bitmap *bp, g3ds_tmap *t, int perspective)
+{
+	tmap_bin_cmd	*cmd;
+	int		top, bot;
+
+	tmap_bin_y_bounds(t->verts, t->nv, &top, &bot);
+	if (top > Window_clip_bot)
+		return;		// the rasterizer would not draw it either
+	if (bot > Window_clip_bot)
+		bot = Window_clip_bot;
+
+	cmd = tmap_bin_new_cmd(t->nv);
+	memcpy(&Bin_verts[cmd->first_vert], t->verts, t->nv * sizeof(g3ds_vertex));
+	cmd->bp = bp;
+	cmd->type = perspective ? TMAP_BIN_PERSPECTIVE : TMAP_BIN_LINEAR;
+	cmd->lighting = Lighting_enabled;
+	cmd->transparency = Transparency_on != 0;
+	cmd->per2 = per2_flag;
+
+	tmap_bin_add(top, bot);
+}
+
+// -------------------------------------------------------------------------------------
+//	vert is a list of x,y pairs as for gr_upoly_tmap().
+void tmap_bin_add_flat(int nverts, int *vert, int color, int fade_level)
+{
+	tmap_bin_cmd	*cmd;
+	g3ds_vertex	*v;
+	int		i, top, bot;
+
+	Assert(nverts <= MAX_TMAP_VERTS);
+
+	cmd = tmap_bin_new_cmd(nverts);
+	v = &Bin_verts[cmd->first_vert];
+	for (i=0; i<nverts; i++) {
+		v[i].x2d = *vert++;
+		v[i].y2d = *vert++;
+	}
+	cmd->bp = NULL;
+	cmd->type = TMAP_BIN_FLAT;
+	cmd->color = color;
+	cmd->fade_level = fade_level;
+
+	tmap_bin_y_bounds(v, nverts, &top, &bot);
+
+	tmap_bin_add(top, bot);
+}
+
+// -------------------------------------------------------------------------------------
+//	Called before bp is expanded for a queued polygon.  Once every rle cache slot holds a bitmap of a queued
+//	polygon, expanding another one would free one of those, so draw what is queued first.
+void tmap_bin_pin_rle(grs_bitmap *bp)
+{
+	int	i;
+
+	for (i=0; i<Bin_num_pinned; i++)
+		if (Bin_pinned_rle[i] == bp)
+			return;
+
+	if (Bin_num_pinned >= MAX_CACHE_BITMAPS)
+		tmap_bin_flush();
+
+	Bin_pinned_rle[Bin_num_pinned++] = bp;
+}
+
+#endif //!OGL
@@ -29,7 +29,7 @@ COPYRIGHT 1993-1998 PARALLAX SOFTWARE CORPORATION.  ALL RIGHTS RESERVED.
 
 #ifndef OGL
 
-void (*scanline_func)(int,fix,fix);
+TMAP_THREAD void (*scanline_func)(int,fix,fix);
 
 // -------------------------------------------------------------------------------------
 //	Texture map current scanline.
@@ -39,6 +39,8 @@ void tmap_scanline_flat(int y, fix xleft, fix xright)
 {
 	if (xright < xleft)
 		return;
+	if (y < Tmap_band_top || y > Tmap_band_bot)
+		return;
 
 	// setup to call assembler scanline renderer
 
@@ -46,10 +48,10 @@ void tmap_scanline_flat(int y, fix xleft, fix xright)
 	fx_xleft = xleft/F1_0;		// (xleft >> 16) != xleft/F1_0 for negative numbers, f2i caused random crashes
 	fx_xright = xright/F1_0;
 
-	if ( grd_curcanv->cv_fade_level >= GR_FADE_OFF )
+	if ( tmap_flat_fade_level >= GR_FADE_OFF )
 		cur_tmap_scanline_flat();
 	else	{
-		tmap_flat_shade_value = grd_curcanv->cv_fade_level;
+		tmap_flat_shade_value = tmap_flat_fade_level;
 		cur_tmap_scanline_shaded();
 	}	
 }
@@ -122,6 +124,9 @@ void texture_map_flat(g3ds_tmap *t, int color)
 
 	for (y = topy; y < boty; y++) {
 
+		if (y > Tmap_band_bot)
+			return;
+
 		// See if we have reached the end of the current left edge, and if so, set
 		// new values for dx_dy and x,u,v
 		if (y == f2i(v3d[vlb].y2d)) {
@@ -180,9 +185,24 @@ void texture_map_flat(g3ds_tmap *t, int color)
 //	(ie, avoids cracking) edge/delta computation.
 void gr_upoly_tmap(int nverts, int *vert )
 {
+	if (Tmap_bin_active) {
+		tmap_bin_add_flat(nverts, vert, COLOR, grd_curcanv->cv_fade_level);
+		return;
+	}
+
+	tmap_flat_fade_level = grd_curcanv->cv_fade_level;
 	gr_upoly_tmap_ylr(nverts, vert, tmap_scanline_flat);
 }
 
+//	-----------------------------------------------------------------------------------------
+//	Draw a flat shaded polygon queued by the tile binner.
+void texture_map_flat_faded(g3ds_tmap *t, int color, int fade_level)
+{
+	tmap_flat_fade_level = fade_level;
+	scanline_func = tmap_scanline_flat;
+	texture_map_flat(t, color);
+}
+
 #include "3d.h"
 #include "dxxerror.h"
 